@@ -1,422 +1,1536 @@
+#include "alloc_bench.h"
+#include "arena.h"
+#include "bench.h"
+#include "ciphers.h"
+#include "commitment.h"
+#include "commitment_bench.h"
+#include "container.h"
+#include "cpu_bench.h"
+#include "cpuinfo.h"
+#include "drbg_bench.h"
+#include "dudect_bench.h"
+#include "filebatch.h"
+#include "keysetup.h"
+#include "mapped_io.h"
+#include "messages.h"
+#include "metrics.h"
+#include "nodes.h"
+#include "parallel.h"
+#include "phases.h"
+#include "pipeline.h"
+#include "randpool.h"
+#include "segstream.h"
+#include "service.h"
+#include "service_bench.h"
+#include "stream.h"
+
 #include <openssl/evp.h>
-#include <openssl/hmac.h>
-#include <openssl/kdf.h>
 #include <openssl/err.h>
 #include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <fcntl.h>
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
 
-#define KEY_SIZE 32  // 256 bits for master key
-#define AES_KEY_SIZE 16  // 128 bits for AES
-#define HMAC_KEY_SIZE 32  // 256 bits for HMAC
-#define IV_SIZE 16  // 128 bits for IV
-#define NONCE_SIZE 12  // 96 bits for nonce (ChaCha20-Poly1305)
-#define HMAC_TAG_SIZE 32  // 256 bits for HMAC-SHA256 tag
-#define AEAD_TAG_SIZE 16  // 128 bits for GCM/Poly1305 authentication tag
-#define NUM_RUNS 5  // Number of repeated experiments
-
-void handle_crypto_error(void) {
-    ERR_print_errors_fp(stderr);
-    abort();
-}
+// How test_algorithm runs an algorithm; a NULL run_mode means the entry's
+// one-shot functions. fused_block needs ALGO_CAP_ETM, num_threads
+// ALGO_CAP_SEEKABLE.
+typedef struct {
+    int fused_block;  // > 0: single-pass fused variant with this block size
+    int num_threads;  // > 0: parallel engine (tree MAC) with this many threads
+    int in_place;     // encrypt and decrypt inside the plaintext buffer itself
+} run_mode;
 
-// Derive keys from master key using HKDF
-int derive_keys(unsigned char *master_key, const char *info, 
-                unsigned char *enc_key, int enc_key_len,
-                unsigned char *mac_key, int mac_key_len) {
-    EVP_PKEY_CTX *pctx;
-    unsigned char temp_buffer[64];  // Temporary buffer for derived material
-    size_t outlen = enc_key_len + mac_key_len;
+// Test function for a specific algorithm.
+// csv_prefix and avg_out are passed to report_statistics.
+void test_algorithm(const char *algo_name, int algo_type, 
+                    unsigned char *plaintext, int plaintext_len,
+                    unsigned char *master_key, FILE *results_file,
+                    const run_mode *mode, const char *csv_prefix, double *avg_out) {
+    int fused_block = mode ? mode->fused_block : 0;
+    int num_threads = mode ? mode->num_threads : 0;
+    int in_place = mode ? mode->in_place : 0;
+    const algo_desc *algo = algo_get(algo_type);
+    unsigned char enc_key[KEY_SIZE];
+    unsigned char mac_key[HMAC_KEY_SIZE];
+    unsigned char *ciphertext;
+    unsigned char *decryptedtext;
+    unsigned char iv[MAX_IV_SIZE];
+    unsigned char tag[HMAC_TAG_SIZE];  // Large enough for HMAC-SHA256 (32 bytes)
+    unsigned char plain_digest[EVP_MAX_MD_SIZE], decrypted_digest[EVP_MAX_MD_SIZE];
+    bench_mark start, end;
+    bench_samples enc_samples = {0}, dec_samples = {0};
+    int warmup = bench_settings.warmup_runs;
     
-    if (outlen > sizeof(temp_buffer)) {
-        fprintf(stderr, "Derived key material too large\n");
-        return 0;
-    }
+    printf("\n%s:\n", algo_name);
+    printf("Running %d warm-up + %d to %d experiments (target 95%% CI ±%.1f%%)...\n",
+           warmup, bench_settings.min_runs, bench_settings.max_runs, 100 * bench_settings.ci_target);
     
-    pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, NULL);
-    if (!pctx) handle_crypto_error();
+    // Allocate buffers. In place, all three names alias the plaintext buffer
+    // (no mode here pads), which is left as it was after each round trip; the
+    // check then compares SHA-256 digests since no copy of the input is kept.
+    if (in_place) {
+        ciphertext = decryptedtext = plaintext;
+        if (1 != EVP_Digest(plaintext, plaintext_len, plain_digest, NULL, EVP_sha256(), NULL)) handle_crypto_error();
+    } else {
+        ciphertext = (unsigned char *)arena_alloc(plaintext_len + EVP_MAX_BLOCK_LENGTH);
+        decryptedtext = (unsigned char *)arena_alloc(plaintext_len + EVP_MAX_BLOCK_LENGTH);
+        
+        if (!ciphertext || !decryptedtext) {
+            perror("Memory allocation failed");
+            arena_free(ciphertext);
+            arena_free(decryptedtext);
+            return;
+        }
+    }
     
-    if (EVP_PKEY_derive_init(pctx) <= 0) handle_crypto_error();
-    if (EVP_PKEY_CTX_set_hkdf_md(pctx, EVP_sha256()) <= 0) handle_crypto_error();
-    if (EVP_PKEY_CTX_set1_hkdf_key(pctx, master_key, KEY_SIZE) <= 0) handle_crypto_error();
-    if (EVP_PKEY_CTX_add1_hkdf_info(pctx, (unsigned char *)info, strlen(info)) <= 0) handle_crypto_error();
+    // Derive keys for this algorithm
+    derive_algo_keys(master_key, algo_name, algo_type, enc_key, mac_key);
     
-    if (EVP_PKEY_derive(pctx, temp_buffer, &outlen) <= 0) handle_crypto_error();
+    // Warm-up rounds first (page faults, frequency ramp-up), then timed ones
+    // until both series converge
+    for (int run = 0; run < warmup + bench_settings.max_runs; run++) {
+        int measured = run - warmup;  // Negative during warm-up
+        int ciphertext_len, decryptedtext_len;
+        
+        // Generate random IV/nonce for each run
+        rand_pool_bytes(iv, algo->iv_len);
+        
+        // Encryption
+        bench_mark_now(&start);
+        if (num_threads > 0) {
+            ciphertext_len = parallel_etm_encrypt(algo_type, plaintext, plaintext_len, enc_key, mac_key, iv, ciphertext, tag, num_threads);
+        } else if (fused_block > 0) {
+            ciphertext_len = algo->encrypt_fused(plaintext, plaintext_len, enc_key, mac_key, iv, ciphertext, tag, fused_block);
+        } else {
+            ciphertext_len = algo->encrypt(algo_type, plaintext, plaintext_len, enc_key, mac_key, iv, ciphertext, tag);
+        }
+        bench_mark_now(&end);
+        if (measured >= 0) bench_record(&enc_samples, &start, &end);
+        metrics_count(plaintext_len, elapsed_ns(&start.ts, &end.ts));
+        
+        // Decryption
+        bench_mark_now(&start);
+        if (num_threads > 0) {
+            decryptedtext_len = parallel_etm_decrypt(algo_type, ciphertext, ciphertext_len, enc_key, mac_key, iv, tag, decryptedtext, num_threads);
+        } else if (fused_block > 0) {
+            decryptedtext_len = algo->decrypt_fused(ciphertext, ciphertext_len, enc_key, mac_key, iv, tag, decryptedtext, fused_block);
+        } else {
+            decryptedtext_len = algo->decrypt(algo_type, ciphertext, ciphertext_len, enc_key, mac_key, iv, tag, decryptedtext);
+        }
+        bench_mark_now(&end);
+        if (measured >= 0) bench_record(&dec_samples, &start, &end);
+        metrics_count(plaintext_len, elapsed_ns(&start.ts, &end.ts));
+        
+        // Verify correctness
+        if (in_place && decryptedtext_len == plaintext_len) {
+            if (1 != EVP_Digest(decryptedtext, plaintext_len, decrypted_digest, NULL, EVP_sha256(), NULL)) handle_crypto_error();
+        }
+        if (decryptedtext_len != plaintext_len ||
+            (in_place ? memcmp(plain_digest, decrypted_digest, 32) != 0
+                      : memcmp(plaintext, decryptedtext, plaintext_len) != 0)) {
+            if (measured < 0) {
+                metrics_emit("warmup_failed", algo_name, "  Warm-up %lld: Verification FAILED!\n", 1,
+                             (long long)run + 1);
+            } else {
+                metrics_emit("run_failed", algo_name, "  Run %lld: Verification FAILED!\n", 1,
+                             (long long)measured + 1);
+            }
+            if (in_place) break;  // The buffer no longer holds the plaintext
+        } else if (measured >= 0) {
+            metrics_emit("run", algo_name, "  Run %lld: Encryption=%lld μs, Decryption=%lld μs [OK]\n", 3,
+                         (long long)measured + 1, (long long)enc_samples.us[measured],
+                         (long long)dec_samples.us[measured]);
+        }
+        if (measured >= 0 && bench_converged(&enc_samples) && bench_converged(&dec_samples)) break;
+    }
     
-    memcpy(enc_key, temp_buffer, enc_key_len);
-    memcpy(mac_key, temp_buffer + enc_key_len, mac_key_len);
+    // The run lines come out of the formatter thread, ahead of the summary
+    metrics_flush();
+    report_statistics(algo_name, &enc_samples, &dec_samples, plaintext_len, csv_prefix, results_file, avg_out);
     
-    EVP_PKEY_CTX_free(pctx);
-    return 1;
+    if (!in_place) {
+        arena_free(ciphertext);
+        arena_free(decryptedtext);
+    }
 }
 
-// Load file content into memory
-int load_file_content(const char *filepath, unsigned char **buffer) {
-    FILE *fp = fopen(filepath, "rb");
-    if (!fp) {
-        perror("Cannot open file");
-        return -1;
-    }
+// Streaming variant of test_algorithm: the file is never loaded in memory,
+// ciphertext goes to a temporary file and is decrypted back from it
+void test_algorithm_stream(const char *algo_name, int algo_type, const char *test_file,
+                           size_t chunk_size, unsigned char *master_key, FILE *results_file) {
+    unsigned char enc_key[KEY_SIZE];
+    unsigned char mac_key[HMAC_KEY_SIZE];
+    unsigned char iv[MAX_IV_SIZE];
+    unsigned char tag[HMAC_TAG_SIZE];
+    unsigned char plain_digest[EVP_MAX_MD_SIZE], decrypted_digest[EVP_MAX_MD_SIZE];
+    bench_mark start, end;
+    bench_samples enc_samples = {0}, dec_samples = {0};
+    long long file_len = 0;
+    char chunk_column[32];
+    int warmup = bench_settings.warmup_runs, verify = 0;
     
-    struct stat file_info;
-    if (stat(filepath, &file_info) != 0) {
-        perror("Cannot get file size");
-        fclose(fp);
-        return -1;
-    }
+    printf("\n%s (chunk size %zu bytes):\n", algo_name, chunk_size);
+    printf("Running %d warm-up + %d to %d experiments (target 95%% CI ±%.1f%%)...\n",
+           warmup, bench_settings.min_runs, bench_settings.max_runs, 100 * bench_settings.ci_target);
     
-    int size = file_info.st_size;
-    *buffer = (unsigned char *)malloc(size);
-    if (!*buffer) {
-        perror("Memory allocation failed");
-        fclose(fp);
-        return -1;
-    }
+    derive_algo_keys(master_key, algo_name, algo_type, enc_key, mac_key);
     
-    if (fread(*buffer, 1, size, fp) != size) {
-        perror("Error reading file");
-        free(*buffer);
-        fclose(fp);
-        return -1;
+    // Warm-up and timed round trips as in test_algorithm, then one untimed
+    // round that hashes the plaintext on both sides to check correctness
+    // with bounded memory
+    for (int run = 0; ; run++) {
+        int measured = verify ? -1 : run - warmup;  // Negative when not timed
+        long long encrypted_len, decrypted_len = -1;
+        FILE *in, *ct;
+        
+        rand_pool_bytes(iv, algo_iv_len(algo_type));
+        
+        in = fopen(test_file, "rb");
+        ct = tmpfile();
+        if (!in || !ct) {
+            perror("Cannot open stream files");
+            if (in) fclose(in);
+            if (ct) fclose(ct);
+            return;
+        }
+        
+        // Encryption (input file -> temporary ciphertext file)
+        bench_mark_now(&start);
+        encrypted_len = stream_encrypt_file(algo_type, in, ct, chunk_size, enc_key, mac_key,
+                                            iv, tag, verify ? plain_digest : NULL);
+        fflush(ct);
+        bench_mark_now(&end);
+        fclose(in);
+        if (measured >= 0) bench_record(&enc_samples, &start, &end);
+        if (encrypted_len >= 0) metrics_count(encrypted_len, elapsed_ns(&start.ts, &end.ts));
+        file_len = encrypted_len;
+        
+        // Decryption (temporary ciphertext file -> discarded)
+        rewind(ct);
+        bench_mark_now(&start);
+        if (encrypted_len >= 0) {
+            decrypted_len = stream_decrypt_file(algo_type, ct, NULL, chunk_size, enc_key, mac_key,
+                                                iv, tag, verify ? decrypted_digest : NULL);
+        }
+        bench_mark_now(&end);
+        fclose(ct);
+        if (measured >= 0) bench_record(&dec_samples, &start, &end);
+        if (decrypted_len >= 0) metrics_count(decrypted_len, elapsed_ns(&start.ts, &end.ts));
+        
+        if (encrypted_len < 0 || decrypted_len != encrypted_len) {
+            if (verify) {
+                metrics_emit("check_failed", algo_name, "  Check: round trip failed, Verification FAILED!\n", 0);
+            } else if (measured < 0) {
+                metrics_emit("warmup_failed", algo_name, "  Warm-up %lld: Verification FAILED!\n", 1,
+                             (long long)run + 1);
+            } else {
+                metrics_emit("run_failed", algo_name, "  Run %lld: Verification FAILED!\n", 1,
+                             (long long)measured + 1);
+            }
+        } else if (verify) {
+            metrics_flush();
+            if (memcmp(plain_digest, decrypted_digest, 32) != 0) {
+                printf("  Check: SHA-256 of decrypted stream differs, Verification FAILED!\n");
+            } else {
+                printf("  Check: SHA-256 of decrypted stream matches plaintext [OK]\n");
+            }
+        } else if (measured >= 0) {
+            metrics_emit("run", algo_name, "  Run %lld: Encryption=%lld μs, Decryption=%lld μs\n", 3,
+                         (long long)measured + 1, (long long)enc_samples.us[measured],
+                         (long long)dec_samples.us[measured]);
+        }
+        if (verify) break;
+        if (run + 1 >= warmup + bench_settings.max_runs ||
+            (measured >= 0 && bench_converged(&enc_samples) && bench_converged(&dec_samples))) verify = 1;
     }
     
-    fclose(fp);
-    return size;
+    metrics_flush();
+    snprintf(chunk_column, sizeof(chunk_column), "%zu", chunk_size);
+    report_statistics(algo_name, &enc_samples, &dec_samples, file_len > 0 ? file_len : 0,
+                      chunk_column, results_file, NULL);
 }
 
-// AES-128-CTR + HMAC (Encrypt-then-MAC)
-int aes_ctr_hmac_encrypt(unsigned char *plaintext, int plaintext_len,
-                         unsigned char *enc_key, unsigned char *mac_key,
-                         unsigned char *iv, unsigned char *ciphertext,
-                         unsigned char *tag) {
-    EVP_CIPHER_CTX *ctx;
-    int len, ciphertext_len;
-    unsigned int mac_len;
-    
-    // Encrypt with AES-128-CTR
-    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
-    if (1 != EVP_EncryptInit_ex(ctx, EVP_aes_128_ctr(), NULL, enc_key, iv)) handle_crypto_error();
-    if (1 != EVP_EncryptUpdate(ctx, ciphertext, &len, plaintext, plaintext_len)) handle_crypto_error();
-    ciphertext_len = len;
-    if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + len, &len)) handle_crypto_error();
-    ciphertext_len += len;
-    EVP_CIPHER_CTX_free(ctx);
-    
-    // Compute HMAC over ciphertext
-    if (!HMAC(EVP_sha256(), mac_key, HMAC_KEY_SIZE, ciphertext, ciphertext_len, tag, &mac_len)) {
-        handle_crypto_error();
-    }
-    
-    return ciphertext_len;
-}
-
-int aes_ctr_hmac_decrypt(unsigned char *ciphertext, int ciphertext_len,
-                         unsigned char *enc_key, unsigned char *mac_key,
-                         unsigned char *iv, unsigned char *tag,
-                         unsigned char *plaintext) {
-    unsigned char computed_tag[EVP_MAX_MD_SIZE];
-    unsigned int mac_len;
-    EVP_CIPHER_CTX *ctx;
-    int len, plaintext_len;
+// Run every streaming-capable algorithm for every requested chunk size
+int run_stream_tests(const char *test_file, size_t *chunk_sizes, int num_chunk_sizes,
+                     unsigned char *master_key) {
+    char results_filename[256];
+    FILE *results_file;
     
-    // Verify HMAC
-    if (!HMAC(EVP_sha256(), mac_key, HMAC_KEY_SIZE, ciphertext, ciphertext_len, computed_tag, &mac_len)) {
-        handle_crypto_error();
-    }
+    results_file = open_results_file("stream_", test_file,
+                                     "Algorithm,Chunk_Bytes,Avg_Encryption_us,Avg_Decryption_us,Min_Enc_us,Max_Enc_us,Min_Dec_us,Max_Dec_us,"
+                                     BENCH_CSV_COLUMNS,
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) return 1;
+    
+    printf("\n=================================================================\n");
+    printf("  Starting Streaming Tests on %s (%d-%d runs per algorithm)\n", test_file,
+           bench_settings.min_runs, bench_settings.max_runs);
+    printf("  Timings include file I/O; the input is never fully loaded\n");
+    printf("=================================================================\n");
     
-    if (memcmp(tag, computed_tag, HMAC_TAG_SIZE) != 0) {
-        fprintf(stderr, "HMAC verification failed!\n");
-        return -1;
+    for (int c = 0; c < num_chunk_sizes; c++) {
+        for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+            if (!algo_has(algo_type, ALGO_CAP_STREAMING)) continue;
+            test_algorithm_stream(algo_name(algo_type), algo_type, test_file,
+                                  chunk_sizes[c], master_key, results_file);
+            printf("\n-----------------------------------------------------------------\n");
+        }
     }
     
-    // Decrypt with AES-128-CTR
-    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
-    if (1 != EVP_DecryptInit_ex(ctx, EVP_aes_128_ctr(), NULL, enc_key, iv)) handle_crypto_error();
-    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len)) handle_crypto_error();
-    plaintext_len = len;
-    if (1 != EVP_DecryptFinal_ex(ctx, plaintext + len, &len)) handle_crypto_error();
-    plaintext_len += len;
-    EVP_CIPHER_CTX_free(ctx);
+    printf("\n✓ Streaming tests completed (peak RSS: %.2f MB)\n", peak_rss_mb());
+    printf("✓ Results saved to %s\n\n", results_filename);
     
-    return plaintext_len;
-}
-
-// ChaCha20 + HMAC (Encrypt-then-MAC)
-int chacha20_hmac_encrypt(unsigned char *plaintext, int plaintext_len,
-                          unsigned char *enc_key, unsigned char *mac_key,
-                          unsigned char *iv, unsigned char *ciphertext,
-                          unsigned char *tag) {
-    EVP_CIPHER_CTX *ctx;
-    int len, ciphertext_len;
-    unsigned int mac_len;
-    
-    // Encrypt with ChaCha20
-    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
-    if (1 != EVP_EncryptInit_ex(ctx, EVP_chacha20(), NULL, enc_key, iv)) handle_crypto_error();
-    if (1 != EVP_EncryptUpdate(ctx, ciphertext, &len, plaintext, plaintext_len)) handle_crypto_error();
-    ciphertext_len = len;
-    if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + len, &len)) handle_crypto_error();
-    ciphertext_len += len;
-    EVP_CIPHER_CTX_free(ctx);
-    
-    // Compute HMAC over ciphertext
-    if (!HMAC(EVP_sha256(), mac_key, HMAC_KEY_SIZE, ciphertext, ciphertext_len, tag, &mac_len)) {
-        handle_crypto_error();
-    }
-    
-    return ciphertext_len;
+    fclose(results_file);
+    return 0;
 }
 
-int chacha20_hmac_decrypt(unsigned char *ciphertext, int ciphertext_len,
-                          unsigned char *enc_key, unsigned char *mac_key,
-                          unsigned char *iv, unsigned char *tag,
-                          unsigned char *plaintext) {
-    unsigned char computed_tag[EVP_MAX_MD_SIZE];
-    unsigned int mac_len;
-    EVP_CIPHER_CTX *ctx;
-    int len, plaintext_len;
+// Compare the two-pass and fused Encrypt-then-MAC paths for every block size
+int run_fused_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                    size_t *block_sizes, int num_block_sizes, unsigned char *master_key) {
+    char results_filename[256];
+    char mode_column[32];
+    FILE *results_file;
+    double two_pass[NUM_ALGOS + 1][2];
+    double fused[MAX_SWEEP][NUM_ALGOS + 1][2];
     
-    // Verify HMAC
-    if (!HMAC(EVP_sha256(), mac_key, HMAC_KEY_SIZE, ciphertext, ciphertext_len, computed_tag, &mac_len)) {
-        handle_crypto_error();
-    }
+    results_file = open_results_file("fused_", test_file,
+                                     "Algorithm,Mode,Block_Bytes,Avg_Encryption_us,Avg_Decryption_us,Min_Enc_us,Max_Enc_us,Min_Dec_us,Max_Dec_us,"
+                                     BENCH_CSV_COLUMNS,
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) return 1;
+    
+    printf("\n=================================================================\n");
+    printf("  Two-pass vs fused Encrypt-then-MAC (%d-%d runs per algorithm)\n",
+           bench_settings.min_runs, bench_settings.max_runs);
+    printf("=================================================================\n");
     
-    if (memcmp(tag, computed_tag, HMAC_TAG_SIZE) != 0) {
-        fprintf(stderr, "HMAC verification failed!\n");
-        return -1;
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        if (!algo_has(algo_type, ALGO_CAP_ETM)) continue;
+        test_algorithm(algo_name(algo_type), algo_type, plaintext, plaintext_len, master_key,
+                       results_file, NULL, "two-pass,0", two_pass[algo_type]);
+        printf("\n-----------------------------------------------------------------\n");
+        
+        for (int b = 0; b < num_block_sizes; b++) {
+            run_mode mode = { .fused_block = (int)block_sizes[b] };
+            printf("\n[fused, %zu-byte blocks]", block_sizes[b]);
+            snprintf(mode_column, sizeof(mode_column), "fused,%zu", block_sizes[b]);
+            test_algorithm(algo_name(algo_type), algo_type, plaintext, plaintext_len, master_key,
+                           results_file, &mode, mode_column, fused[b][algo_type]);
+            printf("\n-----------------------------------------------------------------\n");
+        }
     }
     
-    // Decrypt with ChaCha20
-    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
-    if (1 != EVP_DecryptInit_ex(ctx, EVP_chacha20(), NULL, enc_key, iv)) handle_crypto_error();
-    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len)) handle_crypto_error();
-    plaintext_len = len;
-    if (1 != EVP_DecryptFinal_ex(ctx, plaintext + len, &len)) handle_crypto_error();
-    plaintext_len += len;
-    EVP_CIPHER_CTX_free(ctx);
+    printf("\n  %-28s %-10s %14s %14s %9s %9s\n",
+           "Algorithm", "Block", "Avg Enc (μs)", "Avg Dec (μs)", "Enc x", "Dec x");
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        if (!algo_has(algo_type, ALGO_CAP_ETM)) continue;
+        printf("  %-28s %-10s %14.2f %14.2f %9s %9s\n", algo_name(algo_type), "two-pass",
+               two_pass[algo_type][0], two_pass[algo_type][1], "1.00", "1.00");
+        for (int b = 0; b < num_block_sizes; b++) {
+            printf("  %-28s %-10zu %14.2f %14.2f %9.2f %9.2f\n", "", block_sizes[b],
+                   fused[b][algo_type][0], fused[b][algo_type][1],
+                   two_pass[algo_type][0] / fused[b][algo_type][0],
+                   two_pass[algo_type][1] / fused[b][algo_type][1]);
+        }
+    }
     
-    return plaintext_len;
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    return 0;
 }
 
-// AES-128-GCM (Authenticated Encryption)
-int aes_gcm_encrypt(unsigned char *plaintext, int plaintext_len,
-                    unsigned char *key, unsigned char *iv,
-                    unsigned char *ciphertext, unsigned char *tag) {
-    EVP_CIPHER_CTX *ctx;
-    int len, ciphertext_len;
-    
-    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
-    if (1 != EVP_EncryptInit_ex(ctx, EVP_aes_128_gcm(), NULL, NULL, NULL)) handle_crypto_error();
-    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, IV_SIZE, NULL)) handle_crypto_error();
-    if (1 != EVP_EncryptInit_ex(ctx, NULL, NULL, key, iv)) handle_crypto_error();
-    if (1 != EVP_EncryptUpdate(ctx, ciphertext, &len, plaintext, plaintext_len)) handle_crypto_error();
-    ciphertext_len = len;
-    if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + len, &len)) handle_crypto_error();
-    ciphertext_len += len;
-    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
-    EVP_CIPHER_CTX_free(ctx);
-    
-    return ciphertext_len;
+// Throughput scaling by thread count for the seekable keystream modes
+int run_parallel_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                       int *thread_counts, int num_thread_counts, unsigned char *master_key) {
+    char results_filename[256];
+    char threads_column[16];
+    FILE *results_file;
+    double avg[2];
+    
+    results_file = open_results_file("threads_", test_file,
+                                     "Algorithm,Threads,Avg_Encryption_us,Avg_Decryption_us,Min_Enc_us,Max_Enc_us,Min_Dec_us,Max_Dec_us,"
+                                     BENCH_CSV_COLUMNS,
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) return 1;
+    
+    printf("\n=================================================================\n");
+    printf("  Parallel CTR/ChaCha20 engine with tree HMAC (%d-%d runs per count)\n",
+           bench_settings.min_runs, bench_settings.max_runs);
+    printf("=================================================================\n");
+    
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        double base_enc = 0;
+        
+        if (!algo_has(algo_type, ALGO_CAP_SEEKABLE)) continue;
+        
+        for (int t = 0; t < num_thread_counts; t++) {
+            run_mode mode = { .num_threads = thread_counts[t] };
+            printf("\n[%d thread%s]", thread_counts[t], thread_counts[t] == 1 ? "" : "s");
+            snprintf(threads_column, sizeof(threads_column), "%d", thread_counts[t]);
+            test_algorithm(algo_name(algo_type), algo_type, plaintext, plaintext_len, master_key,
+                           results_file, &mode, threads_column, avg);
+            if (t == 0) base_enc = avg[0];
+            printf("    Throughput: %.1f MB/s, speedup vs %d thread%s: %.2fx\n",
+                   plaintext_len / avg[0], thread_counts[0], thread_counts[0] == 1 ? "" : "s",
+                   base_enc / avg[0]);
+            printf("\n-----------------------------------------------------------------\n");
+        }
+    }
+    
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    return 0;
 }
 
-int aes_gcm_decrypt(unsigned char *ciphertext, int ciphertext_len,
-                    unsigned char *key, unsigned char *iv,
-                    unsigned char *tag, unsigned char *plaintext) {
-    EVP_CIPHER_CTX *ctx;
-    int len, plaintext_len, ret;
-    
-    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
-    if (1 != EVP_DecryptInit_ex(ctx, EVP_aes_128_gcm(), NULL, NULL, NULL)) handle_crypto_error();
-    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, IV_SIZE, NULL)) handle_crypto_error();
-    if (1 != EVP_DecryptInit_ex(ctx, NULL, NULL, key, iv)) handle_crypto_error();
-    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len)) handle_crypto_error();
-    plaintext_len = len;
-    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
-    ret = EVP_DecryptFinal_ex(ctx, plaintext + len, &len);
-    EVP_CIPHER_CTX_free(ctx);
-    
-    if (ret > 0) {
-        plaintext_len += len;
-        return plaintext_len;
-    } else {
-        fprintf(stderr, "GCM tag verification failed!\n");
-        return -1;
+// NUMA placement of the parallel engine's buffers, threads pinned per node
+// in every mode: all pages on the first node (what malloc + first touch by
+// the main thread gives), interleaved over the nodes, or each worker's
+// input and output slices on the worker's own node
+int run_numa_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                   int *thread_counts, int num_thread_counts, unsigned char *master_key) {
+    const char *placement_names[3] = {"first-node", "interleave", "local"};
+    size_t buffer_len = plaintext_len + EVP_MAX_BLOCK_LENGTH;
+    unsigned char *input, *ciphertext, *decryptedtext;
+    char results_filename[256];
+    FILE *results_file;
+    node_topology topo;
+    
+    node_topology_read(&topo);
+    input = arena_alloc_kind(ARENA_ALIGNED, buffer_len);
+    ciphertext = arena_alloc_kind(ARENA_ALIGNED, buffer_len);
+    decryptedtext = arena_alloc_kind(ARENA_ALIGNED, buffer_len);
+    results_file = open_results_file("numa_", test_file,
+                                     "Algorithm,Placement,Threads,Node,Node_Threads,Local_Pages_pct,"
+                                     "Node_Enc_MB_per_s,Node_Dec_MB_per_s,Avg_Encryption_us,Avg_Decryption_us,"
+                                     "Enc_MB_per_s,Dec_MB_per_s,Runs,Median_Enc_us,P99_Enc_us,Median_Dec_us,P99_Dec_us",
+                                     results_filename, sizeof(results_filename));
+    if (!input || !ciphertext || !decryptedtext || !results_file) {
+        if (results_file) fclose(results_file);
+        arena_free(input);
+        arena_free(ciphertext);
+        arena_free(decryptedtext);
+        return 1;
+    }
+    memcpy(input, plaintext, plaintext_len);
+    
+    printf("\n=================================================================\n");
+    printf("  NUMA placement for the parallel engine (%d warm-up + %d-%d runs each)\n",
+           bench_settings.warmup_runs, bench_settings.min_runs, bench_settings.max_runs);
+    printf("  %d node%s:", topo.count, topo.count == 1 ? "" : "s");
+    for (int n = 0; n < topo.count; n++) printf(" node%d (%d CPUs)", topo.id[n], topo.num_cpus[n]);
+    printf("\n");
+    if (topo.count == 1) printf("  Single node: the placements only differ on multi-socket machines\n");
+    printf("=================================================================\n");
+    
+    parallel_set_placement(&topo);
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        unsigned char enc_key[KEY_SIZE];
+        unsigned char mac_key[HMAC_KEY_SIZE];
+        
+        if (!algo_has(algo_type, ALGO_CAP_SEEKABLE)) continue;
+        derive_algo_keys(master_key, algo_name(algo_type), algo_type, enc_key, mac_key);
+        printf("\n%s:\n", algo_name(algo_type));
+        printf("  %-11s %7s %6s %7s %8s %13s %13s\n", "Placement", "Threads", "Node", "Threads",
+               "Local %", "Enc MB/s", "Dec MB/s");
+        
+        for (int t = 0; t < num_thread_counts; t++) {
+            int threads = thread_counts[t];
+            
+            for (int placement = 0; placement < 3; placement++) {
+                unsigned char *buffers[3] = {input, ciphertext, decryptedtext};
+                parallel_node_stats enc_nodes = {0}, dec_nodes = {0};
+                bench_samples enc_samples = {0}, dec_samples = {0};
+                bench_summary enc_sum, dec_sum;
+                int ok = 1, placed = 0;
+                
+                for (int b = 0; b < 3; b++) {
+                    if (placement == 0) {
+                        placed |= node_bind(&topo, buffers[b], buffer_len, 0);
+                    } else if (placement == 1) {
+                        placed |= node_interleave(&topo, buffers[b], buffer_len);
+                    } else {
+                        for (int w = 0; w < threads; w++) {
+                            size_t offset, len;
+                            parallel_slice(plaintext_len, w, threads, &offset, &len);
+                            placed |= node_bind(&topo, buffers[b] + offset, len,
+                                                parallel_worker_node(w, threads, topo.count));
+                        }
+                    }
+                }
+                if (placed != 0) perror("  mbind (placement not applied)");
+                
+                // Warm-up rounds, then timed ones until both series converge;
+                // the per-node statistics cover the timed rounds only
+                for (int run = 0; run < bench_settings.warmup_runs + bench_settings.max_runs && ok; run++) {
+                    int measured = run - bench_settings.warmup_runs;
+                    unsigned char iv[MAX_IV_SIZE];
+                    unsigned char tag[HMAC_TAG_SIZE];
+                    parallel_node_stats stats;
+                    bench_mark t0, t1, t2, t3;
+                    int dec_len;
+                    
+                    rand_pool_bytes(iv, algo_iv_len(algo_type));
+                    bench_mark_now(&t0);
+                    parallel_etm_encrypt(algo_type, input, plaintext_len, enc_key, mac_key, iv, ciphertext,
+                                         tag, threads);
+                    bench_mark_now(&t1);
+                    parallel_get_node_stats(&stats);
+                    for (int n = 0; n < topo.count && measured >= 0; n++) {
+                        enc_nodes.threads[n] = stats.threads[n];
+                        enc_nodes.bytes[n] += stats.bytes[n];
+                        enc_nodes.busy_us[n] += stats.busy_us[n];
+                    }
+                    // Timed like the encrypt: the call alone, checked afterwards
+                    bench_mark_now(&t2);
+                    dec_len = parallel_etm_decrypt(algo_type, ciphertext, plaintext_len, enc_key, mac_key, iv, tag,
+                                                   decryptedtext, threads);
+                    bench_mark_now(&t3);
+                    ok = dec_len == plaintext_len && memcmp(input, decryptedtext, plaintext_len) == 0;
+                    parallel_get_node_stats(&stats);
+                    if (measured < 0) continue;
+                    for (int n = 0; n < topo.count; n++) {
+                        dec_nodes.bytes[n] += stats.bytes[n];
+                        dec_nodes.busy_us[n] += stats.busy_us[n];
+                    }
+                    bench_record(&enc_samples, &t0, &t1);
+                    bench_record(&dec_samples, &t2, &t3);
+                    if (bench_converged(&enc_samples) && bench_converged(&dec_samples)) break;
+                }
+                if (!ok) {
+                    printf("  %-11s %7d  Verification FAILED!\n", placement_names[placement], threads);
+                    continue;
+                }
+                
+                bench_summarize(&enc_samples, plaintext_len, &enc_sum);
+                bench_summarize(&dec_samples, plaintext_len, &dec_sum);
+                double avg_enc = enc_sum.avg, avg_dec = dec_sum.avg;
+                printf("  %-11s %7d %6s %7s %8s %13.1f %13.1f [OK] %d runs, p99 enc %ld dec %ld μs\n",
+                       placement_names[placement], threads, "all", "", "", plaintext_len / avg_enc,
+                       plaintext_len / avg_dec, enc_samples.n, enc_sum.p99, dec_sum.p99);
+                for (int n = 0; n < topo.count; n++) {
+                    double local = -1, node_enc, node_dec;
+                    size_t local_bytes = 0, offset, len;
+                    
+                    if (enc_nodes.threads[n] == 0) continue;
+                    // Local share over this node's slices of the input
+                    for (int w = 0; w < threads; w++) {
+                        if (parallel_worker_node(w, threads, topo.count) != n) continue;
+                        parallel_slice(plaintext_len, w, threads, &offset, &len);
+                        double share = node_local_share(&topo, input + offset, len, n);
+                        if (share >= 0) {
+                            local = (local < 0 ? 0 : local) + share * len;
+                            local_bytes += len;
+                        }
+                    }
+                    if (local_bytes) local = 100.0 * local / local_bytes;
+                    node_enc = enc_nodes.busy_us[n] > 0 ? enc_nodes.bytes[n] / enc_nodes.busy_us[n] : 0;
+                    node_dec = dec_nodes.busy_us[n] > 0 ? dec_nodes.bytes[n] / dec_nodes.busy_us[n] : 0;
+                    printf("  %-11s %7s %6d %7d %7.1f%% %13.1f %13.1f\n", "", "", topo.id[n],
+                           enc_nodes.threads[n], local, node_enc, node_dec);
+                    fprintf(results_file, "%s,%s,%d,%d,%d,%.1f,%.1f,%.1f,%.2f,%.2f,%.1f,%.1f,%d,%ld,%ld,%ld,%ld\n",
+                            algo_name(algo_type), placement_names[placement], threads, topo.id[n],
+                            enc_nodes.threads[n], local, node_enc, node_dec, avg_enc, avg_dec,
+                            plaintext_len / avg_enc, plaintext_len / avg_dec, enc_samples.n,
+                            enc_sum.median, enc_sum.p99, dec_sum.median, dec_sum.p99);
+                }
+            }
+        }
     }
+    parallel_set_placement(NULL);
+    
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    arena_free(input);
+    arena_free(ciphertext);
+    arena_free(decryptedtext);
+    return 0;
 }
 
-// ChaCha20-Poly1305 (Authenticated Encryption)
-int chacha20_poly1305_encrypt(unsigned char *plaintext, int plaintext_len,
-                               unsigned char *key, unsigned char *nonce,
-                               unsigned char *ciphertext, unsigned char *tag) {
-    EVP_CIPHER_CTX *ctx;
-    int len, ciphertext_len;
-    
-    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
-    if (1 != EVP_EncryptInit_ex(ctx, EVP_chacha20_poly1305(), NULL, NULL, NULL)) handle_crypto_error();
-    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, NONCE_SIZE, NULL)) handle_crypto_error();
-    if (1 != EVP_EncryptInit_ex(ctx, NULL, NULL, key, nonce)) handle_crypto_error();
-    if (1 != EVP_EncryptUpdate(ctx, ciphertext, &len, plaintext, plaintext_len)) handle_crypto_error();
-    ciphertext_len = len;
-    if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + len, &len)) handle_crypto_error();
-    ciphertext_len += len;
-    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
-    EVP_CIPHER_CTX_free(ctx);
-    
-    return ciphertext_len;
+// Out-of-place vs in-place round trips: three buffers (plaintext, ciphertext,
+// decrypted copy) against one. In-place runs first so the peak RSS sampled
+// after it is not inflated by the out-of-place buffers.
+int run_inplace_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                      unsigned char *master_key) {
+    const char *mode_names[2] = {"in-place", "out-of-place"};
+    double buffer_mb[2], rss_mb[2];
+    double avg[2][NUM_ALGOS + 1][2];
+    char results_filename[256];
+    char mode_column[48];
+    FILE *results_file;
+    
+    results_file = open_results_file("inplace_", test_file,
+                                     "Algorithm,Mode,Buffer_MB,Avg_Encryption_us,Avg_Decryption_us,Min_Enc_us,Max_Enc_us,Min_Dec_us,Max_Dec_us,"
+                                     BENCH_CSV_COLUMNS,
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) return 1;
+    
+    buffer_mb[0] = plaintext_len / (1024.0 * 1024.0);
+    buffer_mb[1] = (plaintext_len + 2.0 * (plaintext_len + EVP_MAX_BLOCK_LENGTH)) / (1024.0 * 1024.0);
+    
+    printf("\n=================================================================\n");
+    printf("  In-place vs out-of-place encryption (%d-%d runs per algorithm)\n",
+           bench_settings.min_runs, bench_settings.max_runs);
+    printf("=================================================================\n");
+    
+    for (int m = 0; m < 2; m++) {
+        run_mode mode = { .in_place = (m == 0) };
+        snprintf(mode_column, sizeof(mode_column), "%s,%.2f", mode_names[m], buffer_mb[m]);
+        for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+            if (!algo_available(algo_type)) continue;
+            printf("\n[%s]", mode_names[m]);
+            test_algorithm(algo_name(algo_type), algo_type, plaintext, plaintext_len, master_key,
+                           results_file, &mode, mode_column, avg[m][algo_type]);
+            printf("\n-----------------------------------------------------------------\n");
+        }
+        rss_mb[m] = peak_rss_mb();
+    }
+    
+    printf("\n  %-14s %14s %16s\n", "Mode", "Buffers (MB)", "Peak RSS (MB)");
+    for (int m = 0; m < 2; m++) {
+        printf("  %-14s %14.2f %16.2f\n", mode_names[m], buffer_mb[m], rss_mb[m]);
+    }
+    printf("  Buffer memory reduction: %.1f%%\n", 100.0 * (1.0 - buffer_mb[0] / buffer_mb[1]));
+    
+    printf("\n  %-28s %14s %14s %9s %9s\n", "Algorithm", "Enc in-place", "Dec in-place", "Enc x", "Dec x");
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        if (!algo_available(algo_type)) continue;
+        printf("  %-28s %14.2f %14.2f %9.2f %9.2f\n", algo_name(algo_type),
+               avg[0][algo_type][0], avg[0][algo_type][1],
+               avg[1][algo_type][0] / avg[0][algo_type][0],
+               avg[1][algo_type][1] / avg[0][algo_type][1]);
+    }
+    
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    return 0;
 }
 
-int chacha20_poly1305_decrypt(unsigned char *ciphertext, int ciphertext_len,
-                               unsigned char *key, unsigned char *nonce,
-                               unsigned char *tag, unsigned char *plaintext) {
-    EVP_CIPHER_CTX *ctx;
-    int len, plaintext_len, ret;
-    
-    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
-    if (1 != EVP_DecryptInit_ex(ctx, EVP_chacha20_poly1305(), NULL, NULL, NULL)) handle_crypto_error();
-    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, NONCE_SIZE, NULL)) handle_crypto_error();
-    if (1 != EVP_DecryptInit_ex(ctx, NULL, NULL, key, nonce)) handle_crypto_error();
-    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len)) handle_crypto_error();
-    plaintext_len = len;
-    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
-    ret = EVP_DecryptFinal_ex(ctx, plaintext + len, &len);
-    EVP_CIPHER_CTX_free(ctx);
-    
-    if (ret > 0) {
-        plaintext_len += len;
-        return plaintext_len;
-    } else {
-        fprintf(stderr, "Poly1305 tag verification failed!\n");
-        return -1;
+// File-to-file encryption with the I/O timed separately from the crypto:
+// load_file_content + fwrite (baseline) versus mmap'd input and output
+int run_io_tests(const char *test_file, unsigned char *master_key) {
+    const char *method_names[2] = {"read/fwrite", "mmap"};
+    char results_filename[256];
+    char output_file[256];
+    FILE *results_file;
+    const char *base_name = strrchr(test_file, '/');
+    base_name = base_name ? base_name + 1 : test_file;
+    snprintf(output_file, sizeof(output_file), "%s.enc", base_name);
+    
+    results_file = open_results_file("io_", test_file,
+                                     "Algorithm,IO_Method,Avg_Input_us,Avg_Crypto_us,Avg_Output_us,Avg_Total_us,Total_MB_per_s,"
+                                     "Runs,Median_Total_us,P99_Total_us",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) return 1;
+    
+    printf("\n=================================================================\n");
+    printf("  File-to-file encryption, I/O vs crypto time (%d warm-up + %d-%d runs each)\n",
+           bench_settings.warmup_runs, bench_settings.min_runs, bench_settings.max_runs);
+    printf("  Output file: %s (removed at the end)\n", output_file);
+    printf("=================================================================\n");
+    
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        unsigned char enc_key[KEY_SIZE];
+        unsigned char mac_key[HMAC_KEY_SIZE];
+        unsigned char iv[MAX_IV_SIZE];
+        unsigned char tag[HMAC_TAG_SIZE];
+        
+        if (!algo_available(algo_type)) continue;
+        derive_algo_keys(master_key, algo_name(algo_type), algo_type, enc_key, mac_key);
+        printf("\n%s:\n", algo_name(algo_type));
+        
+        for (int method = 0; method < 2; method++) {
+            // Input, crypto, output and the whole sequence; the total decides convergence
+            bench_samples phase[4];
+            bench_summary sum[4];
+            long long file_len = 0;
+            int ok = 1;
+            
+            memset(phase, 0, sizeof(phase));
+            for (int run = 0; run < bench_settings.warmup_runs + bench_settings.max_runs && ok; run++) {
+                int measured = run - bench_settings.warmup_runs;
+                bench_mark t0, t1, t2, t3;
+                
+                rand_pool_bytes(iv, algo_iv_len(algo_type));
+                
+                if (method == 0) {
+                    unsigned char *plaintext, *ciphertext;
+                    int plaintext_len, ciphertext_len;
+                    FILE *fp;
+                    
+                    bench_mark_now(&t0);
+                    plaintext_len = load_file_content(test_file, &plaintext);
+                    bench_mark_now(&t1);
+                    if (plaintext_len < 0) { ok = 0; break; }
+                    ciphertext = (unsigned char *)malloc(plaintext_len + EVP_MAX_BLOCK_LENGTH);
+                    if (!ciphertext) {
+                        perror("Memory allocation failed");
+                        free(plaintext);
+                        ok = 0;
+                        break;
+                    }
+                    ciphertext_len = algo_encrypt(algo_type, plaintext, plaintext_len, enc_key, mac_key,
+                                                  iv, ciphertext, tag);
+                    bench_mark_now(&t2);
+                    fp = fopen(output_file, "wb");
+                    if (!fp || fwrite(ciphertext, 1, ciphertext_len, fp) != (size_t)ciphertext_len) {
+                        perror("Error writing output file");
+                        ok = 0;
+                    }
+                    if (fp) fclose(fp);
+                    bench_mark_now(&t3);
+                    free(plaintext);
+                    free(ciphertext);
+                    file_len = plaintext_len;
+                } else {
+                    mapped_file in, out;
+                    
+                    bench_mark_now(&t0);
+                    if (map_input_file(test_file, &in) != 0) { ok = 0; break; }
+                    if (map_output_file(output_file, in.len, &out) != 0) {
+                        unmap_file(&in, 0);
+                        ok = 0;
+                        break;
+                    }
+                    bench_mark_now(&t1);
+                    // Page faults on both maps are paid here, inside the cipher call
+                    algo_encrypt(algo_type, in.data, (int)in.len, enc_key, mac_key, iv, out.data, tag);
+                    bench_mark_now(&t2);
+                    file_len = in.len;
+                    unmap_file(&out, 0);
+                    unmap_file(&in, 0);
+                    bench_mark_now(&t3);
+                }
+                if (measured < 0 || !ok) continue;
+                bench_record(&phase[0], &t0, &t1);
+                bench_record(&phase[1], &t1, &t2);
+                bench_record(&phase[2], &t2, &t3);
+                bench_record(&phase[3], &t0, &t3);
+                if (bench_converged(&phase[3])) break;
+            }
+            
+            // Decrypt the last output file back and compare with the input
+            if (ok) {
+                mapped_file in, out;
+                unsigned char *check = NULL;
+                if (map_input_file(test_file, &in) == 0 && map_input_file(output_file, &out) == 0) {
+                    check = (unsigned char *)malloc(out.len + EVP_MAX_BLOCK_LENGTH);
+                    ok = check && out.len == in.len &&
+                         algo_decrypt(algo_type, out.data, (int)out.len, enc_key, mac_key, iv, tag, check) == (int)in.len &&
+                         memcmp(check, in.data, in.len) == 0;
+                    unmap_file(&out, 0);
+                    unmap_file(&in, 0);
+                } else {
+                    ok = 0;
+                }
+                free(check);
+            }
+            if (!ok) {
+                printf("  %-12s Verification FAILED!\n", method_names[method]);
+                continue;
+            }
+            
+            for (int p = 0; p < 4; p++) bench_summarize(&phase[p], 0, &sum[p]);
+            double avg_in = sum[0].avg, avg_crypto = sum[1].avg;
+            double avg_out = sum[2].avg, avg_total = sum[3].avg;
+            printf("  %-12s input %10.2f μs, crypto %10.2f μs, output %10.2f μs, total %10.2f μs (%.1f MB/s) [OK]\n",
+                   method_names[method], avg_in, avg_crypto, avg_out, avg_total,
+                   file_len / avg_total);
+            printf("  %-12s %d runs, total median %ld μs, p99 %ld μs\n", "", phase[3].n, sum[3].median,
+                   sum[3].p99);
+            fprintf(results_file, "%s,%s,%.2f,%.2f,%.2f,%.2f,%.1f,%d,%ld,%ld\n", algo_name(algo_type),
+                    method_names[method], avg_in, avg_crypto, avg_out, avg_total, file_len / avg_total,
+                    phase[3].n, sum[3].median, sum[3].p99);
+        }
     }
+    
+    remove(output_file);
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    return 0;
 }
 
-// Test function for a specific algorithm
-void test_algorithm(const char *algo_name, int algo_type, 
-                    unsigned char *plaintext, int plaintext_len,
-                    unsigned char *master_key, FILE *results_file) {
-    unsigned char enc_key[KEY_SIZE];
-    unsigned char mac_key[HMAC_KEY_SIZE];
-    unsigned char *ciphertext;
-    unsigned char *decryptedtext;
-    unsigned char iv[IV_SIZE];
-    unsigned char nonce[NONCE_SIZE];
-    unsigned char tag[HMAC_TAG_SIZE];  // Large enough for HMAC-SHA256 (32 bytes)
-    struct timespec start, end;
-    long enc_times[NUM_RUNS], dec_times[NUM_RUNS];
+// End-to-end file-to-file encryption: the load/encrypt/save sequence
+// (load_file_content, one-shot encrypt, fwrite) versus the sequential
+// streaming loop versus the three-stage io_uring pipeline, per chunk size
+int run_pipeline_tests(const char *test_file, size_t *chunk_sizes, int num_chunk_sizes,
+                       int depth, unsigned char *master_key) {
+    const char *method_names[3] = {"load/encrypt/save", "stream", "pipeline"};
+    char results_filename[256];
+    char output_file[256];
+    FILE *results_file;
+    const char *base_name = strrchr(test_file, '/');
+    base_name = base_name ? base_name + 1 : test_file;
+    snprintf(output_file, sizeof(output_file), "%s.enc", base_name);
     
-    printf("\n%s:\n", algo_name);
-    printf("Running %d experiments...\n", NUM_RUNS);
+    results_file = open_results_file("pipeline_", test_file,
+                                     "Algorithm,Method,Chunk_Bytes,Depth,Avg_Total_us,Min_Total_us,MB_per_s,Speedup,"
+                                     "Runs,Median_Total_us,P99_Total_us",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) return 1;
     
-    // Allocate buffers
-    ciphertext = (unsigned char *)malloc(plaintext_len + EVP_MAX_BLOCK_LENGTH);
-    decryptedtext = (unsigned char *)malloc(plaintext_len + EVP_MAX_BLOCK_LENGTH);
+    printf("\n=================================================================\n");
+    printf("  File-to-file encryption pipeline (%d warm-up + %d-%d runs each, depth %d, %s)\n",
+           bench_settings.warmup_runs, bench_settings.min_runs, bench_settings.max_runs, depth,
+           pipeline_io_uring_available() ? "io_uring" : "pread/pwrite fallback");
+    printf("  Output file: %s (removed at the end)\n", output_file);
+    printf("=================================================================\n");
     
-    if (!ciphertext || !decryptedtext) {
-        perror("Memory allocation failed");
-        return;
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        unsigned char enc_key[KEY_SIZE];
+        unsigned char mac_key[HMAC_KEY_SIZE];
+        unsigned char iv[MAX_IV_SIZE];
+        unsigned char tag[HMAC_TAG_SIZE];
+        double baseline_us = 0;
+        
+        if (!algo_has(algo_type, ALGO_CAP_STREAMING)) continue;
+        derive_algo_keys(master_key, algo_name(algo_type), algo_type, enc_key, mac_key);
+        printf("\n%s:\n", algo_name(algo_type));
+        
+        // The baseline does not depend on the chunk size: run it once
+        for (int c = -1; c < num_chunk_sizes; c++) {
+            for (int method = (c < 0 ? 0 : 1); method <= (c < 0 ? 0 : 2); method++) {
+                size_t chunk_size = c < 0 ? 0 : chunk_sizes[c];
+                bench_samples samples = {0};
+                bench_summary sum;
+                long long file_len = 0;
+                int ok = 1;
+                
+                for (int run = 0; run < bench_settings.warmup_runs + bench_settings.max_runs && ok; run++) {
+                    int measured = run - bench_settings.warmup_runs;
+                    bench_mark t0, t1;
+                    
+                    rand_pool_bytes(iv, algo_iv_len(algo_type));
+                    bench_mark_now(&t0);
+                    if (method == 0) {
+                        unsigned char *plaintext, *ciphertext;
+                        int plaintext_len, ciphertext_len;
+                        FILE *fp;
+                        
+                        plaintext_len = load_file_content(test_file, &plaintext);
+                        if (plaintext_len < 0) { ok = 0; break; }
+                        ciphertext = (unsigned char *)malloc(plaintext_len + EVP_MAX_BLOCK_LENGTH);
+                        if (!ciphertext) {
+                            perror("Memory allocation failed");
+                            free(plaintext);
+                            ok = 0;
+                            break;
+                        }
+                        ciphertext_len = algo_encrypt(algo_type, plaintext, plaintext_len, enc_key, mac_key,
+                                                      iv, ciphertext, tag);
+                        fp = fopen(output_file, "wb");
+                        if (!fp || fwrite(ciphertext, 1, ciphertext_len, fp) != (size_t)ciphertext_len) {
+                            perror("Error writing output file");
+                            ok = 0;
+                        }
+                        if (fp) fclose(fp);
+                        free(plaintext);
+                        free(ciphertext);
+                        file_len = plaintext_len;
+                    } else if (method == 1) {
+                        FILE *in = fopen(test_file, "rb"), *out = fopen(output_file, "wb");
+                        
+                        if (!in || !out) {
+                            perror("Error opening files");
+                            ok = 0;
+                        } else {
+                            file_len = stream_encrypt_file(algo_type, in, out, chunk_size, enc_key, mac_key,
+                                                           iv, tag, NULL);
+                            ok = (file_len >= 0);
+                        }
+                        if (in) fclose(in);
+                        if (out && fclose(out) != 0) ok = 0;
+                    } else {
+                        int in_fd = open(test_file, O_RDONLY);
+                        int out_fd = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                        
+                        if (in_fd < 0 || out_fd < 0) {
+                            perror("Error opening files");
+                            ok = 0;
+                        } else {
+                            file_len = pipeline_encrypt_file(algo_type, in_fd, out_fd, chunk_size, depth,
+                                                             enc_key, mac_key, iv, tag);
+                            ok = (file_len >= 0);
+                        }
+                        if (in_fd >= 0) close(in_fd);
+                        if (out_fd >= 0 && close(out_fd) != 0) ok = 0;
+                    }
+                    bench_mark_now(&t1);
+                    
+                    if (measured < 0 || !ok) continue;
+                    bench_record(&samples, &t0, &t1);
+                    if (bench_converged(&samples)) break;
+                }
+                
+                // Decrypt the last output file back and compare with the input
+                if (ok) {
+                    mapped_file in, out;
+                    unsigned char *check = NULL;
+                    if (map_input_file(test_file, &in) == 0 && map_input_file(output_file, &out) == 0) {
+                        check = (unsigned char *)malloc(out.len + EVP_MAX_BLOCK_LENGTH);
+                        ok = check && out.len == in.len &&
+                             algo_decrypt(algo_type, out.data, (int)out.len, enc_key, mac_key, iv, tag, check) == (int)in.len &&
+                             memcmp(check, in.data, in.len) == 0;
+                        unmap_file(&out, 0);
+                        unmap_file(&in, 0);
+                    } else {
+                        ok = 0;
+                    }
+                    free(check);
+                }
+                if (!ok) {
+                    printf("  %-18s %8zu  Verification FAILED!\n", method_names[method], chunk_size);
+                    continue;
+                }
+                
+                bench_summarize(&samples, 0, &sum);
+                double avg_us = sum.avg;
+                if (method == 0) baseline_us = avg_us;
+                printf("  %-18s %8zu  total %10.2f μs (min %ld, p99 %ld, %d runs), %8.1f MB/s, %5.2fx [OK]\n",
+                       method_names[method], chunk_size, avg_us, sum.min, sum.p99, samples.n,
+                       file_len / avg_us, baseline_us / avg_us);
+                fprintf(results_file, "%s,%s,%zu,%d,%.2f,%ld,%.1f,%.3f,%d,%ld,%ld\n", algo_name(algo_type),
+                        method_names[method], chunk_size, method == 2 ? depth : 0, avg_us, sum.min,
+                        file_len / avg_us, baseline_us / avg_us, samples.n, sum.median, sum.p99);
+            }
+        }
     }
     
-    // Derive keys for this algorithm
-    if (algo_type <= 2) {  // Encrypt-then-MAC modes need both keys
-        derive_keys(master_key, algo_name, enc_key, (algo_type == 1) ? AES_KEY_SIZE : KEY_SIZE, 
-                    mac_key, HMAC_KEY_SIZE);
-    } else {  // AEAD modes need only encryption key
-        derive_keys(master_key, algo_name, enc_key, (algo_type == 3) ? AES_KEY_SIZE : KEY_SIZE, 
-                    mac_key, 0);
+    remove(output_file);
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    return 0;
+}
+
+// Reject a copy of a small segmented stream with one segment flipped,
+// swapped or dropped; returns the number of attacks that were not detected
+static int segment_tamper_checks(int algo_type, unsigned char *enc_key, unsigned char *mac_key) {
+    const size_t segment_size = 4096, plain_len = 3 * 4096 + 1000;
+    const char *attack_names[4] = {"bit flip", "reorder", "drop final", "drop tail"};
+    unsigned char plain[3 * 4096 + 1000];
+    unsigned char iv[MAX_IV_SIZE];
+    unsigned char *sealed = NULL;
+    size_t sealed_len = 0, header_len, record;
+    int missed = 0;
+    FILE *in, *out;
+    
+    rand_pool_bytes(plain, plain_len);
+    rand_pool_bytes(iv, algo_iv_len(algo_type));
+    out = open_memstream((char **)&sealed, &sealed_len);
+    in = fmemopen(plain, plain_len, "rb");
+    if (!out || !in || seg_encrypt_file(algo_type, in, out, segment_size, enc_key, mac_key, iv, NULL) < 0) {
+        perror("Error sealing tamper test stream");
+        if (in) fclose(in);
+        if (out) fclose(out);
+        free(sealed);
+        return 4;
     }
+    fclose(in);
+    fclose(out);
     
-    // Run multiple experiments
-    for (int run = 0; run < NUM_RUNS; run++) {
-        int ciphertext_len, decryptedtext_len;
+    header_len = SEG_HEADER_FIXED + algo_iv_len(algo_type);
+    record = segment_size + (algo_has(algo_type, ALGO_CAP_ETM) ? HMAC_TAG_SIZE : AEAD_TAG_SIZE);
+    for (int attack = 0; attack < 4; attack++) {
+        unsigned char *copy = (unsigned char *)malloc(sealed_len);
+        size_t copy_len = sealed_len;
+        long long released;
         
-        // Generate random IV/nonce for each run
-        if (algo_type == 4) {  // ChaCha20-Poly1305 uses 96-bit nonce
-            if (RAND_bytes(nonce, NONCE_SIZE) != 1) handle_crypto_error();
+        memcpy(copy, sealed, sealed_len);
+        if (attack == 0) {
+            copy[header_len + record + 100] ^= 0x01;
+        } else if (attack == 1) {
+            memcpy(copy + header_len, sealed + header_len + record, record);
+            memcpy(copy + header_len + record, sealed + header_len, record);
+        } else if (attack == 2) {
+            copy_len = header_len + 3 * record;  // Ends on a full, non-final segment
         } else {
-            if (RAND_bytes(iv, IV_SIZE) != 1) handle_crypto_error();
+            copy_len = sealed_len - 1;
         }
-        
-        // Encryption
-        clock_gettime(CLOCK_MONOTONIC, &start);
-        switch (algo_type) {
-            case 1:  // AES-128-CTR + HMAC
-                ciphertext_len = aes_ctr_hmac_encrypt(plaintext, plaintext_len, enc_key, mac_key, iv, ciphertext, tag);
-                break;
-            case 2:  // ChaCha20 + HMAC
-                ciphertext_len = chacha20_hmac_encrypt(plaintext, plaintext_len, enc_key, mac_key, iv, ciphertext, tag);
-                break;
-            case 3:  // AES-128-GCM
-                ciphertext_len = aes_gcm_encrypt(plaintext, plaintext_len, enc_key, iv, ciphertext, tag);
-                break;
-            case 4:  // ChaCha20-Poly1305
-                ciphertext_len = chacha20_poly1305_encrypt(plaintext, plaintext_len, enc_key, nonce, ciphertext, tag);
-                break;
+        in = fmemopen(copy, copy_len, "rb");
+        released = in ? seg_decrypt_file(algo_type, in, NULL, enc_key, mac_key, NULL) : 0;
+        if (in) fclose(in);
+        free(copy);
+        if (released >= 0) {
+            printf("  Tamper check '%s' NOT detected!\n", attack_names[attack]);
+            missed++;
         }
-        clock_gettime(CLOCK_MONOTONIC, &end);
-        enc_times[run] = (end.tv_sec - start.tv_sec) * 1000000L + 
-                         (end.tv_nsec - start.tv_nsec) / 1000L;
+    }
+    free(sealed);
+    return missed;
+}
+
+// Throughput of the segmented authenticated format (segstream.h) against the
+// plain streaming loop at the same chunk size, with both decrypting to a
+// bounded buffer, plus tamper/reorder/truncation rejection checks
+int run_segment_tests(const char *test_file, size_t *segment_sizes, int num_segment_sizes,
+                      unsigned char *master_key) {
+    const char *format_names[2] = {"stream", "segmented"};
+    char results_filename[256];
+    FILE *results_file;
+    int failures = 0;
+    
+    results_file = open_results_file("segments_", test_file,
+                                     "Algorithm,Format,Segment_Bytes,Avg_Encryption_us,Avg_Decryption_us,Min_Enc_us,Min_Dec_us,"
+                                     "Enc_MB_per_s,Dec_MB_per_s,Expansion_Bytes,Enc_Overhead_Pct,Dec_Overhead_Pct,"
+                                     "Runs,Median_Enc_us,P99_Enc_us,Median_Dec_us,P99_Dec_us",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) return 1;
+    
+    printf("\n=================================================================\n");
+    printf("  Segmented verify-before-release streams on %s (%d warm-up + %d-%d runs each)\n", test_file,
+           bench_settings.warmup_runs, bench_settings.min_runs, bench_settings.max_runs);
+    printf("  Timings include file I/O; the ciphertext goes to a temporary file\n");
+    printf("=================================================================\n");
+    
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        unsigned char enc_key[KEY_SIZE];
+        unsigned char mac_key[HMAC_KEY_SIZE];
+        int missed;
         
-        // Decryption
-        clock_gettime(CLOCK_MONOTONIC, &start);
-        switch (algo_type) {
-            case 1:  // AES-128-CTR + HMAC
-                decryptedtext_len = aes_ctr_hmac_decrypt(ciphertext, ciphertext_len, enc_key, mac_key, iv, tag, decryptedtext);
-                break;
-            case 2:  // ChaCha20 + HMAC
-                decryptedtext_len = chacha20_hmac_decrypt(ciphertext, ciphertext_len, enc_key, mac_key, iv, tag, decryptedtext);
-                break;
-            case 3:  // AES-128-GCM
-                decryptedtext_len = aes_gcm_decrypt(ciphertext, ciphertext_len, enc_key, iv, tag, decryptedtext);
-                break;
-            case 4:  // ChaCha20-Poly1305
-                decryptedtext_len = chacha20_poly1305_decrypt(ciphertext, ciphertext_len, enc_key, nonce, tag, decryptedtext);
-                break;
-        }
-        clock_gettime(CLOCK_MONOTONIC, &end);
-        dec_times[run] = (end.tv_sec - start.tv_sec) * 1000000L + 
-                         (end.tv_nsec - start.tv_nsec) / 1000L;
+        if (!algo_has(algo_type, ALGO_CAP_STREAMING)) continue;
+        derive_algo_keys(master_key, algo_name(algo_type), algo_type, enc_key, mac_key);
+        missed = segment_tamper_checks(algo_type, enc_key, mac_key);
+        printf("\n%s: tamper/reorder/truncation checks %s\n", algo_name(algo_type),
+               missed ? "FAILED" : "rejected [OK]");
+        failures += missed;
         
-        // Verify correctness
-        if (decryptedtext_len != plaintext_len || memcmp(plaintext, decryptedtext, plaintext_len) != 0) {
-            printf("  Run %d: Verification FAILED!\n", run + 1);
-        } else {
-            printf("  Run %d: Encryption=%ld μs, Decryption=%ld μs [OK]\n", 
-                   run + 1, enc_times[run], dec_times[run]);
+        for (int s = 0; s < num_segment_sizes; s++) {
+            size_t segment_size = segment_sizes[s];
+            double stream_us[2] = {0, 0};
+            
+            if (segment_size == 0 || segment_size > SEG_MAX_SIZE) {
+                fprintf(stderr, "Segment size must be between 1 and %d bytes\n", SEG_MAX_SIZE);
+                fclose(results_file);
+                return 1;
+            }
+            for (int format = 0; format < 2; format++) {
+                bench_samples samples[2];  // Encryption, decryption
+                bench_summary sum[2];
+                long long file_len = 0, sealed_len = 0;
+                int ok = 1;
+                
+                memset(samples, 0, sizeof(samples));
+                for (int run = 0; run < bench_settings.warmup_runs + bench_settings.max_runs && ok; run++) {
+                    int measured = run - bench_settings.warmup_runs;
+                    unsigned char iv[MAX_IV_SIZE];
+                    unsigned char tag[HMAC_TAG_SIZE];
+                    unsigned char digest[2][SHA256_DIGEST_LENGTH];
+                    bench_mark t0, t1, t2;
+                    FILE *in = fopen(test_file, "rb"), *sealed = tmpfile();
+                    long long dec_len;
+                    
+                    if (!in || !sealed) {
+                        perror("Error opening files");
+                        if (in) fclose(in);
+                        if (sealed) fclose(sealed);
+                        ok = 0;
+                        break;
+                    }
+                    rand_pool_bytes(iv, algo_iv_len(algo_type));
+                    bench_mark_now(&t0);
+                    if (format == 0) {
+                        file_len = stream_encrypt_file(algo_type, in, sealed, segment_size, enc_key, mac_key,
+                                                       iv, tag, digest[0]);
+                    } else {
+                        file_len = seg_encrypt_file(algo_type, in, sealed, segment_size, enc_key, mac_key,
+                                                    iv, digest[0]);
+                    }
+                    fflush(sealed);
+                    bench_mark_now(&t1);
+                    sealed_len = ftell(sealed);
+                    rewind(sealed);
+                    if (format == 0) {
+                        dec_len = stream_decrypt_file(algo_type, sealed, NULL, segment_size, enc_key, mac_key,
+                                                      iv, tag, digest[1]);
+                    } else {
+                        dec_len = seg_decrypt_file(algo_type, sealed, NULL, enc_key, mac_key, digest[1]);
+                    }
+                    bench_mark_now(&t2);
+                    fclose(in);
+                    fclose(sealed);
+                    
+                    ok = file_len >= 0 && dec_len == file_len &&
+                         memcmp(digest[0], digest[1], SHA256_DIGEST_LENGTH) == 0;
+                    if (measured < 0 || !ok) continue;
+                    bench_record(&samples[0], &t0, &t1);
+                    bench_record(&samples[1], &t1, &t2);
+                    if (bench_converged(&samples[0]) && bench_converged(&samples[1])) break;
+                }
+                if (!ok) {
+                    printf("  %-10s %8zu  Verification FAILED!\n", format_names[format], segment_size);
+                    failures++;
+                    continue;
+                }
+                
+                bench_summarize(&samples[0], 0, &sum[0]);
+                bench_summarize(&samples[1], 0, &sum[1]);
+                double avg_enc = sum[0].avg, avg_dec = sum[1].avg;
+                if (format == 0) {
+                    stream_us[0] = avg_enc;
+                    stream_us[1] = avg_dec;
+                }
+                double enc_pct = 100.0 * (avg_enc / stream_us[0] - 1.0);
+                double dec_pct = 100.0 * (avg_dec / stream_us[1] - 1.0);
+                printf("  %-10s %8zu  enc %8.1f MB/s, dec %8.1f MB/s, +%lld bytes",
+                       format_names[format], segment_size, file_len / avg_enc, file_len / avg_dec,
+                       sealed_len - file_len);
+                if (format == 1) printf(", overhead enc %+.1f%% dec %+.1f%%", enc_pct, dec_pct);
+                printf(" [OK] %d runs\n", samples[0].n);
+                fprintf(results_file, "%s,%s,%zu,%.2f,%.2f,%ld,%ld,%.1f,%.1f,%lld,%.2f,%.2f,%d,%ld,%ld,%ld,%ld\n",
+                        algo_name(algo_type), format_names[format], segment_size, avg_enc, avg_dec,
+                        sum[0].min, sum[1].min, file_len / avg_enc, file_len / avg_dec,
+                        sealed_len - file_len, enc_pct, dec_pct, samples[0].n, sum[0].median, sum[0].p99,
+                        sum[1].median, sum[1].p99);
+            }
         }
     }
     
-    // Calculate statistics
-    long enc_sum = 0, dec_sum = 0;
-    long enc_min = enc_times[0], enc_max = enc_times[0];
-    long dec_min = dec_times[0], dec_max = dec_times[0];
+    printf("\n✓ Segmented stream tests completed (peak RSS: %.2f MB)\n", peak_rss_mb());
+    printf("✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    return failures ? 1 : 0;
+}
+
+// Flip one ciphertext byte of segment 1 in a copy of the container; a read
+// of segment 0 must still succeed and a read of segment 1 must fail
+static int container_tamper_check(const char *container_file, unsigned char *master_key) {
+    char bad_file[300];
+    unsigned char *image, buf[16];
+    mapped_file mf;
+    con_reader r;
+    FILE *fp;
+    int ok = 0;
     
-    for (int i = 0; i < NUM_RUNS; i++) {
-        enc_sum += enc_times[i];
-        dec_sum += dec_times[i];
-        if (enc_times[i] < enc_min) enc_min = enc_times[i];
-        if (enc_times[i] > enc_max) enc_max = enc_times[i];
-        if (dec_times[i] < dec_min) dec_min = dec_times[i];
-        if (dec_times[i] > dec_max) dec_max = dec_times[i];
+    if (map_input_file(container_file, &mf) != 0) return 0;
+    snprintf(bad_file, sizeof(bad_file), "%s.bad", container_file);
+    image = (unsigned char *)malloc(mf.len);
+    if (image && con_open(&r, container_file, master_key) == 0) {
+        if (r.segments > 1) {
+            memcpy(image, mf.data, mf.len);
+            image[r.header_len + r.segment_size + 7] ^= 0x01;
+            fp = fopen(bad_file, "wb");
+            ok = fp && fwrite(image, 1, mf.len, fp) == mf.len;
+            if (fp && fclose(fp) != 0) ok = 0;
+        }
+        con_close(&r);
+    }
+    free(image);
+    unmap_file(&mf, 0);
+    if (ok && con_open(&r, bad_file, master_key) == 0) {
+        ok = con_read(&r, 0, sizeof(buf), buf) == sizeof(buf) &&
+             con_read(&r, r.segment_size, sizeof(buf), buf) < 0;
+        con_close(&r);
+    } else {
+        ok = 0;
     }
+    remove(bad_file);
+    return ok;
+}
+
+// Container format (container.h): seal the test file, decrypt it whole, then
+// random plaintext ranges of every size through the mmap reader, checking
+// each against the input
+int run_container_tests(const char *test_file, size_t *range_sizes, int num_range_sizes,
+                        int num_reads, unsigned char *master_key) {
+    char results_filename[256];
+    char container_file[256];
+    FILE *results_file;
+    mapped_file input;
+    const char *base_name = strrchr(test_file, '/');
+    base_name = base_name ? base_name + 1 : test_file;
+    snprintf(container_file, sizeof(container_file), "%s.hw3c", base_name);
     
-    double enc_avg = (double)enc_sum / NUM_RUNS;
-    double dec_avg = (double)dec_sum / NUM_RUNS;
+    if (map_input_file(test_file, &input) != 0) return 1;
+    results_file = open_results_file("container_", test_file,
+                                     "Algorithm,Operation,Range_Bytes,Reads,Avg_us,P50_us,P99_us,MB_per_s,Segments_per_Read",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) {
+        unmap_file(&input, 0);
+        return 1;
+    }
     
-    printf("\n  Statistics (over %d runs):\n", NUM_RUNS);
-    printf("    Encryption - Avg: %.2f μs, Min: %ld μs, Max: %ld μs\n", 
-           enc_avg, enc_min, enc_max);
-    printf("    Decryption - Avg: %.2f μs, Min: %ld μs, Max: %ld μs\n", 
-           dec_avg, dec_min, dec_max);
+    printf("\n=================================================================\n");
+    printf("  Encrypted container: seal, full open, random range reads\n");
+    printf("  %d-byte segments, %d reads per range size, output %s\n", CON_DEFAULT_SEGMENT, num_reads,
+           container_file);
+    printf("=================================================================\n");
     
-    // Write results to file
-    fprintf(results_file, "%s,%.2f,%.2f,%ld,%ld,%ld,%ld\n", 
-            algo_name, enc_avg, dec_avg, enc_min, enc_max, dec_min, dec_max);
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        long long *lat_ns = NULL;
+        unsigned char *out = NULL;
+        struct timespec t0, t1;
+        con_reader r;
+        FILE *in, *sealed;
+        long long n;
+        int ok;
+        
+        if (!algo_available(algo_type) || !algo_has(algo_type, ALGO_CAP_AEAD) ||
+            algo_iv_len(algo_type) < 12) continue;
+        printf("\n%s:\n", algo_name(algo_type));
+        
+        in = fopen(test_file, "rb");
+        sealed = fopen(container_file, "wb");
+        if (!in || !sealed) {
+            perror("Error opening files");
+            if (in) fclose(in);
+            if (sealed) fclose(sealed);
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        n = con_seal_file(algo_type, in, sealed, CON_DEFAULT_SEGMENT, master_key, NULL);
+        if (fclose(sealed) != 0) n = -1;
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        fclose(in);
+        if (n < 0 || con_open(&r, container_file, master_key) != 0) {
+            printf("  Seal FAILED!\n");
+            continue;
+        }
+        double seal_us = elapsed_ns(&t0, &t1) / 1000.0;
+        printf("  %-10s %10s %12.1f μs %10.1f MB/s, %llu segments, +%zu bytes\n", "seal", "all", seal_us,
+               input.len / seal_us, (unsigned long long)r.segments, r.map_len - input.len);
+        fprintf(results_file, "%s,seal,%zu,1,%.1f,%.1f,%.1f,%.1f,%llu\n", algo_name(algo_type), input.len,
+                seal_us, seal_us, seal_us, input.len / seal_us, (unsigned long long)r.segments);
+        
+        out = (unsigned char *)malloc(input.len + 1);
+        lat_ns = (long long *)malloc(num_reads * sizeof(long long));
+        if (!out || !lat_ns) {
+            perror("Memory allocation failed");
+            free(out);
+            free(lat_ns);
+            con_close(&r);
+            break;
+        }
+        
+        // Whole plaintext
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        n = con_read(&r, 0, input.len, out);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ok = (n == (long long)input.len && memcmp(out, input.data, input.len) == 0);
+        double open_us = elapsed_ns(&t0, &t1) / 1000.0;
+        printf("  %-10s %10s %12.1f μs %10.1f MB/s %s\n", "open", "all", open_us, input.len / open_us,
+               ok ? "[OK]" : "Verification FAILED!");
+        fprintf(results_file, "%s,open,%zu,1,%.1f,%.1f,%.1f,%.1f,%llu\n", algo_name(algo_type), input.len,
+                open_us, open_us, open_us, input.len / open_us, (unsigned long long)r.segments);
+        
+        for (int s = 0; s < num_range_sizes && input.len > 0; s++) {
+            size_t range = range_sizes[s] < input.len ? range_sizes[s] : input.len;
+            uint64_t opened_before = r.segments_opened;
+            bench_latency lat;
+            
+            ok = 1;
+            for (int i = 0; i < num_reads && ok; i++) {
+                uint64_t offset;
+                rand_pool_bytes((unsigned char *)&offset, sizeof(offset));
+                offset %= input.len - range + 1;
+                
+                clock_gettime(CLOCK_MONOTONIC, &t0);
+                n = con_read(&r, offset, range, out);
+                clock_gettime(CLOCK_MONOTONIC, &t1);
+                lat_ns[i] = elapsed_ns(&t0, &t1);
+                ok = (n == (long long)range && memcmp(out, input.data + offset, range) == 0);
+            }
+            double per_read = (double)(r.segments_opened - opened_before) / num_reads;
+            bench_latency_summary(lat_ns, num_reads, &lat);
+            printf("  %-10s %10zu %12.1f μs (p50 %.1f, p99 %.1f), %.2f segments/read %s\n", "range", range,
+                   lat.mean_ns / 1000.0, lat.p50_ns / 1000.0, lat.p99_ns / 1000.0, per_read,
+                   ok ? "[OK]" : "Verification FAILED!");
+            fprintf(results_file, "%s,range,%zu,%d,%.2f,%.2f,%.2f,%.1f,%.2f\n", algo_name(algo_type), range,
+                    num_reads, lat.mean_ns / 1000.0, lat.p50_ns / 1000.0, lat.p99_ns / 1000.0,
+                    range / (lat.mean_ns / 1000.0), per_read);
+        }
+        con_close(&r);
+        free(out);
+        free(lat_ns);
+        
+        printf("  Tampered segment: %s\n",
+               container_tamper_check(container_file, master_key) ? "rejected, other segments still readable [OK]"
+                                                                  : "check FAILED (or file too small)");
+    }
     
-    free(ciphertext);
-    free(decryptedtext);
+    remove(container_file);
+    unmap_file(&input, 0);
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    return 0;
+}
+
+#define APPEND_RUNS 3  // Appends per algorithm
+
+// SHA-256 of bytes [from, from + len) of path, to check that an append left them alone
+static int file_range_digest(const char *path, size_t from, size_t len, unsigned char *digest) {
+    mapped_file mf;
+    int ok;
+
+    if (map_input_file(path, &mf) != 0) return 0;
+    ok = from + len <= mf.len;
+    if (ok && 1 != EVP_Digest(mf.data + from, len, digest, NULL, EVP_sha256(), NULL)) handle_crypto_error();
+    unmap_file(&mf, 0);
+    return ok;
+}
+
+// Incremental sealing (container.h, version 2): seal a copy of the test
+// file as an appendable container, then grow the copy by append_size
+// random bytes APPEND_RUNS times. Each time, con_append_file seals only
+// the new bytes; it is timed against sealing the whole grown file again
+// (con_seal_file). Checks that the old ciphertext is unchanged and, at the
+// end, the round trip.
+int run_append_tests(const char *test_file, size_t append_size, unsigned char *master_key) {
+    char results_filename[256], log_file[256], container_file[256], full_file[256];
+    FILE *results_file;
+    mapped_file input;
+    unsigned char *extra;
+    const char *base_name = strrchr(test_file, '/');
+    base_name = base_name ? base_name + 1 : test_file;
+    snprintf(log_file, sizeof(log_file), "%s.log", base_name);
+    snprintf(container_file, sizeof(container_file), "%s.hw3a", base_name);
+    snprintf(full_file, sizeof(full_file), "%s.hw3c", base_name);
+
+    if (append_size == 0) {
+        fprintf(stderr, "Append size must be at least 1 byte\n");
+        return 1;
+    }
+    if (map_input_file(test_file, &input) != 0) return 1;
+    if (!(extra = (unsigned char *)malloc(append_size))) {
+        perror("Memory allocation failed");
+        unmap_file(&input, 0);
+        return 1;
+    }
+    results_file = open_results_file("append_", test_file,
+                                     "Algorithm,Run,Append_Bytes,Total_Bytes,Segments,Incremental_ms,"
+                                     "Full_Reseal_ms,Speedup,Old_Ciphertext_Unchanged",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) {
+        free(extra);
+        unmap_file(&input, 0);
+        return 1;
+    }
+
+    printf("\n=================================================================\n");
+    printf("  Appendable container: re-seal after appending %zu bytes,\n", append_size);
+    printf("  incremental (new segments only) vs full re-encryption, %d appends\n", APPEND_RUNS);
+    printf("=================================================================\n");
+
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        struct timespec t0, t1;
+        size_t total = input.len;
+        con_reader r;
+        FILE *log, *src, *out;
+        long long n;
+        int ok;
+
+        if (!algo_available(algo_type) || !algo_has(algo_type, ALGO_CAP_AEAD) ||
+            algo_iv_len(algo_type) < 12) continue;
+        printf("\n%s:\n", algo_name(algo_type));
+
+        // The growing source starts as a copy of the test file
+        log = fopen(log_file, "wb");
+        ok = log && fwrite(input.data, 1, input.len, log) == input.len;
+        if (log && fclose(log) != 0) ok = 0;
+        if (!ok) {
+            perror("Error writing the source copy");
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        n = -1;
+        if (con_create_appendable(algo_type, container_file, CON_DEFAULT_SEGMENT, master_key, NULL) == 0 &&
+            (src = fopen(log_file, "rb"))) {
+            n = con_append_file(container_file, src, master_key);
+            fclose(src);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        if (n != (long long)input.len) {
+            printf("  Initial seal FAILED!\n");
+            continue;
+        }
+        printf("  %-8s %12s %12s %14s %14s %9s\n", "Run", "Total bytes", "Segments", "Incremental ms",
+               "Full ms", "Speedup");
+        printf("  %-8s %12zu %12s %14.2f %14s %9s\n", "initial", total, "", elapsed_ns(&t0, &t1) / 1e6, "", "");
+
+        for (int run = 1; run <= APPEND_RUNS && ok; run++) {
+            unsigned char before[SHA256_DIGEST_LENGTH], after[SHA256_DIGEST_LENGTH];
+            size_t header_len;
+            uint64_t segments;
+            double incremental_ms, full_ms;
+            int unchanged;
+
+            rand_pool_bytes(extra, append_size);
+            log = fopen(log_file, "ab");
+            ok = log && fwrite(extra, 1, append_size, log) == append_size;
+            if (log && fclose(log) != 0) ok = 0;
+            if (!ok || con_open(&r, container_file, NULL) != 0) {
+                printf("  Append %d FAILED!\n", run);
+                ok = 0;
+                break;
+            }
+            header_len = r.header_len;
+            con_close(&r);
+            ok = file_range_digest(container_file, header_len, total, before);
+
+            src = fopen(log_file, "rb");
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            n = src ? con_append_file(container_file, src, master_key) : -1;
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            if (src) fclose(src);
+            incremental_ms = elapsed_ns(&t0, &t1) / 1e6;
+            unchanged = ok && file_range_digest(container_file, header_len, total, after) &&
+                        memcmp(before, after, sizeof(before)) == 0;
+            total += append_size;
+
+            // What the tools did before: encrypt the whole grown file again
+            src = fopen(log_file, "rb");
+            out = fopen(full_file, "wb");
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            long long full = (src && out) ? con_seal_file(algo_type, src, out, CON_DEFAULT_SEGMENT, master_key, NULL) : -1;
+            if (out && fclose(out) != 0) full = -1;
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            if (src) fclose(src);
+            full_ms = elapsed_ns(&t0, &t1) / 1e6;
+
+            ok = n == (long long)append_size && full == (long long)total && con_open(&r, container_file, master_key) == 0;
+            if (!ok) {
+                printf("  Append %d FAILED!\n", run);
+                break;
+            }
+            segments = r.segments;
+            con_close(&r);
+            printf("  %-8d %12zu %12llu %14.2f %14.2f %8.1fx%s\n", run, total, (unsigned long long)segments,
+                   incremental_ms, full_ms, full_ms / incremental_ms,
+                   unchanged ? "" : "  old ciphertext CHANGED!");
+            fprintf(results_file, "%s,%d,%zu,%zu,%llu,%.3f,%.3f,%.2f,%s\n", algo_name(algo_type), run, append_size,
+                    total, (unsigned long long)segments, incremental_ms, full_ms, full_ms / incremental_ms,
+                    unchanged ? "yes" : "no");
+        }
+
+        // Whole round trip of the grown file
+        if (ok) {
+            mapped_file grown;
+            unsigned char *plain = NULL;
+
+            ok = map_input_file(log_file, &grown) == 0;
+            if (ok) {
+                plain = (unsigned char *)malloc(grown.len + 1);
+                ok = plain && con_open(&r, container_file, master_key) == 0;
+                if (ok) {
+                    ok = con_read(&r, 0, grown.len, plain) == (long long)grown.len &&
+                         memcmp(plain, grown.data, grown.len) == 0;
+                    con_close(&r);
+                }
+                free(plain);
+                unmap_file(&grown, 0);
+            }
+            printf("  Round trip of the grown file: %s\n", ok ? "[OK]" : "Verification FAILED!");
+        }
+    }
+
+    remove(log_file);
+    remove(container_file);
+    remove(full_file);
+    free(extra);
+    unmap_file(&input, 0);
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    return 0;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options] [test_file]\n", prog);
+    printf("  -s, --stream            Streaming mode: encrypt the file chunk by chunk\n");
+    printf("                          with bounded memory instead of loading it\n");
+    printf("  -c, --chunk-size LIST   Chunk size(s) for streaming mode, comma separated,\n");
+    printf("                          K/M/G suffixes allowed (default 64K, implies -s\n");
+    printf("                          unless -a is given)\n");
+    printf("  -f, --fused             Compare two-pass and single-pass (fused)\n");
+    printf("                          Encrypt-then-MAC on the loaded file\n");
+    printf("  -b, --block-size LIST   Fused block size(s), comma separated\n");
+    printf("                          (default 32K, implies -f)\n");
+    printf("  -p, --pool              Small-message benchmark: fresh contexts per message\n");
+    printf("                          versus pooled, pre-keyed contexts\n");
+    printf("  -l, --latency           Small-message latency (p50/p99 ns per message):\n");
+    printf("                          heap + fresh contexts vs pooled vs the zero-\n");
+    printf("                          allocation small-message API\n");
+    printf("  -Q, --kernels           Compile-time specialized kernels (kernels.h) vs\n");
+    printf("                          registry dispatch vs pooled contexts\n");
+    printf("  -m, --msg-size LIST     Message size(s) for small-message benchmarks\n");
+    printf("                          (default 16,256,4K)\n");
+    printf("  -n, --messages N        Messages per measurement (default %d)\n", DEFAULT_NUM_MESSAGES);
+    printf("  -t, --threads LIST      Parallel engine for CTR/ChaCha20 + HMAC with the\n");
+    printf("                          given thread count(s), e.g. 1,2,4,8\n");
+    printf("  -N, --numa LIST         NUMA placement of the parallel engine with the\n");
+    printf("                          given thread count(s): first-node vs interleaved vs\n");
+    printf("                          node-local slices, per-node throughput\n");
+    printf("  -B, --batch LIST        Multi-buffer AEAD benchmark with the given batch\n");
+    printf("                          size(s), over the --msg-size list\n");
+    printf("  -i, --io                File-to-file encryption timing input I/O, crypto\n");
+    printf("                          and output I/O separately: read/fwrite vs mmap\n");
+    printf("  -a, --pipeline          File-to-file encryption: load/encrypt/save vs the\n");
+    printf("                          streaming loop vs the io_uring read/encrypt/write\n");
+    printf("                          pipeline, over the --chunk-size list\n");
+    printf("  -d, --depth N           Pipeline buffers in flight (default %d)\n", PIPELINE_DEFAULT_DEPTH);
+    printf("  -S, --segments LIST     Segmented verify-before-release stream format with\n");
+    printf("                          the given segment size(s) vs plain streaming, plus\n");
+    printf("                          tamper/reorder/truncation checks (default 64K)\n");
+    printf("  -X, --container LIST    Encrypted container (container.h): seal, full open\n");
+    printf("                          and random reads of the given range size(s)\n");
+    printf("                          (--messages / 100 reads per size)\n");
+    printf("  -Y, --append SIZE       Appendable container: re-seal time after appending\n");
+    printf("                          SIZE bytes to the test file, incremental vs full\n");
+    printf("  -A, --alloc KIND        Payload buffers from malloc (default), aligned\n");
+    printf("                          (64B-aligned, pre-faulted 4K pages) or huge\n");
+    printf("                          (2MB huge pages, pre-faulted); see arena.h\n");
+    printf("  -T, --alloc-tests       Compare the three allocators: first-touch vs\n");
+    printf("                          steady-state time, page faults and dTLB misses\n");
+    printf("  -I, --in-place          Encrypt/decrypt inside the input buffer, checked by\n");
+    printf("                          SHA-256, vs separate buffers; reports memory saved\n");
+    printf("  -k, --counters          Per-phase perf_event_open counters (key derivation,\n");
+    printf("                          cipher, MAC, verify) in results_counters_<file>.csv\n");
+    printf("  -K, --key-setup         Per-session key setup latency, fresh HKDF and\n");
+    printf("                          contexts vs the derived-key cache (--messages sessions)\n");
+    printf("  -D, --drbg              Native ChaCha20/AES-CTR/HMAC DRBG benchmark in\n");
+    printf("                          results_drbg.csv (for HW05 drbg_benchmark.py)\n");
+    printf("  -L, --lengths LIST      DRBG output lengths in bits (default 10^4..10^7)\n");
+    printf("  -G, --iv-gen LIST       IV generation contention benchmark with the given\n");
+    printf("                          thread count(s): RAND_bytes vs rand_pool vs\n");
+    printf("                          nonce_ctr (--messages IVs per thread)\n");
+    printf("  -F, --files PATH        Many-file mode: every file of a directory (or of a\n");
+    printf("                          list file, one path per line) with every algorithm\n");
+    printf("                          on a work-stealing pool, one consolidated CSV\n");
+    printf("  -W, --workers N         Worker threads for --files, --serve and\n");
+    printf("                          --service-bench (default: online CPUs)\n");
+    printf("  -w, --warmup N          Untimed warm-up round trips per algorithm (default 2)\n");
+    printf("  -r, --min-runs N        Minimum timed runs (default %d)\n", NUM_RUNS);
+    printf("  -R, --max-runs N        Maximum timed runs (default 30)\n");
+    printf("  -C, --ci PCT            Stop once the 95%% CI half-width is within PCT%% of\n");
+    printf("                          the mean (default 2)\n");
+    printf("  -P, --cpu N             Pin the benchmark to CPU N\n");
+    printf("  -U, --cpu-report        CPU features, OpenSSL providers and inferred\n");
+    printf("                          implementations, then the fastest algorithm and\n");
+    printf("                          backend for the --msg-size profile\n");
+    printf("  -Z, --cpu-caps MASK     Re-run with OPENSSL_ia32cap=MASK: native, no-avx512,\n");
+    printf("                          no-avx2, no-aesni, scalar or a raw mask\n");
+    printf("  -V, --serve PATH        Run the encryption service (service.h) on the Unix\n");
+    printf("                          socket PATH until SIGINT/SIGTERM\n");
+    printf("  -e, --key-file FILE     Master key for --serve: %d raw bytes (default: a\n", KEY_SIZE);
+    printf("                          random key for this run)\n");
+    printf("  -O, --service-bench LIST  Service benchmark with the given client count(s):\n");
+    printf("                          one request per call vs batched, over --msg-size\n");
+    printf("  -M, --commit-rounds LIST  Native HW06/HW07 commit/reveal exchange over TCP\n");
+    printf("                          loopback with the given rounds-per-frame batch\n");
+    printf("                          size(s), a best-of-(--messages / 100) match\n");
+    printf("  -H, --commit-verify LIST  Batch commitment verification with the given\n");
+    printf("                          batch size(s): libcrypto vs AVX2 8-lane SHA-256,\n");
+    printf("                          over 1, 2, 4 .. online CPUs threads\n");
+    printf("  -J, --dudect N          Timing leak test of tag verification: N timed\n");
+    printf("                          checks per comparator and decrypt, fixed vs random\n");
+    printf("                          forged tags, Welch's t-test\n");
+    printf("  -j, --run-log FILE      CSV of every per-run line (time, event, algorithm,\n");
+    printf("                          values), written off the timed path (metrics.h)\n");
+    printf("  -o, --metrics PATH      Live counters on the Unix socket PATH: bytes, ops/s\n");
+    printf("                          and a latency histogram, one snapshot per connection\n");
+    printf("  -h, --help              Show this help\n");
 }
 
 int main(int argc, char *argv[]) {
@@ -425,10 +1539,360 @@ int main(int argc, char *argv[]) {
     int plaintext_len;
     FILE *results_file;
     const char *test_file;
+    int stream_mode = 0;
+    size_t chunk_sizes[MAX_SWEEP] = {DEFAULT_CHUNK_SIZE};
+    int num_chunk_sizes = 1;
+    int fused_mode = 0;
+    size_t block_sizes[MAX_SWEEP] = {DEFAULT_FUSED_BLOCK_SIZE};
+    int num_block_sizes = 1;
+    int pool_mode = 0;
+    int latency_mode = 0;
+    int kernel_mode = 0;
+    size_t msg_sizes[MAX_SWEEP] = {16, 256, 4096};
+    int num_msg_sizes = 3;
+    int num_messages = DEFAULT_NUM_MESSAGES;
+    int thread_counts[MAX_SWEEP];
+    size_t batch_sizes[MAX_SWEEP];
+    int num_batch_sizes = 0;
+    int io_mode = 0;
+    int pipeline_mode = 0;
+    int pipeline_depth = PIPELINE_DEFAULT_DEPTH;
+    size_t segment_sizes[MAX_SWEEP] = {SEG_DEFAULT_SIZE};
+    int num_segment_sizes = 0;
+    int alloc_tests_mode = 0;
+    size_t range_sizes[MAX_SWEEP];
+    int num_range_sizes = 0;
+    size_t append_size = 0;
+    int inplace_mode = 0;
+    int pin_cpu = -1;
+    int cpu_report_mode = 0;
+    const char *cpu_caps = NULL;
+    cpu_info cpu;
+    int counters_mode = 0;
+    int keysetup_mode = 0;
+    int drbg_mode = 0;
+    size_t drbg_lengths[MAX_SWEEP] = DRBG_DEFAULT_LENGTHS;
+    int num_drbg_lengths = DRBG_NUM_DEFAULT_LENGTHS;
+    int iv_thread_counts[MAX_SWEEP];
+    int num_iv_thread_counts = 0;
+    const char *batch_path = NULL;
+    const char *serve_path = NULL;
+    const char *key_file = NULL;
+    const char *run_log_path = NULL;
+    const char *metrics_path = NULL;
+    int service_clients[MAX_SWEEP];
+    int num_service_clients = 0;
+    int commit_batches[MAX_SWEEP];
+    int num_commit_batches = 0;
+    size_t verify_batches[MAX_SWEEP];
+    int num_verify_batches = 0;
+    int dudect_measurements = 0;
+    int batch_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int num_thread_counts = 0;
+    int numa_thread_counts[MAX_SWEEP];
+    int num_numa_thread_counts = 0;
+    int opt;
+    
+    static struct option long_options[] = {
+        {"stream",     no_argument,       NULL, 's'},
+        {"chunk-size", required_argument, NULL, 'c'},
+        {"fused",      no_argument,       NULL, 'f'},
+        {"block-size", required_argument, NULL, 'b'},
+        {"pool",       no_argument,       NULL, 'p'},
+        {"latency",    no_argument,       NULL, 'l'},
+        {"kernels",    no_argument,       NULL, 'Q'},
+        {"msg-size",   required_argument, NULL, 'm'},
+        {"messages",   required_argument, NULL, 'n'},
+        {"threads",    required_argument, NULL, 't'},
+        {"numa",       required_argument, NULL, 'N'},
+        {"batch",      required_argument, NULL, 'B'},
+        {"io",         no_argument,       NULL, 'i'},
+        {"pipeline",   no_argument,       NULL, 'a'},
+        {"depth",      required_argument, NULL, 'd'},
+        {"segments",   required_argument, NULL, 'S'},
+        {"container",  required_argument, NULL, 'X'},
+        {"append",     required_argument, NULL, 'Y'},
+        {"alloc",      required_argument, NULL, 'A'},
+        {"alloc-tests", no_argument,      NULL, 'T'},
+        {"in-place",   no_argument,       NULL, 'I'},
+        {"counters",   no_argument,       NULL, 'k'},
+        {"key-setup",  no_argument,       NULL, 'K'},
+        {"drbg",       no_argument,       NULL, 'D'},
+        {"lengths",    required_argument, NULL, 'L'},
+        {"iv-gen",     required_argument, NULL, 'G'},
+        {"files",      required_argument, NULL, 'F'},
+        {"workers",    required_argument, NULL, 'W'},
+        {"warmup",     required_argument, NULL, 'w'},
+        {"min-runs",   required_argument, NULL, 'r'},
+        {"max-runs",   required_argument, NULL, 'R'},
+        {"ci",         required_argument, NULL, 'C'},
+        {"cpu",        required_argument, NULL, 'P'},
+        {"cpu-report", no_argument,       NULL, 'U'},
+        {"cpu-caps",   required_argument, NULL, 'Z'},
+        {"serve",      required_argument, NULL, 'V'},
+        {"key-file",   required_argument, NULL, 'e'},
+        {"service-bench", required_argument, NULL, 'O'},
+        {"commit-rounds", required_argument, NULL, 'M'},
+        {"commit-verify", required_argument, NULL, 'H'},
+        {"dudect", required_argument, NULL, 'J'},
+        {"run-log",    required_argument, NULL, 'j'},
+        {"metrics",    required_argument, NULL, 'o'},
+        {"help",       no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    
+    // Ahead of every OpenSSL call, so --latency can count allocations
+    bench_count_crypto_allocs();
+    
+    while ((opt = getopt_long(argc, argv, "sc:fb:plQm:n:t:N:B:iad:S:X:A:TIkKDL:G:F:W:w:r:R:C:P:UZ:V:e:O:M:H:J:Y:j:o:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                stream_mode = 1;
+                break;
+            case 'c':
+                stream_mode = 1;
+                num_chunk_sizes = parse_size_list(optarg, chunk_sizes, MAX_SWEEP);
+                if (num_chunk_sizes < 0) return 1;
+                break;
+            case 'f':
+                fused_mode = 1;
+                break;
+            case 'b':
+                fused_mode = 1;
+                num_block_sizes = parse_size_list(optarg, block_sizes, MAX_SWEEP);
+                if (num_block_sizes < 0) return 1;
+                break;
+            case 'p':
+                pool_mode = 1;
+                break;
+            case 'l':
+                latency_mode = 1;
+                break;
+            case 'Q':
+                kernel_mode = 1;
+                break;
+            case 'm':
+                num_msg_sizes = parse_size_list(optarg, msg_sizes, MAX_SWEEP);
+                if (num_msg_sizes < 0) return 1;
+                break;
+            case 'n':
+                num_messages = atoi(optarg);
+                if (num_messages <= 0) {
+                    fprintf(stderr, "Invalid message count: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'i':
+                io_mode = 1;
+                break;
+            case 'a':
+                pipeline_mode = 1;
+                break;
+            case 'd':
+                pipeline_depth = atoi(optarg);
+                if (pipeline_depth < 2 || pipeline_depth > PIPELINE_MAX_DEPTH) {
+                    fprintf(stderr, "Pipeline depth must be between 2 and %d: %s\n", PIPELINE_MAX_DEPTH, optarg);
+                    return 1;
+                }
+                break;
+            case 'S':
+                num_segment_sizes = parse_size_list(optarg, segment_sizes, MAX_SWEEP);
+                if (num_segment_sizes < 0) return 1;
+                break;
+            case 'X':
+                num_range_sizes = parse_size_list(optarg, range_sizes, MAX_SWEEP);
+                if (num_range_sizes < 0) return 1;
+                break;
+            case 'Y':
+                append_size = parse_size(optarg);
+                if (append_size == 0) {
+                    fprintf(stderr, "Invalid append size: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'A': {
+                int kind = arena_parse_kind(optarg);
+                if (kind < 0) {
+                    fprintf(stderr, "Unknown allocator (malloc, aligned or huge): %s\n", optarg);
+                    return 1;
+                }
+                arena_set_kind(kind);
+                break;
+            }
+            case 'T':
+                alloc_tests_mode = 1;
+                break;
+            case 'I':
+                inplace_mode = 1;
+                break;
+            case 'B':
+                num_batch_sizes = parse_size_list(optarg, batch_sizes, MAX_SWEEP);
+                if (num_batch_sizes < 0) return 1;
+                break;
+            case 't': {
+                size_t counts[MAX_SWEEP];
+                num_thread_counts = parse_size_list(optarg, counts, MAX_SWEEP);
+                if (num_thread_counts < 0) return 1;
+                for (int i = 0; i < num_thread_counts; i++) {
+                    if (counts[i] < 1 || counts[i] > PARALLEL_MAX_THREADS) {
+                        fprintf(stderr, "Thread counts must be between 1 and %d: %s\n", PARALLEL_MAX_THREADS, optarg);
+                        return 1;
+                    }
+                    thread_counts[i] = (int)counts[i];
+                }
+                break;
+            }
+            case 'N': {
+                size_t counts[MAX_SWEEP];
+                num_numa_thread_counts = parse_size_list(optarg, counts, MAX_SWEEP);
+                if (num_numa_thread_counts < 0) return 1;
+                for (int i = 0; i < num_numa_thread_counts; i++) {
+                    if (counts[i] < 1 || counts[i] > PARALLEL_MAX_THREADS) {
+                        fprintf(stderr, "Thread counts must be between 1 and %d\n", PARALLEL_MAX_THREADS);
+                        return 1;
+                    }
+                    numa_thread_counts[i] = (int)counts[i];
+                }
+                break;
+            }
+            case 'k':
+                counters_mode = 1;
+                break;
+            case 'K':
+                keysetup_mode = 1;
+                break;
+            case 'D':
+                drbg_mode = 1;
+                break;
+            case 'L':
+                drbg_mode = 1;
+                num_drbg_lengths = parse_size_list(optarg, drbg_lengths, MAX_SWEEP);
+                if (num_drbg_lengths < 0) return 1;
+                break;
+            case 'G': {
+                size_t counts[MAX_SWEEP];
+                num_iv_thread_counts = parse_size_list(optarg, counts, MAX_SWEEP);
+                if (num_iv_thread_counts < 0) return 1;
+                for (int i = 0; i < num_iv_thread_counts; i++) {
+                    if (counts[i] > RAND_POOL_MAX_THREADS) {
+                        fprintf(stderr, "At most %d threads are supported\n", RAND_POOL_MAX_THREADS);
+                        return 1;
+                    }
+                    iv_thread_counts[i] = (int)counts[i];
+                }
+                break;
+            }
+            case 'F':
+                batch_path = optarg;
+                break;
+            case 'W':
+                batch_workers = atoi(optarg);
+                if (batch_workers < 1 || batch_workers > FILEBATCH_MAX_WORKERS) {
+                    fprintf(stderr, "Worker count must be between 1 and %d: %s\n", FILEBATCH_MAX_WORKERS, optarg);
+                    return 1;
+                }
+                break;
+            case 'w':
+                bench_settings.warmup_runs = atoi(optarg);
+                if (bench_settings.warmup_runs < 0) {
+                    fprintf(stderr, "Invalid warm-up count: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'r':
+            case 'R': {
+                int runs = atoi(optarg);
+                if (runs <= 0 || runs > BENCH_MAX_RUNS) {
+                    fprintf(stderr, "Run count must be between 1 and %d: %s\n", BENCH_MAX_RUNS, optarg);
+                    return 1;
+                }
+                if (opt == 'r') bench_settings.min_runs = runs;
+                else bench_settings.max_runs = runs;
+                break;
+            }
+            case 'C':
+                bench_settings.ci_target = atof(optarg) / 100.0;
+                if (bench_settings.ci_target <= 0) {
+                    fprintf(stderr, "Invalid confidence interval target: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'P':
+                pin_cpu = atoi(optarg);
+                break;
+            case 'U':
+                cpu_report_mode = 1;
+                break;
+            case 'Z':
+                cpu_caps = optarg;
+                break;
+            case 'V':
+                serve_path = optarg;
+                break;
+            case 'e':
+                key_file = optarg;
+                break;
+            case 'O': {
+                size_t counts[MAX_SWEEP];
+                num_service_clients = parse_size_list(optarg, counts, MAX_SWEEP);
+                if (num_service_clients < 0) return 1;
+                for (int i = 0; i < num_service_clients; i++) {
+                    if (counts[i] < 1 || counts[i] > 1024) {
+                        fprintf(stderr, "Client count must be between 1 and 1024: %s\n", optarg);
+                        return 1;
+                    }
+                    service_clients[i] = (int)counts[i];
+                }
+                break;
+            }
+            case 'M': {
+                size_t counts[MAX_SWEEP];
+                num_commit_batches = parse_size_list(optarg, counts, MAX_SWEEP);
+                if (num_commit_batches < 0) return 1;
+                for (int i = 0; i < num_commit_batches; i++) {
+                    if (counts[i] < 1 || counts[i] > COMMIT_MAX_ROUNDS) {
+                        fprintf(stderr, "Batch size must be between 1 and %d rounds: %s\n", COMMIT_MAX_ROUNDS, optarg);
+                        return 1;
+                    }
+                    commit_batches[i] = (int)counts[i];
+                }
+                break;
+            }
+            case 'H':
+                num_verify_batches = parse_size_list(optarg, verify_batches, MAX_SWEEP);
+                if (num_verify_batches < 0) return 1;
+                break;
+            case 'J':
+                dudect_measurements = atoi(optarg);
+                if (dudect_measurements <= 0) {
+                    fprintf(stderr, "Invalid measurement count: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'j':
+                run_log_path = optarg;
+                break;
+            case 'o':
+                metrics_path = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    
+    if (bench_settings.max_runs < bench_settings.min_runs) {
+        bench_settings.max_runs = bench_settings.min_runs;
+    }
+    if (pin_cpu >= 0 && bench_pin_cpu(pin_cpu) != 0) return 1;
+    if (cpu_caps && cpu_force_caps(cpu_caps, argv) != 0) return 1;
     
     // Allow specifying test file as command line argument
-    if (argc > 1) {
-        test_file = argv[1];
+    if (optind < argc) {
+        test_file = argv[optind];
     } else {
         test_file = "testfile_10MB.bin";  // Default file
     }
@@ -438,18 +1902,102 @@ int main(int argc, char *argv[]) {
     printf("  Student: Nicolas Leone (1986354)\n");
     printf("=================================================================\n\n");
     
-    // Generate random master key
-    if (RAND_bytes(master_key, KEY_SIZE) != 1) {
-        fprintf(stderr, "Error generating random master key\n");
-        return 1;
+    if (key_file) {
+        // Service keys have to survive restarts: the master key comes from a file
+        FILE *fp = fopen(key_file, "rb");
+        size_t got = fp ? fread(master_key, 1, KEY_SIZE, fp) : 0;
+        if (fp) fclose(fp);
+        if (got != KEY_SIZE) {
+            fprintf(stderr, "Cannot read a %d-byte master key from %s\n", KEY_SIZE, key_file);
+            return 1;
+        }
+        printf("Loaded 256-bit master key from %s\n", key_file);
+    } else {
+        // Generate random master key
+        if (RAND_bytes(master_key, KEY_SIZE) != 1) {
+            fprintf(stderr, "Error generating random master key\n");
+            return 1;
+        }
+        
+        printf("Generated 256-bit random master key: ");
+        for (int i = 0; i < KEY_SIZE; i++) {
+            printf("%02x", master_key[i]);
+        }
+        printf("\n");
+        if (serve_path) printf("Warning: no --key-file, ciphertexts will not decrypt after a restart\n");
+    }
+    printf("All working keys will be derived from this master key using HKDF.\n");
+    printf("Cycle counter: %s", bench_cycle_source());
+    if (bench_settings.cpu >= 0) printf(", pinned to CPU %d", bench_settings.cpu);
+    printf("\n");
+    cpu_probe(&cpu);
+    {
+        char features[256];
+        cpu_feature_names(cpu.features, features, sizeof(features));
+        printf("CPU: %s; libcrypto features: %s%s%s%s\n", cpu.brand, features,
+               cpu.caps_mask ? " (" CPU_CAPS_ENV "=" : "", cpu.caps_mask ? cpu.caps_mask : "",
+               cpu.caps_mask ? ")" : "");
     }
     
-    printf("Generated 256-bit random master key: ");
-    for (int i = 0; i < KEY_SIZE; i++) {
-        printf("%02x", master_key[i]);
+    // From here on the per-run lines go through the metrics ring
+    {
+        FILE *run_log = NULL;
+        
+        if (run_log_path && !(run_log = fopen(run_log_path, "w"))) {
+            perror("Cannot open the run log");
+            return 1;
+        }
+        if (metrics_start(run_log) != 0) return 1;
+    }
+    if (metrics_path) {
+        if (metrics_serve(metrics_path) != 0) return 1;
+        printf("Live counters on %s\n", metrics_path);
+    }
+    
+    if (serve_path) {
+        return service_run(serve_path, master_key, batch_workers);
+    }
+    if (batch_path) {
+        return run_file_batch(batch_path, batch_workers, master_key);
+    }
+    if (pipeline_mode) {
+        return run_pipeline_tests(test_file, chunk_sizes, num_chunk_sizes, pipeline_depth, master_key);
+    }
+    if (num_range_sizes > 0) {
+        return run_container_tests(test_file, range_sizes, num_range_sizes,
+                                   num_messages / 100 > 0 ? num_messages / 100 : 1, master_key);
+    }
+    if (append_size > 0) {
+        return run_append_tests(test_file, append_size, master_key);
+    }
+    if (num_segment_sizes > 0) {
+        return run_segment_tests(test_file, segment_sizes, num_segment_sizes, master_key);
+    }
+    if (stream_mode) {
+        return run_stream_tests(test_file, chunk_sizes, num_chunk_sizes, master_key);
+    }
+    if (io_mode) {
+        return run_io_tests(test_file, master_key);
+    }
+    if (keysetup_mode) {
+        return run_key_setup_tests(test_file, num_messages, master_key);
+    }
+    if (drbg_mode) {
+        return run_drbg_tests(drbg_lengths, num_drbg_lengths);
+    }
+    if (num_commit_batches > 0) {
+        return run_commit_tests(commit_batches, num_commit_batches,
+                                num_messages / 100 > 0 ? num_messages / 100 : 1);
+    }
+    if (num_verify_batches > 0) {
+        return run_commit_verify_tests(verify_batches, num_verify_batches);
+    }
+    if (dudect_measurements > 0) {
+        return run_dudect_tests(dudect_measurements, master_key);
+    }
+    if (num_iv_thread_counts > 0) {
+        return run_iv_tests(iv_thread_counts, num_iv_thread_counts, num_messages);
     }
-    printf("\n");
-    printf("All working keys will be derived from this master key using HKDF.\n");
     
     // Load test file
     printf("\nLoading test file: %s...\n", test_file);
@@ -460,43 +2008,131 @@ int main(int argc, char *argv[]) {
     }
     printf("Loaded %s: %d bytes (%.2f MB)\n", 
            test_file, plaintext_len, plaintext_len / (1024.0 * 1024.0));
+    if (arena_get_kind() != ARENA_MALLOC) {
+        unsigned char *payload = arena_alloc(plaintext_len);
+        if (!payload) {
+            free(plaintext);
+            return 1;
+        }
+        memcpy(payload, plaintext, plaintext_len);
+        free(plaintext);
+        plaintext = payload;
+        printf("Payload buffers: %s arena (%.0f MB of the input on huge pages)\n",
+               arena_kind_name(arena_get_kind()), arena_huge_bytes(plaintext) / (1024.0 * 1024.0));
+    }
+    
+    if (alloc_tests_mode) {
+        int ret = run_alloc_tests(test_file, plaintext, plaintext_len, master_key);
+        arena_free(plaintext);
+        return ret;
+    }
+    
+    if (counters_mode) {
+        int ret = run_phase_tests(test_file, plaintext, plaintext_len, master_key);
+        arena_free(plaintext);
+        return ret;
+    }
+    
+    if (inplace_mode) {
+        int ret = run_inplace_tests(test_file, plaintext, plaintext_len, master_key);
+        arena_free(plaintext);
+        return ret;
+    }
+    
+    if (pool_mode) {
+        int ret = run_pool_tests(test_file, plaintext, plaintext_len, msg_sizes, num_msg_sizes,
+                                 num_messages, master_key);
+        arena_free(plaintext);
+        return ret;
+    }
+    
+    if (cpu_report_mode) {
+        int ret = run_cpu_report(test_file, plaintext, plaintext_len, msg_sizes, num_msg_sizes, master_key);
+        arena_free(plaintext);
+        return ret;
+    }
+    
+    if (num_service_clients > 0) {
+        int ret = run_service_tests(test_file, plaintext, plaintext_len, service_clients, num_service_clients,
+                                    msg_sizes, num_msg_sizes, num_messages, batch_workers, master_key);
+        arena_free(plaintext);
+        return ret;
+    }
+    
+    if (kernel_mode) {
+        int ret = run_kernel_tests(test_file, plaintext, plaintext_len, msg_sizes, num_msg_sizes,
+                                   num_messages, master_key);
+        arena_free(plaintext);
+        return ret;
+    }
+    
+    if (latency_mode) {
+        int ret = run_latency_tests(test_file, plaintext, plaintext_len, msg_sizes, num_msg_sizes,
+                                    num_messages, master_key);
+        arena_free(plaintext);
+        return ret;
+    }
+    
+    if (num_batch_sizes > 0) {
+        int ret = run_batch_tests(test_file, plaintext, plaintext_len, msg_sizes, num_msg_sizes,
+                                  batch_sizes, num_batch_sizes, num_messages, master_key);
+        arena_free(plaintext);
+        return ret;
+    }
+    
+    if (num_numa_thread_counts > 0) {
+        int ret = run_numa_tests(test_file, plaintext, plaintext_len,
+                                 numa_thread_counts, num_numa_thread_counts, master_key);
+        arena_free(plaintext);
+        return ret;
+    }
+    
+    if (num_thread_counts > 0) {
+        int ret = run_parallel_tests(test_file, plaintext, plaintext_len,
+                                     thread_counts, num_thread_counts, master_key);
+        arena_free(plaintext);
+        return ret;
+    }
+    
+    if (fused_mode) {
+        int ret = run_fused_tests(test_file, plaintext, plaintext_len,
+                                  block_sizes, num_block_sizes, master_key);
+        arena_free(plaintext);
+        return ret;
+    }
     
     // Open results file with filename based on test file
     char results_filename[256];
-    const char *base_name = strrchr(test_file, '/');
-    base_name = base_name ? base_name + 1 : test_file;
-    snprintf(results_filename, sizeof(results_filename), "results_%s.csv", base_name);
-    
-    results_file = fopen(results_filename, "w");
+    results_file = open_results_file("", test_file,
+                                     "Algorithm,Avg_Encryption_us,Avg_Decryption_us,Min_Enc_us,Max_Enc_us,Min_Dec_us,Max_Dec_us,"
+                                     BENCH_CSV_COLUMNS,
+                                     results_filename, sizeof(results_filename));
     if (!results_file) {
-        perror("Cannot create results file");
-        free(plaintext);
+        arena_free(plaintext);
         return 1;
     }
-    fprintf(results_file, "Algorithm,Avg_Encryption_us,Avg_Decryption_us,Min_Enc_us,Max_Enc_us,Min_Dec_us,Max_Dec_us\n");
     
     printf("\n=================================================================\n");
-    printf("  Starting Performance Tests (%d runs per algorithm)\n", NUM_RUNS);
+    printf("  Starting Performance Tests (%d-%d runs per algorithm)\n",
+           bench_settings.min_runs, bench_settings.max_runs);
     printf("=================================================================\n");
     
-    // Test all four configurations
-    test_algorithm("AES-128-CTR + HMAC-SHA256", 1, plaintext, plaintext_len, master_key, results_file);
-    printf("\n-----------------------------------------------------------------\n");
-    
-    test_algorithm("ChaCha20 + HMAC-SHA256", 2, plaintext, plaintext_len, master_key, results_file);
-    printf("\n-----------------------------------------------------------------\n");
-    
-    test_algorithm("AES-128-GCM", 3, plaintext, plaintext_len, master_key, results_file);
-    printf("\n-----------------------------------------------------------------\n");
-    
-    test_algorithm("ChaCha20-Poly1305", 4, plaintext, plaintext_len, master_key, results_file);
+    // Test every registered configuration
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        if (algo_type > 1) printf("\n-----------------------------------------------------------------\n");
+        if (!algo_available(algo_type)) {
+            printf("\n%s: skipped (not available in this OpenSSL build)\n", algo_name(algo_type));
+            continue;
+        }
+        test_algorithm(algo_name(algo_type), algo_type, plaintext, plaintext_len, master_key, results_file, NULL, NULL, NULL);
+    }
     printf("\n=================================================================\n");
     
     printf("\n✓ All tests completed successfully!\n");
     printf("✓ Results saved to %s\n\n", results_filename);
     
     fclose(results_file);
-    free(plaintext);
+    arena_free(plaintext);
     
     return 0;
 }
@@ -0,0 +1,140 @@
+#include "alloc_bench.h"
+#include "arena.h"
+#include "bench.h"
+#include "ciphers.h"
+#include "counters.h"
+#include "randpool.h"
+
+#include <openssl/evp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    double enc_us, dec_us;
+    double page_faults, dtlb_misses;  // Per round trip
+} alloc_timing;
+
+// One encrypt + decrypt of the whole buffer; -1 on a verification failure
+static int round_trip(int algo_type, const unsigned char *plaintext, int plaintext_len,
+                      unsigned char *enc_key, unsigned char *mac_key,
+                      unsigned char *ciphertext, unsigned char *decryptedtext,
+                      const counter_set *cs, alloc_timing *acc) {
+    unsigned char iv[MAX_IV_SIZE];
+    unsigned char tag[HMAC_TAG_SIZE];
+    counter_values before, after, delta;
+    struct timespec t0, t1, t2;
+    int ciphertext_len, decryptedtext_len;
+
+    memset(&delta, 0, sizeof(delta));
+    rand_pool_bytes(iv, algo_iv_len(algo_type));
+    counters_read(cs, &before);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    ciphertext_len = algo_encrypt(algo_type, (unsigned char *)plaintext, plaintext_len, enc_key, mac_key,
+                                  iv, ciphertext, tag);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    decryptedtext_len = algo_decrypt(algo_type, ciphertext, ciphertext_len, enc_key, mac_key, iv, tag,
+                                     decryptedtext);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    counters_read(cs, &after);
+    counters_accumulate(&delta, &before, &after);
+
+    acc->enc_us += elapsed_ns(&t0, &t1) / 1000.0;
+    acc->dec_us += elapsed_ns(&t1, &t2) / 1000.0;
+    acc->page_faults += delta.value[COUNTER_PAGE_FAULTS];
+    acc->dtlb_misses += delta.value[COUNTER_DTLB_MISSES];
+    return (decryptedtext_len == plaintext_len &&
+            memcmp(plaintext, decryptedtext, plaintext_len) == 0) ? 0 : -1;
+}
+
+static void format_counter(char *out, size_t len, const counter_set *cs, int which, double value) {
+    if (counter_available(cs, which)) snprintf(out, len, "%.0f", value);
+    else snprintf(out, len, "NA");
+}
+
+int run_alloc_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                    unsigned char *master_key) {
+    size_t buffer_len = plaintext_len + EVP_MAX_BLOCK_LENGTH;
+    int runs = bench_settings.min_runs;
+    char results_filename[256];
+    FILE *results_file;
+    counter_set cs;
+
+    counters_open(&cs);
+    results_file = open_results_file("alloc_", test_file,
+                                     "Allocator,Algorithm,Huge_MB,Runs,First_Enc_us,First_Dec_us,First_Page_Faults,"
+                                     "First_dTLB_Misses,Avg_Enc_us,Avg_Dec_us,Page_Faults_per_Run,dTLB_Misses_per_Run",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) {
+        counters_close(&cs);
+        return 1;
+    }
+
+    printf("\n=================================================================\n");
+    printf("  Payload allocators: malloc vs aligned 4K vs huge pages (%d runs)\n", runs);
+    printf("  First = first round trip after allocating the buffers; counters:%s%s\n",
+           counter_available(&cs, COUNTER_PAGE_FAULTS) ? " page-faults" : "",
+           counter_available(&cs, COUNTER_DTLB_MISSES) ? " dTLB-load-misses" : " (no dTLB counter)");
+    printf("=================================================================\n");
+
+    for (int kind = 0; kind < NUM_ARENA_KINDS; kind++) {
+        unsigned char *input = arena_alloc_kind(kind, plaintext_len);
+
+        if (!input) continue;
+        memcpy(input, plaintext, plaintext_len);
+        printf("\n%s:\n", arena_kind_name(kind));
+        printf("  %-28s %7s %11s %11s %8s %11s %11s %8s %10s\n", "Algorithm", "Huge MB",
+               "1st enc μs", "1st dec μs", "1st PF", "Avg enc μs", "Avg dec μs", "PF/run", "dTLB/run");
+
+        for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+            unsigned char enc_key[KEY_SIZE];
+            unsigned char mac_key[HMAC_KEY_SIZE];
+            alloc_timing first = {0}, steady = {0};
+            unsigned char *ciphertext, *decryptedtext;
+            char first_pf[32], first_tlb[32], pf[32], tlb[32];
+            double huge_mb;
+            int failed = 0;
+
+            if (!algo_available(algo_type)) continue;
+            derive_algo_keys(master_key, algo_name(algo_type), algo_type, enc_key, mac_key);
+            ciphertext = arena_alloc_kind(kind, buffer_len);
+            decryptedtext = arena_alloc_kind(kind, buffer_len);
+            if (!ciphertext || !decryptedtext) {
+                perror("Memory allocation failed");
+                arena_free(ciphertext);
+                arena_free(decryptedtext);
+                break;
+            }
+            huge_mb = (arena_huge_bytes(input) + arena_huge_bytes(ciphertext) +
+                       arena_huge_bytes(decryptedtext)) / (1024.0 * 1024.0);
+
+            failed |= round_trip(algo_type, input, plaintext_len, enc_key, mac_key, ciphertext,
+                                 decryptedtext, &cs, &first);
+            for (int run = 0; run < runs; run++) {
+                failed |= round_trip(algo_type, input, plaintext_len, enc_key, mac_key, ciphertext,
+                                     decryptedtext, &cs, &steady);
+            }
+            arena_free(ciphertext);
+            arena_free(decryptedtext);
+
+            format_counter(first_pf, sizeof(first_pf), &cs, COUNTER_PAGE_FAULTS, first.page_faults);
+            format_counter(first_tlb, sizeof(first_tlb), &cs, COUNTER_DTLB_MISSES, first.dtlb_misses);
+            format_counter(pf, sizeof(pf), &cs, COUNTER_PAGE_FAULTS, steady.page_faults / runs);
+            format_counter(tlb, sizeof(tlb), &cs, COUNTER_DTLB_MISSES, steady.dtlb_misses / runs);
+            printf("  %-28s %7.0f %11.0f %11.0f %8s %11.0f %11.0f %8s %10s %s\n", algo_name(algo_type),
+                   huge_mb, first.enc_us, first.dec_us, first_pf, steady.enc_us / runs,
+                   steady.dec_us / runs, pf, tlb, failed ? "Verification FAILED!" : "[OK]");
+            fprintf(results_file, "%s,%s,%.0f,%d,%.1f,%.1f,%s,%s,%.1f,%.1f,%s,%s\n",
+                    arena_kind_name(kind), algo_name(algo_type), huge_mb, runs, first.enc_us,
+                    first.dec_us, first_pf, first_tlb, steady.enc_us / runs, steady.dec_us / runs, pf, tlb);
+        }
+        arena_free(input);
+        arena_trim();
+    }
+
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    counters_close(&cs);
+    return 0;
+}
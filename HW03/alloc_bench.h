@@ -0,0 +1,13 @@
+#ifndef HW03_ALLOC_BENCH_H
+#define HW03_ALLOC_BENCH_H
+
+// Payload allocator comparison: for every arena kind (arena.h) the loaded
+// file is copied into a buffer of that kind and every algorithm gets its
+// ciphertext and decrypt buffers from it, the way test_algorithm does. The
+// first round trip after the allocation (first touch) is timed apart from
+// the steady-state runs, each with its page faults and dTLB load misses
+// (counters.h, where available). Writes results_alloc_<file>.csv.
+int run_alloc_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                    unsigned char *master_key);
+
+#endif
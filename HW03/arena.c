@@ -0,0 +1,178 @@
+#include "arena.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+typedef struct {
+    unsigned char *base;
+    size_t map_len;
+    arena_kind kind;
+    int in_use;
+    int hugetlb;  // MAP_HUGETLB mapping (counts as huge without asking smaps)
+} arena_region;
+
+static arena_region regions[ARENA_MAX_REGIONS];
+static pthread_mutex_t arena_lock = PTHREAD_MUTEX_INITIALIZER;
+static arena_kind current_kind = ARENA_MALLOC;
+
+static const char *kind_names[NUM_ARENA_KINDS] = {"malloc", "aligned", "huge"};
+
+void arena_set_kind(arena_kind kind) {
+    current_kind = kind;
+}
+
+arena_kind arena_get_kind(void) {
+    return current_kind;
+}
+
+const char *arena_kind_name(arena_kind kind) {
+    return kind_names[kind];
+}
+
+int arena_parse_kind(const char *name) {
+    for (int i = 0; i < NUM_ARENA_KINDS; i++) {
+        if (strcmp(name, kind_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+static size_t round_up(size_t len, size_t unit) {
+    return (len + unit - 1) / unit * unit;
+}
+
+// Write one byte per 4K page so every page is faulted in before timing
+static void prefault(unsigned char *base, size_t len) {
+    long page = sysconf(_SC_PAGESIZE);
+    for (size_t off = 0; off < len; off += page) ((volatile unsigned char *)base)[off] = 0;
+}
+
+// Map a new region of kind for len bytes, 0 on success
+static int region_map(arena_region *r, arena_kind kind, size_t len) {
+    unsigned char *base;
+
+    memset(r, 0, sizeof(*r));
+    r->kind = kind;
+    if (kind == ARENA_HUGE) {
+        r->map_len = round_up(len, ARENA_HUGE_PAGE);
+#ifdef MAP_HUGETLB
+        base = mmap(NULL, r->map_len, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (base != MAP_FAILED) {
+            r->base = base;
+            r->hugetlb = 1;
+            return 0;
+        }
+#endif
+        // No reserved hugetlbfs pages: over-map, trim to a 2MB-aligned
+        // window and ask for transparent huge pages before the first touch
+        size_t span = r->map_len + ARENA_HUGE_PAGE;
+        unsigned char *raw = mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) return -1;
+        base = (unsigned char *)round_up((uintptr_t)raw, ARENA_HUGE_PAGE);
+        if (base > raw) munmap(raw, base - raw);
+        if (raw + span > base + r->map_len) munmap(base + r->map_len, raw + span - (base + r->map_len));
+#ifdef MADV_HUGEPAGE
+        madvise(base, r->map_len, MADV_HUGEPAGE);
+#endif
+    } else {
+        r->map_len = round_up(len, (size_t)sysconf(_SC_PAGESIZE));
+        base = mmap(NULL, r->map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) return -1;
+#ifdef MADV_NOHUGEPAGE
+        madvise(base, r->map_len, MADV_NOHUGEPAGE);
+#endif
+    }
+    r->base = base;
+    prefault(base, r->map_len);
+    return 0;
+}
+
+void *arena_alloc(size_t len) {
+    return arena_alloc_kind(current_kind, len);
+}
+
+void *arena_alloc_kind(arena_kind kind, size_t len) {
+    arena_region *best = NULL, *free_slot = NULL;
+
+    if (kind == ARENA_MALLOC) return malloc(len);
+    if (len == 0) len = 1;
+
+    pthread_mutex_lock(&arena_lock);
+    // Smallest cached region of this kind that fits
+    for (int i = 0; i < ARENA_MAX_REGIONS; i++) {
+        arena_region *r = &regions[i];
+        if (!r->base) {
+            if (!free_slot) free_slot = r;
+        } else if (!r->in_use && r->kind == kind && r->map_len >= len &&
+                   (!best || r->map_len < best->map_len)) {
+            best = r;
+        }
+    }
+    if (!best && free_slot && region_map(free_slot, kind, len) == 0) best = free_slot;
+    if (best) best->in_use = 1;
+    pthread_mutex_unlock(&arena_lock);
+
+    if (!best) {
+        fprintf(stderr, "Cannot map a %zu-byte %s arena region\n", len, kind_names[kind]);
+        return NULL;
+    }
+    return best->base;
+}
+
+void arena_free(void *ptr) {
+    if (!ptr) return;
+    pthread_mutex_lock(&arena_lock);
+    for (int i = 0; i < ARENA_MAX_REGIONS; i++) {
+        if (regions[i].base == ptr) {
+            regions[i].in_use = 0;
+            pthread_mutex_unlock(&arena_lock);
+            return;
+        }
+    }
+    pthread_mutex_unlock(&arena_lock);
+    free(ptr);
+}
+
+void arena_trim(void) {
+    pthread_mutex_lock(&arena_lock);
+    for (int i = 0; i < ARENA_MAX_REGIONS; i++) {
+        if (regions[i].base && !regions[i].in_use) {
+            munmap(regions[i].base, regions[i].map_len);
+            memset(&regions[i], 0, sizeof(regions[i]));
+        }
+    }
+    pthread_mutex_unlock(&arena_lock);
+}
+
+size_t arena_huge_bytes(const void *ptr) {
+    const arena_region *region = NULL;
+    uintptr_t start, end;
+    size_t huge_kb = 0;
+    char line[256];
+    int inside = 0;
+    FILE *fp;
+
+    for (int i = 0; i < ARENA_MAX_REGIONS; i++) {
+        if (regions[i].base == ptr) region = &regions[i];
+    }
+    if (!region) return 0;
+    if (region->hugetlb) return region->map_len;
+
+    // Sum AnonHugePages of the smaps entries inside the region
+    if (!(fp = fopen("/proc/self/smaps", "r"))) return 0;
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long kb;
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            inside = start >= (uintptr_t)region->base && end <= (uintptr_t)region->base + region->map_len;
+        } else if (inside && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+            huge_kb += kb;
+        }
+    }
+    fclose(fp);
+    return huge_kb * 1024;
+}
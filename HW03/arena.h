@@ -0,0 +1,49 @@
+#ifndef HW03_ARENA_H
+#define HW03_ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_ALIGN 64                      // Cache line
+#define ARENA_HUGE_PAGE (2 * 1024 * 1024)   // x86-64 / arm64 PMD huge page
+#define ARENA_MAX_REGIONS 32
+
+// Where the benchmark payload buffers (plaintext, ciphertext and decrypt
+// buffers of test_algorithm) come from:
+//   malloc   plain malloc, as before: glibc maps large buffers fresh on each
+//            call, so the first run after every allocation pays the page
+//            faults, and whether THP backs them depends on the system setting
+//   aligned  mmap regions on 4K pages (THP disabled), pre-faulted
+//   huge     2MB-aligned regions, hugetlbfs pages when some are reserved
+//            (vm.nr_hugepages), transparent huge pages otherwise, pre-faulted
+typedef enum {
+    ARENA_MALLOC,
+    ARENA_ALIGNED,
+    ARENA_HUGE,
+    NUM_ARENA_KINDS
+} arena_kind;
+
+// Kind used by arena_alloc (default ARENA_MALLOC)
+void arena_set_kind(arena_kind kind);
+arena_kind arena_get_kind(void);
+
+// "malloc", "aligned" or "huge"; arena_parse_kind returns -1 for anything else
+const char *arena_kind_name(arena_kind kind);
+int arena_parse_kind(const char *name);
+
+// At least ARENA_ALIGN-aligned, NULL on failure. Regions are kept on free
+// and handed out again to later requests of the same kind that fit, already
+// faulted in, so repeated test_algorithm calls see identical memory.
+void *arena_alloc(size_t len);
+void *arena_alloc_kind(arena_kind kind, size_t len);
+
+// Also takes pointers from malloc, which it passes to free()
+void arena_free(void *ptr);
+
+// Unmap every cached region that is not in use
+void arena_trim(void);
+
+// Bytes of ptr's region backed by huge pages (hugetlbfs or THP, from
+// /proc/self/smaps), 0 for malloc pointers or when unknown
+size_t arena_huge_bytes(const void *ptr);
+
+#endif
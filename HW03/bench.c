@@ -0,0 +1,487 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // sched_setaffinity, CPU_SET
+#endif
+
+#include "bench.h"
+#include "cpuinfo.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Elapsed time in microseconds between two CLOCK_MONOTONIC samples
+long elapsed_us(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1000000L + 
+           (end->tv_nsec - start->tv_nsec) / 1000L;
+}
+
+// Elapsed time in nanoseconds, for per-message measurements
+long long elapsed_ns(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1000000000LL + 
+           (end->tv_nsec - start->tv_nsec);
+}
+
+// Parse a byte count with optional K/M/G suffix (e.g. "64K", "4M")
+size_t parse_size(const char *arg) {
+    char *end;
+    unsigned long long value;
+    
+    if (*arg < '0' || *arg > '9') return 0;  // strtoull would wrap "-1" around
+    value = strtoull(arg, &end, 10);
+    switch (*end) {
+        case 'k': case 'K': value <<= 10; end++; break;
+        case 'm': case 'M': value <<= 20; end++; break;
+        case 'g': case 'G': value <<= 30; end++; break;
+    }
+    if (end == arg || (*end != '\0' && *end != ',')) return 0;
+    return (size_t)value;
+}
+
+// Parse a comma separated list of sizes into sizes[], returns the count or -1
+int parse_size_list(const char *arg, size_t *sizes, int max_sizes) {
+    int count = 0;
+    
+    for (const char *p = arg; p && *p; p = strchr(p, ',') ? strchr(p, ',') + 1 : NULL) {
+        size_t size = parse_size(p);
+        if (size == 0 || size > INT_MAX - EVP_MAX_BLOCK_LENGTH || count == max_sizes) {
+            fprintf(stderr, "Invalid size list: %s\n", arg);
+            return -1;
+        }
+        sizes[count++] = size;
+    }
+    if (count == 0) {
+        fprintf(stderr, "Empty size list\n");
+        return -1;
+    }
+    return count;
+}
+
+bench_config bench_settings = {
+    .warmup_runs = 2, .min_runs = NUM_RUNS, .max_runs = 30, .ci_target = 0.02, .cpu = -1
+};
+
+#ifdef __linux__
+static int perf_fd = -2;  // -2: not opened yet, -1: unavailable
+
+// Hardware cycle counter for this process, inherited by threads created later
+static int perf_cycles_fd(void) {
+    if (perf_fd == -2) {
+        struct perf_event_attr attr;
+        
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.inherit = 1;
+        perf_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (perf_fd < 0) perf_fd = -1;
+    }
+    return perf_fd;
+}
+#endif
+
+// Core cycles from perf_event_open when the kernel allows it, otherwise the
+// time stamp counter (constant rate, so reference cycles rather than core ones)
+static unsigned long long read_cycles(void) {
+#ifdef __linux__
+    unsigned long long count;
+    if (perf_cycles_fd() >= 0 && read(perf_fd, &count, sizeof(count)) == sizeof(count)) return count;
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+const char *bench_cycle_source(void) {
+#ifdef __linux__
+    if (perf_cycles_fd() >= 0) return "perf";
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+    return "rdtsc";
+#else
+    return "none";
+#endif
+}
+
+void bench_mark_now(bench_mark *mark) {
+    clock_gettime(CLOCK_MONOTONIC, &mark->ts);
+    mark->cycles = read_cycles();
+}
+
+void bench_record(bench_samples *samples, const bench_mark *start, const bench_mark *end) {
+    if (samples->n == BENCH_MAX_RUNS) return;
+    samples->us[samples->n] = elapsed_us((struct timespec *)&start->ts, (struct timespec *)&end->ts);
+    samples->cycles[samples->n] = end->cycles - start->cycles;
+    samples->n++;
+}
+
+// Two-sided 95% Student t quantile for df degrees of freedom (df < 1 is
+// clamped to 1: there is no spread to measure yet)
+static double t95(int df) {
+    static const double table[30] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (df < 1) df = 1;
+    return (df <= 30) ? table[df - 1] : 1.96;
+}
+
+static void mean_sd(const bench_samples *samples, double *mean, double *sd) {
+    double sum = 0, sq = 0;
+    
+    for (int i = 0; i < samples->n; i++) sum += samples->us[i];
+    *mean = sum / samples->n;
+    for (int i = 0; i < samples->n; i++) sq += (samples->us[i] - *mean) * (samples->us[i] - *mean);
+    *sd = (samples->n > 1) ? sqrt(sq / (samples->n - 1)) : 0;
+}
+
+int bench_converged(const bench_samples *samples) {
+    double mean, sd;
+    
+    if (samples->n < bench_settings.min_runs) return 0;
+    if (samples->n >= bench_settings.max_runs) return 1;
+    if (samples->n < 2) return 0;  // One run has no confidence interval
+    mean_sd(samples, &mean, &sd);
+    if (mean <= 0) return 1;  // Below the clock resolution, nothing to refine
+    return t95(samples->n - 1) * sd / sqrt(samples->n) <= bench_settings.ci_target * mean;
+}
+
+int bench_pin_cpu(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        perror("Cannot pin to CPU");
+        return -1;
+    }
+    bench_settings.cpu = cpu;
+    return 0;
+#else
+    (void)cpu;
+    fprintf(stderr, "CPU pinning is not supported on this platform\n");
+    return -1;
+#endif
+}
+
+// Peak resident set size of this process in MB
+double peak_rss_mb(void) {
+    struct rusage usage;
+    
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);  // bytes on macOS
+#else
+    return usage.ru_maxrss / 1024.0;  // kilobytes on Linux
+#endif
+}
+
+static unsigned long crypto_allocs;
+
+static void *counting_malloc(size_t num, const char *file, int line) {
+    __atomic_fetch_add(&crypto_allocs, 1, __ATOMIC_RELAXED);
+    return malloc(num);
+}
+
+static void *counting_realloc(void *addr, size_t num, const char *file, int line) {
+    __atomic_fetch_add(&crypto_allocs, 1, __ATOMIC_RELAXED);
+    return realloc(addr, num);
+}
+
+static void counting_free(void *addr, const char *file, int line) {
+    free(addr);
+}
+
+int bench_count_crypto_allocs(void) {
+    return CRYPTO_set_mem_functions(counting_malloc, counting_realloc, counting_free) ? 0 : -1;
+}
+
+unsigned long bench_crypto_allocs(void) {
+    return __atomic_load_n(&crypto_allocs, __ATOMIC_RELAXED);
+}
+
+// Sample logs keyed by the results CSV they accompany. A slot is reused when
+// fopen hands out the same FILE address again, or round robin when all are taken.
+#define SAMPLE_LOG_SLOTS 8
+static struct {
+    FILE *csv;
+    FILE *log;
+} sample_logs[SAMPLE_LOG_SLOTS];
+static int next_sample_log;
+
+static FILE *sample_log_of(FILE *results_file) {
+    for (int i = 0; i < SAMPLE_LOG_SLOTS; i++) {
+        if (sample_logs[i].csv == results_file) return sample_logs[i].log;
+    }
+    return NULL;
+}
+
+// JSON string literal, escaping quotes, backslashes and control characters
+static void json_string(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (; s && *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(fp, "\\%c", c);
+        else if (c < 0x20) fprintf(fp, "\\u%04x", c);
+        else fputc(c, fp);
+    }
+    fputc('"', fp);
+}
+
+static void json_field(FILE *fp, const char *key, const char *value) {
+    fprintf(fp, ",");
+    json_string(fp, key);
+    fprintf(fp, ":");
+    json_string(fp, value);
+}
+
+// First line of a sample log: what produced the numbers, where and how
+static void write_run_metadata(FILE *fp, const char *mode, const char *test_file,
+                               const char *results_filename, const char *header) {
+    char timestamp[32], features[256], host[256] = "unknown";
+    struct utsname uts;
+    struct stat st;
+    time_t now = time(NULL);
+    cpu_info cpu;
+
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    gethostname(host, sizeof(host) - 1);
+    if (uname(&uts) != 0) memset(&uts, 0, sizeof(uts));
+    cpu_probe(&cpu);
+    cpu_feature_names(cpu.features, features, sizeof(features));
+
+    fprintf(fp, "{\"schema\":\"%s\",\"type\":\"run\"", BENCH_SCHEMA);
+    json_field(fp, "suite", *mode ? mode : "main");
+    json_field(fp, "results_csv", results_filename);
+    json_field(fp, "columns", header);
+    json_field(fp, "timestamp", timestamp);
+    json_field(fp, "host", host);
+    json_field(fp, "os", uts.sysname);
+    json_field(fp, "os_release", uts.release);
+    json_field(fp, "machine", uts.machine);
+    json_field(fp, "cpu", cpu.brand);
+    fprintf(fp, ",\"cpus_online\":%ld", sysconf(_SC_NPROCESSORS_ONLN));
+    json_field(fp, "libcrypto_features", features);
+    json_field(fp, "caps_mask", cpu.caps_mask ? cpu.caps_mask : "");
+    json_field(fp, "openssl", cpu.openssl);
+#ifdef __VERSION__
+    json_field(fp, "compiler", __VERSION__);
+#endif
+#ifdef __OPTIMIZE__
+    fprintf(fp, ",\"optimized\":true");
+#else
+    fprintf(fp, ",\"optimized\":false");
+#endif
+    json_field(fp, "cycle_source", bench_cycle_source());
+    fprintf(fp, ",\"pinned_cpu\":%d,\"warmup_runs\":%d,\"min_runs\":%d,\"max_runs\":%d,\"ci_target\":%g",
+            bench_settings.cpu, bench_settings.warmup_runs, bench_settings.min_runs,
+            bench_settings.max_runs, bench_settings.ci_target);
+    json_field(fp, "test_file", test_file);
+    fprintf(fp, ",\"test_file_bytes\":%lld}\n", stat(test_file, &st) == 0 ? (long long)st.st_size : -1LL);
+}
+
+// Open results_<mode><file>.csv and write its header
+FILE *open_results_file(const char *mode, const char *test_file, const char *header,
+                        char *results_filename, size_t filename_len) {
+    char log_filename[300];
+    FILE *results_file, *log;
+    const char *base_name = strrchr(test_file, '/');
+    base_name = base_name ? base_name + 1 : test_file;
+    snprintf(results_filename, filename_len, "results_%s%s.csv", mode, base_name);
+    
+    results_file = fopen(results_filename, "w");
+    if (!results_file) {
+        perror("Cannot create results file");
+        return NULL;
+    }
+    fprintf(results_file, "%s\n", header);
+    
+    // Sample log next to it; the CSV stays usable without one
+    snprintf(log_filename, sizeof(log_filename), "results_%s%s.jsonl", mode, base_name);
+    log = fopen(log_filename, "w");
+    if (!log) {
+        perror("Cannot create sample log");
+        return results_file;
+    }
+    write_run_metadata(log, mode, test_file, results_filename, header);
+    fflush(log);
+    
+    int slot = -1;
+    for (int i = 0; i < SAMPLE_LOG_SLOTS && slot < 0; i++) {
+        if (sample_logs[i].csv == results_file) slot = i;
+    }
+    if (slot < 0) {
+        slot = next_sample_log;
+        next_sample_log = (next_sample_log + 1) % SAMPLE_LOG_SLOTS;
+    }
+    if (sample_logs[slot].log) fclose(sample_logs[slot].log);
+    sample_logs[slot].csv = results_file;
+    sample_logs[slot].log = log;
+    return results_file;
+}
+
+void bench_log_samples(FILE *results_file, const char *algo_name, const char *params, size_t bytes,
+                       const char *unit, const char **names, const double *const *values,
+                       const int *counts, int num_series) {
+    FILE *log = sample_log_of(results_file);
+
+    if (!log) return;
+    fprintf(log, "{\"type\":\"series\"");
+    json_field(log, "algorithm", algo_name);
+    json_field(log, "params", params ? params : "");
+    fprintf(log, ",\"bytes\":%zu", bytes);
+    json_field(log, "unit", unit);
+    for (int s = 0; s < num_series; s++) {
+        fprintf(log, ",");
+        json_string(log, names[s]);
+        fprintf(log, ":[");
+        for (int i = 0; i < counts[s]; i++) fprintf(log, "%s%.17g", i ? "," : "", values[s][i]);
+        fprintf(log, "]");
+    }
+    fprintf(log, "}\n");
+    fflush(log);
+}
+
+// Raw runs of report_statistics: wall time and cycles of both directions
+static void log_run_samples(const char *algo_name, const bench_samples *enc, const bench_samples *dec,
+                            size_t bytes, const char *csv_prefix, FILE *results_file) {
+    static double columns[4][BENCH_MAX_RUNS];
+    static const char *names[4] = {"enc", "dec", "enc_cycles", "dec_cycles"};
+    const double *values[4] = {columns[0], columns[1], columns[2], columns[3]};
+    const int counts[4] = {enc->n, dec->n, enc->n, dec->n};
+
+    if (!sample_log_of(results_file)) return;
+    for (int i = 0; i < enc->n; i++) {
+        columns[0][i] = enc->us[i];
+        columns[2][i] = (double)enc->cycles[i];
+    }
+    for (int i = 0; i < dec->n; i++) {
+        columns[1][i] = dec->us[i];
+        columns[3][i] = (double)dec->cycles[i];
+    }
+    bench_log_samples(results_file, algo_name, csv_prefix, bytes, "us", names, values, counts, 4);
+}
+
+// Nearest-rank percentile of a sorted series
+static long percentile(const long *sorted, int n, int pct) {
+    int rank = (pct * n + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static int cmp_long(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_ull(const void *a, const void *b) {
+    unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+void bench_latency_summary(long long *ns, int n, bench_latency *out) {
+    double sum = 0;
+    int rank;
+
+    memset(out, 0, sizeof(*out));
+    if (n <= 0) return;
+    qsort(ns, n, sizeof(long long), cmp_ll);
+    for (int i = 0; i < n; i++) sum += ns[i];
+    out->mean_ns = sum / n;
+    rank = (50 * n + 99) / 100;
+    out->p50_ns = ns[rank > 0 ? rank - 1 : 0];
+    rank = (99 * n + 99) / 100;
+    out->p99_ns = ns[rank > 0 ? rank - 1 : 0];
+    out->max_ns = ns[n - 1];
+}
+
+void bench_summarize(const bench_samples *s, size_t bytes, bench_summary *st) {
+    static long sorted[BENCH_MAX_RUNS];
+    static unsigned long long sorted_cycles[BENCH_MAX_RUNS];
+    double mean, sd;
+    
+    memset(st, 0, sizeof(*st));
+    if (s->n == 0) return;
+    mean_sd(s, &mean, &sd);
+    memcpy(sorted, s->us, s->n * sizeof(long));
+    qsort(sorted, s->n, sizeof(long), cmp_long);
+    memcpy(sorted_cycles, s->cycles, s->n * sizeof(unsigned long long));
+    qsort(sorted_cycles, s->n, sizeof(unsigned long long), cmp_ull);
+    
+    st->avg = mean;
+    st->min = sorted[0];
+    st->max = sorted[s->n - 1];
+    st->median = percentile(sorted, s->n, 50);
+    st->p90 = percentile(sorted, s->n, 90);
+    st->p99 = percentile(sorted, s->n, 99);
+    st->ci_pct = (s->n > 1 && mean > 0) ? 100.0 * t95(s->n - 1) * sd / sqrt(s->n) / mean : 0;
+    st->cycles_per_byte = bytes ? (double)sorted_cycles[(s->n - 1) / 2] / bytes : 0;
+}
+
+// Print avg/min/max and median/p90/p99 over the runs and append one CSV row.
+// csv_prefix, if not NULL, is written between the algorithm name and the times.
+// avg_out, if not NULL, receives the encryption and decryption averages.
+void report_statistics(const char *algo_name, const bench_samples *enc, const bench_samples *dec,
+                       size_t bytes, const char *csv_prefix, FILE *results_file,
+                       double *avg_out) {
+    bench_summary e, d;
+    
+    bench_summarize(enc, bytes, &e);
+    bench_summarize(dec, bytes, &d);
+    
+    printf("\n  Statistics (over %d runs):\n", enc->n);
+    printf("    Encryption - Avg: %.2f μs, Min: %ld μs, Max: %ld μs\n", 
+           e.avg, e.min, e.max);
+    printf("                 Median: %ld μs, p90: %ld μs, p99: %ld μs, 95%% CI: ±%.2f%%\n",
+           e.median, e.p90, e.p99, e.ci_pct);
+    printf("    Decryption - Avg: %.2f μs, Min: %ld μs, Max: %ld μs\n", 
+           d.avg, d.min, d.max);
+    printf("                 Median: %ld μs, p90: %ld μs, p99: %ld μs, 95%% CI: ±%.2f%%\n",
+           d.median, d.p90, d.p99, d.ci_pct);
+    if (bench_cycle_source()[0] != 'n') {
+        printf("    Cycles/byte (%s) - Encryption: %.2f, Decryption: %.2f\n",
+               bench_cycle_source(), e.cycles_per_byte, d.cycles_per_byte);
+    }
+    
+    // Write results to file
+    fprintf(results_file, "%s,%s%s%.2f,%.2f,%ld,%ld,%ld,%ld,%d,%ld,%ld,%ld,%ld,%ld,%ld,%.2f,%.2f,%.3f,%.3f\n", 
+            algo_name, csv_prefix ? csv_prefix : "", csv_prefix ? "," : "",
+            e.avg, d.avg, e.min, e.max, d.min, d.max,
+            enc->n, e.median, e.p90, e.p99, d.median, d.p90, d.p99,
+            e.ci_pct, d.ci_pct, e.cycles_per_byte, d.cycles_per_byte);
+    
+    log_run_samples(algo_name, enc, dec, bytes, csv_prefix, results_file);
+    
+    if (avg_out) {
+        avg_out[0] = e.avg;
+        avg_out[1] = d.avg;
+    }
+}
@@ -0,0 +1,127 @@
+#ifndef HW03_BENCH_H
+#define HW03_BENCH_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <time.h>
+
+#define NUM_RUNS 5  // Number of repeated experiments
+#define MAX_SWEEP 16  // Maximum entries in a comma separated size list
+#define BENCH_MAX_RUNS 1000  // Capacity of a bench_samples series
+#define BENCH_SCHEMA "hw03-results/1"  // Schema tag of the sample logs
+
+// Columns report_statistics appends after Max_Dec_us in every results CSV
+#define BENCH_CSV_COLUMNS "Runs,Median_Enc_us,P90_Enc_us,P99_Enc_us,Median_Dec_us,P90_Dec_us,P99_Dec_us," \
+                          "CI95_Enc_pct,CI95_Dec_pct,Enc_Cycles_per_Byte,Dec_Cycles_per_Byte"
+
+// How the adaptive loops run: warmup_runs untimed iterations, then at least
+// min_runs and at most max_runs timed ones, stopping as soon as the 95%
+// confidence interval of the mean is within ci_target (relative half-width)
+typedef struct {
+    int warmup_runs;
+    int min_runs;
+    int max_runs;
+    double ci_target;
+    int cpu;  // CPU the process was pinned to, -1 if not pinned
+} bench_config;
+
+extern bench_config bench_settings;
+
+// One timed series: wall time in microseconds plus cycles per sample
+typedef struct {
+    long us[BENCH_MAX_RUNS];
+    unsigned long long cycles[BENCH_MAX_RUNS];
+    int n;
+} bench_samples;
+
+// A point in time on both clocks
+typedef struct {
+    struct timespec ts;
+    unsigned long long cycles;
+} bench_mark;
+
+// Summary of per-operation latencies (bench_latency_summary)
+typedef struct {
+    double mean_ns;
+    long long p50_ns, p99_ns, max_ns;
+} bench_latency;
+
+// Elapsed time between two CLOCK_MONOTONIC samples
+long elapsed_us(struct timespec *start, struct timespec *end);
+long long elapsed_ns(struct timespec *start, struct timespec *end);
+
+// Parse a byte count with optional K/M/G suffix (e.g. "64K", "4M")
+size_t parse_size(const char *arg);
+
+// Parse a comma separated list of sizes into sizes[], returns the count or
+// -1 (also for an empty list)
+int parse_size_list(const char *arg, size_t *sizes, int max_sizes);
+
+// Statistics of one series (bench_summarize), times in microseconds
+typedef struct {
+    double avg, ci_pct, cycles_per_byte;
+    long min, max, median, p90, p99;
+} bench_summary;
+
+// Mean, min/max, nearest-rank median/p90/p99, 95% CI half-width (percent of
+// the mean) and median cycles per byte (bytes per sample, 0 for none)
+void bench_summarize(const bench_samples *samples, size_t bytes, bench_summary *out);
+
+// Sort ns[0..n) in place and summarize it
+void bench_latency_summary(long long *ns, int n, bench_latency *out);
+
+// Sample CLOCK_MONOTONIC and the cycle counter
+void bench_mark_now(bench_mark *mark);
+
+// Append the interval start..end to samples (ignored once full)
+void bench_record(bench_samples *samples, const bench_mark *start, const bench_mark *end);
+
+// 1 at max_runs, or once samples holds min_runs (and at least 2) and its
+// 95% CI is within ci_target
+int bench_converged(const bench_samples *samples);
+
+// Name of the counter behind bench_mark.cycles: "perf", "rdtsc" or "none"
+const char *bench_cycle_source(void);
+
+// Pin the calling thread (and threads it creates later) to cpu, 0 on success
+int bench_pin_cpu(int cpu);
+
+// Peak resident set size of this process in MB
+double peak_rss_mb(void);
+
+// Route OpenSSL's heap allocations through a counter. Only possible before
+// OpenSSL allocates anything, so call it first in main; -1 if too late.
+int bench_count_crypto_allocs(void);
+
+// CRYPTO_malloc/CRYPTO_realloc calls so far (0 if counting is not installed)
+unsigned long bench_crypto_allocs(void);
+
+// Open results_<mode><file>.csv and write its header. Alongside it opens
+// the sample log results_<mode><file>.jsonl (JSON Lines, BENCH_SCHEMA):
+// a first "run" object with the environment (host, kernel, CPU and the
+// features libcrypto uses, OpenSSL version, compiler, cycle source, pinning,
+// run settings, test file), then one "series" object per measurement with
+// its raw samples. compare_results.py reads these logs.
+FILE *open_results_file(const char *mode, const char *test_file, const char *header,
+                        char *results_filename, size_t filename_len);
+
+// Append a "series" object to the sample log of results_file (no-op without
+// one): num_series arrays of counts[s] raw samples, named by names; unit is
+// that of the timing series.
+// params identifies the configuration within the algorithm (e.g. the CSV
+// prefix columns), bytes the data size per sample.
+void bench_log_samples(FILE *results_file, const char *algo_name, const char *params, size_t bytes,
+                       const char *unit, const char **names, const double *const *values,
+                       const int *counts, int num_series);
+
+// Print avg/min/max and median/p90/p99 over the runs and append one CSV row
+// (the original columns, then BENCH_CSV_COLUMNS), and the runs themselves
+// to the sample log as series "enc", "dec" (us), "enc_cycles", "dec_cycles". bytes is the data size
+// processed per run, for cycles/byte.
+// csv_prefix, if not NULL, is written between the algorithm name and the times.
+// avg_out, if not NULL, receives the encryption and decryption averages.
+void report_statistics(const char *algo_name, const bench_samples *enc, const bench_samples *dec,
+                       size_t bytes, const char *csv_prefix, FILE *results_file,
+                       double *avg_out);
+
+#endif
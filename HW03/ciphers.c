@@ -0,0 +1,610 @@
+#include "ciphers.h"
+#include "tagcmp.h"
+
+#include <openssl/hmac.h>
+#include <openssl/core_names.h>
+#include <openssl/kdf.h>
+#include <openssl/err.h>
+#include <openssl/crypto.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+int report_tag_failures = 1;
+
+void handle_crypto_error(void) {
+    ERR_print_errors_fp(stderr);
+    abort();
+}
+
+// Derive keys from master key using HKDF
+int derive_keys(unsigned char *master_key, const char *info, 
+                unsigned char *enc_key, int enc_key_len,
+                unsigned char *mac_key, int mac_key_len) {
+    EVP_PKEY_CTX *pctx;
+    unsigned char temp_buffer[64];  // Temporary buffer for derived material
+    size_t outlen = enc_key_len + mac_key_len;
+    
+    if (outlen > sizeof(temp_buffer)) {
+        fprintf(stderr, "Derived key material too large\n");
+        return 0;
+    }
+    
+    pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, NULL);
+    if (!pctx) handle_crypto_error();
+    
+    if (EVP_PKEY_derive_init(pctx) <= 0) handle_crypto_error();
+    if (EVP_PKEY_CTX_set_hkdf_md(pctx, EVP_sha256()) <= 0) handle_crypto_error();
+    if (EVP_PKEY_CTX_set1_hkdf_key(pctx, master_key, KEY_SIZE) <= 0) handle_crypto_error();
+    if (EVP_PKEY_CTX_add1_hkdf_info(pctx, (unsigned char *)info, strlen(info)) <= 0) handle_crypto_error();
+    
+    if (EVP_PKEY_derive(pctx, temp_buffer, &outlen) <= 0) handle_crypto_error();
+    
+    memcpy(enc_key, temp_buffer, enc_key_len);
+    memcpy(mac_key, temp_buffer + enc_key_len, mac_key_len);
+    
+    EVP_PKEY_CTX_free(pctx);
+    return 1;
+}
+
+// Load file content into memory
+int load_file_content(const char *filepath, unsigned char **buffer) {
+    FILE *fp = fopen(filepath, "rb");
+    if (!fp) {
+        perror("Cannot open file");
+        return -1;
+    }
+    
+    struct stat file_info;
+    if (stat(filepath, &file_info) != 0) {
+        perror("Cannot get file size");
+        fclose(fp);
+        return -1;
+    }
+    
+    int size = file_info.st_size;
+    *buffer = (unsigned char *)malloc(size);
+    if (!*buffer) {
+        perror("Memory allocation failed");
+        fclose(fp);
+        return -1;
+    }
+    
+    if (fread(*buffer, 1, size, fp) != size) {
+        perror("Error reading file");
+        free(*buffer);
+        fclose(fp);
+        return -1;
+    }
+    
+    fclose(fp);
+    return size;
+}
+
+// The one-shot functions below are registry entries 1-4: fresh contexts,
+// but on the ciphers the registry fetched once (algo_cipher), not an
+// implicit fetch per call
+
+// AES-128-CTR + HMAC (Encrypt-then-MAC)
+int aes_ctr_hmac_encrypt(unsigned char *plaintext, int plaintext_len,
+                         unsigned char *enc_key, unsigned char *mac_key,
+                         unsigned char *iv, unsigned char *ciphertext,
+                         unsigned char *tag) {
+    EVP_CIPHER_CTX *ctx;
+    int len, ciphertext_len;
+    unsigned int mac_len;
+    
+    // Encrypt with AES-128-CTR
+    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
+    if (1 != EVP_EncryptInit_ex(ctx, algo_cipher(1), NULL, enc_key, iv)) handle_crypto_error();
+    if (1 != EVP_EncryptUpdate(ctx, ciphertext, &len, plaintext, plaintext_len)) handle_crypto_error();
+    ciphertext_len = len;
+    if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + len, &len)) handle_crypto_error();
+    ciphertext_len += len;
+    EVP_CIPHER_CTX_free(ctx);
+    
+    // Compute HMAC over ciphertext
+    if (!HMAC(EVP_sha256(), mac_key, HMAC_KEY_SIZE, ciphertext, ciphertext_len, tag, &mac_len)) {
+        handle_crypto_error();
+    }
+    
+    return ciphertext_len;
+}
+
+int aes_ctr_hmac_decrypt(unsigned char *ciphertext, int ciphertext_len,
+                         unsigned char *enc_key, unsigned char *mac_key,
+                         unsigned char *iv, unsigned char *tag,
+                         unsigned char *plaintext) {
+    unsigned char computed_tag[EVP_MAX_MD_SIZE];
+    unsigned int mac_len;
+    EVP_CIPHER_CTX *ctx;
+    int len, plaintext_len;
+    
+    // Verify HMAC
+    if (!HMAC(EVP_sha256(), mac_key, HMAC_KEY_SIZE, ciphertext, ciphertext_len, computed_tag, &mac_len)) {
+        handle_crypto_error();
+    }
+    
+    if (!tag_equal(tag, computed_tag, HMAC_TAG_SIZE)) {
+        if (report_tag_failures) fprintf(stderr, "HMAC verification failed!\n");
+        return -1;
+    }
+    
+    // Decrypt with AES-128-CTR
+    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
+    if (1 != EVP_DecryptInit_ex(ctx, algo_cipher(1), NULL, enc_key, iv)) handle_crypto_error();
+    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len)) handle_crypto_error();
+    plaintext_len = len;
+    if (1 != EVP_DecryptFinal_ex(ctx, plaintext + len, &len)) handle_crypto_error();
+    plaintext_len += len;
+    EVP_CIPHER_CTX_free(ctx);
+    
+    return plaintext_len;
+}
+
+// ChaCha20 + HMAC (Encrypt-then-MAC)
+int chacha20_hmac_encrypt(unsigned char *plaintext, int plaintext_len,
+                          unsigned char *enc_key, unsigned char *mac_key,
+                          unsigned char *iv, unsigned char *ciphertext,
+                          unsigned char *tag) {
+    EVP_CIPHER_CTX *ctx;
+    int len, ciphertext_len;
+    unsigned int mac_len;
+    
+    // Encrypt with ChaCha20
+    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
+    if (1 != EVP_EncryptInit_ex(ctx, algo_cipher(2), NULL, enc_key, iv)) handle_crypto_error();
+    if (1 != EVP_EncryptUpdate(ctx, ciphertext, &len, plaintext, plaintext_len)) handle_crypto_error();
+    ciphertext_len = len;
+    if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + len, &len)) handle_crypto_error();
+    ciphertext_len += len;
+    EVP_CIPHER_CTX_free(ctx);
+    
+    // Compute HMAC over ciphertext
+    if (!HMAC(EVP_sha256(), mac_key, HMAC_KEY_SIZE, ciphertext, ciphertext_len, tag, &mac_len)) {
+        handle_crypto_error();
+    }
+    
+    return ciphertext_len;
+}
+
+int chacha20_hmac_decrypt(unsigned char *ciphertext, int ciphertext_len,
+                          unsigned char *enc_key, unsigned char *mac_key,
+                          unsigned char *iv, unsigned char *tag,
+                          unsigned char *plaintext) {
+    unsigned char computed_tag[EVP_MAX_MD_SIZE];
+    unsigned int mac_len;
+    EVP_CIPHER_CTX *ctx;
+    int len, plaintext_len;
+    
+    // Verify HMAC
+    if (!HMAC(EVP_sha256(), mac_key, HMAC_KEY_SIZE, ciphertext, ciphertext_len, computed_tag, &mac_len)) {
+        handle_crypto_error();
+    }
+    
+    if (!tag_equal(tag, computed_tag, HMAC_TAG_SIZE)) {
+        if (report_tag_failures) fprintf(stderr, "HMAC verification failed!\n");
+        return -1;
+    }
+    
+    // Decrypt with ChaCha20
+    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
+    if (1 != EVP_DecryptInit_ex(ctx, algo_cipher(2), NULL, enc_key, iv)) handle_crypto_error();
+    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len)) handle_crypto_error();
+    plaintext_len = len;
+    if (1 != EVP_DecryptFinal_ex(ctx, plaintext + len, &len)) handle_crypto_error();
+    plaintext_len += len;
+    EVP_CIPHER_CTX_free(ctx);
+    
+    return plaintext_len;
+}
+
+// AES-128-GCM (Authenticated Encryption)
+int aes_gcm_encrypt(unsigned char *plaintext, int plaintext_len,
+                    unsigned char *key, unsigned char *iv,
+                    unsigned char *ciphertext, unsigned char *tag) {
+    EVP_CIPHER_CTX *ctx;
+    int len, ciphertext_len;
+    
+    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
+    if (1 != EVP_EncryptInit_ex(ctx, algo_cipher(3), NULL, NULL, NULL)) handle_crypto_error();
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, IV_SIZE, NULL)) handle_crypto_error();
+    if (1 != EVP_EncryptInit_ex(ctx, NULL, NULL, key, iv)) handle_crypto_error();
+    if (1 != EVP_EncryptUpdate(ctx, ciphertext, &len, plaintext, plaintext_len)) handle_crypto_error();
+    ciphertext_len = len;
+    if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + len, &len)) handle_crypto_error();
+    ciphertext_len += len;
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
+    EVP_CIPHER_CTX_free(ctx);
+    
+    return ciphertext_len;
+}
+
+int aes_gcm_decrypt(unsigned char *ciphertext, int ciphertext_len,
+                    unsigned char *key, unsigned char *iv,
+                    unsigned char *tag, unsigned char *plaintext) {
+    EVP_CIPHER_CTX *ctx;
+    int len, plaintext_len, ret;
+    
+    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
+    if (1 != EVP_DecryptInit_ex(ctx, algo_cipher(3), NULL, NULL, NULL)) handle_crypto_error();
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, IV_SIZE, NULL)) handle_crypto_error();
+    if (1 != EVP_DecryptInit_ex(ctx, NULL, NULL, key, iv)) handle_crypto_error();
+    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len)) handle_crypto_error();
+    plaintext_len = len;
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
+    ret = EVP_DecryptFinal_ex(ctx, plaintext + len, &len);
+    EVP_CIPHER_CTX_free(ctx);
+    
+    if (ret > 0) {
+        plaintext_len += len;
+        return plaintext_len;
+    } else {
+        if (report_tag_failures) fprintf(stderr, "GCM tag verification failed!\n");
+        return -1;
+    }
+}
+
+// ChaCha20-Poly1305 (Authenticated Encryption)
+int chacha20_poly1305_encrypt(unsigned char *plaintext, int plaintext_len,
+                               unsigned char *key, unsigned char *nonce,
+                               unsigned char *ciphertext, unsigned char *tag) {
+    EVP_CIPHER_CTX *ctx;
+    int len, ciphertext_len;
+    
+    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
+    if (1 != EVP_EncryptInit_ex(ctx, algo_cipher(4), NULL, NULL, NULL)) handle_crypto_error();
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, NONCE_SIZE, NULL)) handle_crypto_error();
+    if (1 != EVP_EncryptInit_ex(ctx, NULL, NULL, key, nonce)) handle_crypto_error();
+    if (1 != EVP_EncryptUpdate(ctx, ciphertext, &len, plaintext, plaintext_len)) handle_crypto_error();
+    ciphertext_len = len;
+    if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + len, &len)) handle_crypto_error();
+    ciphertext_len += len;
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
+    EVP_CIPHER_CTX_free(ctx);
+    
+    return ciphertext_len;
+}
+
+int chacha20_poly1305_decrypt(unsigned char *ciphertext, int ciphertext_len,
+                               unsigned char *key, unsigned char *nonce,
+                               unsigned char *tag, unsigned char *plaintext) {
+    EVP_CIPHER_CTX *ctx;
+    int len, plaintext_len, ret;
+    
+    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
+    if (1 != EVP_DecryptInit_ex(ctx, algo_cipher(4), NULL, NULL, NULL)) handle_crypto_error();
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, NONCE_SIZE, NULL)) handle_crypto_error();
+    if (1 != EVP_DecryptInit_ex(ctx, NULL, NULL, key, nonce)) handle_crypto_error();
+    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len)) handle_crypto_error();
+    plaintext_len = len;
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
+    ret = EVP_DecryptFinal_ex(ctx, plaintext + len, &len);
+    EVP_CIPHER_CTX_free(ctx);
+    
+    if (ret > 0) {
+        plaintext_len += len;
+        return plaintext_len;
+    } else {
+        if (report_tag_failures) fprintf(stderr, "Poly1305 tag verification failed!\n");
+        return -1;
+    }
+}
+
+// Default init hook: fetched cipher, AEAD IV length from the registry entry
+EVP_CIPHER_CTX *evp_cipher_ctx_new(int algo_type, int enc,
+                                   unsigned char *key, unsigned char *iv) {
+    EVP_CIPHER_CTX *ctx;
+
+    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
+    if (1 != EVP_CipherInit_ex(ctx, algo_cipher(algo_type), NULL, NULL, NULL, enc)) handle_crypto_error();
+    if (algo_get(algo_type)->caps & ALGO_CAP_AEAD) {
+        if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, algo_iv_len(algo_type), NULL)) handle_crypto_error();
+    }
+    if (1 != EVP_CipherInit_ex(ctx, NULL, NULL, key, iv, enc)) handle_crypto_error();
+
+    return ctx;
+}
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define QUARTER_ROUND(a, b, c, d) \
+    a += b; d ^= a; d = ROTL32(d, 16); \
+    c += d; b ^= c; b = ROTL32(b, 12); \
+    a += b; d ^= a; d = ROTL32(d, 8);  \
+    c += d; b ^= c; b = ROTL32(b, 7)
+
+static uint32_t load_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void store_le32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+// ChaCha20 block function without the final feed-forward, keeping state
+// words 0-3 and 12-15 as the subkey
+void hchacha20(const unsigned char *key, const unsigned char *input, unsigned char *subkey) {
+    uint32_t x[16] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+
+    for (int i = 0; i < 8; i++) x[4 + i] = load_le32(key + 4 * i);
+    for (int i = 0; i < 4; i++) x[12 + i] = load_le32(input + 4 * i);
+    for (int i = 0; i < 10; i++) {
+        QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+        QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+        QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+        QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+    }
+    for (int i = 0; i < 4; i++) {
+        store_le32(subkey + 4 * i, x[i]);
+        store_le32(subkey + 16 + 4 * i, x[12 + i]);
+    }
+    OPENSSL_cleanse(x, sizeof(x));
+}
+
+EVP_CIPHER_CTX *xchacha20_poly1305_ctx_new(int algo_type, int enc,
+                                           unsigned char *key, unsigned char *iv) {
+    unsigned char subkey[KEY_SIZE];
+    unsigned char nonce[NONCE_SIZE] = {0};
+    EVP_CIPHER_CTX *ctx;
+
+    if (!key || !iv) {
+        // The subkey depends on the nonce, so there is no key-only context
+        fprintf(stderr, "XChaCha20-Poly1305 needs key and nonce together\n");
+        abort();
+    }
+    hchacha20(key, iv, subkey);
+    memcpy(nonce + 4, iv + 16, 8);
+
+    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
+    if (1 != EVP_CipherInit_ex(ctx, algo_cipher(algo_type), NULL, NULL, NULL, enc)) handle_crypto_error();
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, NONCE_SIZE, NULL)) handle_crypto_error();
+    if (1 != EVP_CipherInit_ex(ctx, NULL, NULL, subkey, nonce, enc)) handle_crypto_error();
+    OPENSSL_cleanse(subkey, sizeof(subkey));
+
+    return ctx;
+}
+
+int aead_encrypt(int algo_type, unsigned char *plaintext, int plaintext_len,
+                 unsigned char *key, unsigned char *unused_mac_key, unsigned char *iv,
+                 unsigned char *ciphertext, unsigned char *tag) {
+    EVP_CIPHER_CTX *ctx = algo_cipher_ctx_new(algo_type, 1, key, iv);
+    int len, ciphertext_len;
+
+    (void)unused_mac_key;
+    if (1 != EVP_EncryptUpdate(ctx, ciphertext, &len, plaintext, plaintext_len)) handle_crypto_error();
+    ciphertext_len = len;
+    if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + len, &len)) handle_crypto_error();
+    ciphertext_len += len;
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
+
+    EVP_CIPHER_CTX_free(ctx);
+    return ciphertext_len;
+}
+
+// The tag is set before the update: GCM-SIV needs it to decrypt at all
+int aead_decrypt(int algo_type, unsigned char *ciphertext, int ciphertext_len,
+                 unsigned char *key, unsigned char *unused_mac_key, unsigned char *iv,
+                 unsigned char *tag, unsigned char *plaintext) {
+    EVP_CIPHER_CTX *ctx = algo_cipher_ctx_new(algo_type, 0, key, iv);
+    int len, plaintext_len, ret;
+
+    (void)unused_mac_key;
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
+    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len)) handle_crypto_error();
+    plaintext_len = len;
+    ret = EVP_DecryptFinal_ex(ctx, plaintext + len, &len);
+    EVP_CIPHER_CTX_free(ctx);
+
+    if (ret <= 0) {
+        OPENSSL_cleanse(plaintext, plaintext_len);
+        if (report_tag_failures) fprintf(stderr, "%s tag verification failed!\n", algo_name(algo_type));
+        return -1;
+    }
+    return plaintext_len + len;
+}
+
+// Incremental HMAC-SHA256 context for the chunked Encrypt-then-MAC paths
+EVP_MAC_CTX *hmac_sha256_ctx_new(unsigned char *mac_key) {
+    EVP_MAC *mac;
+    EVP_MAC_CTX *ctx;
+    OSSL_PARAM params[2];
+
+    if (!(mac = EVP_MAC_fetch(NULL, "HMAC", NULL))) handle_crypto_error();
+    ctx = EVP_MAC_CTX_new(mac);
+    EVP_MAC_free(mac);  // The context keeps its own reference
+    if (!ctx) handle_crypto_error();
+
+    params[0] = OSSL_PARAM_construct_utf8_string("digest", "SHA256", 0);
+    params[1] = OSSL_PARAM_construct_end();
+    if (1 != EVP_MAC_init(ctx, mac_key, HMAC_KEY_SIZE, params)) handle_crypto_error();
+
+    return ctx;
+}
+
+// Fused Encrypt-then-MAC: encrypt block_size bytes, then MAC that ciphertext
+// block while it is still in cache, instead of two passes over the buffer
+static int etm_fused_encrypt(const EVP_CIPHER *cipher, unsigned char *plaintext, int plaintext_len,
+                             unsigned char *enc_key, unsigned char *mac_key,
+                             unsigned char *iv, unsigned char *ciphertext,
+                             unsigned char *tag, int block_size) {
+    EVP_CIPHER_CTX *ctx;
+    EVP_MAC_CTX *mac;
+    int len, ciphertext_len = 0;
+    size_t mac_len;
+    
+    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
+    if (1 != EVP_EncryptInit_ex(ctx, cipher, NULL, enc_key, iv)) handle_crypto_error();
+    mac = hmac_sha256_ctx_new(mac_key);
+    
+    for (int off = 0; off < plaintext_len; off += block_size) {
+        int n = (plaintext_len - off < block_size) ? plaintext_len - off : block_size;
+        if (1 != EVP_EncryptUpdate(ctx, ciphertext + ciphertext_len, &len, plaintext + off, n)) handle_crypto_error();
+        if (1 != EVP_MAC_update(mac, ciphertext + ciphertext_len, len)) handle_crypto_error();
+        ciphertext_len += len;
+    }
+    if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + ciphertext_len, &len)) handle_crypto_error();
+    if (1 != EVP_MAC_update(mac, ciphertext + ciphertext_len, len)) handle_crypto_error();
+    ciphertext_len += len;
+    if (1 != EVP_MAC_final(mac, tag, &mac_len, HMAC_TAG_SIZE)) handle_crypto_error();
+    
+    EVP_MAC_CTX_free(mac);
+    EVP_CIPHER_CTX_free(ctx);
+    return ciphertext_len;
+}
+
+// Fused decryption: MAC each ciphertext block and decrypt it right away, then
+// check the tag once at the end. Plaintext is therefore produced before the
+// tag is known; on mismatch the output buffer is wiped before returning.
+static int etm_fused_decrypt(const EVP_CIPHER *cipher, unsigned char *ciphertext, int ciphertext_len,
+                             unsigned char *enc_key, unsigned char *mac_key,
+                             unsigned char *iv, unsigned char *tag,
+                             unsigned char *plaintext, int block_size) {
+    unsigned char computed_tag[EVP_MAX_MD_SIZE];
+    EVP_CIPHER_CTX *ctx;
+    EVP_MAC_CTX *mac;
+    int len, plaintext_len = 0;
+    size_t mac_len;
+    
+    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
+    if (1 != EVP_DecryptInit_ex(ctx, cipher, NULL, enc_key, iv)) handle_crypto_error();
+    mac = hmac_sha256_ctx_new(mac_key);
+    
+    for (int off = 0; off < ciphertext_len; off += block_size) {
+        int n = (ciphertext_len - off < block_size) ? ciphertext_len - off : block_size;
+        if (1 != EVP_MAC_update(mac, ciphertext + off, n)) handle_crypto_error();
+        if (1 != EVP_DecryptUpdate(ctx, plaintext + plaintext_len, &len, ciphertext + off, n)) handle_crypto_error();
+        plaintext_len += len;
+    }
+    if (1 != EVP_DecryptFinal_ex(ctx, plaintext + plaintext_len, &len)) handle_crypto_error();
+    plaintext_len += len;
+    if (1 != EVP_MAC_final(mac, computed_tag, &mac_len, sizeof(computed_tag))) handle_crypto_error();
+    
+    EVP_MAC_CTX_free(mac);
+    EVP_CIPHER_CTX_free(ctx);
+    
+    if (!tag_equal(tag, computed_tag, HMAC_TAG_SIZE)) {
+        OPENSSL_cleanse(plaintext, plaintext_len);
+        if (report_tag_failures) fprintf(stderr, "HMAC verification failed!\n");
+        return -1;
+    }
+    
+    return plaintext_len;
+}
+
+int aes_ctr_hmac_encrypt_fused(unsigned char *plaintext, int plaintext_len,
+                               unsigned char *enc_key, unsigned char *mac_key,
+                               unsigned char *iv, unsigned char *ciphertext,
+                               unsigned char *tag, int block_size) {
+    return etm_fused_encrypt(algo_cipher(1), plaintext, plaintext_len, enc_key, mac_key,
+                             iv, ciphertext, tag, block_size);
+}
+
+int aes_ctr_hmac_decrypt_fused(unsigned char *ciphertext, int ciphertext_len,
+                               unsigned char *enc_key, unsigned char *mac_key,
+                               unsigned char *iv, unsigned char *tag,
+                               unsigned char *plaintext, int block_size) {
+    return etm_fused_decrypt(algo_cipher(1), ciphertext, ciphertext_len, enc_key, mac_key,
+                             iv, tag, plaintext, block_size);
+}
+
+int chacha20_hmac_encrypt_fused(unsigned char *plaintext, int plaintext_len,
+                                unsigned char *enc_key, unsigned char *mac_key,
+                                unsigned char *iv, unsigned char *ciphertext,
+                                unsigned char *tag, int block_size) {
+    return etm_fused_encrypt(algo_cipher(2), plaintext, plaintext_len, enc_key, mac_key,
+                             iv, ciphertext, tag, block_size);
+}
+
+int chacha20_hmac_decrypt_fused(unsigned char *ciphertext, int ciphertext_len,
+                                unsigned char *enc_key, unsigned char *mac_key,
+                                unsigned char *iv, unsigned char *tag,
+                                unsigned char *plaintext, int block_size) {
+    return etm_fused_decrypt(algo_cipher(2), ciphertext, ciphertext_len, enc_key, mac_key,
+                             iv, tag, plaintext, block_size);
+}
+
+// Batch AEAD: one context keyed once, only the nonce (and AAD) per message.
+// Ciphertexts are written back to back in message order, tags every AEAD_TAG_SIZE bytes.
+int algo_encrypt_batch(int algo_type, const aead_msg *msgs, int count, unsigned char *key,
+                       unsigned char *ciphertexts, unsigned char *tags) {
+    EVP_CIPHER_CTX *ctx = algo_cipher_ctx_new(algo_type, 1, key, NULL);
+    unsigned char *out = ciphertexts;
+    int len;
+    
+    for (int i = 0; i < count; i++) {
+        if (1 != EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, msgs[i].nonce)) handle_crypto_error();
+        if (msgs[i].aad_len > 0) {
+            if (1 != EVP_EncryptUpdate(ctx, NULL, &len, msgs[i].aad, msgs[i].aad_len)) handle_crypto_error();
+        }
+        if (1 != EVP_EncryptUpdate(ctx, out, &len, msgs[i].data, msgs[i].len)) handle_crypto_error();
+        out += len;
+        if (1 != EVP_EncryptFinal_ex(ctx, out, &len)) handle_crypto_error();
+        out += len;
+        if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, tags + (size_t)i * AEAD_TAG_SIZE)) handle_crypto_error();
+    }
+    
+    EVP_CIPHER_CTX_free(ctx);
+    return (int)(out - ciphertexts);
+}
+
+// Batch decryption; ok[i] (if not NULL) is set to 1 when message i verified.
+// The plaintext of a message that fails verification is wiped.
+// Returns the number of messages that failed verification.
+int algo_decrypt_batch(int algo_type, const aead_msg *msgs, int count, unsigned char *key,
+                       unsigned char *tags, unsigned char *plaintexts, unsigned char *ok) {
+    EVP_CIPHER_CTX *ctx = algo_cipher_ctx_new(algo_type, 0, key, NULL);
+    unsigned char *out = plaintexts;
+    int len, failures = 0;
+    
+    for (int i = 0; i < count; i++) {
+        unsigned char *msg_out = out;
+        if (1 != EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, msgs[i].nonce)) handle_crypto_error();
+        // Tag before the data, as GCM-SIV requires
+        if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, AEAD_TAG_SIZE, tags + (size_t)i * AEAD_TAG_SIZE)) handle_crypto_error();
+        if (msgs[i].aad_len > 0) {
+            if (1 != EVP_DecryptUpdate(ctx, NULL, &len, msgs[i].aad, msgs[i].aad_len)) handle_crypto_error();
+        }
+        if (1 != EVP_DecryptUpdate(ctx, out, &len, msgs[i].data, msgs[i].len)) handle_crypto_error();
+        out += len;
+        if (EVP_DecryptFinal_ex(ctx, out, &len) > 0) {
+            out += len;
+            if (ok) ok[i] = 1;
+        } else {
+            OPENSSL_cleanse(msg_out, out - msg_out);
+            failures++;
+            if (ok) ok[i] = 0;
+        }
+    }
+    
+    EVP_CIPHER_CTX_free(ctx);
+    return failures;
+}
+
+int aes_gcm_encrypt_batch(const aead_msg *msgs, int count, unsigned char *key,
+                          unsigned char *ciphertexts, unsigned char *tags) {
+    return algo_encrypt_batch(3, msgs, count, key, ciphertexts, tags);
+}
+
+int aes_gcm_decrypt_batch(const aead_msg *msgs, int count, unsigned char *key,
+                          unsigned char *tags, unsigned char *plaintexts, unsigned char *ok) {
+    return algo_decrypt_batch(3, msgs, count, key, tags, plaintexts, ok);
+}
+
+int chacha20_poly1305_encrypt_batch(const aead_msg *msgs, int count, unsigned char *key,
+                                    unsigned char *ciphertexts, unsigned char *tags) {
+    return algo_encrypt_batch(4, msgs, count, key, ciphertexts, tags);
+}
+
+int chacha20_poly1305_decrypt_batch(const aead_msg *msgs, int count, unsigned char *key,
+                                    unsigned char *tags, unsigned char *plaintexts, unsigned char *ok) {
+    return algo_decrypt_batch(4, msgs, count, key, tags, plaintexts, ok);
+}
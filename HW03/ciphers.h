@@ -0,0 +1,217 @@
+#ifndef HW03_CIPHERS_H
+#define HW03_CIPHERS_H
+
+#include <openssl/evp.h>
+
+#define KEY_SIZE 32  // 256 bits for master key
+#define AES_KEY_SIZE 16  // 128 bits for AES
+#define HMAC_KEY_SIZE 32  // 256 bits for HMAC
+#define IV_SIZE 16  // 128 bits for IV
+#define NONCE_SIZE 12  // 96 bits for nonce (ChaCha20-Poly1305)
+#define HMAC_TAG_SIZE 32  // 256 bits for HMAC-SHA256 tag
+#define AEAD_TAG_SIZE 16  // 128 bits for GCM/Poly1305 authentication tag
+#define XNONCE_SIZE 24  // 192 bits for the XChaCha20-Poly1305 nonce
+#define MAX_IV_SIZE 24  // Largest IV/nonce of any registry entry
+
+// Algorithm identifiers (algo_type) index the registry in registry.c:
+//   1 = AES-128-CTR + HMAC, 2 = ChaCha20 + HMAC,
+//   3 = AES-128-GCM,        4 = ChaCha20-Poly1305,
+//   5 = AES-256-GCM,        6 = AES-128-GCM-SIV,
+//   7 = AES-128-OCB,        8 = XChaCha20-Poly1305
+#define NUM_ALGOS 8
+
+// Capabilities of a registry entry, tested with algo_has
+#define ALGO_CAP_ETM       0x01  // Keystream cipher + HMAC-SHA256 (Encrypt-then-MAC)
+#define ALGO_CAP_AEAD      0x02  // AEAD cipher with an AEAD_TAG_SIZE tag
+#define ALGO_CAP_SEEKABLE  0x04  // Keystream can start at any offset (parallel.h)
+#define ALGO_CAP_STREAMING 0x08  // Accepts chunked EVP updates on one context
+#define ALGO_CAP_POOLABLE  0x10  // Key schedule independent of the nonce, so a
+                                 // context keyed once can be re-IVed per message
+
+// Descriptor of one algorithm. The drivers look it up once per test and call
+// through it, so adding an algorithm is one table entry.
+typedef struct {
+    const char *name;         // Display name, also the HKDF info string
+    const char *cipher_name;  // EVP_CIPHER_fetch name of the underlying cipher
+    int key_len;
+    int mac_key_len;          // 0 for AEAD
+    int iv_len;               // IV/nonce length the caller supplies
+    int tag_len;
+    unsigned int caps;
+    // Build a cipher context keyed for (key, iv); iv may be NULL for POOLABLE entries
+    EVP_CIPHER_CTX *(*init)(int algo_type, int enc, unsigned char *key, unsigned char *iv);
+    // One-shot with fresh contexts; decrypt returns -1 on tag mismatch
+    int (*encrypt)(int algo_type, unsigned char *plaintext, int plaintext_len,
+                   unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                   unsigned char *ciphertext, unsigned char *tag);
+    int (*decrypt)(int algo_type, unsigned char *ciphertext, int ciphertext_len,
+                   unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                   unsigned char *tag, unsigned char *plaintext);
+    // Single-pass Encrypt-then-MAC variants, NULL for AEAD entries
+    int (*encrypt_fused)(unsigned char *plaintext, int plaintext_len,
+                         unsigned char *enc_key, unsigned char *mac_key,
+                         unsigned char *iv, unsigned char *ciphertext,
+                         unsigned char *tag, int block_size);
+    int (*decrypt_fused)(unsigned char *ciphertext, int ciphertext_len,
+                         unsigned char *enc_key, unsigned char *mac_key,
+                         unsigned char *iv, unsigned char *tag,
+                         unsigned char *plaintext, int block_size);
+} algo_desc;
+
+// Descriptor of algo_type, NULL outside 1..NUM_ALGOS
+const algo_desc *algo_get(int algo_type);
+
+// 1 if the provider has the cipher (e.g. GCM-SIV needs OpenSSL 3.2)
+int algo_available(int algo_type);
+
+// 1 if algo_type is available and has every capability in caps
+int algo_has(int algo_type, unsigned int caps);
+
+void handle_crypto_error(void);
+
+// 1 (the default): a decrypt whose tag does not verify says so on stderr.
+// The timing tests clear it, so the write is not part of what they measure
+extern int report_tag_failures;
+
+// Derive keys from master key using HKDF
+int derive_keys(unsigned char *master_key, const char *info,
+                unsigned char *enc_key, int enc_key_len,
+                unsigned char *mac_key, int mac_key_len);
+
+// Load file content into memory
+int load_file_content(const char *filepath, unsigned char **buffer);
+
+// Display name (also the HKDF info string), fetched cipher and IV/nonce length
+const char *algo_name(int algo_type);
+const EVP_CIPHER *algo_cipher(int algo_type);
+int algo_iv_len(int algo_type);
+
+// Derive the working keys of algo_type, using the algorithm name as HKDF info
+int derive_algo_keys(unsigned char *master_key, const char *algo_name, int algo_type,
+                     unsigned char *enc_key, unsigned char *mac_key);
+
+// Create a cipher context keyed for algo_type (enc = 1 encrypt, 0 decrypt)
+// through the entry's init hook
+EVP_CIPHER_CTX *algo_cipher_ctx_new(int algo_type, int enc,
+                                    unsigned char *key, unsigned char *iv);
+
+// Default init hook: algo_cipher with the entry's IV length
+EVP_CIPHER_CTX *evp_cipher_ctx_new(int algo_type, int enc,
+                                   unsigned char *key, unsigned char *iv);
+
+// XChaCha20-Poly1305 init hook: HChaCha20 subkey from the first 16 nonce
+// bytes, then ChaCha20-Poly1305 with nonce 0^4 || nonce[16..23]
+EVP_CIPHER_CTX *xchacha20_poly1305_ctx_new(int algo_type, int enc,
+                                           unsigned char *key, unsigned char *iv);
+
+// HChaCha20 core (draft-irtf-cfrg-xchacha): 32-byte key, 16-byte input
+void hchacha20(const unsigned char *key, const unsigned char *input, unsigned char *subkey);
+
+// Generic AEAD one-shot through algo_cipher_ctx_new, used by the registry
+// entries that have no dedicated function
+int aead_encrypt(int algo_type, unsigned char *plaintext, int plaintext_len,
+                 unsigned char *key, unsigned char *unused_mac_key, unsigned char *iv,
+                 unsigned char *ciphertext, unsigned char *tag);
+int aead_decrypt(int algo_type, unsigned char *ciphertext, int ciphertext_len,
+                 unsigned char *key, unsigned char *unused_mac_key, unsigned char *iv,
+                 unsigned char *tag, unsigned char *plaintext);
+
+// Incremental HMAC-SHA256 context for the chunked Encrypt-then-MAC paths
+EVP_MAC_CTX *hmac_sha256_ctx_new(unsigned char *mac_key);
+
+// AES-128-CTR + HMAC (Encrypt-then-MAC)
+int aes_ctr_hmac_encrypt(unsigned char *plaintext, int plaintext_len,
+                         unsigned char *enc_key, unsigned char *mac_key,
+                         unsigned char *iv, unsigned char *ciphertext,
+                         unsigned char *tag);
+int aes_ctr_hmac_decrypt(unsigned char *ciphertext, int ciphertext_len,
+                         unsigned char *enc_key, unsigned char *mac_key,
+                         unsigned char *iv, unsigned char *tag,
+                         unsigned char *plaintext);
+
+// ChaCha20 + HMAC (Encrypt-then-MAC)
+int chacha20_hmac_encrypt(unsigned char *plaintext, int plaintext_len,
+                          unsigned char *enc_key, unsigned char *mac_key,
+                          unsigned char *iv, unsigned char *ciphertext,
+                          unsigned char *tag);
+int chacha20_hmac_decrypt(unsigned char *ciphertext, int ciphertext_len,
+                          unsigned char *enc_key, unsigned char *mac_key,
+                          unsigned char *iv, unsigned char *tag,
+                          unsigned char *plaintext);
+
+// Single-pass (fused) Encrypt-then-MAC variants: each block_size block of
+// ciphertext is fed to an incremental HMAC right after it is produced.
+// Decryption MACs and decrypts per block and checks the tag at the end.
+#define DEFAULT_FUSED_BLOCK_SIZE (32 * 1024)  // Fits in L1/L2 with its ciphertext
+int aes_ctr_hmac_encrypt_fused(unsigned char *plaintext, int plaintext_len,
+                               unsigned char *enc_key, unsigned char *mac_key,
+                               unsigned char *iv, unsigned char *ciphertext,
+                               unsigned char *tag, int block_size);
+int aes_ctr_hmac_decrypt_fused(unsigned char *ciphertext, int ciphertext_len,
+                               unsigned char *enc_key, unsigned char *mac_key,
+                               unsigned char *iv, unsigned char *tag,
+                               unsigned char *plaintext, int block_size);
+int chacha20_hmac_encrypt_fused(unsigned char *plaintext, int plaintext_len,
+                                unsigned char *enc_key, unsigned char *mac_key,
+                                unsigned char *iv, unsigned char *ciphertext,
+                                unsigned char *tag, int block_size);
+int chacha20_hmac_decrypt_fused(unsigned char *ciphertext, int ciphertext_len,
+                                unsigned char *enc_key, unsigned char *mac_key,
+                                unsigned char *iv, unsigned char *tag,
+                                unsigned char *plaintext, int block_size);
+
+// AES-128-GCM (Authenticated Encryption)
+int aes_gcm_encrypt(unsigned char *plaintext, int plaintext_len,
+                    unsigned char *key, unsigned char *iv,
+                    unsigned char *ciphertext, unsigned char *tag);
+int aes_gcm_decrypt(unsigned char *ciphertext, int ciphertext_len,
+                    unsigned char *key, unsigned char *iv,
+                    unsigned char *tag, unsigned char *plaintext);
+
+// ChaCha20-Poly1305 (Authenticated Encryption)
+int chacha20_poly1305_encrypt(unsigned char *plaintext, int plaintext_len,
+                               unsigned char *key, unsigned char *nonce,
+                               unsigned char *ciphertext, unsigned char *tag);
+int chacha20_poly1305_decrypt(unsigned char *ciphertext, int ciphertext_len,
+                               unsigned char *key, unsigned char *nonce,
+                               unsigned char *tag, unsigned char *plaintext);
+
+// One message of an AEAD batch. data is the plaintext for the encrypt calls
+// and the ciphertext for the decrypt calls; aad may be NULL with aad_len 0.
+typedef struct {
+    const unsigned char *data;
+    int len;
+    const unsigned char *nonce;  // algo_iv_len bytes
+    const unsigned char *aad;
+    int aad_len;
+} aead_msg;
+
+// Multi-message AEAD with one context keyed once per batch and no per-message
+// allocation. Outputs are contiguous: message i's ciphertext/plaintext follows
+// message i-1's, its tag is at tags + i * AEAD_TAG_SIZE.
+// Encrypt returns the total output length; decrypt returns the number of
+// messages that failed verification and sets ok[i] (if ok is not NULL).
+int aes_gcm_encrypt_batch(const aead_msg *msgs, int count, unsigned char *key,
+                          unsigned char *ciphertexts, unsigned char *tags);
+int aes_gcm_decrypt_batch(const aead_msg *msgs, int count, unsigned char *key,
+                          unsigned char *tags, unsigned char *plaintexts, unsigned char *ok);
+int chacha20_poly1305_encrypt_batch(const aead_msg *msgs, int count, unsigned char *key,
+                                    unsigned char *ciphertexts, unsigned char *tags);
+int chacha20_poly1305_decrypt_batch(const aead_msg *msgs, int count, unsigned char *key,
+                                    unsigned char *tags, unsigned char *plaintexts, unsigned char *ok);
+
+// Same batch API for any AEAD | POOLABLE registry entry
+int algo_encrypt_batch(int algo_type, const aead_msg *msgs, int count, unsigned char *key,
+                       unsigned char *ciphertexts, unsigned char *tags);
+int algo_decrypt_batch(int algo_type, const aead_msg *msgs, int count, unsigned char *key,
+                       unsigned char *tags, unsigned char *plaintexts, unsigned char *ok);
+
+// One-shot dispatch through the registry with fresh contexts (nonce held in iv)
+int algo_encrypt(int algo_type, unsigned char *plaintext, int plaintext_len,
+                 unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                 unsigned char *ciphertext, unsigned char *tag);
+int algo_decrypt(int algo_type, unsigned char *ciphertext, int ciphertext_len,
+                 unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                 unsigned char *tag, unsigned char *plaintext);
+
+#endif
@@ -0,0 +1,545 @@
+// The SHA256_* low-level functions are deprecated in OpenSSL 3 but hash on
+// a stack context, with no EVP_MD_CTX allocation per commitment
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include "commitment.h"
+#include "cpuinfo.h"
+#include "randpool.h"
+#include "sha256x8.h"
+#include "tagcmp.h"
+
+#include <openssl/crypto.h>
+#include <openssl/sha.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define MAX_FLIGHT 2        // Frames per writev
+#define MAX_VALUE_LEN 16    // Decimal dice sum
+#define MAX_ERROR_LEN 256
+#define BATCH_VALUE_LEN 128 // Longer values are hashed one at a time
+
+static void put_be32(unsigned char *p, uint32_t v) {
+    p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static uint32_t get_be32(const unsigned char *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+void commit_nonce(unsigned char *nonce, size_t count) {
+    rand_pool_bytes(nonce, count * COMMIT_NONCE_SIZE);
+}
+
+static void nonce_hex(const unsigned char *nonce, char *hex) {
+    for (int i = 0; i < COMMIT_NONCE_SIZE; i++) {
+        hex[2 * i] = "0123456789abcdef"[nonce[i] >> 4];
+        hex[2 * i + 1] = "0123456789abcdef"[nonce[i] & 0xf];
+    }
+}
+
+void commit_compute(const char *value, size_t value_len, const unsigned char *nonce,
+                    unsigned char *commitment) {
+    char hex[2 * COMMIT_NONCE_SIZE];
+    SHA256_CTX sha;
+
+    nonce_hex(nonce, hex);
+    SHA256_Init(&sha);
+    SHA256_Update(&sha, value, value_len);
+    SHA256_Update(&sha, "||", 2);
+    SHA256_Update(&sha, hex, sizeof(hex));
+    SHA256_Final(commitment, &sha);
+}
+
+int commit_verify(const unsigned char *commitment, const char *value, size_t value_len,
+                  const unsigned char *nonce) {
+    unsigned char expected[COMMIT_HASH_SIZE];
+
+    commit_compute(value, value_len, nonce, expected);
+    return tag_equal(expected, commitment, COMMIT_HASH_SIZE);
+}
+
+void commit_hex(const unsigned char *commitment, char *hex) {
+    for (int i = 0; i < COMMIT_HASH_SIZE; i++) sprintf(hex + 2 * i, "%02x", commitment[i]);
+}
+
+// --- Batch verification ---
+
+int commit_hash_backend(int backend) {
+    cpu_info cpu;
+
+    if (backend == COMMIT_HASH_AVX2 && !sha256x8_available()) return COMMIT_HASH_LIBCRYPTO;
+    if (backend != COMMIT_HASH_AUTO) return backend;
+    // One SHA-NI stream beats eight AVX2 lanes; without it the lanes win
+    cpu_probe(&cpu);
+    if (cpu.features & CPU_SHA) return COMMIT_HASH_LIBCRYPTO;
+    return sha256x8_available() ? COMMIT_HASH_AVX2 : COMMIT_HASH_LIBCRYPTO;
+}
+
+const char *commit_hash_name(int backend) {
+    return backend == COMMIT_HASH_AVX2 ? "avx2-8x" : backend == COMMIT_HASH_LIBCRYPTO ? "libcrypto" : "auto";
+}
+
+typedef struct {
+    const unsigned char *commitments, *nonces;
+    const char *const *values;
+    const size_t *value_lens;
+    size_t first, last;  // Items; first is a multiple of 8, so bitmap bytes are not shared
+    unsigned char *bitmap;
+    int backend;
+    size_t ok;
+} verify_job;
+
+// Items [first, first + n) of an 8-item group through the AVX2 lanes; 0 if
+// they do not fit them (long values, different block counts)
+static int verify_lanes(verify_job *job, size_t first, int n, unsigned char *bits) {
+    unsigned char preimages[SHA256X8_LANES][BATCH_VALUE_LEN + 2 + 2 * COMMIT_NONCE_SIZE];
+    unsigned char digests[SHA256X8_LANES][32];
+    const unsigned char *msgs[SHA256X8_LANES];
+    size_t lens[SHA256X8_LANES];
+    int nblocks = 0;
+
+    for (int l = 0; l < SHA256X8_LANES; l++) {
+        size_t i = first + (l < n ? l : 0);  // Spare lanes repeat the first item
+        size_t value_len = job->value_lens[i];
+
+        if (value_len > BATCH_VALUE_LEN) return 0;
+        memcpy(preimages[l], job->values[i], value_len);
+        memcpy(preimages[l] + value_len, "||", 2);
+        nonce_hex(job->nonces + i * COMMIT_NONCE_SIZE, (char *)preimages[l] + value_len + 2);
+        msgs[l] = preimages[l];
+        lens[l] = value_len + 2 + 2 * COMMIT_NONCE_SIZE;
+        if (l == 0) nblocks = SHA256X8_BLOCKS(lens[0]);
+        else if (SHA256X8_BLOCKS(lens[l]) != nblocks) return 0;
+    }
+    if (nblocks > SHA256X8_MAX_BLOCKS) return 0;
+
+    sha256x8(msgs, lens, nblocks, digests);
+    *bits = 0;
+    for (int l = 0; l < n; l++) {
+        *bits |= (tag_equal_mask(digests[l], job->commitments + (first + l) * COMMIT_HASH_SIZE,
+                                 COMMIT_HASH_SIZE) & 1) << l;
+    }
+    return 1;
+}
+
+static void *verify_worker(void *arg) {
+    verify_job *job = arg;
+
+    for (size_t first = job->first; first < job->last; first += 8) {
+        int n = job->last - first < 8 ? (int)(job->last - first) : 8;
+        unsigned char bits = 0;
+
+        if (job->backend != COMMIT_HASH_AVX2 || !verify_lanes(job, first, n, &bits)) {
+            for (int l = 0; l < n; l++) {
+                size_t i = first + l;
+                bits |= commit_verify(job->commitments + i * COMMIT_HASH_SIZE, job->values[i],
+                                      job->value_lens[i], job->nonces + i * COMMIT_NONCE_SIZE) << l;
+            }
+        }
+        job->bitmap[first / 8] = bits;
+        job->ok += __builtin_popcount(bits);
+    }
+    return NULL;
+}
+
+size_t commit_verify_batch(const unsigned char *commitments, const char *const *values,
+                           const size_t *value_lens, const unsigned char *nonces, size_t count,
+                           unsigned char *bitmap, int backend, int num_threads) {
+    pthread_t threads[COMMIT_VERIFY_MAX_THREADS];
+    int started[COMMIT_VERIFY_MAX_THREADS] = {0};
+    verify_job jobs[COMMIT_VERIFY_MAX_THREADS];
+    size_t groups = (count + 7) / 8, ok = 0;
+
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > COMMIT_VERIFY_MAX_THREADS) num_threads = COMMIT_VERIFY_MAX_THREADS;
+    if ((size_t)num_threads > groups) num_threads = groups > 0 ? (int)groups : 1;
+    backend = commit_hash_backend(backend);
+
+    for (int t = 0; t < num_threads; t++) {
+        size_t first = groups * t / num_threads * 8, last = groups * (t + 1) / num_threads * 8;
+        jobs[t] = (verify_job){commitments, nonces, values, value_lens, first, last < count ? last : count,
+                               bitmap, backend, 0};
+    }
+    // Thread 0 is the caller itself
+    for (int t = 1; t < num_threads; t++) {
+        started[t] = (pthread_create(&threads[t], NULL, verify_worker, &jobs[t]) == 0);
+        if (!started[t]) verify_worker(&jobs[t]);  // Run inline if no thread
+    }
+    verify_worker(&jobs[0]);
+    for (int t = 1; t < num_threads; t++) {
+        if (started[t]) pthread_join(threads[t], NULL);
+    }
+    for (int t = 0; t < num_threads; t++) ok += jobs[t].ok;
+    return ok;
+}
+
+// --- Frames ---
+
+void commit_conn_init(commit_conn *conn, int fd) {
+    memset(conn, 0, sizeof(*conn));
+    conn->fd = fd;
+}
+
+static uint32_t frame_body_len(const commit_frame *frame) {
+    uint32_t len = 0;
+
+    for (int c = 0; c < frame->num_columns; c++) len += frame->columns[c].iov_len;
+    return len;
+}
+
+// Fill iov[0..count) completely, advancing through it on short transfers
+static int transfer_all(int fd, struct iovec *iov, int count, int sending) {
+    while (count > 0) {
+        struct msghdr msg = {.msg_iov = iov, .msg_iovlen = count};
+        ssize_t n = sending ? sendmsg(fd, &msg, MSG_NOSIGNAL) : recvmsg(fd, &msg, MSG_WAITALL);
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (unsigned char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+int commit_send(commit_conn *conn, commit_frame *frames, int n) {
+    unsigned char headers[MAX_FLIGHT][COMMIT_HEADER_SIZE];
+    struct iovec iov[MAX_FLIGHT * (1 + COMMIT_MAX_COLUMNS)];
+    int count = 0;
+
+    if (n < 1 || n > MAX_FLIGHT) return -1;
+    for (int f = 0; f < n; f++) {
+        unsigned char *h = headers[f];
+
+        put_be32(h, frame_body_len(&frames[f]));
+        h[4] = (unsigned char)frames[f].type;
+        h[5] = (unsigned char)((frames[f].flags & ~COMMIT_F_MORE) | (f < n - 1 ? COMMIT_F_MORE : 0));
+        h[6] = (unsigned char)frames[f].num_dice;
+        h[7] = COMMIT_VERSION;
+        put_be32(h + 8, frames[f].first_round);
+        put_be32(h + 12, frames[f].count);
+        iov[count++] = (struct iovec){h, COMMIT_HEADER_SIZE};
+        for (int c = 0; c < frames[f].num_columns; c++) {
+            if (frames[f].columns[c].iov_len > 0) iov[count++] = frames[f].columns[c];
+        }
+    }
+    conn->flights_sent++;
+    return transfer_all(conn->fd, iov, count, 1);
+}
+
+int commit_recv_header(commit_conn *conn, commit_frame *frame) {
+    unsigned char *h = conn->next_header;
+
+    if (!conn->have_next) {
+        struct iovec iov = {h, COMMIT_HEADER_SIZE};
+        if (transfer_all(conn->fd, &iov, 1, 0) != 0) return -1;
+    }
+    conn->have_next = 0;
+
+    frame->body_len = get_be32(h);
+    frame->type = h[4];
+    frame->flags = h[5];
+    frame->num_dice = h[6];
+    frame->first_round = get_be32(h + 8);
+    frame->count = get_be32(h + 12);
+    if (h[7] != COMMIT_VERSION || frame->type < COMMIT_MSG_COMMIT || frame->type > COMMIT_MSG_ERROR ||
+        frame->body_len > COMMIT_MAX_BODY || frame->count > COMMIT_MAX_ROUNDS) {
+        fprintf(stderr, "Malformed commitment frame header\n");
+        return -1;
+    }
+    return 0;
+}
+
+int commit_recv_body(commit_conn *conn, const commit_frame *frame) {
+    struct iovec iov[COMMIT_MAX_COLUMNS + 1];
+    int count = 0;
+
+    if (frame_body_len(frame) != frame->body_len) {
+        fprintf(stderr, "Commitment frame body of %u bytes, expected %u\n", frame->body_len,
+                frame_body_len(frame));
+        return -1;
+    }
+    for (int c = 0; c < frame->num_columns; c++) {
+        if (frame->columns[c].iov_len > 0) iov[count++] = frame->columns[c];
+    }
+    // The next header of the flight comes in the same recvmsg
+    if (frame->flags & COMMIT_F_MORE) iov[count++] = (struct iovec){conn->next_header, COMMIT_HEADER_SIZE};
+    if (transfer_all(conn->fd, iov, count, 0) != 0) return -1;
+    conn->have_next = (frame->flags & COMMIT_F_MORE) != 0;
+    return 0;
+}
+
+static void send_error(commit_conn *conn, const char *message) {
+    commit_frame frame = {.type = COMMIT_MSG_ERROR, .columns = {{(void *)message, strlen(message)}},
+                          .num_columns = 1};
+    commit_send(conn, &frame, 1);
+}
+
+// Next header, which has to be a `type` frame of count rounds from
+// first_round (count 0: any); an ERROR frame is printed
+static int expect_frame(commit_conn *conn, commit_frame *frame, int type, int num_dice,
+                        uint32_t first_round, uint32_t count) {
+    if (commit_recv_header(conn, frame) != 0) return -1;
+    if (frame->type == COMMIT_MSG_ERROR) {
+        char message[MAX_ERROR_LEN + 1] = "";
+        frame->columns[0] = (struct iovec){message, frame->body_len};
+        frame->num_columns = 1;
+        if (frame->body_len <= MAX_ERROR_LEN && commit_recv_body(conn, frame) == 0) {
+            message[frame->body_len] = '\0';
+        }
+        fprintf(stderr, "Error from peer: %s\n", message);
+        return -1;
+    }
+    if (frame->type != type || (num_dice && frame->num_dice != num_dice) ||
+        frame->first_round != first_round || (count && frame->count != count)) {
+        fprintf(stderr, "Unexpected commitment frame (type %d, rounds %u-%u)\n", frame->type,
+                frame->first_round, frame->first_round + frame->count);
+        send_error(conn, "Unexpected frame");
+        return -1;
+    }
+    return 0;
+}
+
+// --- Dice exchange ---
+
+// count * num_dice fair six-sided dice (rejection sampling of random bytes)
+static void roll_dice(unsigned char *dice, size_t n) {
+    unsigned char bytes[256];
+    size_t have = 0, pos = 0;
+
+    for (size_t i = 0; i < n;) {
+        if (pos == have) {
+            rand_pool_bytes(bytes, sizeof(bytes));
+            have = sizeof(bytes);
+            pos = 0;
+        }
+        unsigned char b = bytes[pos++];
+        if (b < 252) dice[i++] = 1 + b % 6;
+    }
+    OPENSSL_cleanse(bytes, sizeof(bytes));
+}
+
+// Sum of one player's dice, -1 if a die is out of range
+static int dice_sum(const unsigned char *dice, int num_dice) {
+    int sum = 0;
+
+    for (int d = 0; d < num_dice; d++) {
+        if (dice[d] < 1 || dice[d] > 6) return -1;
+        sum += dice[d];
+    }
+    return sum;
+}
+
+static void tally(commit_score *score, const unsigned char *outcome, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        switch (outcome[i]) {
+            case COMMIT_ALICE: score->alice_wins++; break;
+            case COMMIT_BOB: score->bob_wins++; break;
+            case COMMIT_TIE: score->ties++; break;
+            default: score->rejected++; break;
+        }
+    }
+}
+
+typedef struct {
+    uint32_t first, count;
+    unsigned char *dice, *nonces, *commitments;
+} alice_batch;
+
+static void alice_prepare(alice_batch *b, int num_dice, uint32_t first, uint32_t count, int cheat_round) {
+    b->first = first;
+    b->count = count;
+    roll_dice(b->dice, (size_t)count * num_dice);
+    commit_nonce(b->nonces, count);
+    for (uint32_t i = 0; i < count; i++) {
+        char value[MAX_VALUE_LEN];
+        int len = snprintf(value, sizeof(value), "%d", dice_sum(b->dice + (size_t)i * num_dice, num_dice));
+        commit_compute(value, len, b->nonces + (size_t)i * COMMIT_NONCE_SIZE,
+                       b->commitments + (size_t)i * COMMIT_HASH_SIZE);
+    }
+    // A cheating Alice changes her reveal after committing
+    if (cheat_round >= 0 && (uint32_t)cheat_round >= first && (uint32_t)cheat_round < first + count) {
+        b->nonces[(size_t)(cheat_round - first) * COMMIT_NONCE_SIZE] ^= 1;
+    }
+}
+
+int commit_play_alice(commit_conn *conn, int num_dice, int num_rounds, int batch, int cheat_round,
+                      commit_score *score) {
+    alice_batch batches[2];
+    unsigned char *bob_dice = malloc((size_t)batch * num_dice);
+    unsigned char *outcome = malloc(batch);
+    commit_frame frames[MAX_FLIGHT], in;
+    int allocated = bob_dice && outcome, ret = -1;
+
+    memset(score, 0, sizeof(*score));
+    memset(batches, 0, sizeof(batches));
+    if (num_dice < 1 || num_dice > COMMIT_MAX_DICE || batch < 1 || batch > COMMIT_MAX_ROUNDS || num_rounds < 1) {
+        fprintf(stderr, "Invalid match: %d dice, batches of %d rounds\n", num_dice, batch);
+        goto cleanup;
+    }
+    for (int s = 0; s < 2; s++) {
+        batches[s].dice = malloc((size_t)batch * num_dice);
+        batches[s].nonces = malloc((size_t)batch * COMMIT_NONCE_SIZE);
+        batches[s].commitments = malloc((size_t)batch * COMMIT_HASH_SIZE);
+        allocated &= batches[s].dice && batches[s].nonces && batches[s].commitments;
+    }
+    if (!allocated) {
+        perror("Memory allocation failed");
+        goto cleanup;
+    }
+
+    alice_prepare(&batches[0], num_dice, 0, batch < num_rounds ? batch : num_rounds, cheat_round);
+    frames[0] = (commit_frame){.type = COMMIT_MSG_COMMIT, .num_dice = num_dice, .count = batches[0].count,
+                               .columns = {{batches[0].commitments, (size_t)batches[0].count * COMMIT_HASH_SIZE}},
+                               .num_columns = 1};
+    if (commit_send(conn, frames, 1) != 0) goto cleanup;
+
+    for (int k = 0;; k++) {
+        alice_batch *b = &batches[k & 1], *next = &batches[(k + 1) & 1];
+        uint32_t next_first = b->first + b->count;
+        int more = next_first < (uint32_t)num_rounds, n = 1;
+
+        // Bob's roll, made without knowing Alice's
+        if (expect_frame(conn, &in, COMMIT_MSG_RESULT, num_dice, b->first, b->count) != 0) goto cleanup;
+        in.columns[0] = (struct iovec){bob_dice, (size_t)b->count * num_dice};
+        in.num_columns = 1;
+        if (commit_recv_body(conn, &in) != 0) goto cleanup;
+
+        // Reveal this batch and commit to the next one in the same flight
+        frames[0] = (commit_frame){.type = COMMIT_MSG_REVEAL, .num_dice = num_dice, .first_round = b->first,
+                                   .count = b->count,
+                                   .columns = {{b->nonces, (size_t)b->count * COMMIT_NONCE_SIZE},
+                                               {b->dice, (size_t)b->count * num_dice}},
+                                   .num_columns = 2};
+        if (more) {
+            uint32_t left = num_rounds - next_first;
+            alice_prepare(next, num_dice, next_first, left < (uint32_t)batch ? left : (uint32_t)batch, cheat_round);
+            frames[n++] = (commit_frame){.type = COMMIT_MSG_COMMIT, .num_dice = num_dice,
+                                         .first_round = next->first, .count = next->count,
+                                         .columns = {{next->commitments, (size_t)next->count * COMMIT_HASH_SIZE}},
+                                         .num_columns = 1};
+        }
+        if (commit_send(conn, frames, n) != 0) goto cleanup;
+
+        if (expect_frame(conn, &in, COMMIT_MSG_OUTCOME, 0, b->first, b->count) != 0) goto cleanup;
+        in.columns[0] = (struct iovec){outcome, b->count};
+        in.num_columns = 1;
+        if (commit_recv_body(conn, &in) != 0) goto cleanup;
+        tally(score, outcome, b->count);
+        if (!more) break;
+    }
+    ret = 0;
+
+cleanup:
+    for (int s = 0; s < 2; s++) {
+        if (batches[s].nonces) OPENSSL_cleanse(batches[s].nonces, (size_t)batch * COMMIT_NONCE_SIZE);
+        free(batches[s].dice);
+        free(batches[s].nonces);
+        free(batches[s].commitments);
+    }
+    free(bob_dice);
+    free(outcome);
+    return ret;
+}
+
+int commit_serve_bob(commit_conn *conn, commit_score *score) {
+    unsigned char *commitments = malloc((size_t)COMMIT_MAX_ROUNDS * COMMIT_HASH_SIZE);
+    unsigned char *nonces = malloc((size_t)COMMIT_MAX_ROUNDS * COMMIT_NONCE_SIZE);
+    unsigned char *alice_dice = malloc((size_t)COMMIT_MAX_ROUNDS * COMMIT_MAX_DICE);
+    unsigned char *bob_dice = malloc((size_t)COMMIT_MAX_ROUNDS * COMMIT_MAX_DICE);
+    unsigned char *outcome = malloc(COMMIT_MAX_ROUNDS);
+    commit_frame frames[MAX_FLIGHT], in;
+    uint32_t first = 0, count, prev_first = 0, prev_count = 0;
+    int num_dice, pending = 0, ret = -1;
+
+    memset(score, 0, sizeof(*score));
+    if (!commitments || !nonces || !alice_dice || !bob_dice || !outcome) {
+        perror("Memory allocation failed");
+        goto cleanup;
+    }
+    if (expect_frame(conn, &in, COMMIT_MSG_COMMIT, 0, 0, 0) != 0) goto cleanup;
+    num_dice = in.num_dice;
+    count = in.count;
+    if (num_dice < 1 || num_dice > COMMIT_MAX_DICE || count < 1) {
+        send_error(conn, "Invalid number of dice or rounds");
+        goto cleanup;
+    }
+
+    for (;;) {
+        int n = 0;
+
+        in.columns[0] = (struct iovec){commitments, (size_t)count * COMMIT_HASH_SIZE};
+        in.num_columns = 1;
+        if (commit_recv_body(conn, &in) != 0) goto cleanup;
+
+        // Roll only once Alice is committed; the previous outcome rides along
+        roll_dice(bob_dice, (size_t)count * num_dice);
+        if (pending) {
+            frames[n++] = (commit_frame){.type = COMMIT_MSG_OUTCOME, .first_round = prev_first, .count = prev_count,
+                                         .columns = {{outcome, prev_count}}, .num_columns = 1};
+        }
+        frames[n++] = (commit_frame){.type = COMMIT_MSG_RESULT, .num_dice = num_dice, .first_round = first,
+                                     .count = count, .columns = {{bob_dice, (size_t)count * num_dice}},
+                                     .num_columns = 1};
+        if (commit_send(conn, frames, n) != 0) goto cleanup;
+
+        if (expect_frame(conn, &in, COMMIT_MSG_REVEAL, num_dice, first, count) != 0) goto cleanup;
+        in.columns[0] = (struct iovec){nonces, (size_t)count * COMMIT_NONCE_SIZE};
+        in.columns[1] = (struct iovec){alice_dice, (size_t)count * num_dice};
+        in.num_columns = 2;
+        if (commit_recv_body(conn, &in) != 0) goto cleanup;
+
+        for (uint32_t i = 0; i < count; i++) {
+            int alice_sum = dice_sum(alice_dice + (size_t)i * num_dice, num_dice);
+            int bob_sum = dice_sum(bob_dice + (size_t)i * num_dice, num_dice);
+            char value[MAX_VALUE_LEN];
+            int len = snprintf(value, sizeof(value), "%d", alice_sum);
+
+            if (alice_sum < 0) {
+                outcome[i] = COMMIT_BAD_DICE;
+            } else if (!commit_verify(commitments + (size_t)i * COMMIT_HASH_SIZE, value, len,
+                                      nonces + (size_t)i * COMMIT_NONCE_SIZE)) {
+                outcome[i] = COMMIT_MISMATCH;
+            } else {
+                outcome[i] = alice_sum > bob_sum ? COMMIT_ALICE : bob_sum > alice_sum ? COMMIT_BOB : COMMIT_TIE;
+            }
+        }
+        tally(score, outcome, count);
+        prev_first = first;
+        prev_count = count;
+        first += count;
+
+        if (!(in.flags & COMMIT_F_MORE)) break;
+        // Alice's next commitment came in the same flight
+        if (expect_frame(conn, &in, COMMIT_MSG_COMMIT, num_dice, first, 0) != 0) goto cleanup;
+        count = in.count;
+        if (count < 1) {
+            send_error(conn, "Empty batch");
+            goto cleanup;
+        }
+        pending = 1;
+    }
+
+    frames[0] = (commit_frame){.type = COMMIT_MSG_OUTCOME, .first_round = prev_first, .count = prev_count,
+                               .columns = {{outcome, prev_count}}, .num_columns = 1};
+    ret = commit_send(conn, frames, 1);
+
+cleanup:
+    free(commitments);
+    free(nonces);
+    free(alice_dice);
+    free(bob_dice);
+    free(outcome);
+    return ret;
+}
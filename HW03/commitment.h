@@ -0,0 +1,123 @@
+#ifndef HW03_COMMITMENT_H
+#define HW03_COMMITMENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#define COMMIT_HASH_SIZE 32    // SHA-256
+#define COMMIT_NONCE_SIZE 32   // secrets.token_hex(32): 32 random bytes, sent raw
+#define COMMIT_HEADER_SIZE 16
+#define COMMIT_MAX_ROUNDS 4096 // Rounds per frame
+#define COMMIT_MAX_DICE 32
+#define COMMIT_MAX_BODY (COMMIT_MAX_ROUNDS * (COMMIT_NONCE_SIZE + COMMIT_MAX_DICE))
+
+// Native CommitmentScheme of HW06/HW07 shared/protocol.py. The preimage is
+// the Python one, "<value>||<nonce as 64 lowercase hex digits>", so a
+// commitment made here verifies with CommitmentScheme.verify and the other
+// way round; only the wire carries the hash and the nonce as raw bytes.
+void commit_nonce(unsigned char *nonce, size_t count);  // count nonces, from rand_pool_bytes
+void commit_compute(const char *value, size_t value_len, const unsigned char *nonce,
+                    unsigned char *commitment);
+int commit_verify(const unsigned char *commitment, const char *value, size_t value_len,
+                  const unsigned char *nonce);  // 1 if it matches
+void commit_hex(const unsigned char *commitment, char *hex);  // 2 * COMMIT_HASH_SIZE + 1 bytes
+
+// Hash backends of commit_verify_batch: libcrypto one message at a time
+// (SHA-NI when the CPU has it) or eight messages per AVX2 register
+// (sha256x8.h). AUTO takes libcrypto if it uses SHA-NI, else AVX2.
+enum { COMMIT_HASH_AUTO = 0, COMMIT_HASH_LIBCRYPTO, COMMIT_HASH_AVX2 };
+
+#define COMMIT_VERIFY_MAX_THREADS 64
+
+// Backend that runs for a requested one (AVX2 falls back to libcrypto
+// when unavailable), and its name
+int commit_hash_backend(int backend);
+const char *commit_hash_name(int backend);
+
+// Verify count commitments at once: commitments[i] against values[i]
+// (value_lens[i] bytes) and nonces[i]. Bit i % 8 of bitmap[i / 8] is set
+// when item i matches; bitmap holds (count + 7) / 8 bytes. The items are
+// split over num_threads threads (the caller is one) in groups of eight,
+// so every thread writes its own bitmap bytes. Returns the number of
+// matches.
+size_t commit_verify_batch(const unsigned char *commitments, const char *const *values,
+                           const size_t *value_lens, const unsigned char *nonces, size_t count,
+                           unsigned char *bitmap, int backend, int num_threads);
+
+// Binary frames of the dice exchange (HW07 alice.py/bob.py), big-endian:
+//
+//   be32 body_len || type || flags || num_dice || version || be32 first_round || be32 count || body
+//
+// The body is a set of columns, one array per field, each count records
+// long, so the sender gathers them with writev and the receiver scatters
+// them with recvmsg straight into its arrays:
+//
+//   COMMIT   Alice  commitments[count][32]
+//   RESULT   Bob    dice[count][num_dice]
+//   REVEAL   Alice  nonces[count][32], dice[count][num_dice]
+//   OUTCOME  Bob    outcome[count] (COMMIT_TIE, COMMIT_ALICE, ... per round)
+//   ERROR    both   message text, count 0
+//
+// count rounds travel in each frame, so a batch of rounds costs one
+// COMMIT/RESULT and one REVEAL/OUTCOME exchange. Frames of one flight go
+// out in a single writev; all but the last carry COMMIT_F_MORE, which lets
+// the receiver read the next header together with the current body.
+// Alice pipelines batches: REVEAL k travels with COMMIT k+1 and OUTCOME k
+// with RESULT k+1, so a match of B batches takes B + 1 round trips.
+enum { COMMIT_MSG_COMMIT = 1, COMMIT_MSG_RESULT, COMMIT_MSG_REVEAL, COMMIT_MSG_OUTCOME, COMMIT_MSG_ERROR };
+
+#define COMMIT_VERSION 1
+#define COMMIT_F_MORE 0x01  // Another frame of the same flight follows
+
+// Per-round outcome: the DiceLogic.determine_winner values, or why the
+// reveal was rejected (the round is then not scored)
+enum { COMMIT_TIE = 0, COMMIT_ALICE = 1, COMMIT_BOB = 2, COMMIT_MISMATCH = 3, COMMIT_BAD_DICE = 4 };
+
+#define COMMIT_MAX_COLUMNS 2
+
+typedef struct {
+    int type, flags, num_dice;
+    uint32_t first_round, count;
+    uint32_t body_len;  // Set by commit_recv_header
+    struct iovec columns[COMMIT_MAX_COLUMNS];  // Body, in order
+    int num_columns;
+} commit_frame;
+
+// A connection: the socket and, after a COMMIT_F_MORE frame, the next
+// header already read with its predecessor's body
+typedef struct {
+    int fd;
+    unsigned char next_header[COMMIT_HEADER_SIZE];
+    int have_next;
+    unsigned long flights_sent;  // writev calls, for the round-trip count
+} commit_conn;
+
+void commit_conn_init(commit_conn *conn, int fd);
+
+// Send frames[0..n) as one flight, header and columns in one writev.
+// 0 on success, -1 on error.
+int commit_send(commit_conn *conn, commit_frame *frames, int n);
+
+// Next frame header into frame (columns untouched). -1 on error, closed
+// connection or a malformed header.
+int commit_recv_header(commit_conn *conn, commit_frame *frame);
+
+// Body of the frame whose header was just received, scattered into
+// frame->columns, which must add up to frame->body_len (-1 otherwise)
+int commit_recv_body(commit_conn *conn, const commit_frame *frame);
+
+typedef struct {
+    int alice_wins, bob_wins, ties, rejected;
+} commit_score;
+
+// Alice: play num_rounds rounds of num_dice dice, batch rounds per frame,
+// pipelined; cheat_round >= 0 reveals a different nonce in that round
+// (checks Bob's verification). Returns 0 when the match completed.
+int commit_play_alice(commit_conn *conn, int num_dice, int num_rounds, int batch, int cheat_round,
+                      commit_score *score);
+
+// Bob: serve one match on conn until Alice's last REVEAL. 0 on success.
+int commit_serve_bob(commit_conn *conn, commit_score *score);
+
+#endif
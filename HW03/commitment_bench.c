@@ -0,0 +1,292 @@
+#include "commitment_bench.h"
+#include "bench.h"
+#include "commitment.h"
+#include "cpuinfo.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    int listen_fd;
+    commit_score score;
+    int ret;
+} bob_arg;
+
+static void *bob_main(void *arg) {
+    bob_arg *b = arg;
+    int fd = accept(b->listen_fd, NULL, NULL), one = 1;
+    commit_conn conn;
+
+    b->ret = -1;
+    if (fd < 0) {
+        perror("accept");
+        return NULL;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    commit_conn_init(&conn, fd);
+    b->ret = commit_serve_bob(&conn, &b->score);
+    close(fd);
+    return NULL;
+}
+
+// Loopback listener on an ephemeral port
+static int listen_loopback(struct sockaddr_in *addr) {
+    socklen_t len = sizeof(*addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || bind(fd, (struct sockaddr *)addr, sizeof(*addr)) != 0 || listen(fd, 1) != 0 ||
+        getsockname(fd, (struct sockaddr *)addr, &len) != 0) {
+        perror("Cannot listen on loopback");
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// One match; returns 0 if both sides completed with the same score
+static int run_match(int num_rounds, int batch, int cheat_round, long long *ns,
+                     unsigned long *round_trips, commit_score *score) {
+    struct sockaddr_in addr;
+    struct timespec start, end;
+    bob_arg bob = {0};
+    pthread_t thread;
+    commit_conn conn;
+    int fd, one = 1, ret;
+
+    if ((bob.listen_fd = listen_loopback(&addr)) < 0) return -1;
+    if (pthread_create(&thread, NULL, bob_main, &bob) != 0) {
+        perror("pthread_create");
+        close(bob.listen_fd);
+        return -1;
+    }
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("Cannot connect to Bob");
+        if (fd >= 0) close(fd);
+        shutdown(bob.listen_fd, SHUT_RDWR);
+        pthread_join(thread, NULL);
+        close(bob.listen_fd);
+        return -1;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    commit_conn_init(&conn, fd);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ret = commit_play_alice(&conn, COMMIT_BENCH_DICE, num_rounds, batch, cheat_round, score);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    close(fd);
+    pthread_join(thread, NULL);
+    close(bob.listen_fd);
+
+    *ns = elapsed_ns(&start, &end);
+    *round_trips = conn.flights_sent;
+    if (ret != 0 || bob.ret != 0) return -1;
+    return memcmp(score, &bob.score, sizeof(*score)) == 0 ? 0 : -1;
+}
+
+// The value "7" with the nonce 00 01 .. 1f, hashed by protocol.py
+static int check_python_preimage(void) {
+    static const char expected[] = "7b81bac9c2fa9d9c0f0f428fa8d3bf6a64a2a45c9a59d6a1da4af7dcebc98df3";
+    unsigned char nonce[COMMIT_NONCE_SIZE], commitment[COMMIT_HASH_SIZE];
+    char hex[2 * COMMIT_HASH_SIZE + 1];
+
+    for (int i = 0; i < COMMIT_NONCE_SIZE; i++) nonce[i] = (unsigned char)i;
+    commit_compute("7", 1, nonce, commitment);
+    commit_hex(commitment, hex);
+    return strcmp(hex, expected) == 0;
+}
+
+int run_commit_tests(int *batch_sizes, int num_batch_sizes, int num_rounds) {
+    char results_filename[256];
+    FILE *results_file;
+    commit_score score;
+    unsigned long round_trips;
+    long long ns;
+
+    printf("\n=================================================================\n");
+    printf("  Native commitment exchange: best-of-%d match, %d dice, TCP loopback\n",
+           num_rounds, COMMIT_BENCH_DICE);
+    printf("=================================================================\n");
+
+    printf("\nPython CommitmentScheme preimage: %s\n", check_python_preimage() ? "[OK]" : "MISMATCH!");
+    if (run_match(100, 8, 42, &ns, &round_trips, &score) == 0 && score.rejected == 1 &&
+        score.alice_wins + score.bob_wins + score.ties == 99) {
+        printf("Changed reveal in round 42 of 100: rejected by Bob [OK]\n");
+    } else {
+        printf("Changed reveal in round 42 of 100: NOT rejected (%d rejected)!\n", score.rejected);
+    }
+
+    results_file = open_results_file("commit", "",
+                                     "Batch,Rounds,Num_Dice,Round_Trips,Best_Match_ms,Median_Match_ms,"
+                                     "Rounds_per_sec,Alice_Wins,Bob_Wins,Ties,Rejected",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) return 1;
+
+    printf("\n    %-8s %10s %12s %12s %14s %s\n", "Batch", "Round trips", "Best ms", "Median ms",
+           "Rounds/s", "Alice-Bob-Ties");
+    for (int b = 0; b < num_batch_sizes; b++) {
+        long long match_ns[COMMIT_BENCH_REPEATS];
+        double match_us[COMMIT_BENCH_REPEATS];
+        const char *names[1] = {"match"};
+        const double *values[1] = {match_us};
+        int counts[1] = {COMMIT_BENCH_REPEATS};
+        char params[32];
+        int batch = batch_sizes[b], ok = 1;
+
+        for (int r = 0; r < COMMIT_BENCH_REPEATS && ok; r++) {
+            ok = run_match(num_rounds, batch, -1, &match_ns[r], &round_trips, &score) == 0 && score.rejected == 0;
+            match_us[r] = match_ns[r] / 1000.0;
+        }
+        if (!ok) {
+            printf("    %-8d FAILED\n", batch);
+            continue;
+        }
+        snprintf(params, sizeof(params), "batch=%d", batch);
+        bench_log_samples(results_file, "commit-reveal", params, (size_t)num_rounds, "us", names, values, counts, 1);
+
+        bench_latency lat;
+        bench_latency_summary(match_ns, COMMIT_BENCH_REPEATS, &lat);
+        double rounds_per_sec = num_rounds / (match_ns[0] / 1e9);  // Sorted: best first
+        printf("    %-8d %10lu %12.2f %12.2f %14.0f %d-%d-%d\n", batch, round_trips, match_ns[0] / 1e6,
+               lat.p50_ns / 1e6, rounds_per_sec, score.alice_wins, score.bob_wins, score.ties);
+        fprintf(results_file, "%d,%d,%d,%lu,%.3f,%.3f,%.0f,%d,%d,%d,%d\n", batch, num_rounds, COMMIT_BENCH_DICE,
+                round_trips, match_ns[0] / 1e6, lat.p50_ns / 1e6, rounds_per_sec,
+                score.alice_wins, score.bob_wins, score.ties, score.rejected);
+    }
+
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    return 0;
+}
+
+// One batch size through one backend and thread count: best ns per
+// verification over enough calls for COMMIT_VERIFY_ITEMS items; -1 if the
+// bitmap is wrong
+static double time_verify_batch(const unsigned char *commitments, const char *const *values,
+                                const size_t *value_lens, const unsigned char *nonces, size_t count,
+                                unsigned char *bitmap, int backend, int threads) {
+    size_t calls = COMMIT_VERIFY_ITEMS / count > 0 ? COMMIT_VERIFY_ITEMS / count : 1;
+    double best = -1;
+
+    for (int rep = 0; rep < 3; rep++) {
+        struct timespec start, end;
+        size_t ok = 0;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (size_t c = 0; c < calls; c++) {
+            ok = commit_verify_batch(commitments, values, value_lens, nonces, count, bitmap, backend, threads);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        // Everything verifies but the altered entry in the middle
+        if (ok != count - 1 || (bitmap[count / 2 / 8] >> (count / 2 % 8) & 1)) return -1;
+        double ns = (double)elapsed_ns(&start, &end) / (calls * count);
+        if (best < 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+int run_commit_verify_tests(size_t *batch_sizes, int num_batch_sizes) {
+    static const int backends[2] = {COMMIT_HASH_LIBCRYPTO, COMMIT_HASH_AVX2};
+    char results_filename[256];
+    FILE *results_file;
+    size_t max_count = 0;
+    int online = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int thread_counts[MAX_SWEEP], num_thread_counts = 0;
+
+    for (int b = 0; b < num_batch_sizes; b++) {
+        if (batch_sizes[b] < 2) {
+            fprintf(stderr, "Batch size must be at least 2\n");
+            return 1;
+        }
+        if (batch_sizes[b] > max_count) max_count = batch_sizes[b];
+    }
+    for (int t = 1; num_thread_counts < MAX_SWEEP; t *= 2) {
+        if (t >= online || t >= COMMIT_VERIFY_MAX_THREADS) {
+            thread_counts[num_thread_counts++] = online < COMMIT_VERIFY_MAX_THREADS ? online : COMMIT_VERIFY_MAX_THREADS;
+            break;
+        }
+        thread_counts[num_thread_counts++] = t;
+    }
+
+    unsigned char *commitments = malloc(max_count * COMMIT_HASH_SIZE);
+    unsigned char *nonces = malloc(max_count * COMMIT_NONCE_SIZE);
+    unsigned char *bitmap = malloc((max_count + 7) / 8);
+    char (*sums)[4] = malloc(max_count * sizeof(*sums));
+    const char **values = malloc(max_count * sizeof(char *));
+    size_t *value_lens = malloc(max_count * sizeof(size_t));
+    if (!commitments || !nonces || !bitmap || !sums || !values || !value_lens) {
+        perror("Memory allocation failed");
+        free(commitments); free(nonces); free(bitmap); free(sums); free(values); free(value_lens);
+        return 1;
+    }
+
+    // Sums of three dice, as the HW07 Alice commits to them
+    commit_nonce(nonces, max_count);
+    for (size_t i = 0; i < max_count; i++) {
+        value_lens[i] = snprintf(sums[i], sizeof(sums[i]), "%d", 3 + nonces[i * COMMIT_NONCE_SIZE] % 16);
+        values[i] = sums[i];
+        commit_compute(values[i], value_lens[i], nonces + i * COMMIT_NONCE_SIZE, commitments + i * COMMIT_HASH_SIZE);
+    }
+
+    // Under --cpu-caps the native results are kept
+    results_file = open_results_file(getenv(CPU_CAPS_ENV) ? "commit_verify_masked" : "commit_verify", "",
+                                     "Backend,Threads,Batch,Verifies_per_sec,ns_per_verify,Speedup",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) {
+        free(commitments); free(nonces); free(bitmap); free(sums); free(values); free(value_lens);
+        return 1;
+    }
+
+    printf("\n=================================================================\n");
+    printf("  Batch commitment verification (auto backend: %s)\n",
+           commit_hash_name(commit_hash_backend(COMMIT_HASH_AUTO)));
+    printf("  speedup against libcrypto, 1 thread, same batch size\n");
+    printf("=================================================================\n");
+    printf("\n    %-10s %7s %8s %14s %10s %8s\n", "Backend", "Threads", "Batch", "Verifies/s", "ns each", "Speedup");
+
+    for (int b = 0; b < num_batch_sizes; b++) {
+        size_t count = batch_sizes[b];
+        double base = -1;
+
+        // Alter the middle entry; restored after this batch size
+        commitments[count / 2 * COMMIT_HASH_SIZE] ^= 1;
+        for (int k = 0; k < 2; k++) {
+            if (commit_hash_backend(backends[k]) != backends[k]) {
+                printf("    %-10s not available\n", commit_hash_name(backends[k]));
+                continue;
+            }
+            for (int t = 0; t < num_thread_counts; t++) {
+                double ns = time_verify_batch(commitments, values, value_lens, nonces, count, bitmap,
+                                              backends[k], thread_counts[t]);
+                if (ns < 0) {
+                    printf("    %-10s %7d %8zu Verification FAILED!\n", commit_hash_name(backends[k]),
+                           thread_counts[t], count);
+                    continue;
+                }
+                if (base < 0) base = ns;
+                printf("    %-10s %7d %8zu %14.0f %10.1f %8.2f\n", commit_hash_name(backends[k]),
+                       thread_counts[t], count, 1e9 / ns, ns, base / ns);
+                fprintf(results_file, "%s,%d,%zu,%.0f,%.2f,%.3f\n", commit_hash_name(backends[k]),
+                        thread_counts[t], count, 1e9 / ns, ns, base / ns);
+            }
+        }
+        commitments[count / 2 * COMMIT_HASH_SIZE] ^= 1;
+    }
+
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    free(commitments); free(nonces); free(bitmap); free(sums); free(values); free(value_lens);
+    return 0;
+}
@@ -0,0 +1,28 @@
+#ifndef HW03_COMMITMENT_BENCH_H
+#define HW03_COMMITMENT_BENCH_H
+
+#include <stddef.h>
+
+#define COMMIT_BENCH_DICE 3     // NUM_DICE of the HW07 containers
+#define COMMIT_BENCH_REPEATS 5  // Matches per batch size, best of
+
+// Native commitment exchange benchmark (commitment.h): Alice and Bob in two
+// threads over TCP loopback (TCP_NODELAY, as between the HW07 containers),
+// one best-of-num_rounds match per batch size, pipelined. First checks
+// that a changed reveal is rejected and that the preimage matches the
+// Python CommitmentScheme. Writes rounds/sec and round trips per match to
+// results_commit.csv, which HW07/protocol_benchmark.py --native compares
+// with the JSON protocol.
+int run_commit_tests(int *batch_sizes, int num_batch_sizes, int num_rounds);
+
+#define COMMIT_VERIFY_ITEMS (1 << 20)  // Verifications per measurement, at least one batch
+
+// Batch verification throughput (commit_verify_batch): every hash backend,
+// thread counts 1, 2, 4 .. up to the online CPUs, and the given batch
+// sizes, on dice-sum commitments with one altered entry per batch (which
+// must come back clear in the bitmap). Writes verifications/sec to
+// results_commit_verify.csv (results_commit_verify_masked.csv under an
+// OPENSSL_ia32cap mask, e.g. --cpu-caps scalar to take SHA-NI away).
+int run_commit_verify_tests(size_t *batch_sizes, int num_batch_sizes);
+
+#endif
@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+"""
+Regression gate over two sets of HW03 benchmark results
+Used for HW03 - Cybersecurity course
+Author: Nicolas Leone - Student ID: 1986354
+
+Reads the sample logs (results_*.jsonl, schema hw03-results/1) that the C
+program writes next to every results CSV, matches the series of a baseline
+and a candidate run by (log file, algorithm, params, bytes), and compares
+the raw timing samples of every direction with a two-sided Mann-Whitney U
+test. A series is flagged when the difference is significant (p < alpha)
+and its median moved by more than --min-change percent. Higher time means
+lower throughput, so both are reported.
+
+Usage:
+    compare_results.py BASELINE CANDIDATE [--alpha 0.05] [--min-change 3]
+
+BASELINE and CANDIDATE are .jsonl files or directories of them (matched by
+file name). Exits with status 1 if there is a regression.
+"""
+
+import argparse
+import glob
+import json
+import math
+import os
+import sys
+
+# Environment fields that explain a difference when they changed
+ENV_FIELDS = ['host', 'cpu', 'libcrypto_features', 'caps_mask', 'openssl', 'compiler',
+              'optimized', 'os_release', 'cycle_source', 'pinned_cpu', 'cpus_online',
+              'test_file_bytes']
+
+TIME_SERIES = ['enc', 'dec']  # Cycle series are kept in the logs but not gated
+
+
+def read_log(filename):
+    """Return (run metadata, {(algorithm, params, bytes): series object})"""
+    run = None
+    series = {}
+    with open(filename, 'r') as f:
+        for line_no, line in enumerate(f, 1):
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                obj = json.loads(line)
+            except json.JSONDecodeError as e:
+                print(f"Warning: {filename}:{line_no}: {e}")
+                continue
+            if obj.get('type') == 'run':
+                run = obj
+            elif obj.get('type') == 'series':
+                series[(obj['algorithm'], obj.get('params', ''), obj.get('bytes', 0))] = obj
+    return run, series
+
+
+def collect(path):
+    """Map log file name to its contents, for a file or a directory"""
+    if os.path.isdir(path):
+        files = sorted(glob.glob(os.path.join(path, 'results_*.jsonl')))
+    elif os.path.isfile(path):
+        files = [path]
+    else:
+        print(f"Error: {path} not found!")
+        sys.exit(2)
+    return {os.path.basename(f): read_log(f) for f in files}
+
+
+def ranks(values):
+    """Midranks (1-based) of values, and the tie correction sum of t^3 - t"""
+    order = sorted(range(len(values)), key=lambda i: values[i])
+    result = [0.0] * len(values)
+    ties = 0.0
+    i = 0
+    while i < len(order):
+        j = i
+        while j + 1 < len(order) and values[order[j + 1]] == values[order[i]]:
+            j += 1
+        for k in range(i, j + 1):
+            result[order[k]] = (i + j) / 2.0 + 1
+        t = j - i + 1
+        ties += t ** 3 - t
+        i = j + 1
+    return result, ties
+
+
+def exact_u_distribution(n1, n2):
+    """Number of arrangements giving each U, for U = 0 .. n1 * n2 (no ties)"""
+    # counts[i][j][u]: arrangements of i + j values with i from sample 1 and statistic u
+    prev = [[1] + [0] * (n1 * n2) for _ in range(n2 + 1)]
+    for i in range(1, n1 + 1):
+        cur = [[0] * (n1 * n2 + 1) for _ in range(n2 + 1)]
+        for j in range(n2 + 1):
+            for u in range(i * j + 1):
+                # Largest value from sample 1: beats all j of sample 2
+                total = prev[j][u - j] if u >= j else 0
+                # Largest value from sample 2: adds nothing
+                if j > 0:
+                    total += cur[j - 1][u]
+                cur[j][u] = total
+        prev = cur
+    return prev[n2]
+
+
+def mann_whitney_p(a, b):
+    """Two-sided p-value of the Mann-Whitney U test between samples a and b"""
+    n1, n2 = len(a), len(b)
+    if n1 == 0 or n2 == 0:
+        return 1.0
+    r, ties = ranks(list(a) + list(b))
+    u1 = sum(r[:n1]) - n1 * (n1 + 1) / 2.0
+    u = min(u1, n1 * n2 - u1)
+
+    if ties == 0 and n1 * n2 <= 900:
+        counts = exact_u_distribution(n1, n2)
+        total = sum(counts)
+        tail = sum(counts[:int(math.floor(u)) + 1]) / total
+        return min(1.0, 2 * tail)
+
+    # Normal approximation with tie and continuity corrections
+    n = n1 + n2
+    mean = n1 * n2 / 2.0
+    var = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1)))
+    if var <= 0:
+        return 1.0
+    z = (abs(u1 - mean) - 0.5) / math.sqrt(var)
+    return min(1.0, math.erfc(max(z, 0) / math.sqrt(2)))
+
+
+def median(values):
+    s = sorted(values)
+    n = len(s)
+    return (s[(n - 1) // 2] + s[n // 2]) / 2.0
+
+
+def compare(baseline, candidate, alpha, min_change):
+    """Print the comparison; return (regressions, improvements, compared)"""
+    regressions = improvements = compared = 0
+
+    for name in sorted(set(baseline) & set(candidate)):
+        base_run, base_series = baseline[name]
+        cand_run, cand_series = candidate[name]
+        print(f"\n{name}")
+
+        if base_run and cand_run:
+            changed = [f for f in ENV_FIELDS if base_run.get(f) != cand_run.get(f)]
+            for field in changed:
+                print(f"  env {field}: {base_run.get(field)!r} -> {cand_run.get(field)!r}")
+
+        print(f"  {'Algorithm':<28} {'Params':<14} {'Dir':<4} {'Base med':>10} {'Cand med':>10}"
+              f" {'Change':>8} {'MB/s':>16} {'p':>8}")
+        for key in sorted(set(base_series) & set(cand_series), key=str):
+            algorithm, params, size = key
+            for direction in TIME_SERIES:
+                a = base_series[key].get(direction, [])
+                b = cand_series[key].get(direction, [])
+                if not a or not b:
+                    continue
+                base_med, cand_med = median(a), median(b)
+                if base_med <= 0:
+                    continue
+                change = 100.0 * (cand_med - base_med) / base_med
+                p = mann_whitney_p(a, b)
+                compared += 1
+
+                verdict = ''
+                if p < alpha and abs(change) > min_change:
+                    if change > 0:
+                        verdict = 'REGRESSION'
+                        regressions += 1
+                    else:
+                        verdict = 'improved'
+                        improvements += 1
+                throughput = ''
+                if size and cand_med > 0:
+                    throughput = f"{size / base_med:.0f}->{size / cand_med:.0f}"
+                print(f"  {algorithm:<28} {params or '-':<14} {direction:<4} {base_med:>10.1f} {cand_med:>10.1f}"
+                      f" {change:>+7.1f}% {throughput:>16} {p:>8.4f} {verdict}")
+
+        for key in sorted(set(base_series) ^ set(cand_series), key=str):
+            side = 'baseline' if key in base_series else 'candidate'
+            print(f"  {key[0]} {key[1] or ''}: only in {side}")
+
+    for name in sorted(set(baseline) ^ set(candidate)):
+        print(f"\n{name}: only in {'baseline' if name in baseline else 'candidate'}")
+    return regressions, improvements, compared
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Flag significant performance regressions '
+                                                 'between two HW03 result sets')
+    parser.add_argument('baseline', help='baseline .jsonl file or directory')
+    parser.add_argument('candidate', help='candidate .jsonl file or directory')
+    parser.add_argument('--alpha', type=float, default=0.05,
+                        help='significance level of the Mann-Whitney U test (default 0.05)')
+    parser.add_argument('--min-change', type=float, default=3.0,
+                        help='smallest median change in percent worth flagging (default 3)')
+    args = parser.parse_args()
+
+    print("=" * 70)
+    print("  Benchmark regression check")
+    print(f"  alpha {args.alpha}, minimum change {args.min_change}%")
+    print("=" * 70)
+
+    regressions, improvements, compared = compare(collect(args.baseline), collect(args.candidate),
+                                                  args.alpha, args.min_change)
+
+    print(f"\n{compared} series compared: {regressions} regression(s), {improvements} improvement(s)")
+    if compared == 0:
+        print("Nothing to compare (no common series)")
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == '__main__':
+    main()
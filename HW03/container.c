@@ -0,0 +1,603 @@
+#include "container.h"
+#include "mapped_io.h"
+#include "randpool.h"
+#include "tagcmp.h"
+
+#include <openssl/crypto.h>
+#include <openssl/hmac.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static void put_be32(unsigned char *p, uint32_t v) {
+    for (int i = 3; i >= 0; i--) {
+        p[i] = (unsigned char)v;
+        v >>= 8;
+    }
+}
+
+static void put_be64(unsigned char *p, uint64_t v) {
+    for (int i = 7; i >= 0; i--) {
+        p[i] = (unsigned char)v;
+        v >>= 8;
+    }
+}
+
+static uint64_t get_be(const unsigned char *p, int n) {
+    uint64_t v = 0;
+    for (int i = 0; i < n; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t segment_count(uint64_t plaintext_len, size_t segment_size) {
+    return plaintext_len == 0 ? 1 : (plaintext_len + segment_size - 1) / segment_size;
+}
+
+// base[0 .. nonce_len-5) || be32(index) || last
+static void segment_nonce(const unsigned char *base, int nonce_len, uint32_t index, int last,
+                          unsigned char *nonce) {
+    memcpy(nonce, base, nonce_len);
+    put_be32(nonce + nonce_len - 5, index);
+    nonce[nonce_len - 1] = (unsigned char)(last != 0);
+}
+
+// Point ctx (or a fresh one, for rekeyed algorithms) at nonce and feed the
+// associated data: the header, then for version 2 the be64 plaintext
+// offset of the segment (position)
+static EVP_CIPHER_CTX *segment_begin(EVP_CIPHER_CTX *ctx, int algo_type, int rekey, int enc,
+                                     unsigned char *key, unsigned char *nonce,
+                                     const unsigned char *header, size_t header_len,
+                                     const unsigned char *position) {
+    int len;
+
+    if (rekey) {
+        EVP_CIPHER_CTX_free(ctx);
+        ctx = algo_cipher_ctx_new(algo_type, enc, key, nonce);
+    } else {
+        if (1 != EVP_CipherInit_ex(ctx, NULL, NULL, NULL, nonce, enc)) handle_crypto_error();
+    }
+    if (1 != EVP_CipherUpdate(ctx, NULL, &len, header, (int)header_len)) handle_crypto_error();
+    if (position && 1 != EVP_CipherUpdate(ctx, NULL, &len, position, 8)) handle_crypto_error();
+    return ctx;
+}
+
+static int container_algo_ok(int algo_type) {
+    if (!algo_available(algo_type) || !algo_has(algo_type, ALGO_CAP_AEAD) || algo_iv_len(algo_type) < 12) {
+        fprintf(stderr, "%s cannot be used for containers (AEAD modes only)\n",
+                algo_available(algo_type) ? algo_name(algo_type) : "This algorithm");
+        return 0;
+    }
+    return 1;
+}
+
+static int seal_params_ok(int algo_type, size_t segment_size, const char *info) {
+    if (!container_algo_ok(algo_type)) return 0;
+    if (segment_size == 0 || segment_size > CON_MAX_SEGMENT || strlen(info) > CON_MAX_INFO) {
+        fprintf(stderr, "Segment size must be 1 to %d bytes and the info at most %d characters\n",
+                CON_MAX_SEGMENT, CON_MAX_INFO);
+        return 0;
+    }
+    return 1;
+}
+
+// Header of either version with a fresh random nonce (container id), returns its length
+static size_t make_header(unsigned char *header, int version, int algo_type, size_t segment_size,
+                          uint64_t plaintext_len, const char *info) {
+    int nonce_len = algo_iv_len(algo_type);
+    size_t info_len = strlen(info);
+
+    memcpy(header, CON_MAGIC, 4);
+    header[4] = (unsigned char)version;
+    header[5] = (unsigned char)algo_type;
+    header[6] = (unsigned char)nonce_len;
+    header[7] = (unsigned char)info_len;
+    put_be32(header + 8, (uint32_t)segment_size);
+    put_be64(header + 12, plaintext_len);
+    rand_pool_bytes(header + CON_HEADER_FIXED, nonce_len);
+    memcpy(header + CON_HEADER_FIXED + nonce_len, info, info_len);
+    return CON_HEADER_FIXED + nonce_len + info_len;
+}
+
+// A_0 = HMAC(K_mac, header)
+static void chain_start(const unsigned char *mac_key, const unsigned char *header, size_t header_len,
+                        unsigned char *chain) {
+    unsigned int len;
+
+    if (!HMAC(EVP_sha256(), mac_key, HMAC_KEY_SIZE, header, header_len, chain, &len)) handle_crypto_error();
+}
+
+// A_{i+1} = HMAC(K_mac, A_i || E_i), in place
+static void chain_step(const unsigned char *mac_key, unsigned char *chain, const unsigned char *entry,
+                       size_t entry_len) {
+    unsigned char buf[CON_CHAIN_SIZE + 4 + MAX_IV_SIZE + AEAD_TAG_SIZE];
+    unsigned int len;
+
+    memcpy(buf, chain, CON_CHAIN_SIZE);
+    memcpy(buf + CON_CHAIN_SIZE, entry, entry_len);
+    if (!HMAC(EVP_sha256(), mac_key, HMAC_KEY_SIZE, buf, CON_CHAIN_SIZE + entry_len, chain, &len)) {
+        handle_crypto_error();
+    }
+}
+
+static void append_footer(unsigned char *footer, uint64_t index_offset, uint64_t segments,
+                          const unsigned char *chain) {
+    memcpy(footer, CON_APPEND_FOOTER_MAGIC, 4);
+    put_be64(footer + 4, index_offset);
+    put_be64(footer + 12, segments);
+    memcpy(footer + 20, chain, CON_CHAIN_SIZE);
+}
+
+long long con_seal_file(int algo_type, FILE *in, FILE *out, size_t segment_size,
+                        unsigned char *master_key, const char *info) {
+    unsigned char header[CON_HEADER_FIXED + MAX_IV_SIZE + CON_MAX_INFO];
+    unsigned char footer[CON_FOOTER_SIZE];
+    unsigned char key[KEY_SIZE], unused_mac_key[HMAC_KEY_SIZE];
+    unsigned char *plain = NULL, *sealed = NULL, *tags = NULL;
+    int nonce_len = algo_iv_len(algo_type);
+    int rekey = !algo_has(algo_type, ALGO_CAP_POOLABLE);
+    EVP_CIPHER_CTX *ctx = NULL;
+    uint64_t plaintext_len, segments, done = 0;
+    size_t header_len;
+    long long ret = -1;
+    struct stat st;
+
+    if (!info) info = algo_name(algo_type);
+    if (!seal_params_ok(algo_type, segment_size, info)) return -1;
+    // The total length is part of the header, which every tag authenticates
+    if (fstat(fileno(in), &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "Container input must be a regular file\n");
+        return -1;
+    }
+    plaintext_len = st.st_size;
+    segments = segment_count(plaintext_len, segment_size);
+    if (segments > UINT32_MAX) {
+        fprintf(stderr, "Too many segments for a 32-bit counter\n");
+        return -1;
+    }
+
+    header_len = make_header(header, 1, algo_type, segment_size, plaintext_len, info);
+
+    derive_keys(master_key, info, key, algo_get(algo_type)->key_len, unused_mac_key, 0);
+    if (!rekey) ctx = algo_cipher_ctx_new(algo_type, 1, key, header + CON_HEADER_FIXED);
+
+    plain = malloc(segment_size);
+    sealed = malloc(segment_size + EVP_MAX_BLOCK_LENGTH);
+    tags = malloc(segments * AEAD_TAG_SIZE);
+    if (!plain || !sealed || !tags) {
+        perror("Memory allocation failed");
+        goto done;
+    }
+    if (fwrite(header, 1, header_len, out) != header_len) {
+        perror("Error writing container header");
+        goto done;
+    }
+
+    for (uint64_t i = 0; i < segments; i++) {
+        size_t n = (plaintext_len - done < segment_size) ? plaintext_len - done : segment_size;
+        unsigned char nonce[MAX_IV_SIZE];
+        int len = 0, final_len = 0;
+
+        if (fread(plain, 1, n, in) != n) {
+            perror("Error reading input (did it change size?)");
+            goto done;
+        }
+        segment_nonce(header + CON_HEADER_FIXED, nonce_len, (uint32_t)i, i == segments - 1, nonce);
+        ctx = segment_begin(ctx, algo_type, rekey, 1, key, nonce, header, header_len, NULL);
+        if (n > 0 && 1 != EVP_EncryptUpdate(ctx, sealed, &len, plain, (int)n)) handle_crypto_error();
+        if (1 != EVP_EncryptFinal_ex(ctx, sealed + len, &final_len)) handle_crypto_error();
+        if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, tags + i * AEAD_TAG_SIZE)) handle_crypto_error();
+        if (fwrite(sealed, 1, n, out) != n) {
+            perror("Error writing container data");
+            goto done;
+        }
+        done += n;
+    }
+
+    memcpy(footer, CON_FOOTER_MAGIC, 4);
+    put_be64(footer + 4, header_len + plaintext_len);
+    put_be64(footer + 12, segments);
+    if (fwrite(tags, 1, segments * AEAD_TAG_SIZE, out) != segments * AEAD_TAG_SIZE ||
+        fwrite(footer, 1, sizeof(footer), out) != sizeof(footer)) {
+        perror("Error writing container index");
+        goto done;
+    }
+    ret = (long long)plaintext_len;
+
+done:
+    EVP_CIPHER_CTX_free(ctx);
+    OPENSSL_cleanse(key, sizeof(key));
+    if (plain) OPENSSL_cleanse(plain, segment_size);
+    free(plain);
+    free(sealed);
+    free(tags);
+    return ret;
+}
+
+int con_create_appendable(int algo_type, const char *path, size_t segment_size,
+                          unsigned char *master_key, const char *info) {
+    unsigned char header[CON_HEADER_FIXED + MAX_IV_SIZE + CON_MAX_INFO];
+    unsigned char footer[CON_APPEND_FOOTER_SIZE], chain[CON_CHAIN_SIZE];
+    unsigned char key[KEY_SIZE], mac_key[HMAC_KEY_SIZE];
+    size_t header_len;
+    FILE *out;
+    int ok;
+
+    if (!info) info = algo_name(algo_type);
+    if (!seal_params_ok(algo_type, segment_size, info)) return -1;
+    header_len = make_header(header, 2, algo_type, segment_size, 0, info);
+
+    derive_keys(master_key, info, key, algo_get(algo_type)->key_len, mac_key, HMAC_KEY_SIZE);
+    chain_start(mac_key, header, header_len, chain);
+    OPENSSL_cleanse(key, sizeof(key));
+    OPENSSL_cleanse(mac_key, sizeof(mac_key));
+    append_footer(footer, header_len, 0, chain);
+
+    if (!(out = fopen(path, "wb"))) {
+        perror("Cannot create container");
+        return -1;
+    }
+    ok = fwrite(header, 1, header_len, out) == header_len && fwrite(footer, 1, sizeof(footer), out) == sizeof(footer);
+    if (fclose(out) != 0) ok = 0;
+    if (!ok) {
+        perror("Error writing container");
+        remove(path);
+        return -1;
+    }
+    return 0;
+}
+
+long long con_append_file(const char *path, FILE *in, unsigned char *master_key) {
+    unsigned char header[CON_HEADER_FIXED + MAX_IV_SIZE + CON_MAX_INFO];
+    unsigned char footer[CON_APPEND_FOOTER_SIZE], chain[CON_CHAIN_SIZE];
+    unsigned char key[KEY_SIZE], mac_key[HMAC_KEY_SIZE], prefix[MAX_IV_SIZE];
+    unsigned char *plain = NULL, *sealed = NULL, *index = NULL;
+    EVP_CIPHER_CTX *ctx = NULL;
+    FILE *out = NULL;
+    con_reader r;
+    uint64_t old_len, new_len, old_segments, segments, done;
+    size_t header_len, entry_len, segment_size;
+    int algo_type, nonce_len, rekey;
+    long long ret = -1;
+    struct stat st;
+
+    if (con_open(&r, path, master_key) != 0) return -1;
+    if (r.version != 2) {
+        fprintf(stderr, "%s is not an appendable container\n", path);
+        con_close(&r);
+        return -1;
+    }
+    if (fstat(fileno(in), &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "Container input must be a regular file\n");
+        con_close(&r);
+        return -1;
+    }
+
+    // All the append needs from the old file, whose index is about to be overwritten
+    algo_type = r.algo_type;
+    nonce_len = r.nonce_len;
+    rekey = r.rekey;
+    segment_size = r.segment_size;
+    header_len = r.header_len;
+    entry_len = r.entry_len;
+    old_len = r.plaintext_len;
+    old_segments = r.segments;
+    new_len = st.st_size;
+    segments = old_segments + (new_len > old_len ? (new_len - old_len + segment_size - 1) / segment_size : 0);
+    memcpy(header, r.map, header_len);
+    memcpy(chain, r.chain, CON_CHAIN_SIZE);
+    derive_keys(master_key, r.info, key, algo_get(algo_type)->key_len, mac_key, HMAC_KEY_SIZE);
+    if (new_len < old_len) {
+        fprintf(stderr, "%s: the input is shorter than the container (%llu < %llu bytes), not an append\n",
+                path, (unsigned long long)new_len, (unsigned long long)old_len);
+        con_close(&r);
+        goto done;
+    }
+    if (segments > UINT32_MAX) {
+        fprintf(stderr, "Too many segments for a 32-bit counter\n");
+        con_close(&r);
+        goto done;
+    }
+    index = malloc(segments * entry_len > 0 ? segments * entry_len : 1);
+    plain = malloc(segment_size);
+    sealed = malloc(segment_size + EVP_MAX_BLOCK_LENGTH);
+    if (!index || !plain || !sealed) {
+        perror("Memory allocation failed");
+        con_close(&r);
+        goto done;
+    }
+    memcpy(index, r.tags, old_segments * entry_len);
+    con_close(&r);
+    if (new_len == old_len) {
+        ret = 0;
+        goto done;
+    }
+
+    // New segments start where the old index did; the data before it stays as it is
+    if (!(out = fopen(path, "r+b"))) {
+        perror("Cannot open container for writing");
+        goto done;
+    }
+    if (fseeko(out, (off_t)(header_len + old_len), SEEK_SET) != 0 || fseeko(in, (off_t)old_len, SEEK_SET) != 0) {
+        perror("Seek failed");
+        goto done;
+    }
+    if (!rekey) ctx = algo_cipher_ctx_new(algo_type, 1, key, header + CON_HEADER_FIXED);
+    rand_pool_bytes(prefix, nonce_len - 4);  // Nonces of this append: prefix || be32(index)
+
+    done = old_len;
+    for (uint64_t i = old_segments; i < segments; i++) {
+        size_t n = (new_len - done < segment_size) ? new_len - done : segment_size;
+        unsigned char *entry = index + i * entry_len, position[8];
+        int len = 0, final_len = 0;
+
+        if (fread(plain, 1, n, in) != n) {
+            perror("Error reading input (did it change size?)");
+            goto done;
+        }
+        put_be32(entry, (uint32_t)n);
+        memcpy(entry + 4, prefix, nonce_len - 4);
+        put_be32(entry + nonce_len, (uint32_t)i);
+        put_be64(position, done);
+        ctx = segment_begin(ctx, algo_type, rekey, 1, key, entry + 4, header, header_len, position);
+        if (1 != EVP_EncryptUpdate(ctx, sealed, &len, plain, (int)n)) handle_crypto_error();
+        if (1 != EVP_EncryptFinal_ex(ctx, sealed + len, &final_len)) handle_crypto_error();
+        if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, entry + 4 + nonce_len)) handle_crypto_error();
+        if (fwrite(sealed, 1, n, out) != n) {
+            perror("Error writing container data");
+            goto done;
+        }
+        chain_step(mac_key, chain, entry, entry_len);
+        done += n;
+    }
+
+    append_footer(footer, header_len + new_len, segments, chain);
+    if (fwrite(index, 1, segments * entry_len, out) != segments * entry_len ||
+        fwrite(footer, 1, sizeof(footer), out) != sizeof(footer) || fflush(out) != 0) {
+        perror("Error writing container index");
+        goto done;
+    }
+    ret = (long long)(new_len - old_len);
+
+done:
+    if (out && fclose(out) != 0 && ret >= 0) {
+        perror("Error writing container");
+        ret = -1;
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    OPENSSL_cleanse(key, sizeof(key));
+    OPENSSL_cleanse(mac_key, sizeof(mac_key));
+    if (plain) OPENSSL_cleanse(plain, segment_size);
+    free(plain);
+    free(sealed);
+    free(index);
+    return ret;
+}
+
+// Version 2: footer, index entries and segment offsets. The entries must
+// cover the data exactly, each segment 1 to segment_size bytes with the
+// nonce counter of its position.
+static int open_index(con_reader *r, const char *path) {
+    const unsigned char *footer = r->map + r->map_len - CON_APPEND_FOOTER_SIZE;
+    uint64_t index_offset, offset = 0;
+
+    r->entry_len = 4 + r->nonce_len + AEAD_TAG_SIZE;
+    if (r->map_len < r->header_len + CON_APPEND_FOOTER_SIZE || get_be(r->map + 12, 8) != 0 ||
+        memcmp(footer, CON_APPEND_FOOTER_MAGIC, 4) != 0) goto bad;
+    index_offset = get_be(footer + 4, 8);
+    r->segments = get_be(footer + 12, 8);
+    if (index_offset < r->header_len || index_offset > r->map_len || r->segments > UINT32_MAX ||
+        r->map_len - index_offset != r->segments * r->entry_len + CON_APPEND_FOOTER_SIZE) goto bad;
+    r->plaintext_len = index_offset - r->header_len;
+    r->data = r->map + r->header_len;
+    r->tags = r->map + index_offset;
+    memcpy(r->chain, footer + 20, CON_CHAIN_SIZE);
+
+    if (!(r->offsets = malloc((r->segments + 1) * sizeof(uint64_t)))) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+    for (uint64_t i = 0; i < r->segments; i++) {
+        const unsigned char *entry = r->tags + i * r->entry_len;
+        uint64_t len = get_be(entry, 4);
+
+        if (len == 0 || len > r->segment_size || len > r->plaintext_len - offset ||
+            get_be(entry + r->nonce_len, 4) != i) goto bad;
+        r->offsets[i] = offset;
+        offset += len;
+    }
+    if (offset != r->plaintext_len) goto bad;
+    r->offsets[r->segments] = offset;
+    return 0;
+
+bad:
+    fprintf(stderr, "%s: container truncated or index inconsistent\n", path);
+    return -1;
+}
+
+// Recompute A_n over the index and compare it with the footer's
+static int check_chain(const con_reader *r, const unsigned char *mac_key) {
+    unsigned char chain[CON_CHAIN_SIZE];
+
+    chain_start(mac_key, r->map, r->header_len, chain);
+    for (uint64_t i = 0; i < r->segments; i++) chain_step(mac_key, chain, r->tags + i * r->entry_len, r->entry_len);
+    return tag_equal(chain, r->chain, CON_CHAIN_SIZE) ? 0 : -1;
+}
+
+int con_open(con_reader *r, const char *path, unsigned char *master_key) {
+    unsigned char mac_key[HMAC_KEY_SIZE];
+    mapped_file mf;
+    const unsigned char *p, *footer;
+    size_t info_len;
+
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+    if (map_input_file(path, &mf) != 0) return -1;
+    r->map = mf.data;
+    r->map_len = mf.len;
+    r->fd = mf.fd;
+    if (r->map) madvise(r->map, r->map_len, MADV_RANDOM);  // Undo the sequential read-ahead hint
+    p = r->map;
+
+    if (r->map_len < CON_HEADER_FIXED + CON_FOOTER_SIZE || memcmp(p, CON_MAGIC, 4) != 0 || (p[4] != 1 && p[4] != 2)) {
+        fprintf(stderr, "%s is not a container\n", path);
+        goto fail;
+    }
+    r->version = p[4];
+    r->algo_type = p[5];
+    r->nonce_len = p[6];
+    info_len = p[7];
+    r->segment_size = get_be(p + 8, 4);
+    r->plaintext_len = get_be(p + 12, 8);
+    r->header_len = CON_HEADER_FIXED + r->nonce_len + info_len;
+    if (r->algo_type < 1 || r->algo_type > NUM_ALGOS || !container_algo_ok(r->algo_type) ||
+        r->nonce_len != algo_iv_len(r->algo_type) ||
+        r->segment_size == 0 || r->segment_size > CON_MAX_SEGMENT) {
+        fprintf(stderr, "%s: unsupported container parameters\n", path);
+        goto fail;
+    }
+
+    if (r->version == 2) {
+        if (open_index(r, path) != 0) goto fail;
+    } else {
+        r->segments = segment_count(r->plaintext_len, r->segment_size);
+
+        // Every part must be where the header says, with nothing in between
+        footer = p + r->map_len - CON_FOOTER_SIZE;
+        if (r->plaintext_len > r->map_len || r->segments > UINT32_MAX ||
+            r->map_len != r->header_len + r->plaintext_len + r->segments * AEAD_TAG_SIZE + CON_FOOTER_SIZE ||
+            memcmp(footer, CON_FOOTER_MAGIC, 4) != 0 ||
+            get_be(footer + 4, 8) != r->header_len + r->plaintext_len || get_be(footer + 12, 8) != r->segments) {
+            fprintf(stderr, "%s: container truncated or index inconsistent\n", path);
+            goto fail;
+        }
+        r->data = p + r->header_len;
+        r->tags = r->data + r->plaintext_len;
+    }
+    memcpy(r->info, p + CON_HEADER_FIXED + r->nonce_len, info_len);
+    r->info[info_len] = '\0';
+    r->rekey = !algo_has(r->algo_type, ALGO_CAP_POOLABLE);
+    if (!master_key) return 0;  // Structure only
+
+    derive_keys(master_key, r->info, r->key, algo_get(r->algo_type)->key_len, mac_key,
+                r->version == 2 ? HMAC_KEY_SIZE : 0);
+    if (r->version == 2 && check_chain(r, mac_key) != 0) {
+        fprintf(stderr, "%s: index authentication failed (wrong key, or segments dropped or changed)\n", path);
+        OPENSSL_cleanse(mac_key, sizeof(mac_key));
+        goto fail;
+    }
+    OPENSSL_cleanse(mac_key, sizeof(mac_key));
+    if (!r->rekey) r->ctx = algo_cipher_ctx_new(r->algo_type, 0, r->key, (unsigned char *)p + CON_HEADER_FIXED);
+    if (!(r->segment_buf = malloc(r->segment_size + EVP_MAX_BLOCK_LENGTH))) {
+        perror("Memory allocation failed");
+        goto fail;
+    }
+    return 0;
+
+fail:
+    con_close(r);
+    return -1;
+}
+
+void con_close(con_reader *r) {
+    if (r->map) {
+        mapped_file mf = { .data = r->map, .len = r->map_len, .fd = r->fd };
+        unmap_file(&mf, 0);
+    }
+    EVP_CIPHER_CTX_free(r->ctx);
+    free(r->segment_buf);
+    free(r->offsets);
+    OPENSSL_cleanse(r, sizeof(*r));
+    r->fd = -1;
+}
+
+static uint64_t segment_start(const con_reader *r, uint64_t index) {
+    return r->version == 2 ? r->offsets[index] : index * r->segment_size;
+}
+
+static uint64_t segment_end(const con_reader *r, uint64_t index) {
+    if (r->version == 2) return r->offsets[index + 1];
+    return (r->plaintext_len - index * r->segment_size < r->segment_size) ? r->plaintext_len
+                                                                           : (index + 1) * r->segment_size;
+}
+
+// Segment holding plaintext byte offset (< plaintext_len); version 2
+// segments vary in length, so a binary search over their offsets
+static uint64_t segment_at(const con_reader *r, uint64_t offset) {
+    uint64_t lo = 0, hi = r->segments - 1;
+
+    if (r->version == 1) return offset / r->segment_size;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo + 1) / 2;
+        if (r->offsets[mid] <= offset) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+// Decrypt and verify segment index into out (its full length)
+static int open_segment(con_reader *r, uint64_t index, unsigned char *out) {
+    uint64_t start = segment_start(r, index);
+    size_t n = segment_end(r, index) - start;
+    unsigned char nonce[MAX_IV_SIZE], position[8];
+    const unsigned char *tag;
+    int len = 0, final_len = 0;
+
+    if (r->version == 2) {
+        const unsigned char *entry = r->tags + index * r->entry_len;
+        memcpy(nonce, entry + 4, r->nonce_len);
+        tag = entry + 4 + r->nonce_len;
+        put_be64(position, start);
+    } else {
+        segment_nonce(r->map + CON_HEADER_FIXED, r->nonce_len, (uint32_t)index, index == r->segments - 1, nonce);
+        tag = r->tags + index * AEAD_TAG_SIZE;
+    }
+    r->ctx = segment_begin(r->ctx, r->algo_type, r->rekey, 0, r->key, nonce, r->map, r->header_len,
+                           r->version == 2 ? position : NULL);
+    if (1 != EVP_CIPHER_CTX_ctrl(r->ctx, EVP_CTRL_AEAD_SET_TAG, AEAD_TAG_SIZE, (void *)tag)) handle_crypto_error();
+    if (n > 0 && 1 != EVP_DecryptUpdate(r->ctx, out, &len, r->data + start, (int)n)) handle_crypto_error();
+    r->segments_opened++;
+    if (EVP_DecryptFinal_ex(r->ctx, out + len, &final_len) <= 0) {
+        OPENSSL_cleanse(out, n);
+        return -1;
+    }
+    return 0;
+}
+
+long long con_read(con_reader *r, uint64_t offset, size_t len, unsigned char *out) {
+    uint64_t end, first, last;
+    size_t written = 0;
+
+    if (!r->segment_buf) return -1;  // Opened without a key
+    if (offset >= r->plaintext_len) {
+        // Only the empty final segment authenticates an empty version 1
+        // container (version 2 has the index authenticator)
+        if (r->version == 1 && r->plaintext_len == 0 && open_segment(r, 0, r->segment_buf) != 0) return -1;
+        return 0;
+    }
+    end = (len > r->plaintext_len - offset) ? r->plaintext_len : offset + len;
+    first = segment_at(r, offset);
+    last = segment_at(r, end - 1);
+
+    for (uint64_t i = first; i <= last; i++) {
+        uint64_t seg_start = segment_start(r, i);
+        uint64_t seg_end = segment_end(r, i);
+        uint64_t from = (offset > seg_start) ? offset : seg_start;
+        uint64_t to = (end < seg_end) ? end : seg_end;
+
+        if (from == seg_start && to == seg_end) {
+            // Whole segment: straight into the caller's buffer
+            if (open_segment(r, i, out + written) != 0) goto fail;
+        } else {
+            if (open_segment(r, i, r->segment_buf) != 0) goto fail;
+            memcpy(out + written, r->segment_buf + (from - seg_start), to - from);
+        }
+        written += to - from;
+    }
+    return (long long)written;
+
+fail:
+    fprintf(stderr, "Container segment failed authentication\n");
+    OPENSSL_cleanse(out, written);
+    return -1;
+}
@@ -0,0 +1,119 @@
+#ifndef HW03_CONTAINER_H
+#define HW03_CONTAINER_H
+
+#include <openssl/evp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#include "ciphers.h"
+
+#define CON_MAGIC "HW3C"
+#define CON_FOOTER_MAGIC "HW3I"
+#define CON_DEFAULT_SEGMENT (64 * 1024)
+#define CON_MAX_SEGMENT (64 * 1024 * 1024)
+#define CON_HEADER_FIXED 20  // Up to the nonce
+#define CON_FOOTER_SIZE 20
+#define CON_APPEND_FOOTER_MAGIC "HW3J"
+#define CON_APPEND_FOOTER_SIZE 52
+#define CON_CHAIN_SIZE 32  // HMAC-SHA256
+#define CON_MAX_INFO 255
+
+// Encrypted container for random-access reads, AEAD algorithms only:
+//
+//   header  "HW3C" || 0x01 || algo_type || nonce_len || info_len ||
+//           be32(segment_size) || be64(plaintext_len) ||
+//           base nonce (nonce_len bytes) || HKDF info (info_len bytes)
+//   data    C_0 || C_1 || ... || C_{n-1}, segment_size bytes each except the
+//           last (n = ceil(plaintext_len / segment_size), at least 1)
+//   index   T_0 || ... || T_{n-1}, AEAD_TAG_SIZE bytes each
+//   footer  "HW3I" || be64(offset of the index) || be64(n)
+//
+// The key is HKDF(master key, info). Segment i is sealed with nonce
+// base[0 .. nonce_len-5) || be32(i) || (i == n-1) and the whole header as
+// associated data, so a segment is bound to its position, its container
+// and the total length; swapping, dropping or truncating is detected when
+// the affected segment is read. Ciphertext keeps the plaintext offsets
+// (byte k of the plaintext is byte header_len + k of the file), so a
+// reader maps the file and touches only the segments a range covers.
+
+// Encrypt the regular file in into out. info NULL means algo_name(algo_type).
+// Returns the plaintext length, or -1 on error.
+long long con_seal_file(int algo_type, FILE *in, FILE *out, size_t segment_size,
+                        unsigned char *master_key, const char *info);
+
+// Appendable containers (version 2), for files that only grow:
+//
+//   header  "HW3C" || 0x02 || algo_type || nonce_len || info_len ||
+//           be32(segment_size) || be64(0) ||
+//           container id (nonce_len random bytes) || HKDF info
+//   data    C_0 || ... || C_{n-1}, back to back, up to segment_size bytes
+//           each (n may be 0)
+//   index   E_0 || ... || E_{n-1}, E_i = be32(length) || nonce || tag
+//   footer  "HW3J" || be64(offset of the index) || be64(n) || A_n
+//
+// The header never changes. Every append seals the new bytes into new
+// segments, starting a fresh one, so short segments can sit anywhere; it
+// writes them over the old index and footer and then the extended index,
+// leaving the existing ciphertext as it was. Ciphertext still keeps the
+// plaintext offsets. Segment i is sealed with the nonce of E_i (random per
+// append || be32(i)) and header || be64(plaintext offset of segment i) as
+// associated data. A_n is a running authenticator of the index:
+//
+//   A_0 = HMAC(K_mac, header), A_{i+1} = HMAC(K_mac, A_i || E_i)
+//
+// with K_mac the HMAC key after the cipher key in HKDF(master key, info).
+// An append only extends it, and con_open checks it, so dropping,
+// reordering or resizing segments is caught before any read. Rolling the
+// whole file back to an earlier state is not: compare A_n (con_reader.chain)
+// with a copy kept elsewhere for that. An append is not atomic; if it is
+// interrupted, seal again from the source file.
+
+// New appendable container at path with no data. 0 on success, -1 on error.
+int con_create_appendable(int algo_type, const char *path, size_t segment_size,
+                          unsigned char *master_key, const char *info);
+
+// Seal the bytes of the regular file in past the container's plaintext
+// length (in is the grown source; what the container already holds is not
+// read again). Returns the bytes appended (0 if in did not grow), or -1 on
+// error, a source shorter than the container, or a container that is not
+// appendable or fails its checks.
+long long con_append_file(const char *path, FILE *in, unsigned char *master_key);
+
+typedef struct {
+    unsigned char *map;
+    size_t map_len;
+    int fd;
+    int version;              // 1 sealed, 2 appendable
+    int algo_type;
+    int nonce_len;
+    int rekey;                // XChaCha20: a context per segment
+    size_t header_len;
+    size_t segment_size;
+    uint64_t plaintext_len;
+    uint64_t segments;
+    const unsigned char *data;
+    const unsigned char *tags;   // Version 2: the index entries
+    size_t entry_len;            // Version 2: bytes per index entry
+    uint64_t *offsets;           // Version 2: plaintext offset of every segment, then plaintext_len
+    unsigned char chain[CON_CHAIN_SIZE];  // Version 2: A_n
+    char info[CON_MAX_INFO + 1];
+    unsigned char key[KEY_SIZE];
+    EVP_CIPHER_CTX *ctx;
+    unsigned char *segment_buf;  // One segment, for partially covered ones
+    uint64_t segments_opened;    // Counter for callers measuring locality
+} con_reader;
+
+// Map path and check its structure, and for version 2 the index
+// authenticator (not the tags, which are checked per segment on read).
+// 0 on success, -1 on a malformed file or I/O error. A NULL master_key
+// checks the structure only, for printing the header; con_read then fails.
+int con_open(con_reader *r, const char *path, unsigned char *master_key);
+void con_close(con_reader *r);
+
+// Decrypt plaintext bytes [offset, offset + len) into out, verifying each
+// segment the range covers and no other. Returns the bytes written (short
+// at the end of the plaintext) or -1, with out wiped, if a tag fails.
+long long con_read(con_reader *r, uint64_t offset, size_t len, unsigned char *out);
+
+#endif
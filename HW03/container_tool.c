@@ -0,0 +1,209 @@
+// Command-line front end for the encrypted container format (container.h)
+#include "bench.h"
+#include "ciphers.h"
+#include "container.h"
+
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define TOOL_READ_CHUNK (1024 * 1024)  // Plaintext staged per con_read when streaming out
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s COMMAND [options] ARGS\n", prog);
+    printf("  keygen KEYFILE          Write a random 256-bit master key\n");
+    printf("  seal KEYFILE IN OUT     Encrypt IN into the container OUT\n");
+    printf("    -a, --algo N          AEAD registry entry (default 5, AES-256-GCM)\n");
+    printf("    -s, --segment SIZE    Segment size, K/M suffixes allowed (default 64K)\n");
+    printf("    -i, --info TEXT       HKDF info string (default: the algorithm name)\n");
+    printf("  append KEYFILE IN OUT   Seal what IN gained since the last append into the\n");
+    printf("                          appendable container OUT (created on first use,\n");
+    printf("                          with the seal options); old segments stay as they are\n");
+    printf("  open KEYFILE IN OUT     Decrypt the whole container IN into OUT\n");
+    printf("  read KEYFILE IN OFFSET LENGTH\n");
+    printf("                          Decrypt a plaintext byte range to stdout, touching\n");
+    printf("                          only the segments it covers\n");
+    printf("  info IN                 Print the container header\n");
+}
+
+static int load_key(const char *path, unsigned char *key) {
+    FILE *fp = fopen(path, "rb");
+    int ok = fp && fread(key, 1, KEY_SIZE, fp) == KEY_SIZE;
+
+    if (!ok) fprintf(stderr, "Cannot read a %d-byte key from %s\n", KEY_SIZE, path);
+    if (fp) fclose(fp);
+    return ok ? 0 : -1;
+}
+
+// Stream [offset, offset + length) of the plaintext to out
+static int copy_range(con_reader *r, uint64_t offset, uint64_t length, FILE *out) {
+    unsigned char *buf = malloc(TOOL_READ_CHUNK);
+    int ret = 0;
+
+    if (!buf) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+    while (length > 0) {
+        size_t want = length < TOOL_READ_CHUNK ? (size_t)length : TOOL_READ_CHUNK;
+        long long got = con_read(r, offset, want, buf);
+
+        if (got < 0) {
+            ret = -1;
+            break;
+        }
+        if (got == 0) break;
+        if (fwrite(buf, 1, got, out) != (size_t)got) {
+            perror("Error writing output");
+            ret = -1;
+            break;
+        }
+        offset += got;
+        length -= got;
+    }
+    OPENSSL_cleanse(buf, TOOL_READ_CHUNK);
+    free(buf);
+    return ret;
+}
+
+// seal and append share their options; append keeps the container's own
+// once it exists
+static int cmd_seal(int argc, char **argv, int append) {
+    static struct option long_options[] = {
+        {"algo",    required_argument, NULL, 'a'},
+        {"segment", required_argument, NULL, 's'},
+        {"info",    required_argument, NULL, 'i'},
+        {NULL, 0, NULL, 0}
+    };
+    unsigned char key[KEY_SIZE];
+    size_t segment_size = CON_DEFAULT_SEGMENT;
+    const char *info = NULL;
+    int algo_type = 5;
+    int opt;
+    FILE *in, *out;
+    long long n;
+
+    while ((opt = getopt_long(argc, argv, "a:s:i:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'a': algo_type = atoi(optarg); break;
+            case 's': segment_size = parse_size(optarg); break;
+            case 'i': info = optarg; break;
+            default: return 1;
+        }
+    }
+    if (argc - optind != 3) {
+        fprintf(stderr, "%s needs KEYFILE IN OUT\n", append ? "append" : "seal");
+        return 1;
+    }
+    if (algo_type < 1 || algo_type > NUM_ALGOS) {
+        fprintf(stderr, "Invalid algorithm: %d\n", algo_type);
+        return 1;
+    }
+    if (load_key(argv[optind], key) != 0) return 1;
+    if (!(in = fopen(argv[optind + 1], "rb"))) {
+        perror("Cannot open input");
+        return 1;
+    }
+    if (append) {
+        struct stat st;
+        int created = stat(argv[optind + 2], &st) != 0;
+
+        if (created && con_create_appendable(algo_type, argv[optind + 2], segment_size, key, info) != 0) n = -1;
+        else n = con_append_file(argv[optind + 2], in, key);
+        fclose(in);
+        OPENSSL_cleanse(key, sizeof(key));
+        if (n < 0) {
+            if (created) remove(argv[optind + 2]);
+            return 1;
+        }
+        fprintf(stderr, "%s %lld bytes\n", created ? "Sealed" : "Appended", n);
+        return 0;
+    }
+    if (!(out = fopen(argv[optind + 2], "wb"))) {
+        perror("Cannot create output");
+        fclose(in);
+        return 1;
+    }
+    n = con_seal_file(algo_type, in, out, segment_size, key, info);
+    fclose(in);
+    if (fclose(out) != 0) n = -1;
+    OPENSSL_cleanse(key, sizeof(key));
+    if (n < 0) {
+        remove(argv[optind + 2]);
+        return 1;
+    }
+    fprintf(stderr, "Sealed %lld bytes with %s\n", n, algo_name(algo_type));
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned char key[KEY_SIZE];
+    con_reader r;
+    const char *cmd;
+    int ret = 0;
+
+    if (argc < 2 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
+        print_usage(argv[0]);
+        return argc < 2;
+    }
+    cmd = argv[1];
+
+    if (strcmp(cmd, "keygen") == 0 && argc == 3) {
+        FILE *fp = fopen(argv[2], "wb");
+        if (RAND_bytes(key, KEY_SIZE) != 1) handle_crypto_error();
+        if (!fp || fwrite(key, 1, KEY_SIZE, fp) != KEY_SIZE || fclose(fp) != 0) {
+            perror("Cannot write key file");
+            return 1;
+        }
+        OPENSSL_cleanse(key, sizeof(key));
+        return 0;
+    }
+    if (strcmp(cmd, "seal") == 0) return cmd_seal(argc - 1, argv + 1, 0);
+    if (strcmp(cmd, "append") == 0) return cmd_seal(argc - 1, argv + 1, 1);
+
+    if (strcmp(cmd, "info") == 0 && argc == 3) {
+        // Structure only: no key, no segment is opened
+        if (con_open(&r, argv[2], NULL) != 0) return 1;
+        printf("Format:       %s\n", r.version == 2 ? "appendable (version 2)" : "sealed (version 1)");
+        printf("Algorithm:    %s\n", algo_name(r.algo_type));
+        printf("HKDF info:    %s\n", r.info);
+        printf("Segment size: %zu bytes\n", r.segment_size);
+        printf("Plaintext:    %llu bytes in %llu segments\n",
+               (unsigned long long)r.plaintext_len, (unsigned long long)r.segments);
+        if (r.version == 2) {
+            printf("Index MAC:    ");
+            for (int i = 0; i < CON_CHAIN_SIZE; i++) printf("%02x", r.chain[i]);
+            printf(" (unverified)\n");
+        }
+        con_close(&r);
+        return 0;
+    }
+
+    if (strcmp(cmd, "open") == 0 && argc == 5) {
+        FILE *out;
+        if (load_key(argv[2], key) != 0 || con_open(&r, argv[3], key) != 0) return 1;
+        if (!(out = fopen(argv[4], "wb"))) {
+            perror("Cannot create output");
+            con_close(&r);
+            return 1;
+        }
+        ret = copy_range(&r, 0, r.plaintext_len, out) != 0;
+        if (fclose(out) != 0) ret = 1;
+        if (ret) remove(argv[4]);  // Do not leave a partial plaintext behind
+    } else if (strcmp(cmd, "read") == 0 && argc == 6) {
+        if (load_key(argv[2], key) != 0 || con_open(&r, argv[3], key) != 0) return 1;
+        ret = copy_range(&r, strtoull(argv[4], NULL, 0), strtoull(argv[5], NULL, 0), stdout) != 0;
+        fprintf(stderr, "%llu of %llu segments decrypted\n", (unsigned long long)r.segments_opened,
+                (unsigned long long)r.segments);
+    } else {
+        print_usage(argv[0]);
+        return 1;
+    }
+    OPENSSL_cleanse(key, sizeof(key));
+    con_close(&r);
+    return ret;
+}
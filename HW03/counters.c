@@ -0,0 +1,83 @@
+#include "counters.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+
+static const struct {
+    unsigned int type;
+    unsigned long long config;
+} counter_events[NUM_COUNTERS] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },  // Last level cache
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+};
+#endif
+
+static const char *counter_names[NUM_COUNTERS] = {
+    "cycles", "instructions", "LLC-misses", "branch-misses", "task-clock", "dTLB-load-misses",
+    "page-faults"
+};
+
+int counters_open(counter_set *cs) {
+    int available = 0;
+
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        cs->fd[i] = -1;
+#ifdef __linux__
+        struct perf_event_attr attr;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = counter_events[i].type;
+        attr.config = counter_events[i].config;
+        attr.exclude_kernel = 1;  // Allowed at perf_event_paranoid 2
+        attr.exclude_hv = 1;
+        cs->fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (cs->fd[i] < 0) cs->fd[i] = -1;
+#endif
+        if (cs->fd[i] >= 0) available++;
+    }
+    return available;
+}
+
+void counters_close(counter_set *cs) {
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        if (cs->fd[i] >= 0) close(cs->fd[i]);
+        cs->fd[i] = -1;
+    }
+}
+
+void counters_read(const counter_set *cs, counter_values *values) {
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        values->value[i] = 0;
+        if (cs->fd[i] >= 0 &&
+            read(cs->fd[i], &values->value[i], sizeof(values->value[i])) != sizeof(values->value[i])) {
+            values->value[i] = 0;
+        }
+    }
+}
+
+void counters_accumulate(counter_values *acc, const counter_values *start,
+                         const counter_values *end) {
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        acc->value[i] += end->value[i] - start->value[i];
+    }
+}
+
+int counter_available(const counter_set *cs, int which) {
+    return cs->fd[which] >= 0;
+}
+
+const char *counter_name(int which) {
+    return counter_names[which];
+}
@@ -0,0 +1,42 @@
+#ifndef HW03_COUNTERS_H
+#define HW03_COUNTERS_H
+
+// Hardware performance counters of the calling thread through
+// perf_event_open. Each event is opened on its own, so a kernel or VM that
+// exposes only some of them still reports the rest; task-clock is a software
+// event and works even where no PMU is virtualized.
+
+enum {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_LLC_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_TASK_CLOCK,  // Nanoseconds on the CPU
+    COUNTER_DTLB_MISSES,  // Data TLB load misses
+    COUNTER_PAGE_FAULTS,  // Software event, first touches of fresh pages
+    NUM_COUNTERS
+};
+
+typedef struct {
+    int fd[NUM_COUNTERS];  // -1 where the event is not available
+} counter_set;
+
+typedef struct {
+    unsigned long long value[NUM_COUNTERS];
+} counter_values;
+
+// Open every event, returns how many are available (0 off Linux)
+int counters_open(counter_set *cs);
+void counters_close(counter_set *cs);
+
+// Current totals; differences of two reads give the counts in between
+void counters_read(const counter_set *cs, counter_values *values);
+
+// Add end - start into acc
+void counters_accumulate(counter_values *acc, const counter_values *start,
+                         const counter_values *end);
+
+int counter_available(const counter_set *cs, int which);
+const char *counter_name(int which);
+
+#endif
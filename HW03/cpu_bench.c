@@ -0,0 +1,171 @@
+#include "cpu_bench.h"
+#include "bench.h"
+#include "ciphers.h"
+#include "cpuinfo.h"
+#include "kernels.h"
+
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CAL_MIN_MESSAGES 16
+#define CAL_MAX_MESSAGES 20000
+#define CAL_REPEATS 3  // Best of, against scheduling noise
+
+enum { BACKEND_REGISTRY, BACKEND_KERNEL, NUM_BACKENDS };
+static const char *backend_names[NUM_BACKENDS] = {"registry", "kernel"};
+
+// Best-of-repeats ns for one encrypt + decrypt of a msg_size message through
+// k (or the registry's one-shot functions if k is NULL); -1 on a mismatch
+static double calibrate_size(int algo_type, kernel *k, unsigned char *plaintext, int plaintext_len,
+                             size_t msg_size, unsigned char *enc_key, unsigned char *mac_key) {
+    unsigned char *ciphertext = malloc(msg_size + EVP_MAX_BLOCK_LENGTH);
+    unsigned char *decrypted = malloc(msg_size + EVP_MAX_BLOCK_LENGTH);
+    unsigned char iv[MAX_IV_SIZE];
+    unsigned char tag[HMAC_TAG_SIZE];
+    size_t count = CPU_CALIBRATION_BYTES / (msg_size ? msg_size : 1);
+    int messages = count < CAL_MIN_MESSAGES ? CAL_MIN_MESSAGES
+                   : count > CAL_MAX_MESSAGES ? CAL_MAX_MESSAGES : (int)count;
+    double best = -1;
+
+    if (!ciphertext || !decrypted) {
+        perror("Memory allocation failed");
+        free(ciphertext);
+        free(decrypted);
+        return -1;
+    }
+    if (RAND_bytes(iv, MAX_IV_SIZE) != 1) handle_crypto_error();
+
+    for (int rep = 0; rep < CAL_REPEATS; rep++) {
+        struct timespec start, end;
+        int ok = 1;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < messages && ok; i++) {
+            unsigned char *msg = plaintext + ((size_t)i * msg_size) % (plaintext_len - msg_size + 1);
+            int len;
+
+            iv[algo_iv_len(algo_type) - 1] = (unsigned char)i;
+            if (k) {
+                len = kernel_encrypt(k, msg, msg_size, iv, ciphertext, tag);
+                len = kernel_decrypt(k, ciphertext, len, iv, tag, decrypted);
+            } else {
+                len = algo_encrypt(algo_type, msg, msg_size, enc_key, mac_key, iv, ciphertext, tag);
+                len = algo_decrypt(algo_type, ciphertext, len, enc_key, mac_key, iv, tag, decrypted);
+            }
+            ok = (len == (int)msg_size && memcmp(decrypted, msg, msg_size) == 0);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (!ok) {
+            best = -1;
+            break;
+        }
+        double ns = (double)elapsed_ns(&start, &end) / messages;
+        if (best < 0 || ns < best) best = ns;
+    }
+    free(ciphertext);
+    free(decrypted);
+    return best;
+}
+
+int run_cpu_report(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                   size_t *profile, int profile_len, unsigned char *master_key) {
+    char results_filename[256];
+    char hardware[256], features[256], providers[128], profile_str[256];
+    double cost[NUM_ALGOS + 1][NUM_BACKENDS];
+    size_t profile_bytes = 0, used = 0;
+    int best_algo = 0, best_backend = 0;
+    FILE *results_file;
+    cpu_info info;
+
+    cpu_probe(&info);
+    cpu_feature_names(info.hardware, hardware, sizeof(hardware));
+    cpu_feature_names(info.features, features, sizeof(features));
+    cpu_provider_names(providers, sizeof(providers));
+    profile_str[0] = '\0';
+    for (int s = 0; s < profile_len; s++) {
+        if (profile[s] > (size_t)plaintext_len) {
+            fprintf(stderr, "Profile size %zu is larger than %s\n", profile[s], test_file);
+            return 1;
+        }
+        profile_bytes += profile[s];
+        used += snprintf(profile_str + used, sizeof(profile_str) - used, "%s%zu", s ? ";" : "", profile[s]);
+        if (used >= sizeof(profile_str)) used = sizeof(profile_str) - 1;
+    }
+
+    results_file = open_results_file(info.caps_mask ? "cpu_masked_" : "cpu_", test_file,
+                                     "Algorithm,Backend,Implementation,Provider,Profile_Bytes,Profile_ns,"
+                                     "Round_Trip_MB_per_s,Selected,CPU,Features,Caps_Mask,OpenSSL",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) return 1;
+
+    printf("\n=================================================================\n");
+    printf("  CPU capabilities and backend selection\n");
+    printf("=================================================================\n");
+    printf("  CPU:        %s\n", info.brand);
+    printf("  Hardware:   %s\n", hardware);
+    printf("  libcrypto:  %s%s%s\n", features, info.caps_mask ? ", " CPU_CAPS_ENV "=" : "",
+           info.caps_mask ? info.caps_mask : "");
+    printf("  OpenSSL:    %s, providers %s\n", info.openssl, providers);
+    printf("  Profile:    one message each of %s bytes\n\n", profile_str);
+    printf("    %-28s %-9s %12s %12s  %s\n", "Algorithm", "Backend", "Profile ns", "MB/s", "Implementation");
+
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        unsigned char enc_key[KEY_SIZE];
+        unsigned char mac_key[HMAC_KEY_SIZE];
+        char impl[128];
+
+        cost[algo_type][BACKEND_REGISTRY] = cost[algo_type][BACKEND_KERNEL] = -1;
+        if (!algo_available(algo_type)) continue;
+        derive_algo_keys(master_key, algo_name(algo_type), algo_type, enc_key, mac_key);
+        cpu_backend(algo_type, info.features, impl, sizeof(impl));
+
+        for (int backend = 0; backend < NUM_BACKENDS; backend++) {
+            kernel *k = NULL;
+            double total = 0;
+
+            if (backend == BACKEND_KERNEL && !(k = kernel_new(algo_type, enc_key, mac_key))) continue;
+            for (int s = 0; s < profile_len && total >= 0; s++) {
+                double ns = calibrate_size(algo_type, k, plaintext, plaintext_len, profile[s], enc_key, mac_key);
+                total = ns < 0 ? -1 : total + ns;
+            }
+            kernel_free(k);
+            if (total < 0) {
+                printf("    %-28s %-9s Verification FAILED!\n", algo_name(algo_type), backend_names[backend]);
+                continue;
+            }
+            cost[algo_type][backend] = total;
+            if (!best_algo || total < cost[best_algo][best_backend]) {
+                best_algo = algo_type;
+                best_backend = backend;
+            }
+            printf("    %-28s %-9s %12.0f %12.1f  %s\n", algo_name(algo_type), backend_names[backend], total,
+                   profile_bytes * 1000.0 / total, impl);
+        }
+    }
+
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        char impl[128];
+
+        cpu_backend(algo_type, info.features, impl, sizeof(impl));
+        for (int backend = 0; backend < NUM_BACKENDS; backend++) {
+            if (cost[algo_type][backend] < 0) continue;
+            fprintf(results_file, "%s,%s,%s,%s,%s,%.0f,%.1f,%d,%s,%s,%s,%s\n", algo_name(algo_type),
+                    backend_names[backend], impl, cpu_cipher_provider(algo_type), profile_str,
+                    cost[algo_type][backend], profile_bytes * 1000.0 / cost[algo_type][backend],
+                    algo_type == best_algo && backend == best_backend, info.brand, features,
+                    info.caps_mask ? info.caps_mask : "", info.openssl);
+        }
+    }
+
+    if (best_algo) {
+        printf("\n  Selected: %s on the %s backend (%.0f ns per profile)\n", algo_name(best_algo),
+               backend_names[best_backend], cost[best_algo][best_backend]);
+    }
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    return 0;
+}
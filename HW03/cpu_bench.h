@@ -0,0 +1,21 @@
+#ifndef HW03_CPU_BENCH_H
+#define HW03_CPU_BENCH_H
+
+#include <stddef.h>
+
+#define CPU_CALIBRATION_BYTES (4 * 1024 * 1024)  // Data per (algorithm, backend, size) point
+
+// Capability report and backend selection: prints the cpu_probe result,
+// the providers and, per algorithm, the provider and inferred
+// implementation, then calibrates every algorithm on the registry's
+// one-shot dispatch and on the specialized kernels (kernels.h) for the
+// message-size profile. A profile costs one encrypt + decrypt of a message
+// of each size; the lowest cost is the selection. Writes one row per
+// (algorithm, backend), with the probe in every row and Selected = 1 on the
+// winner, to results_cpu_<file>.csv (results_cpu_masked_<file>.csv under
+// an OPENSSL_ia32cap mask, so --cpu-caps runs do not overwrite the native
+// one and the SIMD paths can be compared with their fallbacks).
+int run_cpu_report(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                   size_t *profile, int profile_len, unsigned char *master_key);
+
+#endif
@@ -0,0 +1,258 @@
+#include "cpuinfo.h"
+#include "ciphers.h"
+
+#include <openssl/crypto.h>
+#include <openssl/provider.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define CPU_X86 1
+#endif
+
+// Bit positions in OpenSSL's two capability words, and the feature they stand for
+typedef struct {
+    int word;  // 0: leaf 1 ECX:EDX, 1: leaf 7 ECX:EBX
+    int bit;
+    unsigned int feature;
+    const char *name;
+} cap_bit;
+
+static const cap_bit cap_bits[] = {
+    {0, 32 + 25, CPU_AESNI, "aesni"},
+    {0, 32 + 1, CPU_PCLMULQDQ, "pclmulqdq"},
+    {0, 32 + 9, CPU_SSSE3, "ssse3"},
+    {0, 32 + 28, CPU_AVX, "avx"},
+    {0, 32 + 22, CPU_MOVBE, "movbe"},
+    {1, 5, CPU_AVX2, "avx2"},
+    {1, 16, CPU_AVX512F, "avx512f"},
+    {1, 31, CPU_AVX512VL, "avx512vl"},
+    {1, 30, CPU_AVX512BW, "avx512bw"},
+    {1, 32 + 9, CPU_VAES, "vaes"},
+    {1, 32 + 10, CPU_VPCLMULQDQ, "vpclmulqdq"},
+    {1, 29, CPU_SHA, "sha"},
+};
+#define NUM_CAP_BITS (int)(sizeof(cap_bits) / sizeof(cap_bits[0]))
+
+static unsigned int features_of(const uint64_t caps[2]) {
+    unsigned int features = 0;
+
+    for (int i = 0; i < NUM_CAP_BITS; i++) {
+        if (caps[cap_bits[i].word] >> cap_bits[i].bit & 1) features |= cap_bits[i].feature;
+    }
+    return features;
+}
+
+// One word of an OPENSSL_ia32cap value: "~X" clears the bits of X, "X" replaces
+static const char *apply_mask_word(const char *p, uint64_t *word) {
+    int clear = (*p == '~');
+    char *end;
+    uint64_t value;
+
+    if (clear) p++;
+    value = strtoull(p, &end, 0);
+    if (end == p) return end;
+    *word = clear ? *word & ~value : value;
+    return end;
+}
+
+#ifdef CPU_X86
+static void read_cpuid(uint64_t caps[2], char *brand) {
+    unsigned int eax, ebx, ecx, edx, max_leaf = __get_cpuid_max(0, NULL);
+
+    caps[0] = caps[1] = 0;
+    if (max_leaf >= 1 && __get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        caps[0] = (uint64_t)ecx << 32 | edx;
+    }
+    if (max_leaf >= 7 && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        caps[1] = (uint64_t)ecx << 32 | ebx;
+    }
+
+    // AVX and up only if the OS saves the wider registers (OSXSAVE + XCR0)
+    if (caps[0] >> (32 + 27) & 1) {
+        unsigned int xcr0_lo, xcr0_hi;
+        __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+        if ((xcr0_lo & 0x6) != 0x6) {
+            caps[0] &= ~(1ULL << (32 + 28));
+            caps[1] &= ~((1ULL << 5) | 0xFFFF0000ULL | (3ULL << (32 + 9)));
+        } else if ((xcr0_lo & 0xE0) != 0xE0) {
+            caps[1] &= ~0xFFFF0000ULL;  // No ZMM state: no AVX-512
+        }
+    } else {
+        caps[0] &= ~(1ULL << (32 + 28));
+        caps[1] &= ~((1ULL << 5) | 0xFFFF0000ULL | (3ULL << (32 + 9)));
+    }
+
+    strcpy(brand, "unknown");
+    if (__get_cpuid_max(0x80000000, NULL) >= 0x80000004) {
+        unsigned int *words = (unsigned int *)brand;
+        for (unsigned int leaf = 0; leaf < 3; leaf++) {
+            __get_cpuid(0x80000002 + leaf, &words[leaf * 4], &words[leaf * 4 + 1],
+                        &words[leaf * 4 + 2], &words[leaf * 4 + 3]);
+        }
+        brand[48] = '\0';
+        while (*brand == ' ') memmove(brand, brand + 1, strlen(brand));
+    }
+}
+#endif
+
+void cpu_probe(cpu_info *info) {
+    uint64_t caps[2] = {0, 0};
+
+    memset(info, 0, sizeof(*info));
+    strcpy(info->brand, "unknown");
+#ifdef CPU_X86
+    read_cpuid(caps, info->brand);
+#endif
+    info->hardware = features_of(caps);
+    info->caps_mask = getenv(CPU_CAPS_ENV);
+    if (info->caps_mask) {
+        const char *p = apply_mask_word(info->caps_mask, &caps[0]);
+        if (*p == ':') apply_mask_word(p + 1, &caps[1]);
+    }
+    info->features = features_of(caps) & info->hardware;
+    info->openssl = OpenSSL_version(OPENSSL_VERSION);
+}
+
+void cpu_feature_names(unsigned int features, char *buf, size_t len) {
+    size_t used = 0;
+
+    buf[0] = '\0';
+    for (int i = 0; i < NUM_CAP_BITS && used < len; i++) {
+        if (!(features & cap_bits[i].feature)) continue;
+        used += snprintf(buf + used, len - used, "%s%s", used ? " " : "", cap_bits[i].name);
+    }
+    if (!buf[0]) snprintf(buf, len, "none");
+}
+
+// AVX-512 F/DQ/BW/VL, VAES and VPCLMULQDQ in the second word; AVX2 on top
+#define MASK_NO_AVX512 "~0x600C0030000"
+#define MASK_NO_AVX2   "~0x600C0030020"
+#define MASK_NO_SIMD   "~0x600E0030020"  // And SHA-NI
+
+const char *cpu_caps_preset(const char *spec) {
+    if (!spec || !*spec) return NULL;
+    if (strcmp(spec, "native") == 0) return "";
+    if (strcmp(spec, "no-avx512") == 0) return ":" MASK_NO_AVX512;
+    if (strcmp(spec, "no-avx2") == 0) return ":" MASK_NO_AVX2;
+    if (strcmp(spec, "no-aesni") == 0) return "~0x200000200000000";
+    if (strcmp(spec, "scalar") == 0) return "~0x1200020200000000:" MASK_NO_SIMD;
+    return spec;
+}
+
+int cpu_force_caps(const char *spec, char *argv[]) {
+    const char *mask = cpu_caps_preset(spec);
+    const char *current = getenv(CPU_CAPS_ENV);
+
+    if (!mask) return 0;
+    // An empty first word leaves it alone; OpenSSL wants the full form
+    if (mask[0] == ':') {
+        static char full[64];
+        snprintf(full, sizeof(full), "~0%s", mask);
+        mask = full;
+    }
+    if (*mask == '\0') {
+        if (!current) return 0;
+        unsetenv(CPU_CAPS_ENV);
+    } else {
+        if (current && strcmp(current, mask) == 0) return 0;
+        if (setenv(CPU_CAPS_ENV, mask, 1) != 0) {
+            perror("setenv");
+            return -1;
+        }
+    }
+    fflush(stdout);
+    execv("/proc/self/exe", argv);
+    perror("Cannot re-run with the capability mask");
+    return -1;
+}
+
+static const char *aes_impl(unsigned int f) {
+    if (f & CPU_AESNI) return "AES-NI";
+    if (f & CPU_SSSE3) return "vpaes (SSSE3)";
+    return "table (scalar)";
+}
+
+static const char *chacha_impl(unsigned int f) {
+    if (f & CPU_AVX512VL) return "ChaCha20 AVX-512VL";
+    if (f & CPU_AVX512F) return "ChaCha20 AVX-512F";
+    if (f & CPU_AVX2) return "ChaCha20 AVX2";
+    if (f & CPU_SSSE3) return "ChaCha20 SSSE3";
+    return "ChaCha20 scalar";
+}
+
+static const char *sha256_impl(unsigned int f) {
+    if (f & CPU_SHA) return "SHA-NI";
+    if (f & CPU_AVX2) return "SHA-256 AVX2";
+    if (f & CPU_AVX) return "SHA-256 AVX";
+    if (f & CPU_SSSE3) return "SHA-256 SSSE3";
+    return "SHA-256 scalar";
+}
+
+static const char *poly1305_impl(unsigned int f) {
+    if (f & CPU_AVX512F) return "Poly1305 AVX-512";
+    if (f & CPU_AVX2) return "Poly1305 AVX2";
+    if (f & CPU_AVX) return "Poly1305 AVX";
+    return "Poly1305 scalar";
+}
+
+static const char *ghash_impl(unsigned int f) {
+    if ((f & (CPU_AESNI | CPU_PCLMULQDQ | CPU_AVX | CPU_MOVBE)) ==
+        (CPU_AESNI | CPU_PCLMULQDQ | CPU_AVX | CPU_MOVBE)) {
+        return "PCLMULQDQ GHASH (AVX stitched)";
+    }
+    if (f & CPU_PCLMULQDQ) return "PCLMULQDQ GHASH";
+    return "4-bit table GHASH";
+}
+
+void cpu_backend(int algo_type, unsigned int features, char *buf, size_t len) {
+    const algo_desc *algo = algo_get(algo_type);
+    const char *cipher = algo ? algo->cipher_name : "";
+
+    if (!algo) {
+        snprintf(buf, len, "unknown");
+    } else if (algo->caps & ALGO_CAP_ETM) {
+        snprintf(buf, len, "%s + %s", strncmp(cipher, "AES", 3) == 0 ? aes_impl(features)
+                                                                    : chacha_impl(features),
+                 sha256_impl(features));
+    } else if (strstr(cipher, "GCM")) {
+        snprintf(buf, len, "%s + %s", aes_impl(features), ghash_impl(features));
+    } else if (strstr(cipher, "OCB")) {
+        snprintf(buf, len, "%s", aes_impl(features));
+    } else {
+        snprintf(buf, len, "%s + %s", chacha_impl(features), poly1305_impl(features));
+    }
+}
+
+const char *cpu_cipher_provider(int algo_type) {
+    const EVP_CIPHER *cipher = algo_cipher(algo_type);
+    const OSSL_PROVIDER *prov = cipher ? EVP_CIPHER_get0_provider(cipher) : NULL;
+    return prov ? OSSL_PROVIDER_get0_name(prov) : "none";
+}
+
+typedef struct {
+    char *buf;
+    size_t len, used;
+} name_list;
+
+static int add_provider_name(OSSL_PROVIDER *prov, void *arg) {
+    name_list *list = arg;
+
+    if (list->used < list->len) {
+        list->used += snprintf(list->buf + list->used, list->len - list->used, "%s%s",
+                               list->used ? "," : "", OSSL_PROVIDER_get0_name(prov));
+    }
+    return 1;
+}
+
+void cpu_provider_names(char *buf, size_t len) {
+    name_list list = {buf, len, 0};
+
+    buf[0] = '\0';
+    algo_available(1);  // Loads the default provider through the first fetch
+    OSSL_PROVIDER_do_all(NULL, add_provider_name, &list);
+}
@@ -0,0 +1,65 @@
+#ifndef HW03_CPUINFO_H
+#define HW03_CPUINFO_H
+
+#include <stddef.h>
+
+#define CPU_CAPS_ENV "OPENSSL_ia32cap"  // Capability mask libcrypto reads at load
+
+// Feature bits of cpu_info.features
+#define CPU_AESNI      0x0001
+#define CPU_PCLMULQDQ  0x0002
+#define CPU_SSSE3      0x0004
+#define CPU_AVX        0x0008
+#define CPU_MOVBE      0x0010
+#define CPU_AVX2       0x0020
+#define CPU_AVX512F    0x0040
+#define CPU_AVX512VL   0x0080
+#define CPU_AVX512BW   0x0100
+#define CPU_VAES       0x0200
+#define CPU_VPCLMULQDQ 0x0400
+#define CPU_SHA        0x0800
+
+// Startup probe: what the CPU has and what libcrypto will use of it.
+// OpenSSL 3 no longer exports its capability vector (OPENSSL_ia32cap_P), so
+// the effective set is rebuilt the way OpenSSL builds it: CPUID leaf 1
+// ECX:EDX as the first 64-bit word and leaf 7 ECX:EBX as the second, the
+// AVX family dropped unless the OS saves the YMM/ZMM state, then the
+// OPENSSL_ia32cap mask applied ("[~]A[:[~]B]", ~ clears bits, otherwise the
+// word is replaced). Off x86 both sets are empty.
+typedef struct {
+    char brand[49];            // CPUID brand string, or "unknown"
+    unsigned int hardware;     // CPU_* bits the CPU and OS support
+    unsigned int features;     // CPU_* bits left to libcrypto after the mask
+    const char *caps_mask;     // OPENSSL_ia32cap at startup, NULL if unset
+    const char *openssl;       // OpenSSL version string
+} cpu_info;
+
+void cpu_probe(cpu_info *info);
+
+// Space separated names of the CPU_* bits in features
+void cpu_feature_names(unsigned int features, char *buf, size_t len);
+
+// Named masks for cpu_force_caps: "native" (no mask), "no-avx512",
+// "no-avx2" (and AVX-512), "no-aesni" (AES-NI and PCLMULQDQ) and "scalar"
+// (all of the above plus AVX, SSSE3 and SHA-NI). Anything else is passed to
+// OpenSSL as a raw mask. NULL if spec is empty.
+const char *cpu_caps_preset(const char *spec);
+
+// libcrypto reads its mask once, when it is loaded, so forcing one means
+// running the program again: if OPENSSL_ia32cap does not already hold the
+// mask of spec, set it and execv /proc/self/exe with argv. Returns 0 when
+// the mask is in effect (the second run), -1 if the exec failed.
+int cpu_force_caps(const char *spec, char *argv[]);
+
+// Implementation libcrypto 3.0 picks for algo_type with the features left,
+// e.g. "AES-NI+PCLMULQDQ (AVX stitched) GHASH". Inferred from the dispatch
+// rules of its x86_64 assembly, not reported by OpenSSL.
+void cpu_backend(int algo_type, unsigned int features, char *buf, size_t len);
+
+// Name of the provider that implements algo_type's cipher ("default", "fips"...)
+const char *cpu_cipher_provider(int algo_type);
+
+// Comma separated names of the loaded providers
+void cpu_provider_names(char *buf, size_t len);
+
+#endif
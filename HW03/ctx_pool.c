@@ -0,0 +1,165 @@
+#include "ctx_pool.h"
+#include "tagcmp.h"
+
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <stdio.h>
+#include <string.h>
+
+int ctx_pool_init(ctx_pool *pool) {
+    memset(pool, 0, sizeof(*pool));
+
+    // Every poolable registry entry the provider has
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        if (!algo_has(algo_type, ALGO_CAP_POOLABLE)) continue;
+        pool->ciphers[algo_type] = EVP_CIPHER_fetch(NULL, algo_get(algo_type)->cipher_name, NULL);
+        if (!pool->ciphers[algo_type]) {
+            fprintf(stderr, "Cannot fetch cipher %s\n", algo_get(algo_type)->cipher_name);
+            ctx_pool_free(pool);
+            return 0;
+        }
+    }
+    if (!(pool->hmac = EVP_MAC_fetch(NULL, "HMAC", NULL))) {
+        fprintf(stderr, "Cannot fetch HMAC\n");
+        ctx_pool_free(pool);
+        return 0;
+    }
+    return 1;
+}
+
+void keyed_ctx_release(keyed_ctx *kc) {
+    EVP_CIPHER_CTX_free(kc->enc_ctx);
+    EVP_CIPHER_CTX_free(kc->dec_ctx);
+    EVP_MAC_CTX_free(kc->mac_ctx);
+    OPENSSL_cleanse(kc, sizeof(*kc));
+}
+
+void ctx_pool_free(ctx_pool *pool) {
+    for (int i = 0; i < POOL_MAX_SLOTS; i++) {
+        if (pool->slots[i].in_use) keyed_ctx_release(&pool->slots[i]);
+    }
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        EVP_CIPHER_free(pool->ciphers[algo_type]);
+        pool->ciphers[algo_type] = NULL;
+    }
+    EVP_MAC_free(pool->hmac);
+    pool->hmac = NULL;
+}
+
+// Run the full key schedule once; the IV is supplied per message
+static EVP_CIPHER_CTX *keyed_cipher_ctx_new(EVP_CIPHER *cipher, int algo_type,
+                                            unsigned char *key, int enc) {
+    EVP_CIPHER_CTX *ctx;
+
+    if (!(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
+    if (1 != EVP_CipherInit_ex(ctx, cipher, NULL, NULL, NULL, enc)) handle_crypto_error();
+    if (algo_get(algo_type)->caps & ALGO_CAP_AEAD) {
+        if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, algo_iv_len(algo_type), NULL)) handle_crypto_error();
+    }
+    if (1 != EVP_CipherInit_ex(ctx, NULL, NULL, key, NULL, enc)) handle_crypto_error();
+    return ctx;
+}
+
+void keyed_ctx_setup(ctx_pool *pool, keyed_ctx *kc, int algo_type,
+                     unsigned char *enc_key, unsigned char *mac_key) {
+    EVP_CIPHER *cipher = pool->ciphers[algo_type];
+
+    kc->in_use = 1;
+    kc->algo_type = algo_type;
+    memcpy(kc->enc_key, enc_key, EVP_CIPHER_get_key_length(cipher));
+    kc->enc_ctx = keyed_cipher_ctx_new(cipher, algo_type, enc_key, 1);
+    kc->dec_ctx = keyed_cipher_ctx_new(cipher, algo_type, enc_key, 0);
+
+    if (algo_get(algo_type)->caps & ALGO_CAP_ETM) {
+        OSSL_PARAM params[2];
+
+        memcpy(kc->mac_key, mac_key, HMAC_KEY_SIZE);
+        if (!(kc->mac_ctx = EVP_MAC_CTX_new(pool->hmac))) handle_crypto_error();
+        params[0] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, "SHA256", 0);
+        params[1] = OSSL_PARAM_construct_end();
+        if (1 != EVP_MAC_init(kc->mac_ctx, mac_key, HMAC_KEY_SIZE, params)) handle_crypto_error();
+    }
+}
+
+keyed_ctx *ctx_pool_get(ctx_pool *pool, int algo_type,
+                        unsigned char *enc_key, unsigned char *mac_key) {
+    int etm = algo_get(algo_type)->caps & ALGO_CAP_ETM;
+    int key_len = EVP_CIPHER_get_key_length(pool->ciphers[algo_type]);
+    keyed_ctx *kc = NULL;
+
+    for (int i = 0; i < POOL_MAX_SLOTS; i++) {
+        keyed_ctx *slot = &pool->slots[i];
+        if (slot->in_use && slot->algo_type == algo_type &&
+            CRYPTO_memcmp(slot->enc_key, enc_key, key_len) == 0 &&
+            (!etm || CRYPTO_memcmp(slot->mac_key, mac_key, HMAC_KEY_SIZE) == 0)) {
+            return slot;
+        }
+        if (!slot->in_use && !kc) kc = slot;
+    }
+
+    // No match: take a free slot, or evict round-robin
+    if (!kc) {
+        kc = &pool->slots[pool->next_victim];
+        pool->next_victim = (pool->next_victim + 1) % POOL_MAX_SLOTS;
+        keyed_ctx_release(kc);
+    }
+
+    keyed_ctx_setup(pool, kc, algo_type, enc_key, mac_key);
+    return kc;
+}
+
+// HMAC over data reusing the keyed context (EVP_MAC_init with a NULL key
+// restarts from the cached inner/outer pads)
+static void pooled_hmac(keyed_ctx *kc, unsigned char *data, int data_len, unsigned char *out) {
+    size_t mac_len;
+
+    if (1 != EVP_MAC_init(kc->mac_ctx, NULL, 0, NULL)) handle_crypto_error();
+    if (1 != EVP_MAC_update(kc->mac_ctx, data, data_len)) handle_crypto_error();
+    if (1 != EVP_MAC_final(kc->mac_ctx, out, &mac_len, EVP_MAX_MD_SIZE)) handle_crypto_error();
+}
+
+int pooled_encrypt(keyed_ctx *kc, unsigned char *plaintext, int plaintext_len,
+                   unsigned char *iv, unsigned char *ciphertext, unsigned char *tag) {
+    int len, ciphertext_len;
+
+    if (1 != EVP_EncryptInit_ex(kc->enc_ctx, NULL, NULL, NULL, iv)) handle_crypto_error();
+    if (1 != EVP_EncryptUpdate(kc->enc_ctx, ciphertext, &len, plaintext, plaintext_len)) handle_crypto_error();
+    ciphertext_len = len;
+    if (1 != EVP_EncryptFinal_ex(kc->enc_ctx, ciphertext + len, &len)) handle_crypto_error();
+    ciphertext_len += len;
+
+    if (algo_get(kc->algo_type)->caps & ALGO_CAP_ETM) {
+        pooled_hmac(kc, ciphertext, ciphertext_len, tag);
+    } else {
+        if (1 != EVP_CIPHER_CTX_ctrl(kc->enc_ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
+    }
+    return ciphertext_len;
+}
+
+int pooled_decrypt(keyed_ctx *kc, unsigned char *ciphertext, int ciphertext_len,
+                   unsigned char *iv, unsigned char *tag, unsigned char *plaintext) {
+    unsigned char computed_tag[EVP_MAX_MD_SIZE];
+    int etm = algo_get(kc->algo_type)->caps & ALGO_CAP_ETM;
+    int len, plaintext_len;
+
+    if (etm) {
+        pooled_hmac(kc, ciphertext, ciphertext_len, computed_tag);
+        if (!tag_equal(tag, computed_tag, HMAC_TAG_SIZE)) {
+            if (report_tag_failures) fprintf(stderr, "HMAC verification failed!\n");
+            return -1;
+        }
+    }
+
+    if (1 != EVP_DecryptInit_ex(kc->dec_ctx, NULL, NULL, NULL, iv)) handle_crypto_error();
+    if (!etm) {
+        if (1 != EVP_CIPHER_CTX_ctrl(kc->dec_ctx, EVP_CTRL_AEAD_SET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
+    }
+    if (1 != EVP_DecryptUpdate(kc->dec_ctx, plaintext, &len, ciphertext, ciphertext_len)) handle_crypto_error();
+    plaintext_len = len;
+    if (EVP_DecryptFinal_ex(kc->dec_ctx, plaintext + len, &len) <= 0) {
+        if (report_tag_failures) fprintf(stderr, "%s tag verification failed!\n", algo_name(kc->algo_type));
+        return -1;
+    }
+    plaintext_len += len;
+    return plaintext_len;
+}
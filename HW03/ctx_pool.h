@@ -0,0 +1,50 @@
+#ifndef HW03_CTX_POOL_H
+#define HW03_CTX_POOL_H
+
+#include <openssl/evp.h>
+
+#include "ciphers.h"
+
+#define POOL_MAX_SLOTS 8  // Keyed contexts kept alive at the same time
+
+// A cipher context pair keyed once for (algo_type, key). Per message only the
+// IV is reset, so the key schedule and the HMAC pads are computed once.
+typedef struct {
+    int in_use;
+    int algo_type;
+    unsigned char enc_key[KEY_SIZE];
+    unsigned char mac_key[HMAC_KEY_SIZE];
+    EVP_CIPHER_CTX *enc_ctx;
+    EVP_CIPHER_CTX *dec_ctx;
+    EVP_MAC_CTX *mac_ctx;  // Encrypt-then-MAC modes only
+} keyed_ctx;
+
+// Ciphers fetched once with EVP_CIPHER_fetch plus a small set of keyed slots
+typedef struct {
+    EVP_CIPHER *ciphers[NUM_ALGOS + 1];  // Indexed by algo_type, NULL if unavailable
+    EVP_MAC *hmac;
+    keyed_ctx slots[POOL_MAX_SLOTS];
+    int next_victim;  // Round-robin replacement when all slots are used
+} ctx_pool;
+
+int ctx_pool_init(ctx_pool *pool);
+void ctx_pool_free(ctx_pool *pool);
+
+// Return the keyed context for (algo_type, keys), keying a slot on first use
+keyed_ctx *ctx_pool_get(ctx_pool *pool, int algo_type,
+                        unsigned char *enc_key, unsigned char *mac_key);
+
+// Key kc for (algo_type, keys) with the pool's fetched ciphers, and free its
+// contexts and wipe its keys; for callers managing their own slots
+void keyed_ctx_setup(ctx_pool *pool, keyed_ctx *kc, int algo_type,
+                     unsigned char *enc_key, unsigned char *mac_key);
+void keyed_ctx_release(keyed_ctx *kc);
+
+// Same contract as the one-shot functions in ciphers.h: tag is HMAC_TAG_SIZE
+// bytes for the Encrypt-then-MAC modes and AEAD_TAG_SIZE for GCM/Poly1305
+int pooled_encrypt(keyed_ctx *kc, unsigned char *plaintext, int plaintext_len,
+                   unsigned char *iv, unsigned char *ciphertext, unsigned char *tag);
+int pooled_decrypt(keyed_ctx *kc, unsigned char *ciphertext, int ciphertext_len,
+                   unsigned char *iv, unsigned char *tag, unsigned char *plaintext);
+
+#endif
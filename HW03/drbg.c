@@ -0,0 +1,115 @@
+#include "drbg.h"
+#include "ciphers.h"
+
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+#include <limits.h>
+#include <string.h>
+
+static const char *drbg_names[NUM_DRBGS + 1] = {NULL, "ChaCha20-DRBG", "AES-CTR DRBG", "HMAC-DRBG"};
+
+const char *drbg_name(int type) {
+    return (type >= 1 && type <= NUM_DRBGS) ? drbg_names[type] : "unknown";
+}
+
+// Seed material as the Python classes take it: zero padded to 32 bytes
+static void seed_key(const unsigned char *seed, size_t seed_len, unsigned char *key) {
+    memset(key, 0, DRBG_SEED_SIZE);
+    memcpy(key, seed, seed_len < DRBG_SEED_SIZE ? seed_len : DRBG_SEED_SIZE);
+}
+
+static void keystream_seed(drbg_ctx *drbg, const unsigned char *seed, size_t seed_len) {
+    unsigned char key[DRBG_SEED_SIZE];
+    unsigned char iv[16] = {0};  // AES-CTR: counter 0
+
+    seed_key(seed, seed_len, key);
+    if (drbg->type == DRBG_CHACHA20 && RAND_bytes(iv, sizeof(iv)) != 1) handle_crypto_error();
+    if (1 != EVP_EncryptInit_ex(drbg->cipher, drbg->type == DRBG_CHACHA20 ? EVP_chacha20() : EVP_aes_256_ctr(),
+                                NULL, key, iv)) handle_crypto_error();
+    OPENSSL_cleanse(key, sizeof(key));
+}
+
+// V = HMAC(K, V); drbg->mac is always keyed with the current K
+static void hmac_next_v(drbg_ctx *drbg) {
+    size_t len;
+
+    if (1 != EVP_MAC_init(drbg->mac, NULL, 0, NULL)) handle_crypto_error();
+    if (1 != EVP_MAC_update(drbg->mac, drbg->v, sizeof(drbg->v))) handle_crypto_error();
+    if (1 != EVP_MAC_final(drbg->mac, drbg->v, &len, sizeof(drbg->v))) handle_crypto_error();
+}
+
+// SP 800-90A HMAC_DRBG_Update; the second round only with provided data
+static void hmac_update(drbg_ctx *drbg, const unsigned char *data, size_t data_len, int have_data) {
+    for (unsigned char round = 0; round < (have_data ? 2 : 1); round++) {
+        size_t len;
+
+        // K = HMAC(K, V || round || data), then rekey and V = HMAC(K, V)
+        if (1 != EVP_MAC_init(drbg->mac, NULL, 0, NULL)) handle_crypto_error();
+        if (1 != EVP_MAC_update(drbg->mac, drbg->v, sizeof(drbg->v))) handle_crypto_error();
+        if (1 != EVP_MAC_update(drbg->mac, &round, 1)) handle_crypto_error();
+        if (data_len && 1 != EVP_MAC_update(drbg->mac, data, data_len)) handle_crypto_error();
+        if (1 != EVP_MAC_final(drbg->mac, drbg->k, &len, sizeof(drbg->k))) handle_crypto_error();
+        if (1 != EVP_MAC_init(drbg->mac, drbg->k, sizeof(drbg->k), NULL)) handle_crypto_error();
+        hmac_next_v(drbg);
+    }
+}
+
+int drbg_init(drbg_ctx *drbg, int type, const unsigned char *seed, size_t seed_len) {
+    unsigned char random_seed[DRBG_SEED_SIZE];
+
+    memset(drbg, 0, sizeof(*drbg));
+    if (type < 1 || type > NUM_DRBGS) return 0;
+    drbg->type = type;
+    if (!seed) {
+        if (RAND_bytes(random_seed, sizeof(random_seed)) != 1) handle_crypto_error();
+        seed = random_seed;
+        seed_len = sizeof(random_seed);
+    }
+
+    if (type == DRBG_HMAC) {
+        memset(drbg->k, 0x00, sizeof(drbg->k));
+        memset(drbg->v, 0x01, sizeof(drbg->v));
+        drbg->mac = hmac_sha256_ctx_new(drbg->k);
+        hmac_update(drbg, seed, seed_len, 1);
+    } else {
+        if (!(drbg->cipher = EVP_CIPHER_CTX_new())) handle_crypto_error();
+        keystream_seed(drbg, seed, seed_len);
+    }
+    OPENSSL_cleanse(random_seed, sizeof(random_seed));
+    return 1;
+}
+
+void drbg_reseed(drbg_ctx *drbg, const unsigned char *seed, size_t seed_len) {
+    if (drbg->type == DRBG_HMAC) {
+        hmac_update(drbg, seed, seed_len, 1);
+    } else {
+        keystream_seed(drbg, seed, seed_len);
+    }
+}
+
+void drbg_generate(drbg_ctx *drbg, unsigned char *out, size_t len) {
+    if (drbg->type == DRBG_HMAC) {
+        for (size_t done = 0; done < len; done += sizeof(drbg->v)) {
+            size_t n = (len - done < sizeof(drbg->v)) ? len - done : sizeof(drbg->v);
+            hmac_next_v(drbg);
+            memcpy(out + done, drbg->v, n);
+        }
+        hmac_update(drbg, NULL, 0, 0);
+        return;
+    }
+
+    // Keystream = encryption of zeros, in place and in int-sized pieces
+    memset(out, 0, len);
+    for (size_t done = 0; done < len;) {
+        int n = (len - done > INT_MAX / 2) ? INT_MAX / 2 : (int)(len - done);
+        int out_len;
+        if (1 != EVP_EncryptUpdate(drbg->cipher, out + done, &out_len, out + done, n)) handle_crypto_error();
+        done += n;
+    }
+}
+
+void drbg_free(drbg_ctx *drbg) {
+    EVP_CIPHER_CTX_free(drbg->cipher);
+    EVP_MAC_CTX_free(drbg->mac);
+    OPENSSL_cleanse(drbg, sizeof(*drbg));
+}
@@ -0,0 +1,48 @@
+#ifndef HW03_DRBG_H
+#define HW03_DRBG_H
+
+#include <openssl/evp.h>
+#include <stddef.h>
+
+#define DRBG_SEED_SIZE 32
+#define NUM_DRBGS 3
+
+// Native versions of the three generators of HW05/drbg_benchmark.py,
+// writing raw bytes into caller buffers:
+//
+//   DRBG_CHACHA20  ChaCha20 keystream, key = seed, random 128-bit IV
+//                  (32-bit counter + 96-bit nonce, as in the Python class)
+//   DRBG_AES_CTR   AES-256-CTR keystream, key = seed, IV = be128(counter)
+//   DRBG_HMAC      HMAC-DRBG with SHA-256 (NIST SP 800-90A update and
+//                  generate, no additional input), K and V as in the Python
+//
+// Unlike the Python classes, consecutive generate calls continue the
+// keystream (the ChaCha20 class restarts it, and the AES-CTR one advances
+// its counter by a single block per call, so calls overlap).
+enum { DRBG_CHACHA20 = 1, DRBG_AES_CTR = 2, DRBG_HMAC = 3 };
+
+typedef struct {
+    int type;
+    EVP_CIPHER_CTX *cipher;  // Keystream DRBGs: running encryption of zeros
+    EVP_MAC_CTX *mac;        // HMAC-DRBG: keyed with K
+    unsigned char k[32];     // HMAC-DRBG key K
+    unsigned char v[32];     // HMAC-DRBG value V
+} drbg_ctx;
+
+const char *drbg_name(int type);
+
+// Seed from seed_len bytes (the keystream DRBGs zero pad shorter seeds like
+// the Python classes), or from RAND_bytes when seed is NULL. Returns 1 on
+// success.
+int drbg_init(drbg_ctx *drbg, int type, const unsigned char *seed, size_t seed_len);
+
+// Reseed: new key for the keystream DRBGs (counter and IV restart),
+// SP 800-90A update with the seed as provided data for HMAC-DRBG
+void drbg_reseed(drbg_ctx *drbg, const unsigned char *seed, size_t seed_len);
+
+void drbg_generate(drbg_ctx *drbg, unsigned char *out, size_t len);
+
+// Free the contexts and wipe the state
+void drbg_free(drbg_ctx *drbg);
+
+#endif
@@ -0,0 +1,200 @@
+#include "drbg_bench.h"
+#include "bench.h"
+#include "ciphers.h"
+#include "drbg.h"
+#include "randpool.h"
+
+#include <openssl/rand.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Ones among the first num_bits bits, most significant bit of each byte
+// first (the order of the Python bit strings)
+static size_t count_ones(const unsigned char *buf, size_t num_bits) {
+    size_t ones = 0, full = num_bits / 8;
+
+    for (size_t i = 0; i < full; i++) ones += __builtin_popcount(buf[i]);
+    if (num_bits % 8) ones += __builtin_popcount(buf[full] >> (8 - num_bits % 8));
+    return ones;
+}
+
+int run_drbg_tests(size_t *lengths_bits, int num_lengths) {
+    char results_filename[256];
+    FILE *results_file;
+    int runs = bench_settings.max_runs;
+    long long ns[BENCH_MAX_RUNS];
+
+    results_file = open_results_file("drbg", "",
+                                     "DRBG,Length_bits,Runs,Avg_Time_s,Median_Time_s,Bytes_per_s,Memory_MB,Peak_RSS_MB,Zeros_pct,Ones_pct",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) return 1;
+
+    printf("\n=================================================================\n");
+    printf("  Native DRBG benchmark (%d warm-up + %d runs per length)\n", bench_settings.warmup_runs, runs);
+    printf("=================================================================\n");
+
+    for (int type = 1; type <= NUM_DRBGS; type++) {
+        printf("\n%s:\n", drbg_name(type));
+        printf("    %-12s %14s %14s %12s %10s %8s %8s\n", "Bits", "Avg time (μs)", "Median (μs)",
+               "MB/s", "Mem (MB)", "0s %", "1s %");
+
+        for (int l = 0; l < num_lengths; l++) {
+            size_t bits = lengths_bits[l], bytes = (bits + 7) / 8;
+            unsigned char *buf = malloc(bytes);
+            double memory_mb = (bytes + sizeof(drbg_ctx)) / (1024.0 * 1024.0);
+            double zeros_pct, ones_pct;
+            bench_latency lat;
+            size_t ones;
+            drbg_ctx drbg;
+
+            if (!buf) {
+                perror("Memory allocation failed");
+                fclose(results_file);
+                return 1;
+            }
+
+            // A fresh instance per run, only the generate call is timed
+            for (int run = -bench_settings.warmup_runs; run < runs; run++) {
+                struct timespec start, end;
+
+                drbg_init(&drbg, type, NULL, 0);
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                drbg_generate(&drbg, buf, bytes);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                drbg_free(&drbg);
+                if (run >= 0) ns[run] = elapsed_ns(&start, &end);
+            }
+            bench_latency_summary(ns, runs, &lat);
+
+            // Monobit counts on the output of the last run
+            ones = count_ones(buf, bits);
+            ones_pct = 100.0 * ones / bits;
+            zeros_pct = 100.0 - ones_pct;
+            free(buf);
+
+            printf("    %-12zu %14.2f %14.2f %12.1f %10.4f %8.2f %8.2f\n", bits,
+                   lat.mean_ns / 1e3, lat.p50_ns / 1e3, bytes / (lat.mean_ns / 1e9) / (1024.0 * 1024.0),
+                   memory_mb, zeros_pct, ones_pct);
+            fprintf(results_file, "%s,%zu,%d,%.9f,%.9f,%.0f,%.6f,%.2f,%.4f,%.4f\n", drbg_name(type),
+                    bits, runs, lat.mean_ns / 1e9, lat.p50_ns / 1e9, bytes / (lat.mean_ns / 1e9),
+                    memory_mb, peak_rss_mb(), zeros_pct, ones_pct);
+        }
+    }
+
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    return 0;
+}
+
+// IV generation methods of the contention benchmark
+enum { IV_RAND_BYTES, IV_RAND_POOL, IV_NONCE_CTR, NUM_IV_METHODS };
+
+static const char *iv_method_names[NUM_IV_METHODS] = {"RAND_bytes", "rand_pool", "nonce_ctr"};
+
+typedef struct {
+    int method;
+    int thread_index;
+    int ivs;
+    pthread_barrier_t *start;
+} iv_worker_arg;
+
+static void *iv_worker(void *arg) {
+    iv_worker_arg *w = (iv_worker_arg *)arg;
+    unsigned char iv[IV_BENCH_LEN];
+    volatile unsigned char sink = 0;
+    nonce_ctr nc;
+
+    if (w->method == IV_NONCE_CTR) nonce_ctr_init(&nc, IV_BENCH_LEN, (uint32_t)w->thread_index);
+    if (w->method == IV_RAND_POOL) rand_pool_bytes(iv, sizeof(iv));  // Pool setup is not timed
+
+    pthread_barrier_wait(w->start);
+    for (int i = 0; i < w->ivs; i++) {
+        switch (w->method) {
+            case IV_RAND_BYTES:
+                if (RAND_bytes(iv, sizeof(iv)) != 1) handle_crypto_error();
+                break;
+            case IV_RAND_POOL:
+                rand_pool_bytes(iv, sizeof(iv));
+                break;
+            default:
+                nonce_ctr_next(&nc, iv);
+                break;
+        }
+        sink ^= iv[0];
+    }
+    // Wait for everyone before the pool is released at thread exit
+    pthread_barrier_wait(w->start);
+    return NULL;
+}
+
+int run_iv_tests(int *thread_counts, int num_thread_counts, int ivs_per_thread) {
+    char results_filename[256];
+    FILE *results_file;
+    int runs = bench_settings.max_runs;
+    long long ns[BENCH_MAX_RUNS];
+
+    results_file = open_results_file("ivgen", "",
+                                     "Method,Threads,IVs_per_thread,Total_ns_per_IV,Per_thread_ns_per_IV,MIVs_per_s",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) return 1;
+
+    printf("\n=================================================================\n");
+    printf("  IV generation under contention (%d-byte IVs, %d per thread, median of %d runs)\n",
+           IV_BENCH_LEN, ivs_per_thread, runs);
+    printf("=================================================================\n");
+
+    if (!rand_pool_start(DRBG_CHACHA20)) {
+        fclose(results_file);
+        return 1;
+    }
+
+    for (int method = 0; method < NUM_IV_METHODS; method++) {
+        printf("\n%s:\n", iv_method_names[method]);
+        printf("    %-8s %16s %20s %12s\n", "Threads", "ns/IV (total)", "ns/IV (per thread)", "M IVs/s");
+
+        for (int t = 0; t < num_thread_counts; t++) {
+            int n = thread_counts[t];
+            pthread_t threads[RAND_POOL_MAX_THREADS];
+            iv_worker_arg args[RAND_POOL_MAX_THREADS];
+            pthread_barrier_t start;
+            double total_ns, per_iv, per_thread;
+            bench_latency lat;
+
+            for (int run = -bench_settings.warmup_runs; run < runs; run++) {
+                struct timespec t0, t1;
+
+                // n workers plus the timing thread meet at the barrier
+                pthread_barrier_init(&start, NULL, n + 1);
+                for (int i = 0; i < n; i++) {
+                    args[i] = (iv_worker_arg){method, i, ivs_per_thread, &start};
+                    if (pthread_create(&threads[i], NULL, iv_worker, &args[i]) != 0) {
+                        perror("Cannot create thread");
+                        exit(1);
+                    }
+                }
+                pthread_barrier_wait(&start);
+                clock_gettime(CLOCK_MONOTONIC, &t0);
+                pthread_barrier_wait(&start);
+                clock_gettime(CLOCK_MONOTONIC, &t1);
+                for (int i = 0; i < n; i++) pthread_join(threads[i], NULL);
+                pthread_barrier_destroy(&start);
+                if (run >= 0) ns[run] = elapsed_ns(&t0, &t1);
+            }
+            bench_latency_summary(ns, runs, &lat);
+
+            total_ns = (double)lat.p50_ns;
+            per_iv = total_ns / ((double)n * ivs_per_thread);
+            per_thread = total_ns / ivs_per_thread;
+            printf("    %-8d %16.2f %20.2f %12.2f\n", n, per_iv, per_thread, 1e3 / per_iv);
+            fprintf(results_file, "%s,%d,%d,%.3f,%.3f,%.3f\n", iv_method_names[method], n,
+                    ivs_per_thread, per_iv, per_thread, 1e3 / per_iv);
+        }
+    }
+    rand_pool_stop();
+
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    return 0;
+}
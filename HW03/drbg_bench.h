@@ -0,0 +1,24 @@
+#ifndef HW03_DRBG_BENCH_H
+#define HW03_DRBG_BENCH_H
+
+#include <stddef.h>
+
+// Length sweep of HW05/drbg_benchmark.py, in bits
+#define DRBG_DEFAULT_LENGTHS {10000, 100000, 1000000, 10000000}
+#define DRBG_NUM_DEFAULT_LENGTHS 4
+
+// Native DRBG benchmark: for every generator and length, a freshly seeded
+// instance per run (as benchmark_drbg does) and one timed drbg_generate.
+// Writes results_drbg.csv with the fields drbg_benchmark.py --from-csv
+// feeds to plot_results and generate_summary_table.
+int run_drbg_tests(size_t *lengths_bits, int num_lengths);
+
+#define IV_BENCH_LEN 12  // GCM / ChaCha20-Poly1305 nonce size
+
+// IV/nonce generation contention benchmark: every thread count starts that
+// many threads on a barrier, each drawing ivs_per_thread IVs from RAND_bytes
+// (OpenSSL's shared DRBG), its rand_pool (background refiller running) or a
+// nonce_ctr. Writes median wall-clock ns per IV to results_ivgen.csv.
+int run_iv_tests(int *thread_counts, int num_thread_counts, int ivs_per_thread);
+
+#endif
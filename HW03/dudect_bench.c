@@ -0,0 +1,382 @@
+#include "dudect_bench.h"
+#include "bench.h"
+#include "ciphers.h"
+#include "ctx_pool.h"
+#include "kernels.h"
+#include "randpool.h"
+#include "tagcmp.h"
+
+#include <openssl/crypto.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static const double crop_pct[DUDECT_NUM_CROPS] = {100, 99.9, 99, 95, 90, 50};
+
+typedef struct {
+    const char *name;
+    // 1 if tag (tag_len bytes) is accepted
+    int (*check)(void *arg, const unsigned char *tag, size_t tag_len);
+    void *arg;
+    const unsigned char *reference;  // The right tag
+    size_t tag_len;
+} dudect_target;
+
+typedef int (*etm_decrypt_fn)(unsigned char *ciphertext, int ciphertext_len,
+                              unsigned char *enc_key, unsigned char *mac_key,
+                              unsigned char *iv, unsigned char *tag, unsigned char *plaintext);
+typedef int (*etm_decrypt_fused_fn)(unsigned char *ciphertext, int ciphertext_len,
+                                    unsigned char *enc_key, unsigned char *mac_key,
+                                    unsigned char *iv, unsigned char *tag,
+                                    unsigned char *plaintext, int block_size);
+
+// A decryption whose tag is checked: 64 bytes under a kernel (kernels.h),
+// and for the Encrypt-then-MAC modes through the one-shot, pooled and fused
+// paths of ciphers.h and ctx_pool.h as well
+typedef struct {
+    kernel *k;
+    keyed_ctx *kc;                // NULL if not Encrypt-then-MAC
+    etm_decrypt_fn oneshot;
+    etm_decrypt_fused_fn fused;
+    unsigned char enc_key[KEY_SIZE];
+    unsigned char mac_key[HMAC_KEY_SIZE];
+    unsigned char iv[MAX_IV_SIZE];
+    unsigned char ciphertext[DUDECT_MSG_SIZE];
+    unsigned char plaintext[DUDECT_MSG_SIZE];
+    unsigned char tag[DUDECT_TAG_LEN];
+} verify_target;
+
+// Welch's t-test accumulated online (Welford), per class
+typedef struct {
+    double n[2], mean[2], m2[2];
+} welch;
+
+// Serializing read of the time stamp counter: lfence keeps the call from
+// starting before the read or the read from overtaking the call
+static uint64_t ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_lfence();
+    uint64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// What a hand-written comparison does: stop at the first difference
+static int check_early_exit(void *arg, const unsigned char *tag, size_t tag_len) {
+    const unsigned char *ref = arg;
+
+    for (size_t i = 0; i < tag_len; i++) {
+        if (ref[i] != tag[i]) return 0;
+    }
+    return 1;
+}
+
+static int check_memcmp(void *arg, const unsigned char *tag, size_t tag_len) {
+    return memcmp(arg, tag, tag_len) == 0;
+}
+
+static int check_crypto_memcmp(void *arg, const unsigned char *tag, size_t tag_len) {
+    return CRYPTO_memcmp(arg, tag, tag_len) == 0;
+}
+
+static int check_tag_equal(void *arg, const unsigned char *tag, size_t tag_len) {
+    return tag_equal(arg, tag, tag_len);
+}
+
+static int check_decrypt(void *arg, const unsigned char *tag, size_t tag_len) {
+    verify_target *v = arg;
+    return kernel_decrypt(v->k, v->ciphertext, DUDECT_MSG_SIZE, v->iv, tag, v->plaintext) >= 0;
+}
+
+static int check_decrypt_oneshot(void *arg, const unsigned char *tag, size_t tag_len) {
+    verify_target *v = arg;
+    return v->oneshot(v->ciphertext, DUDECT_MSG_SIZE, v->enc_key, v->mac_key, v->iv,
+                      (unsigned char *)tag, v->plaintext) >= 0;
+}
+
+static int check_decrypt_pooled(void *arg, const unsigned char *tag, size_t tag_len) {
+    verify_target *v = arg;
+    return pooled_decrypt(v->kc, v->ciphertext, DUDECT_MSG_SIZE, v->iv, (unsigned char *)tag, v->plaintext) >= 0;
+}
+
+static int check_decrypt_fused(void *arg, const unsigned char *tag, size_t tag_len) {
+    verify_target *v = arg;
+    return v->fused(v->ciphertext, DUDECT_MSG_SIZE, v->enc_key, v->mac_key, v->iv,
+                    (unsigned char *)tag, v->plaintext, DEFAULT_FUSED_BLOCK_SIZE) >= 0;
+}
+
+static void welch_push(welch *w, int cls, double x) {
+    double delta = x - w->mean[cls];
+
+    w->n[cls]++;
+    w->mean[cls] += delta / w->n[cls];
+    w->m2[cls] += delta * (x - w->mean[cls]);
+}
+
+static double welch_t(const welch *w) {
+    if (w->n[0] < 2 || w->n[1] < 2) return 0;
+    double var0 = w->m2[0] / (w->n[0] - 1), var1 = w->m2[1] / (w->n[1] - 1);
+    double se = sqrt(var0 / w->n[0] + var1 / w->n[1]);
+    return se > 0 ? (w->mean[0] - w->mean[1]) / se : 0;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Forged tags of both classes for target, in random order: classes[i] 0
+// (fixed) or 1 (random), candidates[i] DUDECT_TAG_LEN bytes each
+static void make_inputs(const dudect_target *target, unsigned char *classes, unsigned char *candidates, int n) {
+    rand_pool_bytes(classes, (size_t)n);
+    rand_pool_bytes(candidates, (size_t)n * DUDECT_TAG_LEN);
+    for (int i = 0; i < n; i++) {
+        unsigned char *c = candidates + (size_t)i * DUDECT_TAG_LEN;
+
+        classes[i] &= 1;
+        if (classes[i] == 0) {
+            memcpy(c, target->reference, target->tag_len);
+            c[target->tag_len - 1] ^= 0x01;
+        } else if (memcmp(c, target->reference, target->tag_len) == 0) {
+            c[0] ^= 0x01;  // A random tag that happens to be right is still a forgery
+        }
+    }
+}
+
+// Best of three passes over the candidates, ns per call
+static double ns_per_call(const dudect_target *target, const unsigned char *candidates, int n) {
+    double best = -1;
+    int accepted = 0;
+
+    for (int rep = 0; rep < 3; rep++) {
+        struct timespec start, end;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < n; i++) {
+            accepted += target->check(target->arg, candidates + (size_t)i * DUDECT_TAG_LEN, target->tag_len);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double ns = (double)elapsed_ns(&start, &end) / n;
+        if (best < 0 || ns < best) best = ns;
+    }
+    return accepted ? -1 : best;  // A forgery got through
+}
+
+// Time every candidate, then the t statistics. 0 on success, -1 on a
+// forgery accepted or an allocation failure.
+static int measure(const dudect_target *target, int n, FILE *results_file, double *cost_ns) {
+    unsigned char *classes = malloc((size_t)n);
+    unsigned char *candidates = malloc((size_t)n * DUDECT_TAG_LEN);
+    uint64_t *samples = malloc((size_t)n * sizeof(uint64_t));
+    uint64_t *sorted = malloc((size_t)n * sizeof(uint64_t));
+    long long *by_class[2] = {malloc((size_t)n * sizeof(long long)), malloc((size_t)n * sizeof(long long))};
+    int count[2] = {0, 0}, accepted = 0, ret = -1;
+
+    if (!classes || !candidates || !samples || !sorted || !by_class[0] || !by_class[1]) {
+        perror("malloc");
+        goto out;
+    }
+    make_inputs(target, classes, candidates, n);
+
+    // Untimed warm-up: caches, branch predictors, first-use allocations
+    for (int i = 0; i < n && i < 10000; i++) {
+        accepted += target->check(target->arg, candidates + (size_t)i * DUDECT_TAG_LEN, target->tag_len);
+    }
+    for (int i = 0; i < n; i++) {
+        const unsigned char *c = candidates + (size_t)i * DUDECT_TAG_LEN;
+        uint64_t start = ticks();
+        accepted += target->check(target->arg, c, target->tag_len);
+        samples[i] = ticks() - start;
+    }
+    if (accepted) {
+        printf("    %-34s FAILED: accepted a forged tag\n", target->name);
+        goto out;
+    }
+
+    // t on all measurements and below each percentile of both classes together
+    double t_raw = 0, t_max = 0, max_crop = 100;
+    memcpy(sorted, samples, (size_t)n * sizeof(uint64_t));
+    qsort(sorted, (size_t)n, sizeof(uint64_t), cmp_u64);
+    for (int c = 0; c < DUDECT_NUM_CROPS; c++) {
+        uint64_t threshold = sorted[(size_t)(crop_pct[c] / 100 * (n - 1))];
+        welch w;
+
+        memset(&w, 0, sizeof(w));
+        for (int i = 0; i < n; i++) {
+            if (samples[i] <= threshold) welch_push(&w, classes[i], (double)samples[i]);
+        }
+        double t = fabs(welch_t(&w));
+        if (c == 0) t_raw = t;
+        if (t > t_max) {
+            t_max = t;
+            max_crop = crop_pct[c];
+        }
+    }
+
+    for (int i = 0; i < n; i++) by_class[classes[i]][count[classes[i]]++] = (long long)samples[i];
+    bench_latency lat[2];
+    bench_latency_summary(by_class[0], count[0], &lat[0]);
+    bench_latency_summary(by_class[1], count[1], &lat[1]);
+
+    *cost_ns = ns_per_call(target, candidates, n);
+    if (*cost_ns < 0) {
+        printf("    %-34s FAILED: accepted a forged tag\n", target->name);
+        goto out;
+    }
+
+    int leak = t_max > DUDECT_T_THRESHOLD;
+    printf("    %-34s %12lld %12lld %9.2f %9.2f %7.1f%% %10.1f   %s\n", target->name,
+           lat[0].p50_ns, lat[1].p50_ns, t_raw, t_max, max_crop, *cost_ns,
+           leak ? "LEAK" : "no leak detected");
+    fprintf(results_file, "%s,%zu,%d,%d,%d,%lld,%lld,%.3f,%.3f,%.1f,%s,%.2f\n", target->name,
+            target->tag_len, n, count[0], count[1], lat[0].p50_ns, lat[1].p50_ns, t_raw, t_max,
+            max_crop, leak ? "yes" : "no", *cost_ns);
+    ret = 0;
+out:
+    free(classes);
+    free(candidates);
+    free(samples);
+    free(sorted);
+    free(by_class[0]);
+    free(by_class[1]);
+    return ret;
+}
+
+// The keys stay in v for the one-shot and fused paths, which take them per
+// call; the caller wipes them
+static int verify_target_init(verify_target *v, ctx_pool *pool, int algo_type, unsigned char *master_key) {
+    unsigned char message[DUDECT_MSG_SIZE];
+
+    derive_algo_keys(master_key, algo_name(algo_type), algo_type, v->enc_key, v->mac_key);
+    v->k = kernel_new(algo_type, v->enc_key, v->mac_key);
+    if (!v->k) return -1;
+    if (algo_type == 1) {
+        v->oneshot = aes_ctr_hmac_decrypt;
+        v->fused = aes_ctr_hmac_decrypt_fused;
+    } else if (algo_type == 2) {
+        v->oneshot = chacha20_hmac_decrypt;
+        v->fused = chacha20_hmac_decrypt_fused;
+    }
+    if (v->oneshot) v->kc = ctx_pool_get(pool, algo_type, v->enc_key, v->mac_key);
+
+    rand_pool_bytes(message, sizeof(message));
+    rand_pool_bytes(v->iv, (size_t)algo_iv_len(algo_type));
+    kernel_encrypt(v->k, message, DUDECT_MSG_SIZE, v->iv, v->ciphertext, v->tag);
+    return kernel_decrypt(v->k, v->ciphertext, DUDECT_MSG_SIZE, v->iv, v->tag, v->plaintext) == DUDECT_MSG_SIZE &&
+           memcmp(v->plaintext, message, DUDECT_MSG_SIZE) == 0 ? 0 : -1;
+}
+
+int run_dudect_tests(int num_measurements, unsigned char *master_key) {
+    static const int verify_algos[3] = {1, 2, 4};
+    verify_target verify[3];
+    dudect_target targets[4 + 3 * 4];
+    unsigned char reference[DUDECT_TAG_LEN];
+    char names[3][4][64];
+    char results_filename[256];
+    FILE *results_file;
+    ctx_pool pool;
+    double cost[4 + 3 * 4];
+    int num_targets = 0, ret = 0;
+
+    if (num_measurements < 1000) {
+        fprintf(stderr, "At least 1000 measurements per target\n");
+        return 1;
+    }
+    memset(verify, 0, sizeof(verify));
+    if (!ctx_pool_init(&pool)) return 1;
+
+    printf("\n=================================================================\n");
+    printf("  Tag verification timing (dudect): fixed vs random forged tags,\n");
+    printf("  %d measurements per target, Welch's t (leak if |t| > %.1f)\n", num_measurements, DUDECT_T_THRESHOLD);
+    printf("=================================================================\n");
+
+    rand_pool_bytes(reference, sizeof(reference));
+    targets[num_targets++] = (dudect_target){"early-exit byte loop", check_early_exit, reference, reference, DUDECT_TAG_LEN};
+    targets[num_targets++] = (dudect_target){"memcmp", check_memcmp, reference, reference, DUDECT_TAG_LEN};
+    targets[num_targets++] = (dudect_target){"CRYPTO_memcmp", check_crypto_memcmp, reference, reference, DUDECT_TAG_LEN};
+    targets[num_targets++] = (dudect_target){"tag_equal", check_tag_equal, reference, reference, DUDECT_TAG_LEN};
+    for (int a = 0; a < 3; a++) {
+        int algo_type = verify_algos[a];
+
+        if (!algo_available(algo_type) || verify_target_init(&verify[a], &pool, algo_type, master_key) != 0) {
+            printf("%s: no kernel, skipped\n", algo_name(algo_type));
+            if (verify[a].k) kernel_free(verify[a].k);
+            verify[a].k = NULL;
+            continue;
+        }
+        size_t tag_len = (size_t)algo_get(algo_type)->tag_len;
+
+        snprintf(names[a][0], sizeof(names[a][0]), "decrypt %s", algo_name(algo_type));
+        targets[num_targets++] = (dudect_target){names[a][0], check_decrypt, &verify[a], verify[a].tag, tag_len};
+        if (!verify[a].oneshot) continue;
+        snprintf(names[a][1], sizeof(names[a][1]), "one-shot %s", algo_name(algo_type));
+        targets[num_targets++] = (dudect_target){names[a][1], check_decrypt_oneshot, &verify[a], verify[a].tag, tag_len};
+        snprintf(names[a][2], sizeof(names[a][2]), "pooled %s", algo_name(algo_type));
+        targets[num_targets++] = (dudect_target){names[a][2], check_decrypt_pooled, &verify[a], verify[a].tag, tag_len};
+        snprintf(names[a][3], sizeof(names[a][3]), "fused %s", algo_name(algo_type));
+        targets[num_targets++] = (dudect_target){names[a][3], check_decrypt_fused, &verify[a], verify[a].tag, tag_len};
+    }
+
+    results_file = open_results_file("dudect", "",
+                                     "Target,Tag_Bytes,Measurements,Fixed_Count,Random_Count,Fixed_Median_ticks,"
+                                     "Random_Median_ticks,Raw_t,Max_t,Max_t_Crop_pct,Leak,ns_per_call",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) {
+        ret = 1;
+        goto out;
+    }
+
+    // Every call rejects a forged tag: time the verification, not the message
+    report_tag_failures = 0;
+    printf("\n    %-34s %12s %12s %9s %9s %8s %10s\n", "Target", "Fixed p50", "Random p50", "|t| raw",
+           "max |t|", "at p", "ns/call");
+    for (int t = 0; t < num_targets; t++) {
+        if (measure(&targets[t], num_measurements, results_file, &cost[t]) != 0) ret = 1;
+    }
+    report_tag_failures = 1;
+    printf("    (p50 in %s ticks; fixed = right tag but the last byte, random = random tag)\n",
+#if defined(__x86_64__) || defined(__i386__)
+           "rdtsc"
+#else
+           "ns"
+#endif
+    );
+
+    // Cost of the constant-time check against the previous memcmp, alone
+    // and as a share of a whole 64-byte Encrypt-then-MAC verification
+    if (ret == 0) {
+        double extra = cost[3] - cost[1];
+
+        printf("\ntag_equal vs memcmp: %+.1f ns per %d-byte comparison (CRYPTO_memcmp %+.1f ns)\n",
+               extra, DUDECT_TAG_LEN, cost[2] - cost[1]);
+        for (int t = 4; t < num_targets; t++) {
+            if (targets[t].tag_len == DUDECT_TAG_LEN) {
+                printf("  %s: %.1f ns per verification, %+.2f%%\n", targets[t].name, cost[t],
+                       100.0 * extra / cost[t]);
+            }
+        }
+    }
+
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+out:
+    for (int a = 0; a < 3; a++) {
+        if (verify[a].k) kernel_free(verify[a].k);
+        OPENSSL_cleanse(verify[a].enc_key, sizeof(verify[a].enc_key));
+        OPENSSL_cleanse(verify[a].mac_key, sizeof(verify[a].mac_key));
+    }
+    ctx_pool_free(&pool);
+    return ret;
+}
@@ -0,0 +1,34 @@
+#ifndef HW03_DUDECT_BENCH_H
+#define HW03_DUDECT_BENCH_H
+
+#define DUDECT_TAG_LEN 32      // HMAC_TAG_SIZE, the longest tag
+#define DUDECT_MSG_SIZE 64     // Ciphertext of the decrypt targets
+#define DUDECT_T_THRESHOLD 4.5 // |t| above this: timing depends on the class
+#define DUDECT_NUM_CROPS 6
+
+// dudect-style timing leak test of tag verification (Reparaz, Balasch and
+// Verbauwhede, "Dude, is my code constant time?"). Every target sees two
+// classes of forged tags, mixed in random order:
+//
+//   fixed   the right tag with its last byte changed (all but one byte match)
+//   random  a random tag (the first byte already differs, almost always)
+//
+// Both are rejected, so only the content of the tag differs. Each call is
+// timed with the time stamp counter and Welch's t-test compares the two
+// classes, on all measurements and on the ones below a few percentiles
+// (cropping the interrupts and migrations of the long tail). A max |t|
+// over DUDECT_T_THRESHOLD is a leak.
+//
+// Targets: an early-exit byte loop (control: must leak), memcmp (the
+// previous check of aes_ctr_hmac_decrypt/chacha20_hmac_decrypt),
+// CRYPTO_memcmp, tag_equal (tagcmp.h), then whole verifications through
+// kernel_decrypt: the two Encrypt-then-MAC modes (tag_equal) and
+// ChaCha20-Poly1305 (checked inside OpenSSL); for the Encrypt-then-MAC
+// modes also aes_ctr_hmac_decrypt/chacha20_hmac_decrypt, pooled_decrypt
+// and the fused decrypts, which all check with tag_equal.
+// num_measurements per target.
+// Also reports ns per call, and what tag_equal costs over memcmp against a
+// whole verification. Writes results_dudect.csv.
+int run_dudect_tests(int num_measurements, unsigned char *master_key);
+
+#endif
@@ -0,0 +1,654 @@
+#include "filebatch.h"
+#include "bench.h"
+#include "ciphers.h"
+#include "ctx_pool.h"
+#include "mapped_io.h"
+#include "metrics.h"
+#include "parallel.h"
+#include "randpool.h"
+#include "tagcmp.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define CHUNK_BYTES ((size_t)FILEBATCH_CHUNK_LEAVES * PARALLEL_MAC_LEAF)
+
+enum { TASK_WHOLE, TASK_SPLIT, TASK_CHUNK };
+
+typedef struct {
+    int kind;
+    int job;
+    size_t first_leaf, last_leaf;  // TASK_CHUNK only
+} batch_task;
+
+// One (file, algorithm) pair
+typedef struct {
+    int file;
+    int algo_type;
+    unsigned char iv[MAX_IV_SIZE];
+    unsigned char tag[HMAC_TAG_SIZE];
+    unsigned char *leaf_tags;   // Split jobs: HMAC_TAG_SIZE bytes per leaf
+    unsigned char *check_tags;  // The leaves recomputed on decrypt (same block)
+    size_t n_leaves;
+    int first_chunk, num_chunks;  // Task ids of the chunk tasks
+    int chunks_left;
+    long long enc_ns, dec_ns;
+    long long done_ns;  // Completion time since the start of the batch
+    int failed;
+} batch_job;
+
+typedef struct {
+    char path[PATH_MAX];
+    mapped_file mf;
+} batch_file;
+
+// Chase-Lev work-stealing deque of task ids. The owner pushes and takes at
+// the bottom, thieves steal at the top; the capacity is the total number of
+// tasks, so it never grows.
+typedef struct {
+    long top __attribute__((aligned(64)));
+    long bottom __attribute__((aligned(64)));
+    int *items;
+    long mask;
+} ws_deque;
+
+struct file_batch;
+
+typedef struct {
+    int id;
+    struct file_batch *batch;
+    ws_deque deque;
+    keyed_ctx kcs[NUM_ALGOS + 1];  // Poolable algorithms, keyed once per worker
+    unsigned char *ct, *pt;        // Scratch buffers, grown on demand
+    size_t scratch_len;
+    unsigned long tasks_run, steals;
+    unsigned int rng;
+    pthread_t thread;
+} batch_worker;
+
+typedef struct file_batch {
+    batch_file *files;
+    int num_files;
+    batch_job *jobs;
+    int num_jobs;
+    batch_task *tasks;
+    int num_tasks;
+    batch_worker workers[FILEBATCH_MAX_WORKERS];
+    int num_workers;
+    int remaining;  // Tasks not yet completed
+    ctx_pool pool;  // Fetched ciphers and HMAC, shared read-only
+    unsigned char enc_keys[NUM_ALGOS + 1][KEY_SIZE];
+    unsigned char mac_keys[NUM_ALGOS + 1][HMAC_KEY_SIZE];
+    struct timespec start;
+} file_batch;
+
+static int deque_init(ws_deque *d, int capacity) {
+    long size = 1;
+
+    while (size < capacity) size <<= 1;
+    d->top = d->bottom = 0;
+    d->mask = size - 1;
+    d->items = (int *)malloc(size * sizeof(int));
+    return d->items != NULL;
+}
+
+static void deque_push(ws_deque *d, int item) {
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&d->items[b & d->mask], item, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+}
+
+static int deque_take(ws_deque *d, int *item) {
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    long t;
+    int got = 1;
+
+    __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+    if (t > b) {
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    *item = __atomic_load_n(&d->items[b & d->mask], __ATOMIC_RELAXED);
+    if (t == b) {
+        // Last item: race the thieves for it
+        got = __atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return got;
+}
+
+// 1 = stolen, 0 = empty, -1 = lost a race (worth retrying)
+static int deque_steal(ws_deque *d, int *item) {
+    long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    long b;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b) return 0;
+    *item = __atomic_load_n(&d->items[t & d->mask], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) return -1;
+    return 1;
+}
+
+static int steal_any(batch_worker *w, int *item) {
+    file_batch *b = w->batch;
+
+    for (int attempt = 0; attempt < 2 * b->num_workers; attempt++) {
+        int victim;
+
+        w->rng = w->rng * 1103515245u + 12345u;
+        victim = (int)((w->rng >> 16) % (unsigned)b->num_workers);
+        if (victim == w->id) continue;
+        if (deque_steal(&b->workers[victim].deque, item) == 1) {
+            w->steals++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static long long batch_now_ns(file_batch *b) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return elapsed_ns(&b->start, &now);
+}
+
+static int grow_scratch(batch_worker *w, size_t len) {
+    unsigned char *ct, *pt;
+
+    if (len <= w->scratch_len) return 0;
+    ct = (unsigned char *)realloc(w->ct, len);
+    if (ct) w->ct = ct;
+    pt = (unsigned char *)realloc(w->pt, len);
+    if (pt) w->pt = pt;
+    if (!ct || !pt) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+    w->scratch_len = len;
+    return 0;
+}
+
+// Encrypt and decrypt back a whole file with the one-shot (or pooled) path
+static void run_whole(batch_worker *w, batch_job *job) {
+    file_batch *b = w->batch;
+    mapped_file *mf = &b->files[job->file].mf;
+    static unsigned char empty[1];
+    unsigned char *data = mf->data ? mf->data : empty;
+    int pooled = algo_has(job->algo_type, ALGO_CAP_POOLABLE);
+    int len = (int)mf->len, ct_len, pt_len;
+    struct timespec t0, t1, t2;
+
+    if (grow_scratch(w, mf->len + EVP_MAX_BLOCK_LENGTH) != 0) {
+        job->failed = 1;
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (pooled) {
+        ct_len = pooled_encrypt(&w->kcs[job->algo_type], data, len, job->iv, w->ct, job->tag);
+    } else {
+        ct_len = algo_encrypt(job->algo_type, data, len, b->enc_keys[job->algo_type],
+                              b->mac_keys[job->algo_type], job->iv, w->ct, job->tag);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (pooled) {
+        pt_len = pooled_decrypt(&w->kcs[job->algo_type], w->ct, ct_len, job->iv, job->tag, w->pt);
+    } else {
+        pt_len = algo_decrypt(job->algo_type, w->ct, ct_len, b->enc_keys[job->algo_type],
+                              b->mac_keys[job->algo_type], job->iv, job->tag, w->pt);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    job->failed = (pt_len != len || memcmp(w->pt, data, len) != 0);
+    job->enc_ns = elapsed_ns(&t0, &t1);
+    job->dec_ns = elapsed_ns(&t1, &t2);
+    job->done_ns = batch_now_ns(b);
+    metrics_count(len, job->enc_ns);
+    metrics_count(len, job->dec_ns);
+}
+
+// One chunk of a split seekable job: keystream at the chunk offset, tree MAC
+// leaves into the job's array, then verify the leaves and decrypt back
+static void run_chunk(batch_worker *w, batch_job *job, batch_task *task) {
+    file_batch *b = w->batch;
+    mapped_file *mf = &b->files[job->file].mf;
+    keyed_ctx *kc = &w->kcs[job->algo_type];
+    size_t start = task->first_leaf * PARALLEL_MAC_LEAF;
+    size_t end = task->last_leaf * PARALLEL_MAC_LEAF;
+    unsigned char chunk_iv[IV_SIZE];
+    struct timespec t0, t1, t2;
+    int len, failed = 0;
+
+    if (end > mf->len) end = mf->len;
+    if (grow_scratch(w, CHUNK_BYTES) != 0) {
+        __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+    } else {
+        keystream_iv_at(job->algo_type, job->iv, start, chunk_iv);
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (1 != EVP_EncryptInit_ex(kc->enc_ctx, NULL, NULL, NULL, chunk_iv)) handle_crypto_error();
+        for (size_t leaf = task->first_leaf; leaf < task->last_leaf; leaf++) {
+            size_t off = leaf * PARALLEL_MAC_LEAF;
+            size_t n = (end - off < PARALLEL_MAC_LEAF) ? end - off : PARALLEL_MAC_LEAF;
+            unsigned char *ct = w->ct + (off - start);
+
+            if (1 != EVP_EncryptUpdate(kc->enc_ctx, ct, &len, mf->data + off, (int)n)) handle_crypto_error();
+            parallel_leaf_tag(kc->mac_ctx, leaf, ct, n, job->leaf_tags + leaf * HMAC_TAG_SIZE);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        // Encrypt-then-MAC: the leaves are checked before anything is decrypted
+        for (size_t leaf = task->first_leaf; leaf < task->last_leaf; leaf++) {
+            size_t off = leaf * PARALLEL_MAC_LEAF;
+            size_t n = (end - off < PARALLEL_MAC_LEAF) ? end - off : PARALLEL_MAC_LEAF;
+            unsigned char *check = job->check_tags + leaf * HMAC_TAG_SIZE;
+
+            parallel_leaf_tag(kc->mac_ctx, leaf, w->ct + (off - start), n, check);
+            failed |= !tag_equal(check, job->leaf_tags + leaf * HMAC_TAG_SIZE, HMAC_TAG_SIZE);
+        }
+        if (1 != EVP_DecryptInit_ex(kc->dec_ctx, NULL, NULL, NULL, chunk_iv)) handle_crypto_error();
+        if (1 != EVP_DecryptUpdate(kc->dec_ctx, w->pt, &len, w->ct, (int)(end - start))) handle_crypto_error();
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        metrics_count(end - start, elapsed_ns(&t0, &t1));
+        metrics_count(end - start, elapsed_ns(&t1, &t2));
+
+        failed |= (memcmp(w->pt, mf->data + start, end - start) != 0);
+        if (failed) __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&job->enc_ns, elapsed_ns(&t0, &t1), __ATOMIC_RELAXED);
+        __atomic_fetch_add(&job->dec_ns, elapsed_ns(&t1, &t2), __ATOMIC_RELAXED);
+    }
+
+    // The last chunk to finish closes the tree, and checks the root over the
+    // recomputed leaves against it
+    if (__atomic_sub_fetch(&job->chunks_left, 1, __ATOMIC_ACQ_REL) == 0) {
+        unsigned char root[HMAC_TAG_SIZE];
+
+        parallel_root_tag(b->mac_keys[job->algo_type], job->leaf_tags, job->n_leaves, mf->len, job->tag);
+        parallel_root_tag(b->mac_keys[job->algo_type], job->check_tags, job->n_leaves, mf->len, root);
+        if (!tag_equal(root, job->tag, HMAC_TAG_SIZE)) __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+        job->done_ns = batch_now_ns(b);
+    }
+}
+
+static void run_task(batch_worker *w, int id) {
+    file_batch *b = w->batch;
+    batch_task *task = &b->tasks[id];
+    batch_job *job = &b->jobs[task->job];
+
+    switch (task->kind) {
+        case TASK_WHOLE:
+            run_whole(w, job);
+            break;
+        case TASK_SPLIT:
+            // Last chunk on top, so this worker starts from the first one
+            // while thieves take the tail
+            for (int c = job->num_chunks - 1; c >= 0; c--) deque_push(&w->deque, job->first_chunk + c);
+            break;
+        default:
+            run_chunk(w, job, task);
+            break;
+    }
+    w->tasks_run++;
+}
+
+static void *worker_main(void *arg) {
+    batch_worker *w = (batch_worker *)arg;
+    file_batch *b = w->batch;
+
+    for (;;) {
+        int id;
+
+        if (deque_take(&w->deque, &id) || steal_any(w, &id)) {
+            run_task(w, id);
+            __atomic_sub_fetch(&b->remaining, 1, __ATOMIC_ACQ_REL);
+            continue;
+        }
+        if (__atomic_load_n(&b->remaining, __ATOMIC_ACQUIRE) == 0) break;
+        sched_yield();
+    }
+    return NULL;
+}
+
+// Descending file size, then job order (qsort is not stable)
+static const file_batch *sort_batch;
+
+static int cmp_job_size(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    size_t lx = sort_batch->files[sort_batch->jobs[x].file].mf.len;
+    size_t ly = sort_batch->files[sort_batch->jobs[y].file].mf.len;
+
+    if (lx != ly) return lx < ly ? 1 : -1;
+    return (x > y) - (x < y);
+}
+
+static int cmp_paths(const void *a, const void *b) {
+    return strcmp(((const batch_file *)a)->path, ((const batch_file *)b)->path);
+}
+
+static int add_file(file_batch *b, int capacity, const char *path) {
+    if (b->num_files == capacity) {
+        fprintf(stderr, "At most %d files per batch\n", FILEBATCH_MAX_FILES);
+        return -1;
+    }
+    snprintf(b->files[b->num_files++].path, PATH_MAX, "%s", path);
+    return 0;
+}
+
+// Regular files of a directory, or the paths listed in a file
+static int collect_files(file_batch *b, const char *path) {
+    struct stat st;
+
+    b->files = (batch_file *)calloc(FILEBATCH_MAX_FILES, sizeof(batch_file));
+    if (!b->files) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+    if (stat(path, &st) != 0) {
+        perror("Cannot access batch path");
+        return -1;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR *dir = opendir(path);
+        struct dirent *entry;
+
+        if (!dir) {
+            perror("Cannot open directory");
+            return -1;
+        }
+        while ((entry = readdir(dir)) != NULL) {
+            char full[PATH_MAX];
+            struct stat fst;
+
+            if (entry->d_name[0] == '.') continue;
+            snprintf(full, sizeof(full), "%s/%s", path, entry->d_name);
+            if (stat(full, &fst) != 0 || !S_ISREG(fst.st_mode)) continue;
+            if (add_file(b, FILEBATCH_MAX_FILES, full) != 0) {
+                closedir(dir);
+                return -1;
+            }
+        }
+        closedir(dir);
+        qsort(b->files, b->num_files, sizeof(batch_file), cmp_paths);
+    } else {
+        FILE *list = fopen(path, "r");
+        char line[PATH_MAX];
+
+        if (!list) {
+            perror("Cannot open file list");
+            return -1;
+        }
+        while (fgets(line, sizeof(line), list)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] == '\0' || line[0] == '#') continue;
+            if (add_file(b, FILEBATCH_MAX_FILES, line) != 0) {
+                fclose(list);
+                return -1;
+            }
+        }
+        fclose(list);
+    }
+
+    if (b->num_files == 0) {
+        fprintf(stderr, "No files to process in %s\n", path);
+        return -1;
+    }
+    for (int f = 0; f < b->num_files; f++) {
+        if (map_input_file(b->files[f].path, &b->files[f].mf) != 0) {
+            fprintf(stderr, "Failed to load %s\n", b->files[f].path);
+            return -1;
+        }
+        if (b->files[f].mf.len > INT32_MAX - EVP_MAX_BLOCK_LENGTH) {
+            fprintf(stderr, "%s: files over 2 GB are not supported\n", b->files[f].path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// One job per (file, available algorithm); split jobs get their chunk tasks
+// right after all the top-level tasks
+static int plan_batch(file_batch *b) {
+    int num_algos = 0, num_chunks = 0, next_chunk;
+
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) num_algos += algo_available(algo_type);
+    b->num_jobs = b->num_files * num_algos;
+    b->jobs = (batch_job *)calloc(b->num_jobs, sizeof(batch_job));
+    if (!b->jobs) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+
+    for (int f = 0, j = 0; f < b->num_files; f++) {
+        size_t len = b->files[f].mf.len;
+
+        for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+            batch_job *job = &b->jobs[j];
+
+            if (!algo_available(algo_type)) continue;
+            job->file = f;
+            job->algo_type = algo_type;
+            rand_pool_bytes(job->iv, algo_iv_len(algo_type));
+            if (algo_has(algo_type, ALGO_CAP_SEEKABLE | ALGO_CAP_POOLABLE) && len > CHUNK_BYTES) {
+                job->n_leaves = (len + PARALLEL_MAC_LEAF - 1) / PARALLEL_MAC_LEAF;
+                job->num_chunks = (int)((job->n_leaves + FILEBATCH_CHUNK_LEAVES - 1) / FILEBATCH_CHUNK_LEAVES);
+                job->chunks_left = job->num_chunks;
+                job->leaf_tags = (unsigned char *)malloc(2 * job->n_leaves * HMAC_TAG_SIZE);
+                if (!job->leaf_tags) {
+                    perror("Memory allocation failed");
+                    return -1;
+                }
+                job->check_tags = job->leaf_tags + job->n_leaves * HMAC_TAG_SIZE;
+                num_chunks += job->num_chunks;
+            }
+            j++;
+        }
+    }
+
+    b->num_tasks = b->num_jobs + num_chunks;
+    b->tasks = (batch_task *)calloc(b->num_tasks, sizeof(batch_task));
+    if (!b->tasks) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+    next_chunk = b->num_jobs;
+    for (int j = 0; j < b->num_jobs; j++) {
+        batch_job *job = &b->jobs[j];
+
+        b->tasks[j].job = j;
+        b->tasks[j].kind = job->num_chunks ? TASK_SPLIT : TASK_WHOLE;
+        job->first_chunk = next_chunk;
+        for (int c = 0; c < job->num_chunks; c++) {
+            batch_task *task = &b->tasks[next_chunk++];
+            task->kind = TASK_CHUNK;
+            task->job = j;
+            task->first_leaf = (size_t)c * FILEBATCH_CHUNK_LEAVES;
+            task->last_leaf = task->first_leaf + FILEBATCH_CHUNK_LEAVES;
+            if (task->last_leaf > job->n_leaves) task->last_leaf = job->n_leaves;
+        }
+    }
+    b->remaining = b->num_tasks;
+    return 0;
+}
+
+static void free_batch(file_batch *b) {
+    for (int w = 0; w < b->num_workers; w++) {
+        batch_worker *worker = &b->workers[w];
+        for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+            if (worker->kcs[algo_type].enc_ctx) keyed_ctx_release(&worker->kcs[algo_type]);
+        }
+        free(worker->deque.items);
+        free(worker->ct);
+        free(worker->pt);
+    }
+    if (b->jobs) {
+        for (int j = 0; j < b->num_jobs; j++) free(b->jobs[j].leaf_tags);
+    }
+    if (b->files) {
+        for (int f = 0; f < b->num_files; f++) unmap_file(&b->files[f].mf, 0);
+    }
+    ctx_pool_free(&b->pool);
+    OPENSSL_cleanse(b->enc_keys, sizeof(b->enc_keys));
+    OPENSSL_cleanse(b->mac_keys, sizeof(b->mac_keys));
+    free(b->tasks);
+    free(b->jobs);
+    free(b->files);
+    free(b);
+}
+
+int run_file_batch(const char *path, int num_workers, unsigned char *master_key) {
+    char results_filename[256], resolved[PATH_MAX];
+    const char *base_name;
+    FILE *results_file;
+    file_batch *b;
+    long long wall_ns, small_done_ns = 0;
+    unsigned long steals = 0;
+    size_t total_bytes = 0;
+    int failures = 0, started, *order;
+
+    if (num_workers < 1) num_workers = 1;
+    if (num_workers > FILEBATCH_MAX_WORKERS) num_workers = FILEBATCH_MAX_WORKERS;
+    if (!(b = (file_batch *)calloc(1, sizeof(*b)))) {
+        perror("Memory allocation failed");
+        return 1;
+    }
+    if (!ctx_pool_init(&b->pool) || collect_files(b, path) != 0 || plan_batch(b) != 0) {
+        free_batch(b);
+        return 1;
+    }
+
+    // results_files_<directory or list name>.csv
+    base_name = realpath(path, resolved) ? resolved : path;
+    base_name = strrchr(base_name, '/') ? strrchr(base_name, '/') + 1 : base_name;
+    results_file = open_results_file("files_", base_name,
+                                     "File,Bytes,Algorithm,Tasks,Encrypt_us,Decrypt_us,Enc_MB_per_s,Completed_at_us,Verified",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) {
+        free_batch(b);
+        return 1;
+    }
+
+    for (int f = 0; f < b->num_files; f++) total_bytes += b->files[f].mf.len;
+    printf("\n=================================================================\n");
+    printf("  Many-file batch: %d files (%.2f MB), %d jobs, %d tasks, %d workers\n", b->num_files,
+           total_bytes / (1024.0 * 1024.0), b->num_jobs, b->num_tasks, num_workers);
+    printf("=================================================================\n");
+
+    // Keys once per algorithm, contexts once per worker
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        if (!algo_available(algo_type)) continue;
+        derive_algo_keys(master_key, algo_name(algo_type), algo_type, b->enc_keys[algo_type], b->mac_keys[algo_type]);
+    }
+    b->num_workers = num_workers;
+    for (int w = 0; w < num_workers; w++) {
+        batch_worker *worker = &b->workers[w];
+
+        worker->id = w;
+        worker->batch = b;
+        worker->rng = 0x9e3779b9u * (w + 1);
+        if (!deque_init(&worker->deque, b->num_tasks)) {
+            perror("Memory allocation failed");
+            fclose(results_file);
+            free_batch(b);
+            return 1;
+        }
+        for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+            if (!algo_has(algo_type, ALGO_CAP_POOLABLE)) continue;
+            keyed_ctx_setup(&b->pool, &worker->kcs[algo_type], algo_type,
+                            b->enc_keys[algo_type], b->mac_keys[algo_type]);
+        }
+    }
+    // Deal the top-level tasks round robin, largest files first: owners take
+    // from the bottom (the small files), thieves from the top (the big ones)
+    order = (int *)malloc(b->num_jobs * sizeof(int));
+    if (!order) {
+        perror("Memory allocation failed");
+        fclose(results_file);
+        free_batch(b);
+        return 1;
+    }
+    for (int j = 0; j < b->num_jobs; j++) order[j] = j;
+    sort_batch = b;
+    qsort(order, b->num_jobs, sizeof(int), cmp_job_size);
+    for (int j = 0; j < b->num_jobs; j++) deque_push(&b->workers[j % num_workers].deque, order[j]);
+    free(order);
+
+    clock_gettime(CLOCK_MONOTONIC, &b->start);
+    // The deques of workers that fail to start stay victims: the running
+    // workers steal their tasks, so the batch still completes
+    for (started = 1; started < num_workers; started++) {
+        if ((errno = pthread_create(&b->workers[started].thread, NULL, worker_main, &b->workers[started])) != 0) {
+            perror("Cannot create worker thread");
+            fprintf(stderr, "Continuing with %d of %d workers\n", started, num_workers);
+            break;
+        }
+    }
+    worker_main(&b->workers[0]);  // Worker 0 is the caller itself
+    for (int w = 1; w < started; w++) pthread_join(b->workers[w].thread, NULL);
+    wall_ns = batch_now_ns(b);
+
+    printf("\n  %-28s %8s %12s %14s %14s %10s\n", "Algorithm", "Files", "MB", "Encrypt (ms)", "Decrypt (ms)", "Enc MB/s");
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        long long enc_ns = 0, dec_ns = 0;
+        size_t bytes = 0;
+        int files = 0;
+
+        for (int j = 0; j < b->num_jobs; j++) {
+            batch_job *job = &b->jobs[j];
+            if (job->algo_type != algo_type) continue;
+            enc_ns += job->enc_ns;
+            dec_ns += job->dec_ns;
+            bytes += b->files[job->file].mf.len;
+            files++;
+        }
+        if (files == 0) continue;
+        printf("  %-28s %8d %12.2f %14.2f %14.2f %10.1f\n", algo_name(algo_type), files,
+               bytes / (1024.0 * 1024.0), enc_ns / 1e6, dec_ns / 1e6,
+               enc_ns > 0 ? bytes / (enc_ns / 1e9) / (1024.0 * 1024.0) : 0.0);
+    }
+
+    for (int j = 0; j < b->num_jobs; j++) {
+        batch_job *job = &b->jobs[j];
+        size_t len = b->files[job->file].mf.len;
+
+        if (job->failed) {
+            printf("  %s / %s: Verification FAILED!\n", b->files[job->file].path, algo_name(job->algo_type));
+            failures++;
+        }
+        if (len < CHUNK_BYTES && job->done_ns > small_done_ns) small_done_ns = job->done_ns;
+        fprintf(results_file, "%s,%zu,%s,%d,%.2f,%.2f,%.1f,%.2f,%s\n", b->files[job->file].path, len,
+                algo_name(job->algo_type), job->num_chunks ? job->num_chunks : 1, job->enc_ns / 1e3,
+                job->dec_ns / 1e3, job->enc_ns > 0 ? len / (job->enc_ns / 1e3) : 0.0,
+                job->done_ns / 1e3, job->failed ? "FAILED" : "OK");
+    }
+    for (int w = 0; w < num_workers; w++) steals += b->workers[w].steals;
+
+    printf("\n  Wall time %.2f ms: %.1f MB/s of encrypt+decrypt round trips over all jobs\n",
+           wall_ns / 1e6, total_bytes * (double)b->num_jobs / b->num_files / (1024.0 * 1024.0) / (wall_ns / 1e9));
+    printf("  Files under %zu MB all done after %.2f ms; %lu steals\n", CHUNK_BYTES >> 20,
+           small_done_ns / 1e6, steals);
+    printf("  Per worker tasks:");
+    for (int w = 0; w < num_workers; w++) printf(" %lu", b->workers[w].tasks_run);
+    printf("\n");
+    if (failures == 0) printf("\n✓ All %d jobs verified\n", b->num_jobs);
+    printf("✓ Results saved to %s\n\n", results_filename);
+
+    fclose(results_file);
+    free_batch(b);
+    return failures ? 1 : 0;
+}
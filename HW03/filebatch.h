@@ -0,0 +1,30 @@
+#ifndef HW03_FILEBATCH_H
+#define HW03_FILEBATCH_H
+
+#define FILEBATCH_MAX_FILES 4096
+#define FILEBATCH_MAX_WORKERS 64
+#define FILEBATCH_CHUNK_LEAVES 4  // Tree MAC leaves per chunk task (4 MB)
+
+// Many-file mode: every file of a directory (regular files, non-recursive,
+// dot files skipped) or of a list file (one path per line, '#' comments) is
+// encrypted and decrypted back with every available algorithm in a single
+// process, on a pool of work-stealing threads.
+//
+// One task per (file, algorithm) is dealt round robin onto the workers'
+// deques. A worker pops its own deque LIFO and, when it runs dry, steals
+// FIFO from a random victim (Chase-Lev deques, no locks). For the seekable
+// Encrypt-then-MAC modes a file larger than one chunk is not processed
+// whole: its task splits into chunk tasks of FILEBATCH_CHUNK_LEAVES tree MAC
+// leaves (parallel.h format) pushed onto the local deque, where idle workers
+// steal them, so a 100 MB file does not hold one worker while the small
+// files queue behind it.
+//
+// Keys are derived once per algorithm. The ciphers and HMAC are fetched once
+// into a shared ctx_pool; every worker keys its own contexts from it once
+// and only resets the IV per file.
+//
+// Writes one row per (file, algorithm) to results_files_<list>.csv, with
+// the completion time since the start of the batch.
+int run_file_batch(const char *path, int num_workers, unsigned char *master_key);
+
+#endif
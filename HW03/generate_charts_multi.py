@@ -43,6 +43,30 @@ def read_all_results():
     
     return results
 
+def read_thread_results():
+    """Read all results_threads_*.csv files written by ./HW03 --threads"""
+    results = {}
+    
+    for csv_file in sorted(glob.glob("results_threads_testfile_*.csv")):
+        size_str = csv_file.replace("results_threads_testfile_", "").replace(".csv", "")
+        per_algo = {}
+        
+        try:
+            with open(csv_file, 'r') as f:
+                reader = csv.DictReader(f)
+                for row in reader:
+                    entry = per_algo.setdefault(row['Algorithm'], {'threads': [], 'encryption': [], 'decryption': []})
+                    entry['threads'].append(int(row['Threads']))
+                    entry['encryption'].append(float(row['Avg_Encryption_us']))
+                    entry['decryption'].append(float(row['Avg_Decryption_us']))
+            
+            results[size_str] = per_algo
+            print(f"✓ Loaded: {csv_file} ({size_str})")
+        except Exception as e:
+            print(f"✗ Error reading {csv_file}: {e}")
+    
+    return results
+
 def extract_size_mb(size_str):
     """Extract numeric size in MB from size string"""
     return int(size_str.replace("MB.bin", ""))
@@ -58,8 +82,8 @@ def create_scaling_chart(results):
     
     # Extract data for each algorithm
     algorithms = results[sorted_sizes[0]]['algorithms']
-    colors = ['#e67e22', '#3498db', '#2ecc71', '#9b59b6']
-    markers = ['o', 's', '^', 'D']
+    colors = ['#e67e22', '#3498db', '#2ecc71', '#9b59b6', '#e74c3c', '#1abc9c', '#f1c40f', '#34495e']
+    markers = ['o', 's', '^', 'D', 'v', 'P', 'X', '*']
     
     file_sizes_mb = [extract_size_mb(s) for s in sorted_sizes]
     
@@ -70,8 +94,8 @@ def create_scaling_chart(results):
             idx = results[size]['algorithms'].index(algo)
             enc_times.append(results[size]['encryption'][idx] / 1000.0)  # Convert to ms
         
-        ax1.plot(file_sizes_mb, enc_times, marker=markers[i], linewidth=2, 
-                markersize=8, label=algo, color=colors[i])
+        ax1.plot(file_sizes_mb, enc_times, marker=markers[i % len(markers)], linewidth=2, 
+                markersize=8, label=algo, color=colors[i % len(colors)])
     
     ax1.set_xlabel('File Size (MB)', fontsize=13, fontweight='bold')
     ax1.set_ylabel('Encryption Time (milliseconds)', fontsize=13, fontweight='bold')
@@ -89,8 +113,8 @@ def create_scaling_chart(results):
             idx = results[size]['algorithms'].index(algo)
             dec_times.append(results[size]['decryption'][idx] / 1000.0)  # Convert to ms
         
-        ax2.plot(file_sizes_mb, dec_times, marker=markers[i], linewidth=2,
-                markersize=8, label=algo, color=colors[i])
+        ax2.plot(file_sizes_mb, dec_times, marker=markers[i % len(markers)], linewidth=2,
+                markersize=8, label=algo, color=colors[i % len(colors)])
     
     ax2.set_xlabel('File Size (MB)', fontsize=13, fontweight='bold')
     ax2.set_ylabel('Decryption Time (milliseconds)', fontsize=13, fontweight='bold')
@@ -118,8 +142,8 @@ def create_throughput_chart(results):
     algorithms = results[sorted_sizes[0]]['algorithms']
     
     x = np.arange(len(sorted_sizes))
-    width = 0.2
-    colors = ['#e67e22', '#3498db', '#2ecc71', '#9b59b6']
+    width = 0.8 / len(algorithms)  # One group of bars per file size
+    colors = ['#e67e22', '#3498db', '#2ecc71', '#9b59b6', '#e74c3c', '#1abc9c', '#f1c40f', '#34495e']
     
     for i, algo in enumerate(algorithms):
         throughputs = []
@@ -132,7 +156,7 @@ def create_throughput_chart(results):
         
         offset = (i - len(algorithms)/2 + 0.5) * width
         bars = ax.bar(x + offset, throughputs, width, label=algo, 
-                     color=colors[i], alpha=0.85, edgecolor='black', linewidth=1.2)
+                     color=colors[i % len(colors)], alpha=0.85, edgecolor='black', linewidth=1.2)
         
         # Add value labels
         for bar in bars:
@@ -227,6 +251,45 @@ def create_comparison_heatmap(results):
     print(f"✓ Generated: {filename}")
     plt.close()
 
+def create_thread_scaling_chart(thread_results):
+    """Create chart showing throughput scaling by thread count"""
+    plt.style.use('seaborn-v0_8-darkgrid')
+    
+    fig, (ax1, ax2) = plt.subplots(1, 2, figsize=(16, 6))
+    colors = ['#e67e22', '#3498db', '#2ecc71', '#9b59b6', '#e74c3c']
+    markers = ['o', 's', '^', 'D', 'v']
+    linestyles = {0: '-', 1: '--'}
+    
+    sorted_sizes = sorted(thread_results.keys(), key=extract_size_mb)
+    
+    for i, size in enumerate(sorted_sizes):
+        size_mb = extract_size_mb(size)
+        for j, (algo, data) in enumerate(sorted(thread_results[size].items())):
+            threads = data['threads']
+            enc_tp = [size_mb / (t / 1000000.0) for t in data['encryption']]  # MB/s
+            dec_tp = [size_mb / (t / 1000000.0) for t in data['decryption']]
+            label = f"{algo} ({size_mb} MB)"
+            style = dict(marker=markers[i % len(markers)], linewidth=2, markersize=8,
+                         color=colors[i % len(colors)], linestyle=linestyles.get(j, ':'), label=label)
+            ax1.plot(threads, enc_tp, **style)
+            ax2.plot(threads, dec_tp, **style)
+    
+    for ax, title in ((ax1, 'Encryption'), (ax2, 'Decryption')):
+        ax.set_xlabel('Threads', fontsize=13, fontweight='bold')
+        ax.set_ylabel('Throughput (MB/s)', fontsize=13, fontweight='bold')
+        ax.set_title(f'{title} Throughput Scaling by Core Count', fontsize=15, fontweight='bold', pad=20)
+        ax.set_xscale('log', base=2)
+        ax.legend(fontsize=9, loc='upper left')
+        ax.grid(True, alpha=0.3, linestyle='--')
+        ax.set_facecolor('#f8f9fa')
+    
+    fig.patch.set_facecolor('white')
+    plt.tight_layout()
+    filename = 'thread_scaling.png'
+    plt.savefig(filename, dpi=300, bbox_inches='tight')
+    print(f"✓ Generated: {filename}")
+    plt.close()
+
 def main():
     print("="*70)
     print("  Generating Multi-Size Performance Charts")
@@ -253,6 +316,10 @@ def main():
     create_throughput_chart(results)
     create_comparison_heatmap(results)
     
+    thread_results = read_thread_results()
+    if thread_results:
+        create_thread_scaling_chart(thread_results)
+    
     print("\n" + "="*70)
     print("All charts generated successfully!")
     print("="*70)
@@ -260,6 +327,8 @@ def main():
     print("  1. performance_scaling.png - Performance vs file size (log-log)")
     print("  2. throughput_scaling.png - Throughput comparison")
     print("  3. performance_heatmap.png - Performance heatmaps")
+    if thread_results:
+        print("  4. thread_scaling.png - Throughput vs thread count (./HW03 --threads)")
     print("\nYou can now include these charts in your LaTeX document!")
 
 if __name__ == '__main__':
@@ -1,71 +1,306 @@
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #define BYTES_PER_MB (1024 * 1024)
+#define GEN_BLOCK_SIZE (4 * BYTES_PER_MB)  // Bytes per pwrite, 4K aligned
+#define GEN_MAX_THREADS 64
+#define GEN_MAX_SIZES 16
 
-void generate_file(const char *filename, int size_mb) {
-    FILE *fp;
-    unsigned char *buffer;
-    size_t total_bytes = size_mb * BYTES_PER_MB;
-    size_t chunk_size = BYTES_PER_MB; // Write 1MB at a time
-    
-    printf("Generating %s (%d MB)...\n", filename, size_mb);
-    printf("Generating %s (%d MB)...\n", filename, size_mb);
-    
-    fp = fopen(filename, "wb");
-    if (fp == NULL) {
-        perror("Error opening file");
-        return;
+// Data patterns:
+//   random  AES-128-CTR keystream keyed by the seed (incompressible)
+//   zeros   all zero bytes
+//   text    keystream mapped onto letters, spaces and newlines with roughly
+//           English letter frequencies (compressible like real text)
+enum { PATTERN_RANDOM, PATTERN_ZEROS, PATTERN_TEXT };
+
+static const char *pattern_names[] = {"random", "zeros", "text"};
+
+// 64 symbols (plus the terminator), indexed by 6 keystream bits
+static const char text_alphabet[65] =
+    "eeeeeeetttttaaaaooooiiinnnnssshhhrrrddlllcuummwwffggyppbvk     \n";
+
+// Shared by the writer threads: block b covers [b * GEN_BLOCK_SIZE, ...)
+typedef struct {
+    int fd;
+    int pattern;
+    size_t total_bytes;
+    size_t num_blocks;
+    size_t next_block;  // Claimed with an atomic fetch-add
+    unsigned char key[16];
+    int failed;
+} gen_job;
+
+static void handle_crypto_error(void) {
+    fprintf(stderr, "OpenSSL error while generating keystream\n");
+    abort();
+}
+
+// The keystream of block b starts at CTR block offset / 16, so the output
+// depends on the seed only, never on the number of threads
+static void block_iv(size_t offset, unsigned char *iv) {
+    uint64_t counter = offset / 16;
+
+    memset(iv, 0, 16);
+    for (int i = 15; i >= 8; i--) {
+        iv[i] = (unsigned char)counter;
+        counter >>= 8;
     }
-    
-    buffer = (unsigned char *)malloc(chunk_size);
-    if (buffer == NULL) {
+}
+
+static void *gen_worker(void *arg) {
+    gen_job *job = (gen_job *)arg;
+    EVP_CIPHER_CTX *ctx = NULL;
+    unsigned char *buffer;
+    size_t b;
+
+    if (posix_memalign((void **)&buffer, 4096, GEN_BLOCK_SIZE) != 0) {
         perror("Memory allocation failed");
-        fclose(fp);
-        return;
-    }
-    
-    srand(time(NULL));
-    
-    for (size_t i = 0; i < total_bytes; i += chunk_size) {
-        size_t write_size = (i + chunk_size > total_bytes) ? (total_bytes - i) : chunk_size;
-        
-        // Fill buffer with random data
-        for (size_t j = 0; j < write_size; j++) {
-            buffer[j] = rand() % 256;
+        __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    if (job->pattern != PATTERN_ZEROS && !(ctx = EVP_CIPHER_CTX_new())) handle_crypto_error();
+
+    while ((b = __atomic_fetch_add(&job->next_block, 1, __ATOMIC_RELAXED)) < job->num_blocks &&
+           !__atomic_load_n(&job->failed, __ATOMIC_RELAXED)) {
+        size_t offset = b * GEN_BLOCK_SIZE;
+        size_t len = (job->total_bytes - offset < GEN_BLOCK_SIZE) ? job->total_bytes - offset : GEN_BLOCK_SIZE;
+        size_t done = 0;
+        int out_len;
+
+        // The keystream is the encryption of zeros, generated in place
+        memset(buffer, 0, len);
+        if (ctx) {
+            unsigned char iv[16];
+            block_iv(offset, iv);
+            if (1 != EVP_EncryptInit_ex(ctx, EVP_aes_128_ctr(), NULL, job->key, iv)) handle_crypto_error();
+            if (1 != EVP_EncryptUpdate(ctx, buffer, &out_len, buffer, (int)len)) handle_crypto_error();
+        }
+        if (job->pattern == PATTERN_TEXT) {
+            for (size_t i = 0; i < len; i++) buffer[i] = text_alphabet[buffer[i] & 63];
         }
-        
-        if (fwrite(buffer, 1, write_size, fp) != write_size) {
-            perror("Error writing to file");
-            free(buffer);
-            fclose(fp);
-            return;
+
+        while (done < len) {
+            ssize_t n = pwrite(job->fd, buffer + done, len - done, offset + done);
+            if (n <= 0) {
+                perror("Error writing to file");
+                __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+                break;
+            }
+            done += n;
         }
     }
-    
+
+    EVP_CIPHER_CTX_free(ctx);
     free(buffer);
-    fclose(fp);
-    
-    printf("✓ Successfully created %s (%d MB)\n", filename, size_mb);
+    return NULL;
+}
+
+int generate_file(const char *filename, size_t total_bytes, int pattern,
+                  const unsigned char *seed, int num_threads) {
+    pthread_t threads[GEN_MAX_THREADS];
+    int started[GEN_MAX_THREADS] = {0};
+    gen_job job;
+    struct timespec start, end;
+    double seconds;
+    unsigned int key_len;
+
+    printf("Generating %s (%.2f MB, %s, %d thread%s)...\n", filename,
+           total_bytes / (double)BYTES_PER_MB, pattern_names[pattern],
+           num_threads, num_threads == 1 ? "" : "s");
+
+    memset(&job, 0, sizeof(job));
+    job.pattern = pattern;
+    job.total_bytes = total_bytes;
+    job.num_blocks = (total_bytes + GEN_BLOCK_SIZE - 1) / GEN_BLOCK_SIZE;
+
+    // AES key = first 16 bytes of SHA-256(seed); the same seed reproduces the file
+    {
+        unsigned char digest[EVP_MAX_MD_SIZE];
+        if (1 != EVP_Digest(seed, 8, digest, &key_len, EVP_sha256(), NULL)) handle_crypto_error();
+        memcpy(job.key, digest, sizeof(job.key));
+    }
+
+    job.fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (job.fd < 0) {
+        perror("Error opening file");
+        return -1;
+    }
+    // Size the file up front so the threads can pwrite their blocks in any order
+    if (ftruncate(job.fd, (off_t)total_bytes) != 0) {
+        perror("Error sizing file");
+        close(job.fd);
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 1; t < num_threads; t++) {
+        started[t] = (pthread_create(&threads[t], NULL, gen_worker, &job) == 0);
+    }
+    gen_worker(&job);  // Thread 0 is the caller itself
+    for (int t = 1; t < num_threads; t++) {
+        if (started[t]) pthread_join(threads[t], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (close(job.fd) != 0) {
+        perror("Error closing file");
+        job.failed = 1;
+    }
+    if (job.failed) return -1;
+
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("✓ Successfully created %s in %.3f s (%.1f MB/s)\n", filename, seconds,
+           total_bytes / (double)BYTES_PER_MB / (seconds > 0 ? seconds : 1e-9));
+    return 0;
+}
+
+// Byte count with optional K/M/G suffix (e.g. "64K", "4G"), 0 if invalid
+static size_t parse_size(const char *arg) {
+    char *end;
+    unsigned long long value = strtoull(arg, &end, 10);
+
+    if (end == arg) return 0;
+    switch (toupper((unsigned char)*end)) {
+        case 'G': value *= 1024;  // fall through
+        case 'M': value *= 1024;  // fall through
+        case 'K': value *= 1024; end++; break;
+        case '\0': break;
+        default: return 0;
+    }
+    if (*end == 'B' || *end == 'b') end++;
+    return *end == '\0' ? (size_t)value : 0;
 }
 
-int main() {
+// "1MB", "2GB", "1536KB"... as in the default testfile_<size>.bin names
+static void size_label(size_t bytes, char *out, size_t out_len) {
+    if (bytes % ((size_t)1 << 30) == 0) snprintf(out, out_len, "%zuGB", bytes >> 30);
+    else if (bytes % BYTES_PER_MB == 0) snprintf(out, out_len, "%zuMB", bytes / BYTES_PER_MB);
+    else if (bytes % 1024 == 0) snprintf(out, out_len, "%zuKB", bytes / 1024);
+    else snprintf(out, out_len, "%zuB", bytes);
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options] [SIZE...]\n", prog);
+    printf("  SIZE                    File size(s), K/M/G suffixes allowed; each one is\n");
+    printf("                          written to testfile_<SIZE>.bin\n");
+    printf("                          (default 1M 5M 10M 50M 100M)\n");
+    printf("  -o, --output FILE       Output name (only with a single size)\n");
+    printf("  -p, --pattern NAME      random (default), zeros or text\n");
+    printf("  -S, --seed N            64-bit seed; the same seed gives the same file\n");
+    printf("                          (default: random, printed)\n");
+    printf("  -j, --threads N         Writer threads (default: online CPUs)\n");
+    printf("  -h, --help              Show this help\n");
+}
+
+int main(int argc, char *argv[]) {
+    size_t sizes[GEN_MAX_SIZES];
+    int num_sizes = 0;
+    const char *output = NULL;
+    int pattern = PATTERN_RANDOM;
+    unsigned long long seed;
+    int have_seed = 0;
+    long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned char seed_bytes[8];
+    int opt;
+
+    static struct option long_options[] = {
+        {"output",  required_argument, NULL, 'o'},
+        {"pattern", required_argument, NULL, 'p'},
+        {"seed",    required_argument, NULL, 'S'},
+        {"threads", required_argument, NULL, 'j'},
+        {"help",    no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    while ((opt = getopt_long(argc, argv, "o:p:S:j:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'o':
+                output = optarg;
+                break;
+            case 'p':
+                for (pattern = 0; pattern < 3 && strcmp(optarg, pattern_names[pattern]) != 0; pattern++);
+                if (pattern == 3) {
+                    fprintf(stderr, "Unknown pattern: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'S':
+                seed = strtoull(optarg, NULL, 0);
+                have_seed = 1;
+                break;
+            case 'j':
+                num_threads = atol(optarg);
+                if (num_threads < 1 || num_threads > GEN_MAX_THREADS) {
+                    fprintf(stderr, "Thread count must be between 1 and %d: %s\n", GEN_MAX_THREADS, optarg);
+                    return 1;
+                }
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > GEN_MAX_THREADS) num_threads = GEN_MAX_THREADS;
+
+    for (; optind < argc; optind++) {
+        if (num_sizes == GEN_MAX_SIZES) {
+            fprintf(stderr, "At most %d sizes per run\n", GEN_MAX_SIZES);
+            return 1;
+        }
+        if ((sizes[num_sizes++] = parse_size(argv[optind])) == 0) {
+            fprintf(stderr, "Invalid size: %s\n", argv[optind]);
+            return 1;
+        }
+    }
+    if (num_sizes == 0) {
+        // Files of increasing sizes: 1 MB, 5 MB, 10 MB, 50 MB, 100 MB
+        const size_t defaults[] = {1, 5, 10, 50, 100};
+        for (; num_sizes < 5; num_sizes++) sizes[num_sizes] = defaults[num_sizes] * BYTES_PER_MB;
+    }
+    if (output && num_sizes != 1) {
+        fprintf(stderr, "--output needs exactly one size\n");
+        return 1;
+    }
+
+    if (!have_seed) {
+        if (RAND_bytes((unsigned char *)&seed, sizeof(seed)) != 1) handle_crypto_error();
+    }
+    for (int i = 0; i < 8; i++) seed_bytes[i] = (unsigned char)(seed >> (8 * (7 - i)));
+
     printf("=================================================================\n");
     printf("  Generating Test Files with Multiple Sizes\n");
+    printf("  Pattern: %s, seed: 0x%016llx\n", pattern_names[pattern], seed);
     printf("=================================================================\n\n");
-    
-    // Generate files of increasing sizes: 1 MB, 5 MB, 10 MB, 50 MB, 100 MB
-    generate_file("testfile_1MB.bin", 1);
-    generate_file("testfile_5MB.bin", 5);
-    generate_file("testfile_10MB.bin", 10);
-    generate_file("testfile_50MB.bin", 50);
-    generate_file("testfile_100MB.bin", 100);
-    
+
+    for (int i = 0; i < num_sizes; i++) {
+        char name[64], label[32];
+
+        if (!output) {
+            size_label(sizes[i], label, sizeof(label));
+            snprintf(name, sizeof(name), "testfile_%s.bin", label);
+        }
+        if (generate_file(output ? output : name, sizes[i], pattern, seed_bytes, (int)num_threads) != 0) {
+            return 1;
+        }
+    }
+
     printf("\n=================================================================\n");
     printf("  All test files generated successfully!\n");
     printf("=================================================================\n");
-    
+
     return 0;
 }
@@ -0,0 +1,200 @@
+// The SHA256_* low-level functions are deprecated in OpenSSL 3 but are the
+// only SHA-256 state that can be copied without an allocation
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include "kernels.h"
+#include "tagcmp.h"
+
+extern "C" {
+#include "ciphers.h"
+}
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct kernel {
+    int (*encrypt)(kernel *k, const unsigned char *in, int len, const unsigned char *iv,
+                   unsigned char *out, unsigned char *tag);
+    int (*decrypt)(kernel *k, const unsigned char *in, int len, const unsigned char *iv,
+                   const unsigned char *tag, unsigned char *out);
+    EVP_CIPHER_CTX *enc_ctx;
+    EVP_CIPHER_CTX *dec_ctx;
+    SHA256_CTX inner;  // SHA-256 state after (K ^ ipad), Encrypt-then-MAC only
+    SHA256_CTX outer;  // SHA-256 state after (K ^ opad)
+};
+
+// Traits of each kernel, checked against the registry entry in kernel_new
+template <int KeyLen, int IvLen, bool Etm>
+struct kernel_traits {
+    static constexpr int key_len = KeyLen;
+    static constexpr int mac_key_len = Etm ? HMAC_KEY_SIZE : 0;
+    static constexpr int iv_len = IvLen;
+    static constexpr int tag_len = Etm ? HMAC_TAG_SIZE : AEAD_TAG_SIZE;
+    static constexpr bool etm = Etm;
+};
+
+template <int Algo> struct algo_traits;
+template <> struct algo_traits<1> : kernel_traits<AES_KEY_SIZE, IV_SIZE, true> {};     // AES-128-CTR + HMAC
+template <> struct algo_traits<2> : kernel_traits<KEY_SIZE, IV_SIZE, true> {};         // ChaCha20 + HMAC
+template <> struct algo_traits<3> : kernel_traits<AES_KEY_SIZE, IV_SIZE, false> {};    // AES-128-GCM
+template <> struct algo_traits<4> : kernel_traits<KEY_SIZE, NONCE_SIZE, false> {};     // ChaCha20-Poly1305
+template <> struct algo_traits<5> : kernel_traits<KEY_SIZE, NONCE_SIZE, false> {};     // AES-256-GCM
+template <> struct algo_traits<6> : kernel_traits<AES_KEY_SIZE, NONCE_SIZE, false> {}; // AES-128-GCM-SIV
+template <> struct algo_traits<7> : kernel_traits<AES_KEY_SIZE, NONCE_SIZE, false> {}; // AES-128-OCB
+
+static_assert(SHA256_DIGEST_LENGTH == HMAC_TAG_SIZE, "HMAC-SHA256 tag length");
+static_assert(HMAC_KEY_SIZE <= SHA256_CBLOCK, "HMAC key longer than a SHA-256 block");
+
+// Outer half of HMAC-SHA256: tag = H((K ^ opad) || inner digest)
+static inline void hmac_finish(const kernel *k, SHA256_CTX *sha, unsigned char *tag) {
+    unsigned char inner_digest[SHA256_DIGEST_LENGTH];
+
+    SHA256_Final(inner_digest, sha);
+    *sha = k->outer;
+    SHA256_Update(sha, inner_digest, sizeof(inner_digest));
+    SHA256_Final(tag, sha);
+    OPENSSL_cleanse(sha, sizeof(*sha));
+}
+
+template <class T>
+static int kernel_encrypt_impl(kernel *k, const unsigned char *in, int len, const unsigned char *iv,
+                               unsigned char *out, unsigned char *tag) {
+    EVP_CIPHER_CTX *ctx = k->enc_ctx;
+    int out_len, final_len;
+
+    if (1 != EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, iv)) handle_crypto_error();
+    if constexpr (T::etm) {
+        SHA256_CTX sha = k->inner;
+
+        for (int off = 0; off < len; off += KERNEL_BLOCK_SIZE) {
+            int n = len - off < KERNEL_BLOCK_SIZE ? len - off : KERNEL_BLOCK_SIZE;
+            if (1 != EVP_EncryptUpdate(ctx, out + off, &out_len, in + off, n)) handle_crypto_error();
+            SHA256_Update(&sha, out + off, n);
+        }
+        if (1 != EVP_EncryptFinal_ex(ctx, out + len, &final_len)) handle_crypto_error();
+        hmac_finish(k, &sha, tag);
+    } else {
+        if (1 != EVP_EncryptUpdate(ctx, out, &out_len, in, len)) handle_crypto_error();
+        if (1 != EVP_EncryptFinal_ex(ctx, out + out_len, &final_len)) handle_crypto_error();
+        if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, T::tag_len, tag)) handle_crypto_error();
+    }
+    return len;
+}
+
+template <class T>
+static int kernel_decrypt_impl(kernel *k, const unsigned char *in, int len, const unsigned char *iv,
+                               const unsigned char *tag, unsigned char *out) {
+    EVP_CIPHER_CTX *ctx = k->dec_ctx;
+    int out_len, final_len;
+
+    if (1 != EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, iv)) handle_crypto_error();
+    if constexpr (T::etm) {
+        unsigned char computed_tag[T::tag_len];
+        SHA256_CTX sha = k->inner;
+
+        // MAC and decrypt block by block; nothing is returned unless the tag matches
+        for (int off = 0; off < len; off += KERNEL_BLOCK_SIZE) {
+            int n = len - off < KERNEL_BLOCK_SIZE ? len - off : KERNEL_BLOCK_SIZE;
+            SHA256_Update(&sha, in + off, n);
+            if (1 != EVP_DecryptUpdate(ctx, out + off, &out_len, in + off, n)) handle_crypto_error();
+        }
+        if (1 != EVP_DecryptFinal_ex(ctx, out + len, &final_len)) handle_crypto_error();
+        hmac_finish(k, &sha, computed_tag);
+        if (!tag_equal(tag, computed_tag, T::tag_len)) {
+            OPENSSL_cleanse(out, len);
+            return -1;
+        }
+    } else {
+        if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, T::tag_len, (void *)tag)) handle_crypto_error();
+        if (1 != EVP_DecryptUpdate(ctx, out, &out_len, in, len)) handle_crypto_error();
+        if (EVP_DecryptFinal_ex(ctx, out + out_len, &final_len) <= 0) {
+            OPENSSL_cleanse(out, len);
+            return -1;
+        }
+    }
+    return len;
+}
+
+// Registry check and function pointers of the instance for Algo
+template <int Algo>
+static bool kernel_bind(kernel *k, const algo_desc *algo) {
+    typedef algo_traits<Algo> T;
+
+    if (algo->key_len != T::key_len || algo->mac_key_len != T::mac_key_len ||
+        algo->iv_len != T::iv_len || algo->tag_len != T::tag_len ||
+        ((algo->caps & ALGO_CAP_ETM) != 0) != T::etm) {
+        return false;
+    }
+    k->encrypt = kernel_encrypt_impl<T>;
+    k->decrypt = kernel_decrypt_impl<T>;
+    return true;
+}
+
+static bool kernel_select(kernel *k, int algo_type) {
+    const algo_desc *algo = algo_get(algo_type);
+
+    switch (algo_type) {
+        case 1: return kernel_bind<1>(k, algo);
+        case 2: return kernel_bind<2>(k, algo);
+        case 3: return kernel_bind<3>(k, algo);
+        case 4: return kernel_bind<4>(k, algo);
+        case 5: return kernel_bind<5>(k, algo);
+        case 6: return kernel_bind<6>(k, algo);
+        case 7: return kernel_bind<7>(k, algo);
+        default: return false;  // XChaCha20-Poly1305 is not poolable
+    }
+}
+
+extern "C" kernel *kernel_new(int algo_type, unsigned char *enc_key, unsigned char *mac_key) {
+    kernel *k;
+
+    if (!algo_has(algo_type, ALGO_CAP_POOLABLE)) return NULL;
+    k = static_cast<kernel *>(calloc(1, sizeof(kernel)));
+    if (!k) {
+        perror("Memory allocation failed");
+        return NULL;
+    }
+    if (!kernel_select(k, algo_type)) {
+        free(k);
+        return NULL;
+    }
+    k->enc_ctx = algo_cipher_ctx_new(algo_type, 1, enc_key, NULL);
+    k->dec_ctx = algo_cipher_ctx_new(algo_type, 0, enc_key, NULL);
+
+    if (algo_get(algo_type)->caps & ALGO_CAP_ETM) {
+        unsigned char pad[SHA256_CBLOCK];
+
+        memset(pad, 0x36, sizeof(pad));
+        for (int i = 0; i < HMAC_KEY_SIZE; i++) pad[i] ^= mac_key[i];
+        SHA256_Init(&k->inner);
+        SHA256_Update(&k->inner, pad, sizeof(pad));
+
+        memset(pad, 0x5c, sizeof(pad));
+        for (int i = 0; i < HMAC_KEY_SIZE; i++) pad[i] ^= mac_key[i];
+        SHA256_Init(&k->outer);
+        SHA256_Update(&k->outer, pad, sizeof(pad));
+        OPENSSL_cleanse(pad, sizeof(pad));
+    }
+    return k;
+}
+
+extern "C" void kernel_free(kernel *k) {
+    if (!k) return;
+    EVP_CIPHER_CTX_free(k->enc_ctx);
+    EVP_CIPHER_CTX_free(k->dec_ctx);
+    OPENSSL_cleanse(k, sizeof(*k));
+    free(k);
+}
+
+extern "C" int kernel_encrypt(kernel *k, const unsigned char *plaintext, int plaintext_len,
+                              const unsigned char *iv, unsigned char *ciphertext, unsigned char *tag) {
+    return k->encrypt(k, plaintext, plaintext_len, iv, ciphertext, tag);
+}
+
+extern "C" int kernel_decrypt(kernel *k, const unsigned char *ciphertext, int ciphertext_len,
+                              const unsigned char *iv, const unsigned char *tag, unsigned char *plaintext) {
+    return k->decrypt(k, ciphertext, ciphertext_len, iv, tag, plaintext);
+}
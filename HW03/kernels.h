@@ -0,0 +1,39 @@
+#ifndef HW03_KERNELS_H
+#define HW03_KERNELS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KERNEL_BLOCK_SIZE (32 * 1024)  // Encrypt-then-MAC fusion block, as DEFAULT_FUSED_BLOCK_SIZE
+
+// Compile-time specialized kernels (kernels.cpp, C++17). The
+// encrypt/decrypt/MAC pipeline is one template instantiated per registry
+// algorithm on its traits: key, IV and tag lengths and Encrypt-then-MAC
+// versus AEAD are constants, so each instance is a straight loop with
+// fixed-size tag and pad buffers and no per-message branch on the mode.
+//
+// The registry picks the instance once, in kernel_new, which also keys the
+// cipher contexts and absorbs the HMAC pads (as smallmsg.h does). Per
+// message only the IV is reset. Encrypt-then-MAC modes MAC each
+// KERNEL_BLOCK_SIZE block of ciphertext while it is still in cache.
+typedef struct kernel kernel;
+
+// NULL if algo_type is not poolable (the key schedule of XChaCha20 depends
+// on the nonce) or its traits do not match the registry entry
+kernel *kernel_new(int algo_type, unsigned char *enc_key, unsigned char *mac_key);
+void kernel_free(kernel *k);
+
+// Same contract as algo_encrypt/algo_decrypt: tag is HMAC_TAG_SIZE or
+// AEAD_TAG_SIZE bytes, iv algo_iv_len bytes. Decrypt returns -1 on a tag
+// mismatch, with the plaintext buffer wiped.
+int kernel_encrypt(kernel *k, const unsigned char *plaintext, int plaintext_len,
+                   const unsigned char *iv, unsigned char *ciphertext, unsigned char *tag);
+int kernel_decrypt(kernel *k, const unsigned char *ciphertext, int ciphertext_len,
+                   const unsigned char *iv, const unsigned char *tag, unsigned char *plaintext);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
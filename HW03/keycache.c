@@ -0,0 +1,131 @@
+#include "keycache.h"
+#include "tagcmp.h"
+
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <stdio.h>
+#include <string.h>
+
+int key_cache_init(key_cache *cache) {
+    OSSL_PARAM params[2];
+    EVP_KDF *kdf;
+
+    memset(cache, 0, sizeof(*cache));
+    if (!ctx_pool_init(&cache->pool)) return 0;
+
+    if (!(kdf = EVP_KDF_fetch(NULL, "HKDF", NULL))) {
+        fprintf(stderr, "Cannot fetch HKDF\n");
+        ctx_pool_free(&cache->pool);
+        return 0;
+    }
+    cache->hkdf = EVP_KDF_CTX_new(kdf);
+    EVP_KDF_free(kdf);  // The context keeps its own reference
+    if (!cache->hkdf) handle_crypto_error();
+
+    params[0] = OSSL_PARAM_construct_utf8_string(OSSL_KDF_PARAM_DIGEST, "SHA256", 0);
+    params[1] = OSSL_PARAM_construct_end();
+    if (1 != EVP_KDF_CTX_set_params(cache->hkdf, params)) handle_crypto_error();
+    return 1;
+}
+
+static void entry_evict(key_cache_entry *e) {
+    keyed_ctx_release(&e->kc);
+    OPENSSL_cleanse(e->id, sizeof(e->id));
+    e->last_use = 0;
+}
+
+void key_cache_free(key_cache *cache) {
+    for (int i = 0; i < KEY_CACHE_SLOTS; i++) {
+        if (cache->entries[i].kc.in_use) entry_evict(&cache->entries[i]);
+    }
+    EVP_KDF_CTX_free(cache->hkdf);
+    cache->hkdf = NULL;
+    ctx_pool_free(&cache->pool);
+}
+
+int key_cache_derive(key_cache *cache, unsigned char *master_key, const char *info,
+                     unsigned char *out, size_t out_len) {
+    OSSL_PARAM params[3];
+
+    // Key and info replace the previous ones, the digest stays set
+    params[0] = OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_KEY, master_key, KEY_SIZE);
+    params[1] = OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_INFO, (char *)info, strlen(info));
+    params[2] = OSSL_PARAM_construct_end();
+    if (EVP_KDF_derive(cache->hkdf, out, out_len, params) <= 0) handle_crypto_error();
+    return 1;
+}
+
+static void put_be32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+keyed_ctx *key_cache_get(key_cache *cache, uint32_t master_id, unsigned char *master_key,
+                         const char *info, int algo_type) {
+    unsigned char id[KEY_CACHE_ID_SIZE] = {0};
+    unsigned char keys[KEY_SIZE + HMAC_KEY_SIZE];
+    const algo_desc *algo = algo_get(algo_type);
+    size_t info_len = strlen(info);
+    size_t hit = KEY_CACHE_SLOTS;
+    key_cache_entry *e = NULL;
+
+    if (info_len > KEY_CACHE_INFO_MAX) {
+        fprintf(stderr, "HKDF info longer than %d bytes\n", KEY_CACHE_INFO_MAX);
+        return NULL;
+    }
+    if (!cache->pool.ciphers[algo_type]) {
+        fprintf(stderr, "%s cannot be cached\n", algo_name(algo_type));
+        return NULL;
+    }
+    put_be32(id, master_id);
+    put_be32(id + 4, (uint32_t)algo_type);
+    memcpy(id + 8, info, info_len);
+
+    // Touch every slot: no early exit, no branch on the comparison result
+    for (size_t i = 0; i < KEY_CACHE_SLOTS; i++) {
+        unsigned int equal = tag_equal_mask(cache->entries[i].id, id, KEY_CACHE_ID_SIZE) & 1;
+        size_t match = 0 - (size_t)(equal & (unsigned int)cache->entries[i].kc.in_use);
+        hit = (i & match) | (hit & ~match);
+    }
+
+    cache->clock++;
+    if (hit < KEY_CACHE_SLOTS) {
+        cache->hits++;
+        cache->entries[hit].last_use = cache->clock;
+        return &cache->entries[hit].kc;
+    }
+
+    // Miss: a free slot, else the least recently used one
+    cache->misses++;
+    for (int i = 0; i < KEY_CACHE_SLOTS; i++) {
+        key_cache_entry *cand = &cache->entries[i];
+        if (!cand->kc.in_use) {
+            e = cand;
+            break;
+        }
+        if (!e || cand->last_use < e->last_use) e = cand;
+    }
+    if (e->kc.in_use) {
+        cache->evictions++;
+        entry_evict(e);
+    }
+
+    key_cache_derive(cache, master_key, info, keys, algo->key_len + algo->mac_key_len);
+    keyed_ctx_setup(&cache->pool, &e->kc, algo_type, keys, keys + algo->key_len);
+    OPENSSL_cleanse(keys, sizeof(keys));
+    memcpy(e->id, id, KEY_CACHE_ID_SIZE);
+    e->last_use = cache->clock;
+    return &e->kc;
+}
+
+void key_cache_forget(key_cache *cache, uint32_t master_id) {
+    unsigned char prefix[4];
+
+    put_be32(prefix, master_id);
+    for (int i = 0; i < KEY_CACHE_SLOTS; i++) {
+        key_cache_entry *e = &cache->entries[i];
+        if (e->kc.in_use && memcmp(e->id, prefix, sizeof(prefix)) == 0) entry_evict(e);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef HW03_KEYCACHE_H
+#define HW03_KEYCACHE_H
+
+#include <openssl/kdf.h>
+#include <stdint.h>
+
+#include "ctx_pool.h"
+
+#define KEY_CACHE_SLOTS 16     // Sessions kept keyed at the same time
+#define KEY_CACHE_INFO_MAX 64  // Longest HKDF info string accepted
+#define KEY_CACHE_ID_SIZE (8 + KEY_CACHE_INFO_MAX)  // Multiple of 8, compared word-wise
+
+// Derived-key cache: (master key id, algo_type, HKDF info) -> fully keyed
+// contexts. A hit skips HKDF, the cipher key schedule and the HMAC pads.
+//
+// Lookup compares the fixed-size identifier of every slot, word by word
+// without early exit, and selects the match with masks, so its timing does not
+// depend on which slot (if any) holds the session. Eviction is LRU; evicted
+// slots have their contexts freed and keys and identifier wiped.
+typedef struct {
+    unsigned char id[KEY_CACHE_ID_SIZE];  // be32(master_id) || be32(algo_type) || info, zero padded
+    uint64_t last_use;
+    keyed_ctx kc;
+} key_cache_entry;
+
+typedef struct {
+    ctx_pool pool;      // Fetched ciphers and HMAC; its own slots are unused
+    EVP_KDF_CTX *hkdf;  // HKDF-SHA256, fetched and set up once
+    key_cache_entry entries[KEY_CACHE_SLOTS];
+    uint64_t clock;
+    unsigned long hits, misses, evictions;
+} key_cache;
+
+int key_cache_init(key_cache *cache);
+void key_cache_free(key_cache *cache);
+
+// Keyed contexts for the session, deriving and keying them on a miss.
+// master_id names master_key (the key itself is not stored); info is the
+// HKDF info string, as in derive_keys. Returns NULL if info is too long.
+keyed_ctx *key_cache_get(key_cache *cache, uint32_t master_id, unsigned char *master_key,
+                         const char *info, int algo_type);
+
+// Evict every session derived from master_id (e.g. on key rotation)
+void key_cache_forget(key_cache *cache, uint32_t master_id);
+
+// HKDF-SHA256 through the pre-fetched KDF; same output as derive_keys
+int key_cache_derive(key_cache *cache, unsigned char *master_key, const char *info,
+                     unsigned char *out, size_t out_len);
+
+#endif
@@ -0,0 +1,132 @@
+#include "keysetup.h"
+#include "bench.h"
+#include "ciphers.h"
+#include "keycache.h"
+
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum { PATH_FRESH, PATH_MISS, PATH_HIT, NUM_PATHS };
+
+static const char *path_names[NUM_PATHS] = {"fresh", "cache-miss", "cache-hit"};
+
+// What a session costs without the cache: everything a keyed_ctx holds
+static void fresh_session(int algo_type, unsigned char *master_key) {
+    unsigned char enc_key[KEY_SIZE];
+    unsigned char mac_key[HMAC_KEY_SIZE];
+    unsigned char zero_iv[MAX_IV_SIZE] = {0};
+    EVP_CIPHER_CTX *enc_ctx, *dec_ctx;
+    EVP_MAC_CTX *mac = NULL;
+
+    derive_algo_keys(master_key, algo_name(algo_type), algo_type, enc_key, mac_key);
+    enc_ctx = algo_cipher_ctx_new(algo_type, 1, enc_key, zero_iv);
+    dec_ctx = algo_cipher_ctx_new(algo_type, 0, enc_key, zero_iv);
+    if (algo_get(algo_type)->caps & ALGO_CAP_ETM) mac = hmac_sha256_ctx_new(mac_key);
+
+    EVP_MAC_CTX_free(mac);
+    EVP_CIPHER_CTX_free(dec_ctx);
+    EVP_CIPHER_CTX_free(enc_ctx);
+    OPENSSL_cleanse(enc_key, sizeof(enc_key));
+    OPENSSL_cleanse(mac_key, sizeof(mac_key));
+}
+
+static void time_sessions(int path, int algo_type, key_cache *cache, int num_sessions,
+                          unsigned char *master_key, long long *ns) {
+    static uint32_t next_master_id = KEY_CACHE_SLOTS;  // Ids below are the hit working set
+    struct timespec start, end;
+
+    for (int i = 0; i < num_sessions; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (path == PATH_FRESH) {
+            fresh_session(algo_type, master_key);
+        } else {
+            uint32_t id = (path == PATH_HIT) ? (uint32_t)(i % KEY_CACHE_SLOTS) : next_master_id++;
+            if (!key_cache_get(cache, id, master_key, algo_name(algo_type), algo_type)) handle_crypto_error();
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ns[i] = elapsed_ns(&start, &end);
+    }
+}
+
+// A cached context must interoperate with keys derived the usual way
+static int check_cached_keys(key_cache *cache, int algo_type, unsigned char *master_key) {
+    unsigned char enc_key[KEY_SIZE];
+    unsigned char mac_key[HMAC_KEY_SIZE];
+    unsigned char iv[MAX_IV_SIZE];
+    unsigned char msg[64], ciphertext[64 + EVP_MAX_BLOCK_LENGTH], decrypted[64 + EVP_MAX_BLOCK_LENGTH];
+    unsigned char tag[HMAC_TAG_SIZE];
+    keyed_ctx *kc = key_cache_get(cache, 0, master_key, algo_name(algo_type), algo_type);
+    int ciphertext_len;
+
+    if (RAND_bytes(iv, sizeof(iv)) != 1 || RAND_bytes(msg, sizeof(msg)) != 1) handle_crypto_error();
+    derive_algo_keys(master_key, algo_name(algo_type), algo_type, enc_key, mac_key);
+    ciphertext_len = pooled_encrypt(kc, msg, sizeof(msg), iv, ciphertext, tag);
+    return algo_decrypt(algo_type, ciphertext, ciphertext_len, enc_key, mac_key, iv, tag, decrypted) == (int)sizeof(msg) &&
+           memcmp(msg, decrypted, sizeof(msg)) == 0;
+}
+
+int run_key_setup_tests(const char *test_file, int num_sessions, unsigned char *master_key) {
+    char results_filename[256];
+    FILE *results_file;
+    key_cache cache;
+    long long *ns;
+
+    if (!(ns = malloc(num_sessions * sizeof(long long)))) {
+        perror("Memory allocation failed");
+        return 1;
+    }
+    if (!key_cache_init(&cache)) {
+        free(ns);
+        return 1;
+    }
+    results_file = open_results_file("keysetup_", test_file,
+                                     "Algorithm,Path,Sessions,Mean_ns,P50_ns,P99_ns,Max_ns,Speedup_vs_Fresh",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) {
+        key_cache_free(&cache);
+        free(ns);
+        return 1;
+    }
+
+    printf("\n=================================================================\n");
+    printf("  Per-session key setup: fresh vs derived-key cache (%d sessions,\n", num_sessions);
+    printf("  %d cache slots)\n", KEY_CACHE_SLOTS);
+    printf("=================================================================\n");
+
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        double fresh_mean = 0;
+
+        if (!algo_has(algo_type, ALGO_CAP_POOLABLE)) continue;
+        printf("\n%s: %s\n", algo_name(algo_type),
+               check_cached_keys(&cache, algo_type, master_key) ? "cached keys match HKDF [OK]"
+                                                                : "cached keys differ, Verification FAILED!");
+        printf("    %-12s %12s %12s %12s %12s %10s\n", "Path", "Mean ns", "p50 ns", "p99 ns", "Max ns", "Speedup");
+
+        for (int path = 0; path < NUM_PATHS; path++) {
+            bench_latency lat;
+
+            // Untimed pass first: page faults, and the hit working set gets keyed
+            time_sessions(path, algo_type, &cache, num_sessions < 1000 ? num_sessions : 1000, master_key, ns);
+            time_sessions(path, algo_type, &cache, num_sessions, master_key, ns);
+            bench_latency_summary(ns, num_sessions, &lat);
+            if (path == PATH_FRESH) fresh_mean = lat.mean_ns;
+
+            printf("    %-12s %12.1f %12lld %12lld %12lld %9.2fx\n", path_names[path],
+                   lat.mean_ns, lat.p50_ns, lat.p99_ns, lat.max_ns, fresh_mean / lat.mean_ns);
+            fprintf(results_file, "%s,%s,%d,%.1f,%lld,%lld,%lld,%.2f\n", algo_name(algo_type),
+                    path_names[path], num_sessions, lat.mean_ns, lat.p50_ns, lat.p99_ns, lat.max_ns,
+                    fresh_mean / lat.mean_ns);
+        }
+    }
+
+    printf("\nCache: %lu hits, %lu misses, %lu evictions\n", cache.hits, cache.misses, cache.evictions);
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    key_cache_free(&cache);
+    free(ns);
+    return 0;
+}
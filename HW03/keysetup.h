@@ -0,0 +1,15 @@
+#ifndef HW03_KEYSETUP_H
+#define HW03_KEYSETUP_H
+
+// Per-session key setup latency, kept apart from the bulk-encryption runs:
+//
+//   fresh  derive_algo_keys (new EVP_PKEY_CTX) + new encrypt/decrypt
+//          contexts + HMAC context for Encrypt-then-MAC, then freed
+//   miss   key_cache_get on a new session every time (HKDF through the
+//          pre-fetched KDF, keying, LRU eviction of the oldest session)
+//   hit    key_cache_get over a working set that fits the cache
+//
+// Reports mean/p50/p99 ns per session in results_keysetup_<file>.csv
+int run_key_setup_tests(const char *test_file, int num_sessions, unsigned char *master_key);
+
+#endif
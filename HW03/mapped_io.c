@@ -0,0 +1,83 @@
+#include "mapped_io.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Access pattern hints; all of them are advisory, so failures are ignored
+static void advise_sequential(unsigned char *data, size_t len) {
+    madvise(data, len, MADV_SEQUENTIAL);
+    madvise(data, len, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+    madvise(data, len, MADV_HUGEPAGE);  // Only honoured where THP covers file maps
+#endif
+}
+
+int map_input_file(const char *path, mapped_file *mf) {
+    struct stat file_info;
+
+    memset(mf, 0, sizeof(*mf));
+    mf->fd = open(path, O_RDONLY);
+    if (mf->fd < 0) {
+        perror("Cannot open file");
+        return -1;
+    }
+    if (fstat(mf->fd, &file_info) != 0) {
+        perror("Cannot get file size");
+        close(mf->fd);
+        return -1;
+    }
+
+    mf->len = file_info.st_size;
+    if (mf->len == 0) return 0;  // Nothing to map; data stays NULL
+
+    mf->data = mmap(NULL, mf->len, PROT_READ, MAP_PRIVATE, mf->fd, 0);
+    if (mf->data == MAP_FAILED) {
+        perror("Cannot map file");
+        mf->data = NULL;
+        close(mf->fd);
+        return -1;
+    }
+    advise_sequential(mf->data, mf->len);
+    return 0;
+}
+
+int map_output_file(const char *path, size_t len, mapped_file *mf) {
+    memset(mf, 0, sizeof(*mf));
+    mf->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (mf->fd < 0) {
+        perror("Cannot create output file");
+        return -1;
+    }
+    if (ftruncate(mf->fd, len) != 0) {
+        perror("Cannot size output file");
+        close(mf->fd);
+        return -1;
+    }
+
+    mf->len = len;
+    if (len == 0) return 0;
+
+    mf->data = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, mf->fd, 0);
+    if (mf->data == MAP_FAILED) {
+        perror("Cannot map output file");
+        mf->data = NULL;
+        close(mf->fd);
+        return -1;
+    }
+    advise_sequential(mf->data, mf->len);
+    return 0;
+}
+
+void unmap_file(mapped_file *mf, int sync) {
+    if (mf->data) {
+        if (sync) msync(mf->data, mf->len, MS_SYNC);
+        munmap(mf->data, mf->len);
+    }
+    if (mf->fd >= 0) close(mf->fd);
+    memset(mf, 0, sizeof(*mf));
+    mf->fd = -1;
+}
@@ -0,0 +1,24 @@
+#ifndef HW03_MAPPED_IO_H
+#define HW03_MAPPED_IO_H
+
+#include <stddef.h>
+
+// A file mapped into memory. Input maps are read-only and private; output
+// maps are shared, so ciphertext written into data lands in the page cache
+// directly without an fwrite copy.
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    int fd;
+} mapped_file;
+
+// Map path read-only with sequential/hugepage hints. Returns 0 on success.
+int map_input_file(const char *path, mapped_file *mf);
+
+// Create (or truncate) path with len bytes and map it read-write.
+int map_output_file(const char *path, size_t len, mapped_file *mf);
+
+// Unmap and close; sync = 1 flushes an output map with msync first
+void unmap_file(mapped_file *mf, int sync);
+
+#endif
@@ -0,0 +1,504 @@
+#include "messages.h"
+#include "bench.h"
+#include "ciphers.h"
+#include "ctx_pool.h"
+#include "kernels.h"
+#include "smallmsg.h"
+
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Per-message IVs: a random base incremented as a 64-bit big-endian counter,
+// so every message gets a distinct IV without a RAND_bytes call in the loop
+static void next_iv(unsigned char *iv, int iv_len) {
+    for (int i = iv_len - 1; i >= iv_len - 8; i--) {
+        if (++iv[i] != 0) break;
+    }
+}
+
+// Record i of the file, wrapping around so any message count works
+static unsigned char *message_at(unsigned char *plaintext, int plaintext_len,
+                                 size_t msg_size, int i) {
+    size_t span = plaintext_len - msg_size + 1;
+    return plaintext + ((size_t)i * msg_size) % span;
+}
+
+// Time num_messages encryptions, then num_messages decryptions of the last
+// ciphertext, through k if it is not NULL, else through pool; with both
+// NULL every call builds and keys a fresh context
+static int time_messages(int algo_type, ctx_pool *pool, kernel *k, unsigned char *plaintext, int plaintext_len,
+                         size_t msg_size, int num_messages,
+                         unsigned char *enc_key, unsigned char *mac_key,
+                         double *enc_ns, double *dec_ns) {
+    unsigned char iv[MAX_IV_SIZE];
+    unsigned char tag[HMAC_TAG_SIZE];
+    unsigned char *ciphertext = malloc(msg_size + EVP_MAX_BLOCK_LENGTH);
+    unsigned char *decryptedtext = malloc(msg_size + EVP_MAX_BLOCK_LENGTH);
+    unsigned char *last = NULL;
+    keyed_ctx *kc = NULL;
+    struct timespec start, end;
+    int ciphertext_len = 0, decryptedtext_len = 0, ok;
+
+    if (!ciphertext || !decryptedtext) {
+        perror("Memory allocation failed");
+        free(ciphertext);
+        free(decryptedtext);
+        return 0;
+    }
+    if (RAND_bytes(iv, MAX_IV_SIZE) != 1) handle_crypto_error();
+    if (pool && !k) kc = ctx_pool_get(pool, algo_type, enc_key, mac_key);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < num_messages; i++) {
+        last = message_at(plaintext, plaintext_len, msg_size, i);
+        next_iv(iv, algo_iv_len(algo_type));
+        if (k) {
+            ciphertext_len = kernel_encrypt(k, last, msg_size, iv, ciphertext, tag);
+        } else if (kc) {
+            ciphertext_len = pooled_encrypt(kc, last, msg_size, iv, ciphertext, tag);
+        } else {
+            ciphertext_len = algo_encrypt(algo_type, last, msg_size, enc_key, mac_key, iv, ciphertext, tag);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    *enc_ns = (double)elapsed_ns(&start, &end) / num_messages;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < num_messages; i++) {
+        if (k) {
+            decryptedtext_len = kernel_decrypt(k, ciphertext, ciphertext_len, iv, tag, decryptedtext);
+        } else if (kc) {
+            decryptedtext_len = pooled_decrypt(kc, ciphertext, ciphertext_len, iv, tag, decryptedtext);
+        } else {
+            decryptedtext_len = algo_decrypt(algo_type, ciphertext, ciphertext_len, enc_key, mac_key, iv, tag, decryptedtext);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    *dec_ns = (double)elapsed_ns(&start, &end) / num_messages;
+
+    ok = (decryptedtext_len == (int)msg_size && memcmp(last, decryptedtext, msg_size) == 0);
+    free(ciphertext);
+    free(decryptedtext);
+    return ok;
+}
+
+int run_pool_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                   size_t *msg_sizes, int num_msg_sizes, int num_messages,
+                   unsigned char *master_key) {
+    char results_filename[256];
+    FILE *results_file;
+    ctx_pool pool;
+
+    if (!ctx_pool_init(&pool)) return 1;
+    results_file = open_results_file("pool_", test_file,
+                                     "Algorithm,Msg_Bytes,Messages,Fresh_Enc_ns,Fresh_Dec_ns,Pooled_Enc_ns,Pooled_Dec_ns,Enc_Speedup,Dec_Speedup",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) {
+        ctx_pool_free(&pool);
+        return 1;
+    }
+
+    printf("\n=================================================================\n");
+    printf("  Fresh vs pooled cipher contexts (%d messages per size)\n", num_messages);
+    printf("=================================================================\n");
+
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        unsigned char enc_key[KEY_SIZE];
+        unsigned char mac_key[HMAC_KEY_SIZE];
+
+        if (!algo_has(algo_type, ALGO_CAP_POOLABLE)) continue;
+        derive_algo_keys(master_key, algo_name(algo_type), algo_type, enc_key, mac_key);
+        printf("\n%s:\n", algo_name(algo_type));
+        printf("    %-10s %14s %14s %14s %14s %8s\n", "Msg size",
+               "Fresh enc ns", "Fresh dec ns", "Pooled enc ns", "Pooled dec ns", "Enc x");
+
+        for (int m = 0; m < num_msg_sizes; m++) {
+            double fresh_enc, fresh_dec, pooled_enc, pooled_dec;
+            int ok;
+
+            if (msg_sizes[m] > (size_t)plaintext_len) {
+                printf("    %-10zu skipped (larger than %s)\n", msg_sizes[m], test_file);
+                continue;
+            }
+            ok = time_messages(algo_type, NULL, NULL, plaintext, plaintext_len, msg_sizes[m], num_messages,
+                               enc_key, mac_key, &fresh_enc, &fresh_dec);
+            ok &= time_messages(algo_type, &pool, NULL, plaintext, plaintext_len, msg_sizes[m], num_messages,
+                                enc_key, mac_key, &pooled_enc, &pooled_dec);
+
+            printf("    %-10zu %14.1f %14.1f %14.1f %14.1f %8.2f %s\n", msg_sizes[m],
+                   fresh_enc, fresh_dec, pooled_enc, pooled_dec, fresh_enc / pooled_enc,
+                   ok ? "[OK]" : "Verification FAILED!");
+            fprintf(results_file, "%s,%zu,%d,%.1f,%.1f,%.1f,%.1f,%.2f,%.2f\n",
+                    algo_name(algo_type), msg_sizes[m], num_messages,
+                    fresh_enc, fresh_dec, pooled_enc, pooled_dec,
+                    fresh_enc / pooled_enc, fresh_dec / pooled_dec);
+        }
+    }
+
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    ctx_pool_free(&pool);
+    return 0;
+}
+
+#define KERNEL_BYTES_PER_SIZE (256 * 1024 * 1024)  // Caps the message count of large sizes
+
+int run_kernel_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                     size_t *msg_sizes, int num_msg_sizes, int num_messages,
+                     unsigned char *master_key) {
+    char results_filename[256];
+    FILE *results_file;
+    ctx_pool pool;
+
+    if (!ctx_pool_init(&pool)) return 1;
+    results_file = open_results_file("kernels_", test_file,
+                                     "Algorithm,Msg_Bytes,Messages,Registry_Enc_ns,Registry_Dec_ns,Pooled_Enc_ns,"
+                                     "Pooled_Dec_ns,Kernel_Enc_ns,Kernel_Dec_ns,Enc_vs_Pooled,Dec_vs_Pooled",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) {
+        ctx_pool_free(&pool);
+        return 1;
+    }
+
+    printf("\n=================================================================\n");
+    printf("  Registry dispatch vs pooled contexts vs specialized kernels\n");
+    printf("  (up to %d messages per size, ns per message)\n", num_messages);
+    printf("=================================================================\n");
+
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        unsigned char enc_key[KEY_SIZE];
+        unsigned char mac_key[HMAC_KEY_SIZE];
+        kernel *k;
+
+        if (!algo_has(algo_type, ALGO_CAP_POOLABLE)) continue;
+        derive_algo_keys(master_key, algo_name(algo_type), algo_type, enc_key, mac_key);
+        if (!(k = kernel_new(algo_type, enc_key, mac_key))) {
+            printf("\n%s: no kernel\n", algo_name(algo_type));
+            continue;
+        }
+        printf("\n%s:\n", algo_name(algo_type));
+        printf("    %-10s %12s %12s %12s %12s %12s %12s %8s\n", "Msg size", "Registry enc",
+               "Registry dec", "Pooled enc", "Pooled dec", "Kernel enc", "Kernel dec", "Enc x");
+
+        for (int m = 0; m < num_msg_sizes; m++) {
+            double registry_enc, registry_dec, pooled_enc, pooled_dec, kernel_enc, kernel_dec;
+            size_t cap = KERNEL_BYTES_PER_SIZE / (msg_sizes[m] ? msg_sizes[m] : 1);
+            int messages = (size_t)num_messages < cap ? num_messages : (cap > 0 ? (int)cap : 1);
+            int ok;
+
+            if (msg_sizes[m] > (size_t)plaintext_len) {
+                printf("    %-10zu skipped (larger than %s)\n", msg_sizes[m], test_file);
+                continue;
+            }
+            ok = time_messages(algo_type, NULL, NULL, plaintext, plaintext_len, msg_sizes[m], messages,
+                               enc_key, mac_key, &registry_enc, &registry_dec);
+            ok &= time_messages(algo_type, &pool, NULL, plaintext, plaintext_len, msg_sizes[m], messages,
+                                enc_key, mac_key, &pooled_enc, &pooled_dec);
+            ok &= time_messages(algo_type, NULL, k, plaintext, plaintext_len, msg_sizes[m], messages,
+                                enc_key, mac_key, &kernel_enc, &kernel_dec);
+
+            printf("    %-10zu %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f %8.2f %s\n", msg_sizes[m],
+                   registry_enc, registry_dec, pooled_enc, pooled_dec, kernel_enc, kernel_dec,
+                   pooled_enc / kernel_enc, ok ? "[OK]" : "Verification FAILED!");
+            fprintf(results_file, "%s,%zu,%d,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.3f,%.3f\n",
+                    algo_name(algo_type), msg_sizes[m], messages, registry_enc, registry_dec,
+                    pooled_enc, pooled_dec, kernel_enc, kernel_dec,
+                    pooled_enc / kernel_enc, pooled_dec / kernel_dec);
+        }
+        kernel_free(k);
+    }
+
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    ctx_pool_free(&pool);
+    return 0;
+}
+
+// Push num_messages through batches of batch_size messages. batch_size 0
+// means the one-shot functions, one fresh context per message.
+// Returns 1 if the last batch decrypts back to its plaintext, -1 (and 0 in
+// both outputs) if the buffers cannot be allocated.
+static int time_batches(int algo_type, unsigned char *plaintext, int plaintext_len,
+                        size_t msg_size, int batch_size, int num_messages, unsigned char *key,
+                        double *ns_per_msg, double *batch_us) {
+    int slots = batch_size > 0 ? batch_size : 1;
+    aead_msg *msgs = malloc(slots * sizeof(aead_msg));
+    unsigned char *nonces = malloc((size_t)slots * MAX_IV_SIZE);
+    unsigned char *ciphertexts = malloc((size_t)slots * msg_size + EVP_MAX_BLOCK_LENGTH);
+    unsigned char *decrypted = malloc((size_t)slots * msg_size + EVP_MAX_BLOCK_LENGTH);
+    unsigned char *tags = malloc((size_t)slots * AEAD_TAG_SIZE);
+    unsigned char iv[MAX_IV_SIZE];
+    struct timespec start, end;
+    int iv_len = algo_iv_len(algo_type);
+    int batches = 0, done = 0, ok = 0;
+
+    *ns_per_msg = *batch_us = 0;
+    if (!msgs || !nonces || !ciphertexts || !decrypted || !tags) {
+        perror("Memory allocation failed");
+        ok = -1;
+        goto cleanup;
+    }
+    if (RAND_bytes(iv, MAX_IV_SIZE) != 1) handle_crypto_error();
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (done < num_messages) {
+        int count = (num_messages - done < slots) ? num_messages - done : slots;
+
+        for (int i = 0; i < count; i++) {
+            next_iv(iv, iv_len);
+            memcpy(nonces + (size_t)i * MAX_IV_SIZE, iv, iv_len);
+            msgs[i] = (aead_msg){
+                .data = message_at(plaintext, plaintext_len, msg_size, done + i),
+                .len = (int)msg_size,
+                .nonce = nonces + (size_t)i * MAX_IV_SIZE
+            };
+        }
+        if (batch_size == 0) {
+            algo_encrypt(algo_type, (unsigned char *)msgs[0].data, msgs[0].len, key, NULL,
+                         (unsigned char *)msgs[0].nonce, ciphertexts, tags);
+        } else {
+            algo_encrypt_batch(algo_type, msgs, count, key, ciphertexts, tags);
+        }
+        done += count;
+        batches++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    *ns_per_msg = (double)elapsed_ns(&start, &end) / num_messages;
+    *batch_us = (double)elapsed_ns(&start, &end) / batches / 1000.0;
+
+    // Decrypt the last batch back (descriptors now point at the ciphertexts)
+    {
+        int count = (batch_size == 0) ? 1 : (num_messages - 1) % slots + 1;
+        const unsigned char *originals[1] = {msgs[count - 1].data};
+        for (int i = 0; i < count; i++) msgs[i].data = ciphertexts + (size_t)i * msg_size;
+        ok = (algo_decrypt_batch(algo_type, msgs, count, key, tags, decrypted, NULL) == 0);
+        ok = ok && memcmp(decrypted + (size_t)(count - 1) * msg_size, originals[0], msg_size) == 0;
+    }
+
+cleanup:
+    free(msgs);
+    free(nonces);
+    free(ciphertexts);
+    free(decrypted);
+    free(tags);
+    return ok;
+}
+
+int run_batch_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                    size_t *msg_sizes, int num_msg_sizes, size_t *batch_sizes, int num_batch_sizes,
+                    int num_messages, unsigned char *master_key) {
+    char results_filename[256];
+    FILE *results_file;
+
+    results_file = open_results_file("batch_", test_file,
+                                     "Algorithm,Msg_Bytes,Batch_Size,Messages,Msgs_per_sec,Ns_per_msg,Batch_Latency_us",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) return 1;
+
+    printf("\n=================================================================\n");
+    printf("  Multi-buffer AEAD batches (%d messages per point)\n", num_messages);
+    printf("  Batch size 0 = one-shot functions, fresh context per message\n");
+    printf("=================================================================\n");
+
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        unsigned char key[KEY_SIZE];
+        unsigned char unused_mac_key[HMAC_KEY_SIZE];
+
+        if (!algo_has(algo_type, ALGO_CAP_AEAD | ALGO_CAP_POOLABLE)) continue;
+        derive_algo_keys(master_key, algo_name(algo_type), algo_type, key, unused_mac_key);
+        printf("\n%s:\n", algo_name(algo_type));
+        printf("    %-10s %-10s %14s %12s %16s\n", "Msg size", "Batch", "Msgs/sec", "ns/msg", "Batch latency");
+
+        for (int m = 0; m < num_msg_sizes; m++) {
+            if (msg_sizes[m] > (size_t)plaintext_len) {
+                printf("    %-10zu skipped (larger than %s)\n", msg_sizes[m], test_file);
+                continue;
+            }
+            // One-shot baseline first, then every requested batch size
+            for (int b = -1; b < num_batch_sizes; b++) {
+                int batch_size = (b < 0) ? 0 : (int)batch_sizes[b];
+                double ns_per_msg, batch_us;
+                int ok = time_batches(algo_type, plaintext, plaintext_len, msg_sizes[m], batch_size,
+                                      num_messages, key, &ns_per_msg, &batch_us);
+
+                if (ok < 0) continue;  // Nothing was timed
+                printf("    %-10zu %-10d %14.0f %12.1f %13.2f μs %s\n", msg_sizes[m], batch_size,
+                       1e9 / ns_per_msg, ns_per_msg, batch_us, ok ? "[OK]" : "Verification FAILED!");
+                fprintf(results_file, "%s,%zu,%d,%d,%.0f,%.1f,%.2f\n", algo_name(algo_type),
+                        msg_sizes[m], batch_size, num_messages, 1e9 / ns_per_msg, ns_per_msg, batch_us);
+            }
+        }
+    }
+
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    return 0;
+}
+
+#define LATENCY_WARMUP 1000  // Untimed messages before each latency series
+
+// Median cost of an empty clock_gettime pair, included in every sample below
+static long long timer_floor_ns(void) {
+    long long ns[1001];
+    struct timespec t0, t1;
+
+    for (int i = 0; i < 1001; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns[i] = elapsed_ns(&t0, &t1);
+    }
+    bench_latency lat;
+    bench_latency_summary(ns, 1001, &lat);
+    return lat.p50_ns;
+}
+
+// Per-message latency of one path: 0 = what test_algorithm does (heap
+// buffers and fresh contexts per message), 1 = pooled contexts with
+// preallocated buffers, 2 = the small-message API on stack buffers.
+// Fills enc_ns/dec_ns[num_messages] and the OpenSSL allocations per message.
+static int time_latency(int path, int algo_type, ctx_pool *pool, small_ctx *sc,
+                        unsigned char *plaintext, int plaintext_len, size_t msg_size,
+                        int num_messages, unsigned char *enc_key, unsigned char *mac_key,
+                        long long *enc_ns, long long *dec_ns, double *allocs_per_msg) {
+    unsigned char ciphertext[SMALL_MSG_MAX + EVP_MAX_BLOCK_LENGTH];
+    unsigned char decryptedtext[SMALL_MSG_MAX + EVP_MAX_BLOCK_LENGTH];
+    unsigned char iv[MAX_IV_SIZE];
+    unsigned char tag[HMAC_TAG_SIZE];
+    keyed_ctx *kc = path == 1 ? ctx_pool_get(pool, algo_type, enc_key, mac_key) : NULL;
+    unsigned long allocs = 0;
+    int ok = 1;
+
+    if (RAND_bytes(iv, MAX_IV_SIZE) != 1) handle_crypto_error();
+    for (int i = -LATENCY_WARMUP; i < num_messages && ok; i++) {
+        unsigned char *msg = message_at(plaintext, plaintext_len, msg_size, i < 0 ? -i : i);
+        unsigned long allocs_before = bench_crypto_allocs();
+        struct timespec t0, t1, t2;
+        int len;
+
+        next_iv(iv, algo_iv_len(algo_type));
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (path == 0) {
+            unsigned char *ct = malloc(msg_size + EVP_MAX_BLOCK_LENGTH);
+            unsigned char *pt;
+
+            len = algo_encrypt(algo_type, msg, msg_size, enc_key, mac_key, iv, ct, tag);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            pt = malloc(msg_size + EVP_MAX_BLOCK_LENGTH);
+            len = algo_decrypt(algo_type, ct, len, enc_key, mac_key, iv, tag, pt);
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+            ok = (len == (int)msg_size && memcmp(pt, msg, msg_size) == 0);
+            free(ct);
+            free(pt);
+        } else if (path == 1) {
+            len = pooled_encrypt(kc, msg, msg_size, iv, ciphertext, tag);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            len = pooled_decrypt(kc, ciphertext, len, iv, tag, decryptedtext);
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+            ok = (len == (int)msg_size && memcmp(decryptedtext, msg, msg_size) == 0);
+        } else {
+            len = small_encrypt(sc, msg, msg_size, iv, ciphertext, tag);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            len = small_decrypt(sc, ciphertext, len, iv, tag, decryptedtext);
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+            ok = (len == (int)msg_size && memcmp(decryptedtext, msg, msg_size) == 0);
+        }
+        if (i < 0) continue;
+        allocs += bench_crypto_allocs() - allocs_before;
+        enc_ns[i] = elapsed_ns(&t0, &t1);
+        dec_ns[i] = elapsed_ns(&t1, &t2);
+    }
+    *allocs_per_msg = (double)allocs / num_messages;
+    return ok;
+}
+
+int run_latency_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                      size_t *msg_sizes, int num_msg_sizes, int num_messages,
+                      unsigned char *master_key) {
+    const char *path_names[3] = {"fresh+heap", "pooled", "small"};
+    char results_filename[256];
+    FILE *results_file;
+    long long *enc_ns = malloc(num_messages * sizeof(long long));
+    long long *dec_ns = malloc(num_messages * sizeof(long long));
+    long long timer_ns;
+    ctx_pool pool;
+
+    if (!enc_ns || !dec_ns) {
+        perror("Memory allocation failed");
+        free(enc_ns);
+        free(dec_ns);
+        return 1;
+    }
+    if (!ctx_pool_init(&pool)) {
+        free(enc_ns);
+        free(dec_ns);
+        return 1;
+    }
+    results_file = open_results_file("latency_", test_file,
+                                     "Algorithm,Path,Msg_Bytes,Messages,Enc_Mean_ns,Enc_P50_ns,Enc_P99_ns,"
+                                     "Dec_Mean_ns,Dec_P50_ns,Dec_P99_ns,Crypto_Allocs_per_Msg,Timer_ns",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) {
+        ctx_pool_free(&pool);
+        free(enc_ns);
+        free(dec_ns);
+        return 1;
+    }
+
+    timer_ns = timer_floor_ns();
+    printf("\n=================================================================\n");
+    printf("  Small-message latency per message (%d messages per size)\n", num_messages);
+    printf("  Every sample includes one clock_gettime, about %lld ns here\n", timer_ns);
+    if (bench_crypto_allocs() == 0) printf("  OpenSSL allocation counting is not active\n");
+    printf("=================================================================\n");
+
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        unsigned char enc_key[KEY_SIZE];
+        unsigned char mac_key[HMAC_KEY_SIZE];
+        small_ctx sc;
+
+        if (!algo_has(algo_type, ALGO_CAP_POOLABLE)) continue;
+        derive_algo_keys(master_key, algo_name(algo_type), algo_type, enc_key, mac_key);
+        small_ctx_init(&sc, &pool, algo_type, enc_key, mac_key);
+        printf("\n%s:\n", algo_name(algo_type));
+        printf("    %-8s %-11s %10s %10s %10s %10s %10s\n", "Msg size", "Path",
+               "Enc p50", "Enc p99", "Dec p50", "Dec p99", "Allocs");
+
+        for (int m = 0; m < num_msg_sizes; m++) {
+            if (msg_sizes[m] > (size_t)plaintext_len || msg_sizes[m] > SMALL_MSG_MAX) {
+                printf("    %-8zu skipped (larger than %s or %d bytes)\n", msg_sizes[m], test_file,
+                       SMALL_MSG_MAX);
+                continue;
+            }
+            for (int path = 0; path < 3; path++) {
+                bench_latency enc, dec;
+                double allocs;
+                int ok = time_latency(path, algo_type, &pool, &sc, plaintext, plaintext_len, msg_sizes[m],
+                                      num_messages, enc_key, mac_key, enc_ns, dec_ns, &allocs);
+
+                bench_latency_summary(enc_ns, num_messages, &enc);
+                bench_latency_summary(dec_ns, num_messages, &dec);
+                printf("    %-8zu %-11s %10lld %10lld %10lld %10lld %10.2f %s\n", msg_sizes[m],
+                       path_names[path], enc.p50_ns, enc.p99_ns, dec.p50_ns, dec.p99_ns, allocs,
+                       ok ? "[OK]" : "Verification FAILED!");
+                fprintf(results_file, "%s,%s,%zu,%d,%.1f,%lld,%lld,%.1f,%lld,%lld,%.2f,%lld\n",
+                        algo_name(algo_type), path_names[path], msg_sizes[m], num_messages,
+                        enc.mean_ns, enc.p50_ns, enc.p99_ns, dec.mean_ns, dec.p50_ns, dec.p99_ns,
+                        allocs, timer_ns);
+            }
+        }
+        small_ctx_release(&sc);
+    }
+
+    printf("\n  Allocs: OpenSSL heap allocations per message (fresh+heap also does two\n");
+    printf("  malloc calls of its own)\n");
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    ctx_pool_free(&pool);
+    free(enc_ns);
+    free(dec_ns);
+    return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef HW03_MESSAGES_H
+#define HW03_MESSAGES_H
+
+#include <stddef.h>
+
+#define DEFAULT_NUM_MESSAGES 100000  // Messages per small-message measurement
+
+// Small-message benchmarks: the loaded file is cut into msg_size records and
+// each record is encrypted/decrypted as an independent message.
+
+// Fresh contexts (EVP_CIPHER_CTX_new + key schedule per message) versus the
+// pooled, pre-keyed contexts of ctx_pool.h. Writes results_pool_<file>.csv.
+int run_pool_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                   size_t *msg_sizes, int num_msg_sizes, int num_messages,
+                   unsigned char *master_key);
+
+// Compile-time specialized kernels (kernels.h) against the registry's
+// one-shot dispatch (fresh contexts) and the pooled contexts, which branch
+// on the mode per message. Messages per size are capped at 256 MB of data.
+// Writes results_kernels_<file>.csv.
+int run_kernel_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                     size_t *msg_sizes, int num_msg_sizes, int num_messages,
+                     unsigned char *master_key);
+
+// Per-message latency (p50/p99 ns) of the small-message API in smallmsg.h,
+// against pooled contexts and against heap buffers plus fresh contexts per
+// message, with the OpenSSL allocations per message if bench_count_crypto_allocs()
+// is active. Sizes above SMALL_MSG_MAX are skipped. Writes
+// results_latency_<file>.csv.
+int run_latency_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                      size_t *msg_sizes, int num_msg_sizes, int num_messages,
+                      unsigned char *master_key);
+
+// Multi-buffer AEAD API (aes_gcm_encrypt_batch & co.) swept over message and
+// batch sizes, against the one-shot functions. Reports messages/sec, ns per
+// message and the latency of one batch call. Writes results_batch_<file>.csv.
+int run_batch_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                    size_t *msg_sizes, int num_msg_sizes, size_t *batch_sizes, int num_batch_sizes,
+                    int num_messages, unsigned char *master_key);
+
+#endif
@@ -0,0 +1,347 @@
+#include "metrics.h"
+#include "bench.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RING_MASK (METRICS_RING_SIZE - 1)
+#define IDLE_POLL_NS 1000000  // Formatter sleep when the ring is empty
+
+typedef struct {
+    const char *fmt;
+    const char *event;
+    char label[METRICS_LABEL_LEN];
+    long long when_ns;
+    long long arg[METRICS_MAX_ARGS];
+} metrics_event;
+
+// seq == position: free for the producer of that position;
+// seq == position + 1: filled, ready for the consumer
+typedef struct {
+    unsigned long seq;
+    metrics_event ev;
+} __attribute__((aligned(64))) ring_slot;
+
+typedef struct {
+    unsigned long ops, bytes;
+    unsigned long hist[METRICS_HIST_BUCKETS];
+} __attribute__((aligned(64))) counter_shard;
+
+static struct {
+    ring_slot slots[METRICS_RING_SIZE];
+    unsigned long enqueue_pos __attribute__((aligned(64)));
+    unsigned long dequeue_pos __attribute__((aligned(64)));  // Formatter only
+    unsigned long printed;  // Records formatted, for metrics_flush
+    unsigned long dropped;
+    struct timespec start;
+    FILE *run_log;
+    pthread_t formatter;
+    int running, stopping;
+
+    counter_shard shards[METRICS_SHARDS];
+    int next_shard;
+
+    pthread_mutex_t snapshot_lock;  // prev_*: rates since the previous snapshot
+    struct timespec prev_time;
+    unsigned long prev_ops, prev_bytes;
+
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    int listen_fd;
+    pthread_t server;
+    int serving;
+} m = {.snapshot_lock = PTHREAD_MUTEX_INITIALIZER, .listen_fd = -1};
+
+static __thread int thread_shard = -1;
+
+static long long since_start_ns(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return elapsed_ns(&m.start, &now);
+}
+
+static void print_event(const metrics_event *ev) {
+    const long long *a = ev->arg;
+
+    // Arguments past the ones fmt uses are ignored
+    if (ev->fmt) printf(ev->fmt, a[0], a[1], a[2], a[3]);
+    if (ev->event && m.run_log) {
+        fprintf(m.run_log, "%.6f,%s,%s,%lld,%lld,%lld,%lld\n", ev->when_ns / 1e9, ev->event, ev->label,
+                a[0], a[1], a[2], a[3]);
+    }
+}
+
+void metrics_emit(const char *event, const char *label, const char *fmt, int nargs, ...) {
+    metrics_event ev;
+    unsigned long pos;
+    ring_slot *slot;
+    va_list ap;
+
+    ev.fmt = fmt;
+    ev.event = event;
+    ev.label[0] = '\0';
+    if (label) {
+        size_t n = strlen(label);
+        if (n >= METRICS_LABEL_LEN) n = METRICS_LABEL_LEN - 1;
+        memcpy(ev.label, label, n);
+        ev.label[n] = '\0';
+    }
+    memset(ev.arg, 0, sizeof(ev.arg));
+    va_start(ap, nargs);
+    for (int i = 0; i < nargs && i < METRICS_MAX_ARGS; i++) ev.arg[i] = va_arg(ap, long long);
+    va_end(ap);
+
+    if (!__atomic_load_n(&m.running, __ATOMIC_ACQUIRE)) {
+        print_event(&ev);
+        return;
+    }
+    ev.when_ns = since_start_ns();
+
+    // Claim a position whose slot the formatter has released
+    pos = __atomic_load_n(&m.enqueue_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        long dif;
+
+        slot = &m.slots[pos & RING_MASK];
+        dif = (long)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&m.enqueue_pos, &pos, pos + 1, 1, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) break;
+        } else if (dif < 0) {
+            __atomic_fetch_add(&m.dropped, 1, __ATOMIC_RELAXED);  // Full
+            return;
+        } else {
+            pos = __atomic_load_n(&m.enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+    slot->ev = ev;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+// Format every ready record, returns how many
+static int drain(void) {
+    int n = 0;
+
+    for (;;) {
+        unsigned long pos = m.dequeue_pos;
+        ring_slot *slot = &m.slots[pos & RING_MASK];
+        metrics_event ev;
+
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1) break;
+        ev = slot->ev;
+        __atomic_store_n(&slot->seq, pos + METRICS_RING_SIZE, __ATOMIC_RELEASE);
+        m.dequeue_pos = pos + 1;
+        print_event(&ev);
+        __atomic_store_n(&m.printed, pos + 1, __ATOMIC_RELEASE);
+        n++;
+    }
+    if (n > 0) {
+        fflush(stdout);
+        if (m.run_log) fflush(m.run_log);
+    }
+    return n;
+}
+
+static void *formatter_main(void *arg) {
+    const struct timespec idle = {0, IDLE_POLL_NS};
+
+    (void)arg;
+    for (;;) {
+        if (drain() > 0) continue;
+        if (__atomic_load_n(&m.stopping, __ATOMIC_ACQUIRE)) break;
+        nanosleep(&idle, NULL);
+    }
+    drain();  // Emitted between the last drain and the stop flag
+    return NULL;
+}
+
+void metrics_flush(void) {
+    const struct timespec wait = {0, 50000};
+    unsigned long target = __atomic_load_n(&m.enqueue_pos, __ATOMIC_ACQUIRE);
+
+    if (!__atomic_load_n(&m.running, __ATOMIC_ACQUIRE)) return;
+    while (__atomic_load_n(&m.printed, __ATOMIC_ACQUIRE) < target) nanosleep(&wait, NULL);
+}
+
+int metrics_start(FILE *run_log) {
+    static int registered;
+
+    if (m.running) return 0;
+    for (unsigned long i = 0; i < METRICS_RING_SIZE; i++) m.slots[i].seq = i;
+    m.enqueue_pos = m.dequeue_pos = m.printed = 0;
+    m.stopping = 0;
+    m.run_log = run_log;
+    clock_gettime(CLOCK_MONOTONIC, &m.start);
+    m.prev_time = m.start;
+    if (run_log) fprintf(run_log, "Time_s,Event,Label,Arg1,Arg2,Arg3,Arg4\n");
+
+    // Whatever stdout holds goes out before the formatter's first line
+    fflush(stdout);
+    if (pthread_create(&m.formatter, NULL, formatter_main, NULL) != 0) {
+        perror("pthread_create");
+        return -1;
+    }
+    __atomic_store_n(&m.running, 1, __ATOMIC_RELEASE);
+    if (!registered) {
+        atexit(metrics_stop);
+        registered = 1;
+    }
+    return 0;
+}
+
+void metrics_stop(void) {
+    if (m.serving) {
+        shutdown(m.listen_fd, SHUT_RDWR);  // Wakes the accept
+        pthread_join(m.server, NULL);
+        close(m.listen_fd);
+        unlink(m.path);
+        m.listen_fd = -1;
+        m.serving = 0;
+    }
+    if (!m.running) return;
+    __atomic_store_n(&m.stopping, 1, __ATOMIC_RELEASE);
+    pthread_join(m.formatter, NULL);
+    __atomic_store_n(&m.running, 0, __ATOMIC_RELEASE);
+    if (m.dropped) fprintf(stderr, "metrics: %lu events dropped (ring full)\n", m.dropped);
+    if (m.run_log) {
+        fclose(m.run_log);
+        m.run_log = NULL;
+    }
+}
+
+// --- Live counters ---
+
+void metrics_count(size_t bytes, long long ns) {
+    counter_shard *s;
+    int b = 0;
+
+    if (thread_shard < 0) {
+        thread_shard = __atomic_fetch_add(&m.next_shard, 1, __ATOMIC_RELAXED) % METRICS_SHARDS;
+    }
+    s = &m.shards[thread_shard];
+    while (b < METRICS_HIST_BUCKETS - 1 && ns >= (2LL << b)) b++;
+    __atomic_fetch_add(&s->ops, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->hist[b], 1, __ATOMIC_RELAXED);
+}
+
+void metrics_snapshot(FILE *fp) {
+    unsigned long ops = 0, bytes = 0, hist[METRICS_HIST_BUCKETS] = {0}, seen = 0, peak = 0;
+    long long p50 = 0, p99 = 0;
+    struct timespec now;
+    double uptime, recent;
+
+    for (int i = 0; i < METRICS_SHARDS; i++) {
+        counter_shard *s = &m.shards[i];
+
+        ops += __atomic_load_n(&s->ops, __ATOMIC_RELAXED);
+        bytes += __atomic_load_n(&s->bytes, __ATOMIC_RELAXED);
+        for (int b = 0; b < METRICS_HIST_BUCKETS; b++) hist[b] += __atomic_load_n(&s->hist[b], __ATOMIC_RELAXED);
+    }
+    for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+        seen += hist[b];
+        if (hist[b] > peak) peak = hist[b];
+        if (!p50 && seen * 100 >= ops * 50 && seen > 0) p50 = 2LL << b;
+        if (!p99 && seen * 100 >= ops * 99 && seen > 0) p99 = 2LL << b;
+    }
+
+    pthread_mutex_lock(&m.snapshot_lock);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uptime = elapsed_ns(&m.start, &now) / 1e9;
+    recent = elapsed_ns(&m.prev_time, &now) / 1e9;
+    fprintf(fp, "uptime_s %.3f\n", uptime);
+    fprintf(fp, "ops %lu\n", ops);
+    fprintf(fp, "bytes %lu\n", bytes);
+    fprintf(fp, "ops_per_sec %.1f\n", uptime > 0 ? ops / uptime : 0.0);
+    fprintf(fp, "mb_per_sec %.2f\n", uptime > 0 ? bytes / uptime / (1024.0 * 1024.0) : 0.0);
+    fprintf(fp, "recent_ops_per_sec %.1f\n", recent > 0 ? (ops - m.prev_ops) / recent : 0.0);
+    fprintf(fp, "recent_mb_per_sec %.2f\n",
+            recent > 0 ? (bytes - m.prev_bytes) / recent / (1024.0 * 1024.0) : 0.0);
+    fprintf(fp, "events_emitted %lu\n", __atomic_load_n(&m.enqueue_pos, __ATOMIC_RELAXED));
+    fprintf(fp, "events_dropped %lu\n", __atomic_load_n(&m.dropped, __ATOMIC_RELAXED));
+    m.prev_time = now;
+    m.prev_ops = ops;
+    m.prev_bytes = bytes;
+    pthread_mutex_unlock(&m.snapshot_lock);
+
+    if (ops == 0) return;
+    fprintf(fp, "latency_p50_us %.1f\n", p50 / 1000.0);
+    fprintf(fp, "latency_p99_us %.1f\n", p99 / 1000.0);
+    for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+        if (hist[b] == 0) continue;
+        fprintf(fp, "  %9.1f - %9.1f us %10lu ", (1LL << b) / 1000.0, (2LL << b) / 1000.0, hist[b]);
+        for (unsigned long i = 0; i < (hist[b] * 40 + peak - 1) / peak; i++) fputc('#', fp);
+        fputc('\n', fp);
+    }
+}
+
+// --- Endpoint ---
+
+static void *server_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        int fd = accept(m.listen_fd, NULL, NULL);
+        char *text = NULL;
+        size_t len = 0, off = 0;
+        FILE *fp;
+
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;  // Shut down by metrics_stop
+        }
+        // Formatted in memory first, so a client gone early costs an
+        // EPIPE, not a SIGPIPE
+        if ((fp = open_memstream(&text, &len))) {
+            metrics_snapshot(fp);
+            fclose(fp);
+            while (off < len) {
+                ssize_t n = send(fd, text + off, len - off, MSG_NOSIGNAL);
+                if (n <= 0) break;
+                off += n;
+            }
+            free(text);
+        }
+        close(fd);
+    }
+    return NULL;
+}
+
+int metrics_serve(const char *socket_path) {
+    struct sockaddr_un addr;
+
+    if (m.serving) return 0;
+    if (!m.running) clock_gettime(CLOCK_MONOTONIC, &m.start);  // Uptime without the formatter
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", socket_path);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    strcpy(m.path, socket_path);
+    unlink(socket_path);
+    m.listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m.listen_fd < 0 || bind(m.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(m.listen_fd, 16) != 0) {
+        perror("Cannot listen on the metrics socket");
+        if (m.listen_fd >= 0) close(m.listen_fd);
+        m.listen_fd = -1;
+        return -1;
+    }
+    if (pthread_create(&m.server, NULL, server_main, NULL) != 0) {
+        perror("pthread_create");
+        close(m.listen_fd);
+        unlink(socket_path);
+        m.listen_fd = -1;
+        return -1;
+    }
+    m.serving = 1;
+    return 0;
+}
@@ -0,0 +1,58 @@
+#ifndef HW03_METRICS_H
+#define HW03_METRICS_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define METRICS_RING_SIZE 4096   // Events in flight, a power of two
+#define METRICS_MAX_ARGS 4
+#define METRICS_LABEL_LEN 32
+#define METRICS_SHARDS 64        // Counter shards, one per thread up to this many
+#define METRICS_HIST_BUCKETS 40  // Bucket b counts latencies in [2^b, 2^(b+1)) ns
+
+// Output of the timed loops, kept out of the timed regions.
+//
+// A printf between two timed runs costs a formatting pass and, on a
+// terminal or pipe, a write system call per line, and leaves the next run
+// to start with colder caches. metrics_emit instead copies a fixed-size
+// record (format pointer, label, up to METRICS_MAX_ARGS long long
+// arguments) into a bounded multi-producer ring without a lock (Vyukov's
+// queue: one compare-and-swap on the enqueue position, a sequence number
+// per slot); a background thread formats the records to stdout and, with a
+// run log, writes them as CSV rows. A full ring drops the record and counts
+// it rather than block the timed code.
+//
+// The formatter prints in emit order, but anything printed directly
+// afterwards has to wait for it: metrics_flush before the summary. Until
+// metrics_start, metrics_emit prints inline.
+
+// Start the formatter thread. run_log, if not NULL, gets one CSV row per
+// named event and is closed by metrics_stop. metrics_stop is registered
+// with atexit. 0 on success, -1 on error.
+int metrics_start(FILE *run_log);
+
+// Drain the ring, stop the formatter and the counters endpoint
+void metrics_stop(void);
+
+// Queue fmt (a static string taking nargs long long arguments, %lld) for
+// printing. event names the CSV row (NULL: stdout only), label is copied.
+void metrics_emit(const char *event, const char *label, const char *fmt, int nargs, ...);
+
+// Wait until every record emitted so far has been printed
+void metrics_flush(void);
+
+// Live counters: one operation of bytes in ns. Relaxed atomic adds into the
+// calling thread's cache-line sized shard, so worker threads do not share
+// lines; a snapshot sums the shards.
+void metrics_count(size_t bytes, long long ns);
+
+// Bytes and operations processed, rates since the start and since the
+// previous snapshot, and the latency histogram, as "name value" lines
+void metrics_snapshot(FILE *fp);
+
+// Serve metrics_snapshot on a Unix stream socket: every connection gets
+// one snapshot and is closed (e.g. socat - UNIX-CONNECT:path). From a
+// background thread, stopped by metrics_stop. 0 on success, -1 on error.
+int metrics_serve(const char *socket_path);
+
+#endif
@@ -0,0 +1,168 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // sched_setaffinity, CPU_SET
+#endif
+
+#include "nodes.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+static void mask_set(unsigned long *mask, int cpu) {
+    mask[cpu / (8 * sizeof(unsigned long))] |= 1UL << (cpu % (8 * sizeof(unsigned long)));
+}
+
+// Parse a sysfs cpulist ("0-3,8,10-11") into mask, returns the CPU count
+static int parse_cpulist(const char *list, unsigned long *mask) {
+    int count = 0;
+
+    while (*list && *list != '\n') {
+        char *end;
+        long first = strtol(list, &end, 10), last = first;
+
+        if (end == list) break;
+        if (*end == '-') last = strtol(end + 1, &end, 10);
+        for (long cpu = first; cpu <= last && cpu < NODES_MAX_CPUS; cpu++) {
+            mask_set(mask, (int)cpu);
+            count++;
+        }
+        list = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+void node_topology_read(node_topology *topo) {
+    memset(topo, 0, sizeof(*topo));
+#ifdef __linux__
+    for (int id = 0; id < 1024 && topo->count < NODES_MAX; id++) {
+        char path[96], list[4096];
+        FILE *fp;
+        int n;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", id);
+        if (!(fp = fopen(path, "r"))) continue;
+        if (fgets(list, sizeof(list), fp)) {
+            n = parse_cpulist(list, topo->cpu_mask[topo->count]);
+            if (n > 0) {
+                topo->id[topo->count] = id;
+                topo->num_cpus[topo->count] = n;
+                topo->count++;
+            } else {
+                memset(topo->cpu_mask[topo->count], 0, sizeof(topo->cpu_mask[0]));  // Memory-only node
+            }
+        }
+        fclose(fp);
+    }
+#endif
+    if (topo->count == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        if (online < 1) online = 1;
+        topo->count = 1;
+        topo->num_cpus[0] = (int)online;
+        for (int cpu = 0; cpu < online && cpu < NODES_MAX_CPUS; cpu++) mask_set(topo->cpu_mask[0], cpu);
+    }
+}
+
+int node_pin_thread(const node_topology *topo, int node_index) {
+#ifdef __linux__
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < NODES_MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+        if (topo->cpu_mask[node_index][cpu / (8 * sizeof(unsigned long))] &
+            (1UL << (cpu % (8 * sizeof(unsigned long))))) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0 ? 0 : -1;
+#else
+    (void)topo;
+    (void)node_index;
+    return 0;
+#endif
+}
+
+#ifdef __linux__
+// Shrink [addr, addr + len) to the whole pages inside it
+static int page_range(void *addr, size_t len, uintptr_t *start, size_t *span) {
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t first = ((uintptr_t)addr + page - 1) & ~(page - 1);
+    uintptr_t last = ((uintptr_t)addr + len) & ~(page - 1);
+
+    if (last <= first) return -1;
+    *start = first;
+    *span = last - first;
+    return 0;
+}
+
+static int range_policy(void *addr, size_t len, int mode, const unsigned long *nodemask) {
+    uintptr_t start;
+    size_t span;
+
+    if (page_range(addr, len, &start, &span) != 0) return 0;
+    return syscall(SYS_mbind, start, span, mode, nodemask, (unsigned long)(8 * sizeof(unsigned long) * NODES_CPU_WORDS),
+                   MPOL_MF_MOVE) == 0 ? 0 : -1;
+}
+#endif
+
+int node_bind(const node_topology *topo, void *addr, size_t len, int node_index) {
+#ifdef __linux__
+    unsigned long nodemask[NODES_CPU_WORDS] = {0};
+
+    if (topo->id[node_index] >= NODES_MAX_CPUS) return -1;
+    mask_set(nodemask, topo->id[node_index]);
+    return range_policy(addr, len, MPOL_BIND, nodemask);
+#else
+    return 0;
+#endif
+}
+
+int node_interleave(const node_topology *topo, void *addr, size_t len) {
+#ifdef __linux__
+    unsigned long nodemask[NODES_CPU_WORDS] = {0};
+
+    for (int i = 0; i < topo->count; i++) mask_set(nodemask, topo->id[i]);
+    return range_policy(addr, len, MPOL_INTERLEAVE, nodemask);
+#else
+    return 0;
+#endif
+}
+
+double node_local_share(const node_topology *topo, const void *addr, size_t len, int node_index) {
+#ifdef __linux__
+    enum { BATCH = 512 };
+    uintptr_t start;
+    size_t span, page = (size_t)sysconf(_SC_PAGESIZE), local = 0, resident = 0;
+
+    if (page_range((void *)addr, len, &start, &span) != 0) return -1;
+    for (size_t off = 0; off < span; off += BATCH * page) {
+        void *pages[BATCH];
+        int status[BATCH];
+        unsigned long n = 0;
+
+        for (; n < BATCH && off + n * page < span; n++) pages[n] = (void *)(start + off + n * page);
+        if (syscall(SYS_move_pages, 0, n, pages, NULL, status, 0) != 0) return -1;
+        for (unsigned long i = 0; i < n; i++) {
+            if (status[i] < 0) continue;  // Not resident
+            resident++;
+            if (status[i] == topo->id[node_index]) local++;
+        }
+    }
+    return resident ? (double)local / resident : -1;
+#else
+    (void)topo;
+    (void)addr;
+    (void)len;
+    (void)node_index;
+    return -1;
+#endif
+}
@@ -0,0 +1,39 @@
+#ifndef HW03_NODES_H
+#define HW03_NODES_H
+
+#include <stddef.h>
+
+#define NODES_MAX 16          // NUMA nodes tracked
+#define NODES_MAX_CPUS 1024
+#define NODES_CPU_WORDS (NODES_MAX_CPUS / (8 * sizeof(unsigned long)))
+
+// NUMA topology from /sys/devices/system/node, with memory placement done
+// through the mbind/move_pages system calls directly, so there is no
+// dependency on libnuma. Off Linux, or without the sysfs tree, the machine
+// is one node holding every online CPU and placement calls do nothing.
+typedef struct {
+    int count;                                       // Nodes that have CPUs
+    int id[NODES_MAX];                               // Kernel node numbers
+    int num_cpus[NODES_MAX];
+    unsigned long cpu_mask[NODES_MAX][NODES_CPU_WORDS];
+} node_topology;
+
+// Always reports at least one node
+void node_topology_read(node_topology *topo);
+
+// Restrict the calling thread to the CPUs of topo node index node_index
+// (not node id), 0 on success
+int node_pin_thread(const node_topology *topo, int node_index);
+
+// Move the pages of [addr, addr + len) onto node index node_index and keep
+// them there (MPOL_BIND), or spread them round robin over every node
+// (MPOL_INTERLEAVE). Only whole pages inside the range are affected.
+// 0 on success, -1 if the kernel refused (errno set).
+int node_bind(const node_topology *topo, void *addr, size_t len, int node_index);
+int node_interleave(const node_topology *topo, void *addr, size_t len);
+
+// Share of the resident pages of [addr, addr + len) that are on node index
+// node_index, from move_pages in query mode; -1 if it cannot be told
+double node_local_share(const node_topology *topo, const void *addr, size_t len, int node_index);
+
+#endif
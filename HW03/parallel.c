@@ -0,0 +1,265 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // sched_getaffinity
+#endif
+
+#include "parallel.h"
+#include "ciphers.h"
+#include "tagcmp.h"
+
+#include <openssl/evp.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+enum { WORK_ENCRYPT, WORK_MAC, WORK_DECRYPT };
+
+// One thread's share of the buffer: leaves [first_leaf, last_leaf)
+typedef struct {
+    int work;
+    int algo_type;
+    unsigned char *in;
+    unsigned char *out;
+    size_t total_len;
+    size_t first_leaf, last_leaf;
+    unsigned char *enc_key, *mac_key, *iv;
+    unsigned char *leaf_tags;  // HMAC_TAG_SIZE bytes per leaf, shared array
+    int node;                  // Node index to pin to, -1 for none
+    double elapsed_us;
+} parallel_job;
+
+static const node_topology *placement;
+static parallel_node_stats node_stats;
+
+static void put_be64(unsigned char *p, uint64_t v) {
+    for (int i = 7; i >= 0; i--) {
+        p[i] = (unsigned char)v;
+        v >>= 8;
+    }
+}
+
+void keystream_iv_at(int algo_type, const unsigned char *iv, size_t offset,
+                     unsigned char *out_iv) {
+    memcpy(out_iv, iv, IV_SIZE);
+
+    if (algo_type == 1) {
+        // AES-CTR: the whole IV is a 128-bit big-endian block counter
+        uint64_t carry = offset / 16;
+        for (int i = IV_SIZE - 1; i >= 0 && carry; i--) {
+            carry += out_iv[i];
+            out_iv[i] = (unsigned char)carry;
+            carry >>= 8;
+        }
+    } else {
+        // ChaCha20: bytes 0-7 of the IV are a little-endian block counter
+        // (OpenSSL carries the 32-bit counter into the next word)
+        uint64_t carry = offset / 64;
+        for (int i = 0; i < 8 && carry; i++) {
+            carry += out_iv[i];
+            out_iv[i] = (unsigned char)carry;
+            carry >>= 8;
+        }
+    }
+}
+
+void parallel_leaf_tag(EVP_MAC_CTX *mac, uint64_t index, const unsigned char *data, size_t len,
+                       unsigned char *out) {
+    unsigned char header[9];
+    size_t mac_len;
+
+    header[0] = 0x00;
+    put_be64(header + 1, index);
+    if (1 != EVP_MAC_init(mac, NULL, 0, NULL)) handle_crypto_error();
+    if (1 != EVP_MAC_update(mac, header, sizeof(header))) handle_crypto_error();
+    if (1 != EVP_MAC_update(mac, data, len)) handle_crypto_error();
+    if (1 != EVP_MAC_final(mac, out, &mac_len, HMAC_TAG_SIZE)) handle_crypto_error();
+}
+
+static void *parallel_worker(void *arg) {
+    parallel_job *job = (parallel_job *)arg;
+    size_t start = job->first_leaf * PARALLEL_MAC_LEAF;
+    size_t end = job->last_leaf * PARALLEL_MAC_LEAF;
+    EVP_CIPHER_CTX *ctx = NULL;
+    EVP_MAC_CTX *mac = NULL;
+    int len;
+
+    struct timespec t0, t1;
+
+    if (end > job->total_len) end = job->total_len;
+    if (start >= end) return NULL;
+    if (job->node >= 0) node_pin_thread(placement, job->node);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    if (job->work != WORK_DECRYPT) mac = hmac_sha256_ctx_new(job->mac_key);
+    if (job->work != WORK_MAC) {
+        unsigned char segment_iv[IV_SIZE];
+        keystream_iv_at(job->algo_type, job->iv, start, segment_iv);
+        ctx = algo_cipher_ctx_new(job->algo_type, job->work == WORK_ENCRYPT, job->enc_key, segment_iv);
+    }
+
+    // Leaf by leaf, so on encryption each leaf is MACed while still in cache
+    for (size_t leaf = job->first_leaf; leaf < job->last_leaf; leaf++) {
+        size_t off = leaf * PARALLEL_MAC_LEAF;
+        size_t n = (job->total_len - off < PARALLEL_MAC_LEAF) ? job->total_len - off : PARALLEL_MAC_LEAF;
+
+        if (ctx && 1 != EVP_CipherUpdate(ctx, job->out + off, &len, job->in + off, (int)n)) handle_crypto_error();
+        if (mac) {
+            unsigned char *ct = (job->work == WORK_ENCRYPT) ? job->out + off : job->in + off;
+            parallel_leaf_tag(mac, leaf, ct, n, job->leaf_tags + leaf * HMAC_TAG_SIZE);
+        }
+    }
+
+    EVP_CIPHER_CTX_free(ctx);
+    EVP_MAC_CTX_free(mac);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    job->elapsed_us = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3;
+    return NULL;
+}
+
+void parallel_set_placement(const node_topology *topo) {
+    placement = topo;
+}
+
+int parallel_worker_node(int t, int num_threads, int num_nodes) {
+    return (int)((long)t * num_nodes / num_threads);
+}
+
+void parallel_slice(size_t len, int t, int num_threads, size_t *offset, size_t *slice_len) {
+    size_t n_leaves = (len + PARALLEL_MAC_LEAF - 1) / PARALLEL_MAC_LEAF;
+    size_t start = n_leaves * t / num_threads * PARALLEL_MAC_LEAF;
+    size_t end = n_leaves * (t + 1) / num_threads * PARALLEL_MAC_LEAF;
+
+    if (end > len) end = len;
+    if (start > end) start = end;
+    *offset = start;
+    *slice_len = end - start;
+}
+
+void parallel_get_node_stats(parallel_node_stats *stats) {
+    *stats = node_stats;
+}
+
+// Split the leaves evenly over the threads and wait for all of them
+static void run_jobs(int work, int algo_type, unsigned char *in, unsigned char *out, size_t len,
+                     unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                     unsigned char *leaf_tags, int num_threads) {
+    pthread_t threads[PARALLEL_MAX_THREADS];
+    int started[PARALLEL_MAX_THREADS] = {0};
+    parallel_job jobs[PARALLEL_MAX_THREADS];
+    size_t n_leaves = (len + PARALLEL_MAC_LEAF - 1) / PARALLEL_MAC_LEAF;
+    double node_busy[NODES_MAX] = {0};
+#ifdef __linux__
+    cpu_set_t caller_affinity;
+    int restore = placement && sched_getaffinity(0, sizeof(caller_affinity), &caller_affinity) == 0;
+#endif
+
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > PARALLEL_MAX_THREADS) num_threads = PARALLEL_MAX_THREADS;
+
+    for (int t = 0; t < num_threads; t++) {
+        jobs[t] = (parallel_job){
+            .work = work, .algo_type = algo_type, .in = in, .out = out, .total_len = len,
+            .first_leaf = n_leaves * t / num_threads,
+            .last_leaf = n_leaves * (t + 1) / num_threads,
+            .enc_key = enc_key, .mac_key = mac_key, .iv = iv, .leaf_tags = leaf_tags,
+            .node = placement ? parallel_worker_node(t, num_threads, placement->count) : -1
+        };
+    }
+    // Thread 0 is the caller itself
+    for (int t = 1; t < num_threads; t++) {
+        started[t] = (pthread_create(&threads[t], NULL, parallel_worker, &jobs[t]) == 0);
+        if (!started[t]) parallel_worker(&jobs[t]);  // Run inline if no thread
+    }
+    parallel_worker(&jobs[0]);
+    for (int t = 1; t < num_threads; t++) {
+        if (started[t]) pthread_join(threads[t], NULL);
+    }
+#ifdef __linux__
+    if (restore) sched_setaffinity(0, sizeof(caller_affinity), &caller_affinity);
+#endif
+
+    if (!placement) return;
+    for (int t = 0; t < num_threads; t++) {
+        parallel_job *job = &jobs[t];
+        size_t start = job->first_leaf * PARALLEL_MAC_LEAF, end = job->last_leaf * PARALLEL_MAC_LEAF;
+
+        if (end > len) end = len;
+        if (job->elapsed_us > node_busy[job->node]) node_busy[job->node] = job->elapsed_us;
+        if (work != WORK_MAC) {
+            node_stats.threads[job->node]++;
+            if (end > start) node_stats.bytes[job->node] += end - start;
+        }
+    }
+    for (int n = 0; n < placement->count; n++) node_stats.busy_us[n] += node_busy[n];
+}
+
+void parallel_root_tag(unsigned char *mac_key, const unsigned char *leaf_tags, size_t n_leaves,
+                       size_t total_len, unsigned char *out) {
+    unsigned char header[17];
+    EVP_MAC_CTX *mac = hmac_sha256_ctx_new(mac_key);
+    size_t mac_len;
+
+    header[0] = 0x01;
+    put_be64(header + 1, n_leaves);
+    put_be64(header + 9, total_len);
+    if (1 != EVP_MAC_update(mac, header, sizeof(header))) handle_crypto_error();
+    if (1 != EVP_MAC_update(mac, leaf_tags, n_leaves * HMAC_TAG_SIZE)) handle_crypto_error();
+    if (1 != EVP_MAC_final(mac, out, &mac_len, EVP_MAX_MD_SIZE)) handle_crypto_error();
+    EVP_MAC_CTX_free(mac);
+}
+
+int parallel_etm_encrypt(int algo_type, unsigned char *plaintext, int plaintext_len,
+                         unsigned char *enc_key, unsigned char *mac_key,
+                         unsigned char *iv, unsigned char *ciphertext,
+                         unsigned char *tag, int num_threads) {
+    size_t n_leaves = ((size_t)plaintext_len + PARALLEL_MAC_LEAF - 1) / PARALLEL_MAC_LEAF;
+    unsigned char *leaf_tags = malloc(n_leaves * HMAC_TAG_SIZE + 1);
+
+    if (!leaf_tags) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+    memset(&node_stats, 0, sizeof(node_stats));
+    run_jobs(WORK_ENCRYPT, algo_type, plaintext, ciphertext, plaintext_len,
+             enc_key, mac_key, iv, leaf_tags, num_threads);
+    parallel_root_tag(mac_key, leaf_tags, n_leaves, plaintext_len, tag);
+
+    free(leaf_tags);
+    return plaintext_len;
+}
+
+int parallel_etm_decrypt(int algo_type, unsigned char *ciphertext, int ciphertext_len,
+                         unsigned char *enc_key, unsigned char *mac_key,
+                         unsigned char *iv, unsigned char *tag,
+                         unsigned char *plaintext, int num_threads) {
+    size_t n_leaves = ((size_t)ciphertext_len + PARALLEL_MAC_LEAF - 1) / PARALLEL_MAC_LEAF;
+    unsigned char *leaf_tags = malloc(n_leaves * HMAC_TAG_SIZE + 1);
+    unsigned char computed_tag[EVP_MAX_MD_SIZE];
+
+    if (!leaf_tags) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+
+    // Verify first, then decrypt (Encrypt-then-MAC order is preserved)
+    memset(&node_stats, 0, sizeof(node_stats));
+    run_jobs(WORK_MAC, algo_type, ciphertext, NULL, ciphertext_len,
+             enc_key, mac_key, iv, leaf_tags, num_threads);
+    parallel_root_tag(mac_key, leaf_tags, n_leaves, ciphertext_len, computed_tag);
+    free(leaf_tags);
+
+    if (!tag_equal(tag, computed_tag, HMAC_TAG_SIZE)) {
+        if (report_tag_failures) fprintf(stderr, "HMAC verification failed!\n");
+        return -1;
+    }
+
+    run_jobs(WORK_DECRYPT, algo_type, ciphertext, plaintext, ciphertext_len,
+             enc_key, mac_key, iv, NULL, num_threads);
+    return ciphertext_len;
+}
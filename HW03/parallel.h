@@ -0,0 +1,80 @@
+#ifndef HW03_PARALLEL_H
+#define HW03_PARALLEL_H
+
+#include <openssl/evp.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nodes.h"
+
+#define PARALLEL_MAX_THREADS 64
+#define PARALLEL_MAC_LEAF (1024 * 1024)  // Bytes covered by one leaf tag
+
+// Multi-threaded engine for the seekable keystream modes (algo_type 1 and 2).
+//
+// The buffer is split into one contiguous segment per thread. Each thread
+// seeks the keystream to its segment start (keystream_iv_at) and encrypts it
+// with its own cipher context, so the ciphertext is byte-identical to the
+// single-threaded AES-128-CTR / ChaCha20 output.
+//
+// Tree MAC format (replaces the single HMAC over the whole ciphertext, which
+// cannot be parallelized). With K = mac_key, the ciphertext is cut in leaves
+// of PARALLEL_MAC_LEAF bytes (the last one may be shorter) and
+//
+//   leaf_i = HMAC-SHA256(K, 0x00 || be64(i) || C_i)
+//   tag    = HMAC-SHA256(K, 0x01 || be64(n_leaves) || be64(total_len) ||
+//                           leaf_0 || ... || leaf_{n-1})
+//
+// The leaf index binds each leaf to its position (no reordering), the root
+// binds count and length (no truncation or extension), and the leaf size is
+// fixed, so the tag does not depend on how many threads produced it.
+
+// Derive the IV positioning the keystream of algo_type at byte offset
+// (offset must be a multiple of the 64-byte ChaCha20 block)
+void keystream_iv_at(int algo_type, const unsigned char *iv, size_t offset,
+                     unsigned char *out_iv);
+
+// The two levels of the tree MAC, for callers scheduling leaves themselves.
+// mac is an HMAC context already keyed with K (it is re-initialized per
+// leaf); out receives HMAC_TAG_SIZE bytes.
+void parallel_leaf_tag(EVP_MAC_CTX *mac, uint64_t index, const unsigned char *data, size_t len,
+                       unsigned char *out);
+void parallel_root_tag(unsigned char *mac_key, const unsigned char *leaf_tags, size_t n_leaves,
+                       size_t total_len, unsigned char *out);
+
+// NUMA placement (nodes.h). With a topology set, worker t of n is pinned to
+// node index parallel_worker_node(t, n, topo->count), so consecutive slices
+// share a node; the caller, which runs worker 0, gets its affinity back.
+// Placing the slices' memory is up to the caller (node_bind on
+// parallel_slice ranges). NULL, the default, leaves threads unpinned.
+void parallel_set_placement(const node_topology *topo);
+int parallel_worker_node(int t, int num_threads, int num_nodes);
+
+// Byte range worker t of num_threads processes out of len bytes
+void parallel_slice(size_t len, int t, int num_threads, size_t *offset, size_t *slice_len);
+
+// Per-node work of the last parallel_etm_encrypt/decrypt call while a
+// placement was set: threads, bytes and the time of the node's slowest
+// worker, summed over the passes (decryption verifies, then decrypts)
+typedef struct {
+    int threads[NODES_MAX];
+    size_t bytes[NODES_MAX];
+    double busy_us[NODES_MAX];
+} parallel_node_stats;
+
+void parallel_get_node_stats(parallel_node_stats *stats);
+
+// Returns the ciphertext length, tag receives HMAC_TAG_SIZE bytes
+int parallel_etm_encrypt(int algo_type, unsigned char *plaintext, int plaintext_len,
+                         unsigned char *enc_key, unsigned char *mac_key,
+                         unsigned char *iv, unsigned char *ciphertext,
+                         unsigned char *tag, int num_threads);
+
+// Verifies the tree MAC in parallel before decrypting anything.
+// Returns the plaintext length, or -1 on tag mismatch.
+int parallel_etm_decrypt(int algo_type, unsigned char *ciphertext, int ciphertext_len,
+                         unsigned char *enc_key, unsigned char *mac_key,
+                         unsigned char *iv, unsigned char *tag,
+                         unsigned char *plaintext, int num_threads);
+
+#endif
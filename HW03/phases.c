@@ -0,0 +1,241 @@
+#include "phases.h"
+#include "arena.h"
+#include "bench.h"
+#include "ciphers.h"
+#include "counters.h"
+#include "randpool.h"
+#include "tagcmp.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    PHASE_KEY_DERIVATION,
+    PHASE_ENCRYPT_CIPHER,
+    PHASE_ENCRYPT_MAC,
+    PHASE_DECRYPT_VERIFY,
+    PHASE_DECRYPT_CIPHER,
+    NUM_PHASES
+};
+
+static const char *phase_names[NUM_PHASES] = {
+    "key-derivation", "encrypt-cipher", "encrypt-mac", "decrypt-verify", "decrypt-cipher"
+};
+
+// Counters and timing accumulated over the runs of one phase
+typedef struct {
+    counter_values counts;
+    unsigned long long ref_cycles;  // bench_mark cycles, used when no PMU
+    long long ns;
+} phase_totals;
+
+typedef struct {
+    counter_set *cs;
+    counter_values c0;
+    bench_mark m0;
+} phase_probe;
+
+static void phase_begin(phase_probe *p) {
+    bench_mark_now(&p->m0);
+    counters_read(p->cs, &p->c0);
+}
+
+static void phase_end(phase_probe *p, phase_totals *t, int record) {
+    counter_values c1;
+    bench_mark m1;
+
+    counters_read(p->cs, &c1);
+    bench_mark_now(&m1);
+    if (!record) return;
+    counters_accumulate(&t->counts, &p->c0, &c1);
+    t->ref_cycles += m1.cycles - p->m0.cycles;
+    t->ns += elapsed_ns(&p->m0.ts, &m1.ts);
+}
+
+// One full round trip split in phases; returns 0 if the data came back intact
+static int phase_round_trip(int algo_type, phase_probe *p, phase_totals *totals, int record,
+                            unsigned char *plaintext, int plaintext_len,
+                            unsigned char *master_key, unsigned char *ciphertext,
+                            unsigned char *decryptedtext) {
+    unsigned char enc_key[KEY_SIZE];
+    unsigned char mac_key[HMAC_KEY_SIZE];
+    unsigned char iv[MAX_IV_SIZE];
+    unsigned char tag[HMAC_TAG_SIZE];
+    unsigned char computed_tag[EVP_MAX_MD_SIZE];
+    unsigned int mac_len;
+    EVP_CIPHER_CTX *ctx;
+    int etm = algo_get(algo_type)->caps & ALGO_CAP_ETM;
+    int len, ciphertext_len, decryptedtext_len, ok = 1;
+
+    rand_pool_bytes(iv, algo_iv_len(algo_type));
+
+    phase_begin(p);
+    derive_algo_keys(master_key, algo_name(algo_type), algo_type, enc_key, mac_key);
+    phase_end(p, &totals[PHASE_KEY_DERIVATION], record);
+
+    phase_begin(p);
+    ctx = algo_cipher_ctx_new(algo_type, 1, enc_key, iv);
+    if (1 != EVP_EncryptUpdate(ctx, ciphertext, &len, plaintext, plaintext_len)) handle_crypto_error();
+    ciphertext_len = len;
+    phase_end(p, &totals[PHASE_ENCRYPT_CIPHER], record);
+
+    phase_begin(p);
+    if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + len, &len)) handle_crypto_error();
+    ciphertext_len += len;
+    if (etm) {
+        if (!HMAC(EVP_sha256(), mac_key, HMAC_KEY_SIZE, ciphertext, ciphertext_len, tag, &mac_len)) {
+            handle_crypto_error();
+        }
+    } else {
+        if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    phase_end(p, &totals[PHASE_ENCRYPT_MAC], record);
+
+    // Encrypt-then-MAC verifies before decrypting, AEAD after
+    if (etm) {
+        phase_begin(p);
+        if (!HMAC(EVP_sha256(), mac_key, HMAC_KEY_SIZE, ciphertext, ciphertext_len, computed_tag, &mac_len)) {
+            handle_crypto_error();
+        }
+        ok = tag_equal(tag, computed_tag, HMAC_TAG_SIZE);
+        phase_end(p, &totals[PHASE_DECRYPT_VERIFY], record);
+    }
+
+    phase_begin(p);
+    ctx = algo_cipher_ctx_new(algo_type, 0, enc_key, iv);
+    if (1 != EVP_DecryptUpdate(ctx, decryptedtext, &len, ciphertext, ciphertext_len)) handle_crypto_error();
+    decryptedtext_len = len;
+    phase_end(p, &totals[PHASE_DECRYPT_CIPHER], record);
+
+    phase_begin(p);
+    if (!etm) {
+        if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
+    }
+    if (EVP_DecryptFinal_ex(ctx, decryptedtext + len, &len) <= 0) ok = 0;
+    decryptedtext_len += len;
+    EVP_CIPHER_CTX_free(ctx);
+    if (!etm) phase_end(p, &totals[PHASE_DECRYPT_VERIFY], record);
+
+    OPENSSL_cleanse(enc_key, sizeof(enc_key));
+    OPENSSL_cleanse(mac_key, sizeof(mac_key));
+    return (ok && decryptedtext_len == plaintext_len &&
+            memcmp(plaintext, decryptedtext, plaintext_len) == 0) ? 0 : -1;
+}
+
+// Counter value per run as CSV text, "NA" where the event is missing
+static void format_count(char *buf, size_t len, const counter_set *cs, int which,
+                         const phase_totals *t, int runs) {
+    if (!counter_available(cs, which)) {
+        snprintf(buf, len, "NA");
+    } else {
+        snprintf(buf, len, "%.0f", (double)t->counts.value[which] / runs);
+    }
+}
+
+int run_phase_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                    unsigned char *master_key) {
+    int runs = bench_settings.min_runs;
+    int warmup = bench_settings.warmup_runs;
+    int have_cycles, have_instructions;
+    char results_filename[256];
+    FILE *results_file;
+    counter_set cs;
+    unsigned char *ciphertext, *decryptedtext;
+
+    int available = counters_open(&cs);
+    have_cycles = counter_available(&cs, COUNTER_CYCLES);
+    have_instructions = counter_available(&cs, COUNTER_INSTRUCTIONS);
+
+    results_file = open_results_file("counters_", test_file,
+                                     "Algorithm,Phase,Runs,Bytes,Avg_Time_us,Time_Share_pct,Cycles,Cycle_Source,"
+                                     "Cycles_per_Byte,Instructions,IPC,LLC_Misses,Branch_Misses,Task_Clock_ns",
+                                     results_filename, sizeof(results_filename));
+    ciphertext = arena_alloc(plaintext_len + EVP_MAX_BLOCK_LENGTH);
+    decryptedtext = arena_alloc(plaintext_len + EVP_MAX_BLOCK_LENGTH);
+    if (!results_file || !ciphertext || !decryptedtext) {
+        if (!ciphertext || !decryptedtext) perror("Memory allocation failed");
+        if (results_file) fclose(results_file);
+        arena_free(ciphertext);
+        arena_free(decryptedtext);
+        counters_close(&cs);
+        return 1;
+    }
+
+    printf("\n=================================================================\n");
+    printf("  Per-phase hardware counters (%d warm-up + %d runs per algorithm)\n", warmup, runs);
+    printf("  Events:");
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        printf(" %s%s", counter_name(i), counter_available(&cs, i) ? "" : " (n/a)");
+    }
+    printf("\n");
+    if (!have_cycles) {
+        printf("  No hardware cycle counter: cycles fall back to %s\n", bench_cycle_source());
+    }
+    printf("=================================================================\n");
+    if (available == 0) {
+        printf("  perf_event_open is not available, only timings are reported\n");
+    }
+
+    // The phases need chunked updates on one context
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        if (!algo_has(algo_type, ALGO_CAP_STREAMING)) continue;
+        phase_probe probe = { .cs = &cs };
+        phase_totals totals[NUM_PHASES];
+        long long total_ns = 0;
+        int failed = 0;
+
+        memset(totals, 0, sizeof(totals));
+        for (int run = 0; run < warmup + runs; run++) {
+            if (phase_round_trip(algo_type, &probe, totals, run >= warmup, plaintext, plaintext_len,
+                                 master_key, ciphertext, decryptedtext) != 0) {
+                failed = 1;
+            }
+        }
+        for (int ph = 0; ph < NUM_PHASES; ph++) total_ns += totals[ph].ns;
+
+        printf("\n%s%s:\n", algo_name(algo_type), failed ? " (Verification FAILED!)" : "");
+        printf("  %-16s %12s %7s %14s %9s %6s %12s %12s\n", "Phase", "Time (μs)", "Share",
+               "Cycles", "Cyc/B", "IPC", "LLC miss", "Br miss");
+
+        for (int ph = 0; ph < NUM_PHASES; ph++) {
+            const phase_totals *t = &totals[ph];
+            size_t bytes = (ph == PHASE_KEY_DERIVATION) ? 0 : (size_t)plaintext_len;
+            double avg_us = t->ns / 1000.0 / runs;
+            double share = total_ns ? 100.0 * t->ns / total_ns : 0;
+            double cycles = (double)(have_cycles ? t->counts.value[COUNTER_CYCLES] : t->ref_cycles) / runs;
+            char cyc_per_byte[32], ipc[32], instructions[32], llc[32], branch[32], task_clock[32];
+
+            if (bytes) snprintf(cyc_per_byte, sizeof(cyc_per_byte), "%.3f", cycles / bytes);
+            else snprintf(cyc_per_byte, sizeof(cyc_per_byte), "NA");
+            if (have_cycles && have_instructions && t->counts.value[COUNTER_CYCLES]) {
+                snprintf(ipc, sizeof(ipc), "%.2f",
+                         (double)t->counts.value[COUNTER_INSTRUCTIONS] / t->counts.value[COUNTER_CYCLES]);
+            } else {
+                snprintf(ipc, sizeof(ipc), "NA");
+            }
+            format_count(instructions, sizeof(instructions), &cs, COUNTER_INSTRUCTIONS, t, runs);
+            format_count(llc, sizeof(llc), &cs, COUNTER_LLC_MISSES, t, runs);
+            format_count(branch, sizeof(branch), &cs, COUNTER_BRANCH_MISSES, t, runs);
+            format_count(task_clock, sizeof(task_clock), &cs, COUNTER_TASK_CLOCK, t, runs);
+
+            printf("  %-16s %12.2f %6.1f%% %14.0f %9s %6s %12s %12s\n", phase_names[ph], avg_us,
+                   share, cycles, cyc_per_byte, ipc, llc, branch);
+            fprintf(results_file, "%s,%s,%d,%zu,%.2f,%.2f,%.0f,%s,%s,%s,%s,%s,%s,%s\n",
+                    algo_name(algo_type), phase_names[ph], runs, bytes, avg_us, share, cycles,
+                    have_cycles ? "perf" : bench_cycle_source(), cyc_per_byte, instructions, ipc,
+                    llc, branch, task_clock);
+        }
+    }
+
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    arena_free(ciphertext);
+    arena_free(decryptedtext);
+    counters_close(&cs);
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef HW03_PHASES_H
+#define HW03_PHASES_H
+
+// Per-phase hardware counter breakdown of every streaming registry entry. The
+// one-shot functions of ciphers.h are re-run step by step with counters read
+// between the steps:
+//
+//   key-derivation  derive_algo_keys (HKDF-SHA256)
+//   encrypt-cipher  keystream/AEAD update over the data (GHASH/Poly1305
+//                   absorption is inside this step for the AEAD modes)
+//   encrypt-mac     HMAC-SHA256 over the ciphertext, or AEAD final + tag
+//   decrypt-verify  HMAC recomputation and compare, or AEAD final with tag
+//   decrypt-cipher  keystream/AEAD update back to plaintext
+//
+// Writes results_counters_<file>.csv.
+int run_phase_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                    unsigned char *master_key);
+
+#endif
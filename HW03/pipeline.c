@@ -0,0 +1,528 @@
+#include "pipeline.h"
+#include "ciphers.h"
+
+#include <openssl/evp.h>
+#include <linux/futex.h>
+#include <linux/io_uring.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define QUEUE_SIZE 128  // Power of two above PIPELINE_MAX_DEPTH, so a push never blocks
+
+// ---------------------------------------------------------------------------
+// SPSC queue of buffer indices. The fast path is one acquire load and one
+// store; the consumer only touches the futex word when the queue is empty.
+
+typedef struct {
+    int items[QUEUE_SIZE];
+    unsigned head __attribute__((aligned(64)));  // Consumer side
+    unsigned tail __attribute__((aligned(64)));  // Producer side
+    int seq;                                     // Futex word, bumped on push to a waiting consumer
+    int waiting;
+} spsc_queue;
+
+static void queue_push(spsc_queue *q, int item) {
+    unsigned tail = q->tail;
+
+    q->items[tail & (QUEUE_SIZE - 1)] = item;
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&q->waiting, __ATOMIC_SEQ_CST)) {
+        __atomic_fetch_add(&q->seq, 1, __ATOMIC_SEQ_CST);
+        syscall(SYS_futex, &q->seq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+}
+
+static int queue_try_pop(spsc_queue *q, int *item) {
+    unsigned head = q->head;
+
+    if (head == __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE)) return 0;
+    *item = q->items[head & (QUEUE_SIZE - 1)];
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static int queue_pop(spsc_queue *q) {
+    int item;
+
+    while (!queue_try_pop(q, &item)) {
+        int seq;
+
+        // Announce the wait, then re-check: a push after the check sees
+        // waiting and bumps seq, so FUTEX_WAIT returns at once
+        __atomic_store_n(&q->waiting, 1, __ATOMIC_SEQ_CST);
+        seq = __atomic_load_n(&q->seq, __ATOMIC_SEQ_CST);
+        if (q->head == __atomic_load_n(&q->tail, __ATOMIC_SEQ_CST)) {
+            syscall(SYS_futex, &q->seq, FUTEX_WAIT_PRIVATE, seq, NULL, NULL, 0);
+        }
+        __atomic_store_n(&q->waiting, 0, __ATOMIC_SEQ_CST);
+    }
+    return item;
+}
+
+// ---------------------------------------------------------------------------
+// Minimal io_uring over the raw syscalls (no liburing dependency)
+
+typedef struct {
+    int fd;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_len, cq_ring_len, sqes_len;
+    unsigned pending;  // Prepared but not yet submitted
+} uring;
+
+static int uring_setup(uring *r, unsigned entries) {
+    struct io_uring_params p;
+
+    memset(r, 0, sizeof(*r));
+    memset(&p, 0, sizeof(p));
+    r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0) return -1;
+
+    r->sq_ring_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_ring_len > r->sq_ring_len) r->sq_ring_len = r->cq_ring_len;
+        r->cq_ring_len = r->sq_ring_len;
+    }
+    r->sq_ring = mmap(NULL, r->sq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED) goto fail;
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ring = r->sq_ring;
+    } else {
+        r->cq_ring = mmap(NULL, r->cq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ring == MAP_FAILED) goto fail;
+    }
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) goto fail;
+
+    r->sq_tail = (unsigned *)((char *)r->sq_ring + p.sq_off.tail);
+    r->sq_mask = (unsigned *)((char *)r->sq_ring + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)((char *)r->sq_ring + p.sq_off.array);
+    r->cq_head = (unsigned *)((char *)r->cq_ring + p.cq_off.head);
+    r->cq_tail = (unsigned *)((char *)r->cq_ring + p.cq_off.tail);
+    r->cq_mask = (unsigned *)((char *)r->cq_ring + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)((char *)r->cq_ring + p.cq_off.cqes);
+    return 0;
+
+fail:
+    if (r->sq_ring && r->sq_ring != MAP_FAILED) munmap(r->sq_ring, r->sq_ring_len);
+    if (r->cq_ring && r->cq_ring != MAP_FAILED && r->cq_ring != r->sq_ring) munmap(r->cq_ring, r->cq_ring_len);
+    close(r->fd);
+    return -1;
+}
+
+static void uring_free(uring *r) {
+    munmap(r->sqes, r->sqes_len);
+    if (r->cq_ring != r->sq_ring) munmap(r->cq_ring, r->cq_ring_len);
+    munmap(r->sq_ring, r->sq_ring_len);
+    close(r->fd);
+}
+
+// Queue a read or write; the caller never has more than depth <= entries in flight
+static void uring_prep(uring *r, int op, int fd, void *buf, size_t len, off_t offset, int user_data) {
+    unsigned tail = *r->sq_tail, index = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (unsigned char)op;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long)buf;
+    sqe->len = (unsigned)len;
+    sqe->off = (unsigned long long)offset;
+    sqe->user_data = (unsigned long long)user_data;
+    r->sq_array[index] = index;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->pending++;
+}
+
+// Submit what was prepared and wait for at least min_complete completions
+static int uring_enter(uring *r, unsigned min_complete) {
+    for (;;) {
+        long ret = syscall(__NR_io_uring_enter, r->fd, r->pending, min_complete,
+                           min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (ret >= 0) {
+            r->pending -= (unsigned)ret;
+            return 0;
+        }
+        if (errno != EINTR) {
+            perror("io_uring_enter");
+            return -1;
+        }
+    }
+}
+
+static int uring_reap(uring *r, int *user_data, int *res) {
+    unsigned head = *r->cq_head;
+    struct io_uring_cqe *cqe;
+
+    if (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) return 0;
+    cqe = &r->cqes[head & *r->cq_mask];
+    *user_data = (int)cqe->user_data;
+    *res = cqe->res;
+    __atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+int pipeline_io_uring_available(void) {
+    static int available = -1;
+
+    if (available < 0) {
+        uring r;
+        available = (uring_setup(&r, 4) == 0);
+        if (available) uring_free(&r);
+    }
+    return available;
+}
+
+// ---------------------------------------------------------------------------
+// Pipeline
+
+typedef struct {
+    unsigned char *data;  // chunk_size + EVP_MAX_BLOCK_LENGTH, page aligned
+    size_t len;           // Plaintext bytes read, then ciphertext bytes to write
+    size_t done;          // Bytes of a short read/write already transferred
+    off_t offset;         // File offset of the read, then of the write
+    int ready;            // Read completed (reader only)
+    int last;             // Final chunk (carries EVP_EncryptFinal_ex output)
+    int error;            // Set by the reader; every stage stops at this chunk
+} chunk;
+
+typedef struct {
+    int in_fd, out_fd;
+    size_t chunk_size, file_len;
+    int depth;
+    int use_uring;
+    chunk chunks[PIPELINE_MAX_DEPTH];
+    spsc_queue free_q, read_q, write_q;
+    int write_failed;
+} pipeline;
+
+// Blocking fallback for one chunk
+static int full_pread(pipeline *pl, chunk *ch) {
+    while (ch->done < ch->len) {
+        ssize_t n = pread(pl->in_fd, ch->data + ch->done, ch->len - ch->done, ch->offset + (off_t)ch->done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n == 0) errno = EIO;  // The file shrank under us
+            perror("Error reading input");
+            return -1;
+        }
+        ch->done += (size_t)n;
+    }
+    return 0;
+}
+
+static int full_pwrite(pipeline *pl, chunk *ch) {
+    while (ch->done < ch->len) {
+        ssize_t n = pwrite(pl->out_fd, ch->data + ch->done, ch->len - ch->done, ch->offset + (off_t)ch->done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n == 0) errno = EIO;
+            perror("Error writing ciphertext");
+            return -1;
+        }
+        ch->done += (size_t)n;
+    }
+    return 0;
+}
+
+static void *reader_main(void *arg) {
+    pipeline *pl = (pipeline *)arg;
+    size_t next_offset = 0;
+    int order[PIPELINE_MAX_DEPTH];  // Chunk of each sequence number not yet passed on
+    unsigned long submitted = 0, pushed = 0;
+    int io_pending = 0, failed = 0, sent_last = 0;
+    int use_uring = pl->use_uring;
+    uring r;
+
+    if (use_uring && uring_setup(&r, (unsigned)pl->depth) != 0) use_uring = 0;
+
+    while (!sent_last) {
+        int c;
+
+        // Hand free buffers to the disk while there is input left; block on
+        // the free queue only when nothing else can make progress
+        while (!failed && next_offset < pl->file_len &&
+               ((io_pending == 0 && pushed == submitted) ? (c = queue_pop(&pl->free_q), 1)
+                                                         : queue_try_pop(&pl->free_q, &c))) {
+            chunk *ch = &pl->chunks[c];
+            size_t len = pl->file_len - next_offset;
+
+            if (len > pl->chunk_size) len = pl->chunk_size;
+            ch->len = len;
+            ch->done = 0;
+            ch->offset = (off_t)next_offset;
+            ch->ready = 0;
+            ch->last = (next_offset + len == pl->file_len);
+            ch->error = 0;
+            next_offset += len;
+            order[submitted++ % PIPELINE_MAX_DEPTH] = c;
+
+            if (use_uring) {
+                uring_prep(&r, IORING_OP_READ, pl->in_fd, ch->data, len, ch->offset, c);
+                io_pending++;
+            } else {
+                ch->error = (full_pread(pl, ch) != 0);
+                ch->ready = 1;
+                break;  // Pass it on before reading the next one
+            }
+        }
+
+        if (io_pending > 0) {
+            int user_data, res;
+
+            if (uring_enter(&r, 1) != 0) {
+                // The ring is unusable: fail the oldest chunk and stop
+                chunk *ch = &pl->chunks[order[pushed % PIPELINE_MAX_DEPTH]];
+                ch->error = ch->ready = 1;
+                failed = 1;
+            }
+            while (uring_reap(&r, &user_data, &res)) {
+                chunk *ch = &pl->chunks[user_data];
+
+                io_pending--;
+                if (res <= 0) {
+                    errno = res < 0 ? -res : EIO;
+                    perror("Error reading input");
+                    ch->error = 1;
+                    failed = 1;
+                } else if ((ch->done += (size_t)res) < ch->len) {
+                    // Short read: ask for the rest
+                    uring_prep(&r, IORING_OP_READ, pl->in_fd, ch->data + ch->done, ch->len - ch->done,
+                               ch->offset + (off_t)ch->done, user_data);
+                    io_pending++;
+                    continue;
+                }
+                ch->ready = 1;
+            }
+        }
+
+        // Pass completed chunks downstream in file order
+        while (pushed < submitted && !sent_last) {
+            int c = order[pushed % PIPELINE_MAX_DEPTH];
+            chunk *ch = &pl->chunks[c];
+
+            if (!ch->ready) break;
+            pushed++;
+            if (ch->error) ch->last = 1;
+            sent_last = ch->last;
+            queue_push(&pl->read_q, c);
+        }
+    }
+
+    if (use_uring) {
+        // Let any read still in flight land before the buffers can be freed
+        while (io_pending > 0) {
+            int user_data, res;
+            if (uring_enter(&r, 1) != 0) break;
+            while (uring_reap(&r, &user_data, &res)) io_pending--;
+        }
+        uring_free(&r);
+    }
+    return NULL;
+}
+
+static void *writer_main(void *arg) {
+    pipeline *pl = (pipeline *)arg;
+    off_t next_offset = 0;
+    int io_pending = 0, seen_last = 0;
+    int use_uring = pl->use_uring;
+    uring r;
+
+    if (use_uring && uring_setup(&r, (unsigned)pl->depth) != 0) use_uring = 0;
+
+    while (!seen_last || io_pending > 0) {
+        int c;
+
+        // Queue every ciphertext chunk that is ready; block only when idle
+        while (!seen_last && (io_pending == 0 ? (c = queue_pop(&pl->write_q), 1)
+                                              : queue_try_pop(&pl->write_q, &c))) {
+            chunk *ch = &pl->chunks[c];
+
+            seen_last = ch->last;
+            if (ch->error || pl->write_failed || ch->len == 0) {
+                // Nothing (more) to write: recycle the buffer
+                queue_push(&pl->free_q, c);
+                continue;
+            }
+            ch->offset = next_offset;
+            ch->done = 0;
+            next_offset += (off_t)ch->len;
+
+            if (use_uring) {
+                uring_prep(&r, IORING_OP_WRITE, pl->out_fd, ch->data, ch->len, ch->offset, c);
+                io_pending++;
+            } else {
+                if (full_pwrite(pl, ch) != 0) pl->write_failed = 1;
+                queue_push(&pl->free_q, c);
+            }
+        }
+
+        if (io_pending > 0) {
+            int user_data, res;
+
+            if (uring_enter(&r, 1) != 0) {
+                pl->write_failed = 1;
+                break;
+            }
+            while (uring_reap(&r, &user_data, &res)) {
+                chunk *ch = &pl->chunks[user_data];
+
+                io_pending--;
+                if (res <= 0) {
+                    errno = res < 0 ? -res : EIO;
+                    perror("Error writing ciphertext");
+                    pl->write_failed = 1;
+                } else if ((ch->done += (size_t)res) < ch->len) {
+                    uring_prep(&r, IORING_OP_WRITE, pl->out_fd, ch->data + ch->done, ch->len - ch->done,
+                               ch->offset + (off_t)ch->done, user_data);
+                    io_pending++;
+                    continue;
+                }
+                queue_push(&pl->free_q, user_data);
+            }
+        }
+    }
+
+    if (use_uring) uring_free(&r);
+    return NULL;
+}
+
+long long pipeline_encrypt_file(int algo_type, int in_fd, int out_fd, size_t chunk_size, int depth,
+                                unsigned char *enc_key, unsigned char *mac_key,
+                                unsigned char *iv, unsigned char *tag) {
+    pipeline *pl;
+    pthread_t reader, writer;
+    EVP_CIPHER_CTX *ctx;
+    EVP_MAC_CTX *mac = NULL;
+    struct stat st;
+    long long total = 0;
+    int ok = 1, allocated = 0;
+
+    if (depth < 2 || depth > PIPELINE_MAX_DEPTH) {
+        fprintf(stderr, "Pipeline depth must be between 2 and %d\n", PIPELINE_MAX_DEPTH);
+        return -1;
+    }
+    if (chunk_size == 0 || chunk_size > INT32_MAX) {
+        fprintf(stderr, "Invalid pipeline chunk size: %zu\n", chunk_size);
+        return -1;
+    }
+    if (fstat(in_fd, &st) != 0) {
+        perror("Cannot stat input");
+        return -1;
+    }
+    if (!(pl = (pipeline *)calloc(1, sizeof(*pl)))) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+    pl->in_fd = in_fd;
+    pl->out_fd = out_fd;
+    pl->chunk_size = chunk_size;
+    pl->file_len = (size_t)st.st_size;
+    pl->depth = depth;
+    pl->use_uring = pipeline_io_uring_available();
+
+    for (; allocated < depth; allocated++) {
+        if (posix_memalign((void **)&pl->chunks[allocated].data, 4096, chunk_size + EVP_MAX_BLOCK_LENGTH) != 0) {
+            perror("Memory allocation failed");
+            ok = 0;
+            break;
+        }
+        queue_push(&pl->free_q, allocated);
+    }
+
+    ctx = algo_cipher_ctx_new(algo_type, 1, enc_key, iv);
+    if (algo_get(algo_type)->caps & ALGO_CAP_ETM) mac = hmac_sha256_ctx_new(mac_key);
+    // In-place updates must never carry a partial block over (OCB)
+    if (ok && chunk_size % EVP_CIPHER_CTX_get_block_size(ctx) != 0) {
+        fprintf(stderr, "%s needs a chunk size multiple of %d bytes\n", algo_name(algo_type),
+                EVP_CIPHER_CTX_get_block_size(ctx));
+        ok = 0;
+    }
+
+    if (ok && pl->file_len == 0) {
+        // Nothing to read: a single empty chunk carries EVP_EncryptFinal_ex
+        int c = queue_pop(&pl->free_q);
+        pl->chunks[c].len = 0;
+        pl->chunks[c].last = 1;
+        queue_push(&pl->read_q, c);
+    }
+    // Writer first: if the reader cannot start, an error chunk stops the
+    // writer, which is then the only thread touching the buffers
+    if (ok && (errno = pthread_create(&writer, NULL, writer_main, pl)) != 0) {
+        perror("Cannot create writer thread");
+        ok = 0;
+    } else if (ok && pl->file_len > 0 && (errno = pthread_create(&reader, NULL, reader_main, pl)) != 0) {
+        int c = queue_pop(&pl->free_q);
+
+        perror("Cannot create reader thread");
+        pl->chunks[c].len = 0;
+        pl->chunks[c].error = pl->chunks[c].last = 1;
+        pl->write_failed = 1;
+        queue_push(&pl->write_q, c);
+        pthread_join(writer, NULL);
+        ok = 0;
+    }
+
+    // Cipher stage: in place, in file order
+    while (ok) {
+        int c = queue_pop(&pl->read_q);
+        chunk *ch = &pl->chunks[c];
+        int len, final_len, last = ch->last;  // ch may be recycled once pushed
+
+        if (ch->error) {
+            total = -1;
+            queue_push(&pl->write_q, c);
+            break;
+        }
+        if (1 != EVP_EncryptUpdate(ctx, ch->data, &len, ch->data, (int)ch->len)) handle_crypto_error();
+        total += (long long)ch->len;
+        if (last) {
+            // Stream ciphers and CTR/GCM emit nothing here, CBC its padding block
+            if (1 != EVP_EncryptFinal_ex(ctx, ch->data + len, &final_len)) handle_crypto_error();
+            len += final_len;
+        }
+        if (mac && 1 != EVP_MAC_update(mac, ch->data, len)) handle_crypto_error();
+        ch->len = (size_t)len;
+        queue_push(&pl->write_q, c);
+        if (last) break;
+    }
+
+    if (ok) {
+        if (pl->file_len > 0) pthread_join(reader, NULL);
+        pthread_join(writer, NULL);
+        if (pl->write_failed) total = -1;
+    } else {
+        total = -1;
+    }
+
+    if (total >= 0) {
+        size_t mac_len;
+        if (mac) {
+            if (1 != EVP_MAC_final(mac, tag, &mac_len, HMAC_TAG_SIZE)) handle_crypto_error();
+        } else {
+            if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
+        }
+    }
+
+    EVP_MAC_CTX_free(mac);
+    EVP_CIPHER_CTX_free(ctx);
+    for (int i = 0; i < allocated; i++) free(pl->chunks[i].data);
+    free(pl);
+    return total;
+}
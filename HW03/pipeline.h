@@ -0,0 +1,38 @@
+#ifndef HW03_PIPELINE_H
+#define HW03_PIPELINE_H
+
+#include <stddef.h>
+
+#define PIPELINE_DEFAULT_DEPTH 8  // Chunk buffers in flight
+#define PIPELINE_MAX_DEPTH 64
+
+// Three-stage file-to-file encryption on top of the streaming chunk mode:
+//
+//   reader thread   io_uring reads of chunk_size bytes into a ring of
+//                   page-aligned buffers, up to depth reads in flight
+//   calling thread  EVP_EncryptUpdate (+ HMAC for Encrypt-then-MAC) in place,
+//                   in file order, with the same contexts as
+//                   stream_encrypt_file
+//   writer thread   io_uring writes of the ciphertext at increasing offsets
+//
+// The stages hand buffer indices over lock-free single-producer,
+// single-consumer queues (reader -> cipher -> writer -> reader), so disk
+// reads, the cipher and disk writes overlap. A stage with nothing to do
+// sleeps on a futex. The cipher stage is a single thread because the EVP
+// stream (and its MAC) is sequential; the output is byte-identical to
+// stream_encrypt_file with the same key and IV.
+//
+// When io_uring is unavailable (old kernel, seccomp, io_uring_disabled) the
+// reader and writer fall back to blocking pread/pwrite and still overlap
+// with the cipher.
+
+// 1 if io_uring rings can be created here (probed once)
+int pipeline_io_uring_available(void);
+
+// Encrypt in_fd into out_fd (both from offset 0). Returns the number of
+// plaintext bytes processed, or -1 on error.
+long long pipeline_encrypt_file(int algo_type, int in_fd, int out_fd, size_t chunk_size, int depth,
+                                unsigned char *enc_key, unsigned char *mac_key,
+                                unsigned char *iv, unsigned char *tag);
+
+#endif
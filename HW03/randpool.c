@@ -0,0 +1,238 @@
+#include "randpool.h"
+#include "ciphers.h"
+#include "drbg.h"
+
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Buffer states. SERVING and RETIRED are owned by the consumer thread,
+// FILLING by whoever won the EMPTY -> FILLING transition.
+enum { RP_RETIRED, RP_EMPTY, RP_FILLING, RP_FULL, RP_SERVING };
+
+typedef struct {
+    unsigned char data[RAND_POOL_BUF_SIZE];
+    drbg_ctx drbg;
+    int state;
+    unsigned long fills;
+} rand_buffer;
+
+typedef struct {
+    rand_buffer buf[2];
+    int in_use;  // Slot claimed by a thread
+    int active;  // Buffer being served (owner thread only)
+    size_t pos;  // Next unread byte of buf[active]
+    unsigned long inline_refills, background_refills;
+} rand_pool;
+
+static rand_pool pools[RAND_POOL_MAX_THREADS];
+static __thread rand_pool *thread_pool;
+static pthread_key_t exit_key;
+static pthread_once_t exit_key_once = PTHREAD_ONCE_INIT;
+
+static int pool_drbg_type = DRBG_CHACHA20;
+static pthread_t refiller;
+static int refiller_running;
+static int refiller_stop;
+static int refill_seq;  // Futex word: bumped whenever a buffer becomes EMPTY
+
+static int cas_state(rand_buffer *b, int from, int to) {
+    return __atomic_compare_exchange_n(&b->state, &from, to, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static void buffer_fill(rand_buffer *b) {
+    drbg_generate(&b->drbg, b->data, RAND_POOL_BUF_SIZE);
+    if (++b->fills % RAND_POOL_RESEED_REFILLS == 0) {
+        unsigned char seed[DRBG_SEED_SIZE];
+        if (RAND_bytes(seed, sizeof(seed)) != 1) handle_crypto_error();
+        drbg_reseed(&b->drbg, seed, sizeof(seed));
+        OPENSSL_cleanse(seed, sizeof(seed));
+    }
+}
+
+static void wake_refiller(void) {
+    if (!__atomic_load_n(&refiller_running, __ATOMIC_ACQUIRE)) return;
+    __atomic_fetch_add(&refill_seq, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &refill_seq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+static void *refiller_main(void *arg) {
+    (void)arg;
+    while (!__atomic_load_n(&refiller_stop, __ATOMIC_ACQUIRE)) {
+        int seq = __atomic_load_n(&refill_seq, __ATOMIC_ACQUIRE);
+        int filled = 0;
+
+        for (int i = 0; i < RAND_POOL_MAX_THREADS; i++) {
+            if (!__atomic_load_n(&pools[i].in_use, __ATOMIC_ACQUIRE)) continue;
+            for (int j = 0; j < 2; j++) {
+                rand_buffer *b = &pools[i].buf[j];
+                if (cas_state(b, RP_EMPTY, RP_FILLING)) {
+                    buffer_fill(b);
+                    __atomic_store_n(&b->state, RP_FULL, __ATOMIC_RELEASE);
+                    __atomic_fetch_add(&pools[i].background_refills, 1, __ATOMIC_RELAXED);
+                    filled = 1;
+                }
+            }
+        }
+        // Nothing to do: sleep until a consumer empties a buffer
+        if (!filled) syscall(SYS_futex, &refill_seq, FUTEX_WAIT_PRIVATE, seq, NULL, NULL, 0);
+    }
+    return NULL;
+}
+
+int rand_pool_start(int drbg_type) {
+    if (refiller_running) return 1;
+    pool_drbg_type = drbg_type;
+    __atomic_store_n(&refiller_stop, 0, __ATOMIC_RELEASE);
+    if (pthread_create(&refiller, NULL, refiller_main, NULL) != 0) {
+        perror("Cannot start the random pool refiller");
+        return 0;
+    }
+    __atomic_store_n(&refiller_running, 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+void rand_pool_stop(void) {
+    if (!refiller_running) return;
+    __atomic_store_n(&refiller_stop, 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&refill_seq, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &refill_seq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    pthread_join(refiller, NULL);
+    __atomic_store_n(&refiller_running, 0, __ATOMIC_RELEASE);
+}
+
+// Thread exit: take both buffers back from the refiller, then wipe the slot
+static void pool_release(void *arg) {
+    rand_pool *pool = (rand_pool *)arg;
+
+    for (int j = 0; j < 2; j++) {
+        rand_buffer *b = &pool->buf[j];
+        for (;;) {
+            int state = __atomic_load_n(&b->state, __ATOMIC_ACQUIRE);
+            if (state != RP_FILLING && cas_state(b, state, RP_RETIRED)) break;
+            sched_yield();
+        }
+        drbg_free(&b->drbg);
+        OPENSSL_cleanse(b->data, sizeof(b->data));
+        b->fills = 0;
+    }
+    if (pool == thread_pool) thread_pool = NULL;
+    __atomic_store_n(&pool->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void make_exit_key(void) {
+    pthread_key_create(&exit_key, pool_release);
+}
+
+static rand_pool *pool_claim(void) {
+    pthread_once(&exit_key_once, make_exit_key);
+
+    for (int i = 0; i < RAND_POOL_MAX_THREADS; i++) {
+        rand_pool *pool = &pools[i];
+        int free_slot = 0;
+
+        if (!__atomic_compare_exchange_n(&pool->in_use, &free_slot, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            continue;
+        }
+        // The buffers are RETIRED until their DRBGs exist, so the refiller
+        // cannot touch them before this point
+        for (int j = 0; j < 2; j++) drbg_init(&pool->buf[j].drbg, pool_drbg_type, NULL, 0);
+        buffer_fill(&pool->buf[0]);
+        pool->active = 0;
+        pool->pos = 0;
+        pool->inline_refills = 1;
+        pool->background_refills = 0;
+        __atomic_store_n(&pool->buf[0].state, RP_SERVING, __ATOMIC_RELEASE);
+        __atomic_store_n(&pool->buf[1].state, RP_EMPTY, __ATOMIC_RELEASE);
+        wake_refiller();
+
+        pthread_setspecific(exit_key, pool);
+        thread_pool = pool;
+        return pool;
+    }
+    return NULL;
+}
+
+// Give the drained buffer to the refiller and start serving the other one
+static void pool_switch(rand_pool *pool) {
+    rand_buffer *spare = &pool->buf[1 - pool->active];
+
+    __atomic_store_n(&pool->buf[pool->active].state, RP_EMPTY, __ATOMIC_RELEASE);
+    wake_refiller();
+
+    for (;;) {
+        if (__atomic_load_n(&spare->state, __ATOMIC_ACQUIRE) == RP_FULL) break;
+        if (cas_state(spare, RP_EMPTY, RP_FILLING)) {
+            // The refiller is behind (or not running): fill it ourselves
+            buffer_fill(spare);
+            pool->inline_refills++;
+            break;
+        }
+        sched_yield();  // Being filled right now
+    }
+    __atomic_store_n(&spare->state, RP_SERVING, __ATOMIC_RELEASE);
+    pool->active = 1 - pool->active;
+    pool->pos = 0;
+}
+
+void rand_pool_bytes(unsigned char *out, size_t len) {
+    rand_pool *pool = thread_pool ? thread_pool : pool_claim();
+
+    if (!pool) {
+        if (RAND_bytes(out, (int)len) != 1) handle_crypto_error();
+        return;
+    }
+    while (len > 0) {
+        unsigned char *src;
+        size_t n;
+
+        if (pool->pos == RAND_POOL_BUF_SIZE) pool_switch(pool);
+        n = RAND_POOL_BUF_SIZE - pool->pos;
+        if (n > len) n = len;
+        src = pool->buf[pool->active].data + pool->pos;
+        memcpy(out, src, n);
+        memset(src, 0, n);  // Served bytes never stay in memory
+        pool->pos += n;
+        out += n;
+        len -= n;
+    }
+}
+
+void rand_pool_stats(unsigned long *inline_refills, unsigned long *background_refills) {
+    rand_pool *pool = thread_pool;
+
+    *inline_refills = pool ? pool->inline_refills : 0;
+    *background_refills = pool ? __atomic_load_n(&pool->background_refills, __ATOMIC_RELAXED) : 0;
+}
+
+int nonce_ctr_init(nonce_ctr *nc, int iv_len, uint32_t fixed) {
+    int fixed_at = iv_len - 12;  // The 32-bit fixed field sits right before the counter
+
+    if (iv_len < 12 || iv_len > (int)sizeof(nc->iv)) return 0;
+    memset(nc, 0, sizeof(*nc));
+    nc->iv_len = iv_len;
+    if (fixed_at > 0 && RAND_bytes(nc->iv, fixed_at) != 1) handle_crypto_error();
+    nc->iv[fixed_at] = (unsigned char)(fixed >> 24);
+    nc->iv[fixed_at + 1] = (unsigned char)(fixed >> 16);
+    nc->iv[fixed_at + 2] = (unsigned char)(fixed >> 8);
+    nc->iv[fixed_at + 3] = (unsigned char)fixed;
+    return 1;
+}
+
+int nonce_ctr_next(nonce_ctr *nc, unsigned char *iv) {
+    uint64_t c = nc->counter;
+
+    if (c == UINT64_MAX) return 0;
+    nc->counter++;
+    for (int i = nc->iv_len - 1; i >= nc->iv_len - 8; i--) {
+        nc->iv[i] = (unsigned char)c;
+        c >>= 8;
+    }
+    memcpy(iv, nc->iv, nc->iv_len);
+    return 1;
+}
@@ -0,0 +1,51 @@
+#ifndef HW03_RANDPOOL_H
+#define HW03_RANDPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RAND_POOL_BUF_SIZE (64 * 1024)  // Bytes per buffer, two buffers per thread
+#define RAND_POOL_MAX_THREADS 64        // Threads beyond this fall back to RAND_bytes
+#define RAND_POOL_RESEED_REFILLS 4096   // Refills of a buffer between reseeds from RAND_bytes
+
+// Per-thread random pool for IVs and nonces.
+//
+// Every thread owns two buffers, each filled by its own DRBG (drbg.h,
+// seeded from RAND_bytes). The thread serves bytes from one buffer while
+// the other is refilled by the background thread of rand_pool_start, so
+// the fast path is a memcpy with no lock and no shared cache line. Buffer
+// ownership moves between the two threads with atomic state transitions
+// (EMPTY -> FILLING -> FULL -> SERVING -> EMPTY); if the spare buffer is
+// still empty when needed, the consumer claims it and fills it inline.
+// Served bytes are wiped from the buffer.
+
+// Start/stop the background refiller. Without it every refill is inline.
+// drbg_type is the generator of pools created afterwards (DRBG_CHACHA20,
+// DRBG_AES_CTR or DRBG_HMAC).
+int rand_pool_start(int drbg_type);
+void rand_pool_stop(void);
+
+// len random bytes from the calling thread's pool (created on first use,
+// released when the thread exits)
+void rand_pool_bytes(unsigned char *out, size_t len);
+
+// Refills of the calling thread's pool so far
+void rand_pool_stats(unsigned long *inline_refills, unsigned long *background_refills);
+
+// Deterministic nonces for the AEADs (NIST SP 800-38D 8.2.1 layout): a
+// fixed field, then a 64-bit big-endian invocation counter. One generator
+// per key; the fixed field must differ between generators sharing a key
+// (e.g. the thread index). For IVs longer than 12 bytes the extra leading
+// bytes are random per generator.
+typedef struct {
+    unsigned char iv[32];  // Current IV: fixed field || counter
+    int iv_len;            // 12 to 32 bytes
+    uint64_t counter;
+} nonce_ctr;
+
+int nonce_ctr_init(nonce_ctr *nc, int iv_len, uint32_t fixed);
+
+// Next nonce into iv, 0 once the counter is exhausted (never reuse a nonce)
+int nonce_ctr_next(nonce_ctr *nc, unsigned char *iv);
+
+#endif
@@ -0,0 +1,150 @@
+#include "ciphers.h"
+
+#include <openssl/err.h>
+#include <pthread.h>
+#include <stddef.h>
+
+// Adapters from the registry signature to the original one-shot functions
+
+static int ctr_hmac_encrypt_entry(int algo_type, unsigned char *plaintext, int plaintext_len,
+                                  unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                                  unsigned char *ciphertext, unsigned char *tag) {
+    return aes_ctr_hmac_encrypt(plaintext, plaintext_len, enc_key, mac_key, iv, ciphertext, tag);
+}
+
+static int ctr_hmac_decrypt_entry(int algo_type, unsigned char *ciphertext, int ciphertext_len,
+                                  unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                                  unsigned char *tag, unsigned char *plaintext) {
+    return aes_ctr_hmac_decrypt(ciphertext, ciphertext_len, enc_key, mac_key, iv, tag, plaintext);
+}
+
+static int chacha_hmac_encrypt_entry(int algo_type, unsigned char *plaintext, int plaintext_len,
+                                     unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                                     unsigned char *ciphertext, unsigned char *tag) {
+    return chacha20_hmac_encrypt(plaintext, plaintext_len, enc_key, mac_key, iv, ciphertext, tag);
+}
+
+static int chacha_hmac_decrypt_entry(int algo_type, unsigned char *ciphertext, int ciphertext_len,
+                                     unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                                     unsigned char *tag, unsigned char *plaintext) {
+    return chacha20_hmac_decrypt(ciphertext, ciphertext_len, enc_key, mac_key, iv, tag, plaintext);
+}
+
+static int gcm_encrypt_entry(int algo_type, unsigned char *plaintext, int plaintext_len,
+                             unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                             unsigned char *ciphertext, unsigned char *tag) {
+    return aes_gcm_encrypt(plaintext, plaintext_len, enc_key, iv, ciphertext, tag);
+}
+
+static int gcm_decrypt_entry(int algo_type, unsigned char *ciphertext, int ciphertext_len,
+                             unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                             unsigned char *tag, unsigned char *plaintext) {
+    return aes_gcm_decrypt(ciphertext, ciphertext_len, enc_key, iv, tag, plaintext);
+}
+
+static int poly1305_encrypt_entry(int algo_type, unsigned char *plaintext, int plaintext_len,
+                                  unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                                  unsigned char *ciphertext, unsigned char *tag) {
+    return chacha20_poly1305_encrypt(plaintext, plaintext_len, enc_key, iv, ciphertext, tag);
+}
+
+static int poly1305_decrypt_entry(int algo_type, unsigned char *ciphertext, int ciphertext_len,
+                                  unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                                  unsigned char *tag, unsigned char *plaintext) {
+    return chacha20_poly1305_decrypt(ciphertext, ciphertext_len, enc_key, iv, tag, plaintext);
+}
+
+#define ETM_CAPS (ALGO_CAP_ETM | ALGO_CAP_SEEKABLE | ALGO_CAP_STREAMING | ALGO_CAP_POOLABLE)
+#define AEAD_CAPS (ALGO_CAP_AEAD | ALGO_CAP_STREAMING | ALGO_CAP_POOLABLE)
+
+// Indexed by algo_type; entry 0 is unused
+static const algo_desc registry[NUM_ALGOS + 1] = {
+    [1] = { "AES-128-CTR + HMAC-SHA256", "AES-128-CTR", AES_KEY_SIZE, HMAC_KEY_SIZE, IV_SIZE, HMAC_TAG_SIZE,
+            ETM_CAPS, evp_cipher_ctx_new, ctr_hmac_encrypt_entry, ctr_hmac_decrypt_entry,
+            aes_ctr_hmac_encrypt_fused, aes_ctr_hmac_decrypt_fused },
+    [2] = { "ChaCha20 + HMAC-SHA256", "ChaCha20", KEY_SIZE, HMAC_KEY_SIZE, IV_SIZE, HMAC_TAG_SIZE,
+            ETM_CAPS, evp_cipher_ctx_new, chacha_hmac_encrypt_entry, chacha_hmac_decrypt_entry,
+            chacha20_hmac_encrypt_fused, chacha20_hmac_decrypt_fused },
+    [3] = { "AES-128-GCM", "AES-128-GCM", AES_KEY_SIZE, 0, IV_SIZE, AEAD_TAG_SIZE,
+            AEAD_CAPS, evp_cipher_ctx_new, gcm_encrypt_entry, gcm_decrypt_entry, NULL, NULL },
+    [4] = { "ChaCha20-Poly1305", "ChaCha20-Poly1305", KEY_SIZE, 0, NONCE_SIZE, AEAD_TAG_SIZE,
+            AEAD_CAPS, evp_cipher_ctx_new, poly1305_encrypt_entry, poly1305_decrypt_entry, NULL, NULL },
+    [5] = { "AES-256-GCM", "AES-256-GCM", KEY_SIZE, 0, NONCE_SIZE, AEAD_TAG_SIZE,
+            AEAD_CAPS, evp_cipher_ctx_new, aead_encrypt, aead_decrypt, NULL, NULL },
+    // Single update per message (the tag is the synthetic IV), so no streaming
+    [6] = { "AES-128-GCM-SIV", "AES-128-GCM-SIV", AES_KEY_SIZE, 0, NONCE_SIZE, AEAD_TAG_SIZE,
+            ALGO_CAP_AEAD | ALGO_CAP_POOLABLE, evp_cipher_ctx_new, aead_encrypt, aead_decrypt, NULL, NULL },
+    [7] = { "AES-128-OCB", "AES-128-OCB", AES_KEY_SIZE, 0, NONCE_SIZE, AEAD_TAG_SIZE,
+            AEAD_CAPS, evp_cipher_ctx_new, aead_encrypt, aead_decrypt, NULL, NULL },
+    // Subkey derived per nonce, so contexts cannot be keyed ahead of the nonce
+    [8] = { "XChaCha20-Poly1305", "ChaCha20-Poly1305", KEY_SIZE, 0, XNONCE_SIZE, AEAD_TAG_SIZE,
+            ALGO_CAP_AEAD | ALGO_CAP_STREAMING, xchacha20_poly1305_ctx_new, aead_encrypt, aead_decrypt,
+            NULL, NULL },
+};
+
+// Ciphers fetched once for the whole process: no implicit fetch per context,
+// and the parallel workers only ever read the table
+static EVP_CIPHER *fetched[NUM_ALGOS + 1];
+static pthread_once_t fetch_once = PTHREAD_ONCE_INIT;
+
+static void fetch_ciphers(void) {
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        fetched[algo_type] = EVP_CIPHER_fetch(NULL, registry[algo_type].cipher_name, NULL);
+    }
+    ERR_clear_error();  // Missing ciphers are reported through algo_available
+}
+
+const algo_desc *algo_get(int algo_type) {
+    if (algo_type < 1 || algo_type > NUM_ALGOS) return NULL;
+    return &registry[algo_type];
+}
+
+int algo_available(int algo_type) {
+    if (!algo_get(algo_type)) return 0;
+    pthread_once(&fetch_once, fetch_ciphers);
+    return fetched[algo_type] != NULL;
+}
+
+int algo_has(int algo_type, unsigned int caps) {
+    return algo_available(algo_type) && (registry[algo_type].caps & caps) == caps;
+}
+
+const char *algo_name(int algo_type) {
+    const algo_desc *algo = algo_get(algo_type);
+    return algo ? algo->name : NULL;
+}
+
+const EVP_CIPHER *algo_cipher(int algo_type) {
+    if (!algo_available(algo_type)) return NULL;
+    return fetched[algo_type];
+}
+
+int algo_iv_len(int algo_type) {
+    return registry[algo_type].iv_len;
+}
+
+// Derive the working keys of algo_type, using the algorithm name as HKDF info
+int derive_algo_keys(unsigned char *master_key, const char *algo_name, int algo_type,
+                     unsigned char *enc_key, unsigned char *mac_key) {
+    const algo_desc *algo = algo_get(algo_type);
+    return derive_keys(master_key, algo_name, enc_key, algo->key_len, mac_key, algo->mac_key_len);
+}
+
+EVP_CIPHER_CTX *algo_cipher_ctx_new(int algo_type, int enc,
+                                    unsigned char *key, unsigned char *iv) {
+    return registry[algo_type].init(algo_type, enc, key, iv);
+}
+
+int algo_encrypt(int algo_type, unsigned char *plaintext, int plaintext_len,
+                 unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                 unsigned char *ciphertext, unsigned char *tag) {
+    return registry[algo_type].encrypt(algo_type, plaintext, plaintext_len, enc_key, mac_key,
+                                       iv, ciphertext, tag);
+}
+
+int algo_decrypt(int algo_type, unsigned char *ciphertext, int ciphertext_len,
+                 unsigned char *enc_key, unsigned char *mac_key, unsigned char *iv,
+                 unsigned char *tag, unsigned char *plaintext) {
+    return registry[algo_type].decrypt(algo_type, ciphertext, ciphertext_len, enc_key, mac_key,
+                                       iv, tag, plaintext);
+}
@@ -6,14 +6,29 @@ echo "  Homework 03 - Nicolas Leone (1986354)"
 echo "================================================================="
 echo ""
 
+# Optional thread sweep for the parallel engine, e.g. THREADS=1,2,4,8 ./run_all_tests.sh
+THREADS="${THREADS:-}"
+# BATCH=1 runs every file and algorithm in a single process on the
+# work-stealing pool (one key setup, one consolidated CSV) instead of the loop
+BATCH="${BATCH:-}"
+
 # Array of test files
 test_files=("testfile_1MB.bin" "testfile_5MB.bin" "testfile_10MB.bin" "testfile_50MB.bin" "testfile_100MB.bin")
 
+if [ -n "$BATCH" ]; then
+    ls "${test_files[@]}" > testfiles.lst 2>/dev/null
+    ./HW03 --files testfiles.lst
+    exit $?
+fi
+
 # Run tests for each file size
 for file in "${test_files[@]}"; do
     if [ -f "$file" ]; then
         echo "Testing with $file..."
         ./HW03 "$file"
+        if [ -n "$THREADS" ]; then
+            ./HW03 --threads "$THREADS" "$file"
+        fi
         echo ""
         echo "-----------------------------------------------------------------"
         echo ""
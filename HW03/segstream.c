@@ -0,0 +1,325 @@
+#include "segstream.h"
+#include "ciphers.h"
+#include "tagcmp.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Per-file state shared by the segment functions
+typedef struct {
+    int algo_type;
+    int etm;    // Encrypt-then-MAC: continuous keystream + HMAC per segment
+    int rekey;  // Nonce-dependent key schedule (XChaCha20): new context per segment
+    int tag_len;
+    EVP_CIPHER_CTX *ctx;
+    EVP_MAC_CTX *mac;
+    unsigned char *enc_key;
+    unsigned char header[SEG_HEADER_MAX];
+    size_t header_len;
+    unsigned char iv[MAX_IV_SIZE];
+    int iv_len;
+    EVP_MD_CTX *md;  // Optional SHA-256 of the plaintext
+} seg_state;
+
+static void put_be32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+static uint32_t get_be32(const unsigned char *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static int seg_state_init(seg_state *st, int algo_type, unsigned char *enc_key,
+                          unsigned char *mac_key, unsigned char *plain_digest) {
+    const algo_desc *algo = algo_get(algo_type);
+
+    memset(st, 0, sizeof(*st));
+    if (!algo_has(algo_type, ALGO_CAP_STREAMING) || algo->iv_len < 12) {
+        fprintf(stderr, "%s cannot be used for segmented streams\n", algo_name(algo_type));
+        return -1;
+    }
+    st->algo_type = algo_type;
+    st->etm = (algo->caps & ALGO_CAP_ETM) != 0;
+    st->rekey = !st->etm && !(algo->caps & ALGO_CAP_POOLABLE);
+    st->tag_len = st->etm ? HMAC_TAG_SIZE : AEAD_TAG_SIZE;
+    st->iv_len = algo->iv_len;
+    st->enc_key = enc_key;
+    if (st->etm) st->mac = hmac_sha256_ctx_new(mac_key);
+    if (plain_digest) {
+        if (!(st->md = EVP_MD_CTX_new())) handle_crypto_error();
+        if (1 != EVP_DigestInit_ex(st->md, EVP_sha256(), NULL)) handle_crypto_error();
+    }
+    return 0;
+}
+
+// Keyed once, after the header (and so the base IV) is known
+static void seg_state_key(seg_state *st, int enc) {
+    if (!st->rekey) st->ctx = algo_cipher_ctx_new(st->algo_type, enc, st->enc_key, st->iv);
+}
+
+static void seg_state_free(seg_state *st, unsigned char *plain_digest) {
+    if (st->md) {
+        if (1 != EVP_DigestFinal_ex(st->md, plain_digest, NULL)) handle_crypto_error();
+        EVP_MD_CTX_free(st->md);
+    }
+    EVP_CIPHER_CTX_free(st->ctx);
+    EVP_MAC_CTX_free(st->mac);
+    OPENSSL_cleanse(st, sizeof(*st));
+}
+
+// nonce_i = IV[0 .. iv_len-5) || be32(i) || last
+static void seg_nonce(const seg_state *st, uint32_t index, int last, unsigned char *nonce) {
+    memcpy(nonce, st->iv, st->iv_len);
+    put_be32(nonce + st->iv_len - 5, index);
+    nonce[st->iv_len - 1] = (unsigned char)(last != 0);
+}
+
+// HMAC-SHA256(K, header || be32(i) || last || C_i)
+static void seg_hmac(seg_state *st, uint32_t index, int last, const unsigned char *ct, size_t len,
+                     unsigned char *tag) {
+    unsigned char position[5];
+    size_t mac_len;
+
+    put_be32(position, index);
+    position[4] = (unsigned char)(last != 0);
+    if (1 != EVP_MAC_init(st->mac, NULL, 0, NULL)) handle_crypto_error();
+    if (1 != EVP_MAC_update(st->mac, st->header, st->header_len)) handle_crypto_error();
+    if (1 != EVP_MAC_update(st->mac, position, sizeof(position))) handle_crypto_error();
+    if (1 != EVP_MAC_update(st->mac, ct, len)) handle_crypto_error();
+    if (1 != EVP_MAC_final(st->mac, tag, &mac_len, HMAC_TAG_SIZE)) handle_crypto_error();
+}
+
+// Set up the AEAD context for segment i and feed the header as AAD
+static void seg_aead_begin(seg_state *st, int enc, uint32_t index, int last) {
+    unsigned char nonce[MAX_IV_SIZE];
+    int len;
+
+    seg_nonce(st, index, last, nonce);
+    if (st->rekey) {
+        EVP_CIPHER_CTX_free(st->ctx);
+        st->ctx = algo_cipher_ctx_new(st->algo_type, enc, st->enc_key, nonce);
+    } else {
+        if (1 != EVP_CipherInit_ex(st->ctx, NULL, NULL, NULL, nonce, enc)) handle_crypto_error();
+    }
+    if (1 != EVP_CipherUpdate(st->ctx, NULL, &len, st->header, (int)st->header_len)) handle_crypto_error();
+}
+
+// C_i || T_i into out, returns its length
+static size_t seg_seal(seg_state *st, uint32_t index, int last, const unsigned char *in, size_t len,
+                       unsigned char *out) {
+    int out_len = 0, final_len = 0;
+
+    if (st->md && 1 != EVP_DigestUpdate(st->md, in, len)) handle_crypto_error();
+    if (st->etm) {
+        if (len > 0 && 1 != EVP_EncryptUpdate(st->ctx, out, &out_len, in, (int)len)) handle_crypto_error();
+        seg_hmac(st, index, last, out, len, out + len);
+    } else {
+        seg_aead_begin(st, 1, index, last);
+        if (len > 0 && 1 != EVP_EncryptUpdate(st->ctx, out, &out_len, in, (int)len)) handle_crypto_error();
+        if (1 != EVP_EncryptFinal_ex(st->ctx, out + out_len, &final_len)) handle_crypto_error();
+        if (1 != EVP_CIPHER_CTX_ctrl(st->ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, out + len)) handle_crypto_error();
+    }
+    return len + st->tag_len;
+}
+
+// Verify T_i, then decrypt C_i into out; -1 without releasing anything on a mismatch
+static int seg_open(seg_state *st, uint32_t index, int last, const unsigned char *in, size_t len,
+                    unsigned char *out) {
+    const unsigned char *tag = in + len;
+    int out_len = 0, final_len = 0;
+
+    if (st->etm) {
+        unsigned char computed_tag[HMAC_TAG_SIZE];
+        seg_hmac(st, index, last, in, len, computed_tag);
+        if (!tag_equal(tag, computed_tag, HMAC_TAG_SIZE)) return -1;
+        if (len > 0 && 1 != EVP_DecryptUpdate(st->ctx, out, &out_len, in, (int)len)) handle_crypto_error();
+    } else {
+        seg_aead_begin(st, 0, index, last);
+        if (1 != EVP_CIPHER_CTX_ctrl(st->ctx, EVP_CTRL_AEAD_SET_TAG, AEAD_TAG_SIZE, (void *)tag)) handle_crypto_error();
+        if (len > 0 && 1 != EVP_DecryptUpdate(st->ctx, out, &out_len, in, (int)len)) handle_crypto_error();
+        if (EVP_DecryptFinal_ex(st->ctx, out + out_len, &final_len) <= 0) return -1;
+    }
+    if (st->md && 1 != EVP_DigestUpdate(st->md, out, len)) handle_crypto_error();
+    return 0;
+}
+
+long long seg_encrypt_file(int algo_type, FILE *in, FILE *out, size_t segment_size,
+                           unsigned char *enc_key, unsigned char *mac_key,
+                           const unsigned char *iv, unsigned char *plain_digest) {
+    seg_state st;
+    unsigned char *cur, *next, *sealed;
+    size_t cur_len, next_len = 0;
+    long long total = 0;
+    uint64_t index = 0;
+
+    if (segment_size == 0 || segment_size > SEG_MAX_SIZE) {
+        fprintf(stderr, "Segment size must be between 1 and %d bytes\n", SEG_MAX_SIZE);
+        return -1;
+    }
+    if (seg_state_init(&st, algo_type, enc_key, mac_key, plain_digest) != 0) return -1;
+
+    memcpy(st.iv, iv, st.iv_len);
+    memcpy(st.header, SEG_MAGIC, 4);
+    st.header[4] = 1;
+    st.header[5] = (unsigned char)algo_type;
+    st.header[6] = (unsigned char)st.iv_len;
+    st.header[7] = 0;
+    put_be32(st.header + 8, (uint32_t)segment_size);
+    memcpy(st.header + SEG_HEADER_FIXED, iv, st.iv_len);
+    st.header_len = SEG_HEADER_FIXED + st.iv_len;
+    seg_state_key(&st, 1);
+
+    cur = (unsigned char *)malloc(segment_size);
+    next = (unsigned char *)malloc(segment_size);
+    sealed = (unsigned char *)malloc(segment_size + HMAC_TAG_SIZE + EVP_MAX_BLOCK_LENGTH);
+    if (!cur || !next || !sealed) {
+        perror("Memory allocation failed");
+        total = -1;
+        goto done;
+    }
+    if (out && fwrite(st.header, 1, st.header_len, out) != st.header_len) {
+        perror("Error writing stream header");
+        total = -1;
+        goto done;
+    }
+
+    // One segment of read-ahead tells whether the current one is the last
+    cur_len = fread(cur, 1, segment_size, in);
+    for (;;) {
+        unsigned char *swap;
+        size_t sealed_len;
+        int last;
+
+        if (cur_len == segment_size) next_len = fread(next, 1, segment_size, in);
+        if (ferror(in)) {
+            perror("Error reading input");
+            total = -1;
+            break;
+        }
+        last = (cur_len < segment_size || next_len == 0);
+        if (index > UINT32_MAX) {
+            fprintf(stderr, "Too many segments for a 32-bit counter\n");
+            total = -1;
+            break;
+        }
+
+        sealed_len = seg_seal(&st, (uint32_t)index, last, cur, cur_len, sealed);
+        if (out && fwrite(sealed, 1, sealed_len, out) != sealed_len) {
+            perror("Error writing ciphertext");
+            total = -1;
+            break;
+        }
+        total += (long long)cur_len;
+        index++;
+        if (last) break;
+
+        swap = cur;
+        cur = next;
+        next = swap;
+        cur_len = next_len;
+        next_len = 0;
+    }
+
+done:
+    seg_state_free(&st, plain_digest);
+    free(cur);
+    free(next);
+    free(sealed);
+    return total;
+}
+
+long long seg_decrypt_file(int algo_type, FILE *in, FILE *out,
+                           unsigned char *enc_key, unsigned char *mac_key,
+                           unsigned char *plain_digest) {
+    seg_state st;
+    unsigned char *cur = NULL, *next = NULL, *plain = NULL;
+    size_t segment_size, record, cur_len, next_len = 0;
+    long long total = 0;
+    uint64_t index = 0;
+
+    if (seg_state_init(&st, algo_type, enc_key, mac_key, plain_digest) != 0) return -1;
+
+    if (fread(st.header, 1, SEG_HEADER_FIXED, in) != SEG_HEADER_FIXED ||
+        memcmp(st.header, SEG_MAGIC, 4) != 0 || st.header[4] != 1 ||
+        st.header[5] != algo_type || st.header[6] != st.iv_len || st.header[7] != 0 ||
+        fread(st.header + SEG_HEADER_FIXED, 1, st.iv_len, in) != (size_t)st.iv_len) {
+        fprintf(stderr, "Not a %s segmented stream\n", algo_name(algo_type));
+        total = -1;
+        goto done;
+    }
+    segment_size = get_be32(st.header + 8);
+    if (segment_size == 0 || segment_size > SEG_MAX_SIZE) {
+        fprintf(stderr, "Invalid segment size in stream header: %zu\n", segment_size);
+        total = -1;
+        goto done;
+    }
+    st.header_len = SEG_HEADER_FIXED + st.iv_len;
+    memcpy(st.iv, st.header + SEG_HEADER_FIXED, st.iv_len);
+    seg_state_key(&st, 0);
+
+    record = segment_size + st.tag_len;
+    cur = (unsigned char *)malloc(record);
+    next = (unsigned char *)malloc(record);
+    plain = (unsigned char *)malloc(segment_size + EVP_MAX_BLOCK_LENGTH);
+    if (!cur || !next || !plain) {
+        perror("Memory allocation failed");
+        total = -1;
+        goto done;
+    }
+
+    cur_len = fread(cur, 1, record, in);
+    for (;;) {
+        unsigned char *swap;
+        size_t len;
+        int last;
+
+        if (cur_len == record) next_len = fread(next, 1, record, in);
+        if (ferror(in)) {
+            perror("Error reading input");
+            total = -1;
+            break;
+        }
+        // A short record must be the final one; a missing one is a truncation
+        last = (cur_len < record || next_len == 0);
+        if (cur_len < (size_t)st.tag_len || index > UINT32_MAX) {
+            fprintf(stderr, "Segmented stream truncated\n");
+            total = -1;
+            break;
+        }
+        len = cur_len - st.tag_len;
+
+        if (seg_open(&st, (uint32_t)index, last, cur, len, plain) != 0) {
+            fprintf(stderr, "Segment %llu failed authentication%s\n", (unsigned long long)index,
+                    last ? " (or the stream was truncated)" : "");
+            total = -1;
+            break;
+        }
+        if (out && fwrite(plain, 1, len, out) != len) {
+            perror("Error writing plaintext");
+            total = -1;
+            break;
+        }
+        total += (long long)len;
+        index++;
+        if (last) break;
+
+        swap = cur;
+        cur = next;
+        next = swap;
+        cur_len = next_len;
+        next_len = 0;
+    }
+
+done:
+    seg_state_free(&st, plain_digest);
+    free(cur);
+    free(next);
+    free(plain);
+    return total;
+}
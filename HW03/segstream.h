@@ -0,0 +1,46 @@
+#ifndef HW03_SEGSTREAM_H
+#define HW03_SEGSTREAM_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define SEG_DEFAULT_SIZE (64 * 1024)
+#define SEG_MAX_SIZE (64 * 1024 * 1024)  // Largest segment a decryptor will buffer
+#define SEG_MAGIC "HW3S"
+#define SEG_HEADER_FIXED 12              // magic, version, algo_type, iv_len, 0, be32 segment size
+#define SEG_HEADER_MAX (SEG_HEADER_FIXED + 24)
+
+// Segmented authenticated stream format (STREAM, Hoang-Reyhanitabar-Rogaway-
+// Vizar 2015), so decryption can verify and release one segment at a time:
+//
+//   header    "HW3S" || 0x01 || algo_type || iv_len || 0x00 ||
+//             be32(segment_size) || base IV (iv_len bytes, random)
+//   segment i C_i || T_i, |C_i| = segment_size except for the last one
+//             (0 to segment_size bytes; an empty input is one empty segment)
+//
+// Segment i uses nonce_i = IV[0 .. iv_len-5) || be32(i) || last, where last
+// is 1 for the final segment and 0 otherwise. For the AEAD modes nonce_i is
+// the segment's nonce and the header its associated data. For
+// Encrypt-then-MAC the keystream runs continuously from the base IV across
+// the segments and T_i = HMAC-SHA256(K, header || be32(i) || last || C_i).
+// The counter stops reordering and dropping segments, and the last flag
+// stops truncation at a segment boundary.
+//
+// Decryption holds one segment. It releases segment i only after T_i has
+// verified, so all plaintext written is authentic. On an error, what was
+// written is an authentic prefix and the call returns -1.
+
+// Returns the number of plaintext bytes processed, or -1 on error.
+// iv holds algo_iv_len(algo_type) bytes (segments are limited to 2^32).
+long long seg_encrypt_file(int algo_type, FILE *in, FILE *out, size_t segment_size,
+                           unsigned char *enc_key, unsigned char *mac_key,
+                           const unsigned char *iv, unsigned char *plain_digest);
+
+// out may be NULL to discard the plaintext; the header must name algo_type.
+// Returns the number of plaintext bytes released, or -1 on a tag mismatch,
+// truncation, malformed header or I/O error.
+long long seg_decrypt_file(int algo_type, FILE *in, FILE *out,
+                           unsigned char *enc_key, unsigned char *mac_key,
+                           unsigned char *plain_digest);
+
+#endif
@@ -0,0 +1,897 @@
+#define _GNU_SOURCE  // accept4
+
+#include "service.h"
+#include "bench.h"
+#include "ciphers.h"
+#include "kernels.h"
+#include "randpool.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HIST_BUCKETS 40          // Bucket b counts latencies in [2^b, 2^(b+1)) ns
+#define LOOP_MAX_EVENTS 64
+#define READ_CHUNK (64 * 1024)   // Free space ensured before every read
+#define BATCH_SCAN_LIMIT (4 * SERVICE_BATCH_MAX)  // Queued requests looked at per batch
+
+typedef struct {
+    unsigned long counts[HIST_BUCKETS];
+    unsigned long total;
+} histogram;
+
+// A client connection. The loop owns the input side; the output side is
+// shared with the workers under out_lock. refs counts the loop (until it
+// stops polling the socket) plus every queued request; the last release
+// closes the socket.
+typedef struct conn {
+    int fd;
+    int refs;
+    int closed;  // The loop has stopped polling it
+    unsigned char *in;
+    size_t in_len, in_cap;
+    pthread_mutex_t out_lock;
+    unsigned char *out;
+    size_t out_len, out_cap;
+    int want_write;         // EPOLLOUT registered
+    int close_after_flush;  // A SERVICE_TOO_LARGE reply is pending
+    struct conn *prev, *next;  // Loop's list of open connections
+} conn;
+
+typedef struct request {
+    struct request *next;
+    conn *c;
+    int op, algo_type;
+    uint32_t id;
+    struct timespec arrived;
+    size_t len;
+    unsigned char body[];
+} request;
+
+struct service;
+
+typedef struct {
+    struct service *svc;
+    kernel *kernels[NUM_ALGOS + 1];  // Created on first use
+    unsigned char *scratch;
+    size_t scratch_len;
+    pthread_t thread;
+} worker;
+
+struct service {
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    int listen_fd, epoll_fd, wake_fd;
+    int batch_max;
+    pthread_t loop_thread;
+    int loop_started;
+    worker workers[SERVICE_MAX_WORKERS];
+    int num_workers;
+    unsigned char enc_keys[NUM_ALGOS + 1][KEY_SIZE];
+    unsigned char mac_keys[NUM_ALGOS + 1][HMAC_KEY_SIZE];
+    conn *conns;  // Loop only
+
+    pthread_mutex_t lock;  // Request queue
+    pthread_cond_t ready;
+    request *head, *tail;
+    int stopping;
+
+    histogram latency[SERVICE_OP_STATS + 1];  // Indexed by op
+    unsigned long batches, batched_requests, requests;
+};
+
+// epoll tags of the two non-connection descriptors
+static char listen_tag, wake_tag;
+
+static void put_be32(unsigned char *p, uint32_t v) {
+    p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static uint32_t get_be32(const unsigned char *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void hist_record(histogram *h, long long ns) {
+    int b = 0;
+
+    while (b < HIST_BUCKETS - 1 && ns >= (2LL << b)) b++;
+    __atomic_fetch_add(&h->counts[b], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->total, 1, __ATOMIC_RELAXED);
+}
+
+// Upper bound of the bucket holding the pct-th percentile, in ns
+static long long hist_percentile(const histogram *h, int pct) {
+    unsigned long rank = (h->total * pct + 99) / 100, seen = 0;
+
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen >= rank && seen > 0) return 2LL << b;
+    }
+    return 0;
+}
+
+// --- Connections ---
+
+static void conn_release(conn *c) {
+    if (__atomic_sub_fetch(&c->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    close(c->fd);
+    pthread_mutex_destroy(&c->out_lock);
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+// Loop only: stop polling c and drop the loop's reference
+static void conn_close(struct service *svc, conn *c) {
+    pthread_mutex_lock(&c->out_lock);
+    c->closed = 1;
+    epoll_ctl(svc->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    pthread_mutex_unlock(&c->out_lock);
+    shutdown(c->fd, SHUT_RD);
+
+    if (c->prev) c->prev->next = c->next;
+    else svc->conns = c->next;
+    if (c->next) c->next->prev = c->prev;
+    conn_release(c);
+}
+
+static void conn_watch(struct service *svc, conn *c, int want_write) {
+    struct epoll_event ev = {.events = EPOLLIN | (want_write ? EPOLLOUT : 0), .data.ptr = c};
+
+    if (c->closed || c->want_write == want_write) return;
+    epoll_ctl(svc->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->want_write = want_write;
+}
+
+// Send what is buffered, under out_lock; -1 if the peer is gone
+static int conn_drain(conn *c) {
+    size_t off = 0;
+
+    while (off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + off, c->out_len - off, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            off += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            c->out_len = 0;
+            return -1;
+        }
+    }
+    memmove(c->out, c->out + off, c->out_len - off);
+    c->out_len -= off;
+    return 0;
+}
+
+static int conn_append(conn *c, const struct iovec *iov, int iov_count, size_t skip) {
+    size_t total = 0;
+
+    for (int i = 0; i < iov_count; i++) total += iov[i].iov_len;
+    total -= skip;
+    if (c->out_len + total > c->out_cap) {
+        size_t cap = c->out_cap ? c->out_cap : 4096;
+        unsigned char *out;
+        while (cap < c->out_len + total) cap *= 2;
+        if (!(out = realloc(c->out, cap))) return -1;
+        c->out = out;
+        c->out_cap = cap;
+    }
+    for (int i = 0; i < iov_count; i++) {
+        size_t len = iov[i].iov_len;
+        const unsigned char *p = iov[i].iov_base;
+        if (skip >= len) {
+            skip -= len;
+            continue;
+        }
+        memcpy(c->out + c->out_len, p + skip, len - skip);
+        c->out_len += len - skip;
+        skip = 0;
+    }
+    return 0;
+}
+
+// Queue one response frame: straight to the socket if nothing is pending,
+// the rest into the output buffer, and EPOLLOUT until it is drained
+static void conn_reply(struct service *svc, conn *c, int status, int op, uint32_t id,
+                       const struct iovec *parts, int num_parts) {
+    unsigned char header[SERVICE_HEADER_SIZE];
+    struct iovec iov[4];
+    size_t body_len = 0, total, sent = 0;
+
+    for (int i = 0; i < num_parts; i++) body_len += parts[i].iov_len;
+    put_be32(header, (uint32_t)body_len);
+    header[4] = (unsigned char)status;
+    header[5] = (unsigned char)op;
+    header[6] = header[7] = 0;
+    put_be32(header + 8, id);
+    iov[0] = (struct iovec){header, sizeof(header)};
+    memcpy(iov + 1, parts, num_parts * sizeof(struct iovec));
+    total = sizeof(header) + body_len;
+
+    pthread_mutex_lock(&c->out_lock);
+    if (c->out_len == 0) {
+        struct msghdr msg = {.msg_iov = iov, .msg_iovlen = num_parts + 1};
+        ssize_t n;
+        do {
+            n = sendmsg(c->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            pthread_mutex_unlock(&c->out_lock);
+            return;  // Peer gone; the loop sees the error too
+        }
+        sent = n > 0 ? (size_t)n : 0;
+    }
+    if (sent < total && !c->closed) {
+        if (conn_append(c, iov, num_parts + 1, sent) != 0) {
+            perror("Memory allocation failed");
+        } else {
+            conn_watch(svc, c, 1);
+        }
+    }
+    pthread_mutex_unlock(&c->out_lock);
+}
+
+static void queue_requests(struct service *svc, request *first, request *last, int count) {
+    if (!first) return;
+    pthread_mutex_lock(&svc->lock);
+    if (svc->tail) svc->tail->next = first;
+    else svc->head = first;
+    svc->tail = last;
+    if (count > 1) pthread_cond_broadcast(&svc->ready);
+    else pthread_cond_signal(&svc->ready);
+    pthread_mutex_unlock(&svc->lock);
+}
+
+// Cut the complete frames out of c's input and queue them in one go.
+// Returns -1 when the connection has to be closed.
+static int conn_parse(struct service *svc, conn *c) {
+    request *first = NULL, *last = NULL;
+    struct timespec now;
+    size_t off = 0;
+    int count = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    while (c->in_len - off >= SERVICE_HEADER_SIZE) {
+        const unsigned char *h = c->in + off;
+        uint32_t body_len = get_be32(h);
+        request *r;
+
+        if (body_len > SERVICE_MAX_PAYLOAD) {
+            // The stream cannot be resynchronized: answer, then hang up
+            pthread_mutex_lock(&c->out_lock);
+            c->close_after_flush = 1;
+            pthread_mutex_unlock(&c->out_lock);
+            conn_reply(svc, c, SERVICE_TOO_LARGE, h[4], get_be32(h + 8), NULL, 0);
+            c->in_len = 0;
+            queue_requests(svc, first, last, count);
+            return c->out_len == 0 ? -1 : 0;
+        }
+        if (c->in_len - off < SERVICE_HEADER_SIZE + body_len) break;
+        if (!(r = malloc(sizeof(request) + body_len))) {
+            perror("Memory allocation failed");
+            queue_requests(svc, first, last, count);
+            return -1;
+        }
+        r->next = NULL;
+        r->c = c;
+        r->op = h[4];
+        r->algo_type = h[5];
+        r->id = get_be32(h + 8);
+        r->arrived = now;
+        r->len = body_len;
+        memcpy(r->body, h + SERVICE_HEADER_SIZE, body_len);
+        __atomic_add_fetch(&c->refs, 1, __ATOMIC_RELAXED);
+
+        if (last) last->next = r;
+        else first = r;
+        last = r;
+        count++;
+        off += SERVICE_HEADER_SIZE + body_len;
+    }
+    memmove(c->in, c->in + off, c->in_len - off);
+    c->in_len -= off;
+    queue_requests(svc, first, last, count);
+    return 0;
+}
+
+// -1 once c is closed: the loop's reference is gone, c may be freed
+static int conn_readable(struct service *svc, conn *c) {
+    for (;;) {
+        ssize_t n;
+
+        if (c->in_cap - c->in_len < READ_CHUNK) {
+            size_t cap = c->in_len + READ_CHUNK;
+            unsigned char *in;
+            if (cap < SERVICE_HEADER_SIZE + SERVICE_MAX_PAYLOAD) cap += cap / 2;
+            if (!(in = realloc(c->in, cap))) {
+                perror("Memory allocation failed");
+                conn_close(svc, c);
+                return -1;
+            }
+            c->in = in;
+            c->in_cap = cap;
+        }
+        n = read(c->fd, c->in + c->in_len, c->in_cap - c->in_len);
+        if (n > 0) {
+            c->in_len += n;
+            if (conn_parse(svc, c) != 0) {
+                conn_close(svc, c);
+                return -1;
+            }
+            if (c->close_after_flush) return 0;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        } else {
+            conn_close(svc, c);  // EOF or error
+            return -1;
+        }
+    }
+}
+
+// Same contract as conn_readable
+static int conn_writable(struct service *svc, conn *c) {
+    int failed, done;
+
+    pthread_mutex_lock(&c->out_lock);
+    failed = conn_drain(c) != 0;
+    if (c->out_len == 0) conn_watch(svc, c, 0);
+    done = failed || (c->close_after_flush && c->out_len == 0);
+    pthread_mutex_unlock(&c->out_lock);
+    if (!done) return 0;
+    conn_close(svc, c);
+    return -1;
+}
+
+static void accept_connections(struct service *svc) {
+    for (;;) {
+        int fd = accept4(svc->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        struct epoll_event ev;
+        conn *c;
+
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("accept");
+            return;
+        }
+        if (!(c = calloc(1, sizeof(conn)))) {
+            perror("Memory allocation failed");
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->refs = 1;
+        pthread_mutex_init(&c->out_lock, NULL);
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        if (epoll_ctl(svc->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            perror("epoll_ctl");
+            conn_release(c);
+            continue;
+        }
+        c->next = svc->conns;
+        if (svc->conns) svc->conns->prev = c;
+        svc->conns = c;
+    }
+}
+
+static void *loop_main(void *arg) {
+    struct service *svc = arg;
+    struct epoll_event events[LOOP_MAX_EVENTS];
+
+    for (;;) {
+        int n = epoll_wait(svc->epoll_fd, events, LOOP_MAX_EVENTS, -1);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            void *tag = events[i].data.ptr;
+
+            if (tag == &wake_tag) goto out;
+            if (tag == &listen_tag) {
+                accept_connections(svc);
+                continue;
+            }
+            conn *c = tag;
+            if ((events[i].events & EPOLLOUT) && conn_writable(svc, c) != 0) continue;  // c may be freed
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) conn_readable(svc, c);
+        }
+    }
+out:
+    while (svc->conns) conn_close(svc, svc->conns);
+    return NULL;
+}
+
+// --- Workers ---
+
+static unsigned char *worker_scratch(worker *w, size_t len) {
+    if (len > w->scratch_len) {
+        unsigned char *p = realloc(w->scratch, len);
+        if (!p) return NULL;
+        w->scratch = p;
+        w->scratch_len = len;
+    }
+    return w->scratch;
+}
+
+static int tag_len_of(int algo_type) {
+    return algo_get(algo_type)->tag_len;
+}
+
+static int valid_request(const request *r) {
+    if (r->op == SERVICE_OP_STATS) return 1;
+    if (r->op != SERVICE_OP_ENCRYPT && r->op != SERVICE_OP_DECRYPT) return 0;
+    if (!algo_available(r->algo_type)) return 0;
+    if (r->op == SERVICE_OP_DECRYPT &&
+        r->len < (size_t)(algo_iv_len(r->algo_type) + tag_len_of(r->algo_type))) return 0;
+    return 1;
+}
+
+static int batchable(const request *r) {
+    return (r->op == SERVICE_OP_ENCRYPT || r->op == SERVICE_OP_DECRYPT) &&
+           r->len <= SERVICE_BATCH_BYTES && valid_request(r) &&
+           algo_has(r->algo_type, ALGO_CAP_AEAD | ALGO_CAP_POOLABLE);
+}
+
+// Under svc->lock: the head request plus, if it can be batched, up to
+// batch_max - 1 more queued requests with the same op and algorithm
+static int take_batch(struct service *svc, request **batch) {
+    request *first = svc->head, *prev, *r;
+    int n = 1, scanned = 0;
+
+    svc->head = first->next;
+    if (!svc->head) svc->tail = NULL;
+    first->next = NULL;
+    batch[0] = first;
+    if (svc->batch_max < 2 || !batchable(first)) return 1;
+
+    prev = NULL;
+    r = svc->head;
+    while (r && n < svc->batch_max && scanned++ < BATCH_SCAN_LIMIT) {
+        request *next = r->next;
+        if (r->op == first->op && r->algo_type == first->algo_type && batchable(r)) {
+            if (prev) prev->next = next;
+            else svc->head = next;
+            if (svc->tail == r) svc->tail = prev;
+            r->next = NULL;
+            batch[n++] = r;
+        } else {
+            prev = r;
+        }
+        r = next;
+    }
+    return n;
+}
+
+static void finish_request(struct service *svc, request *r) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (r->op >= SERVICE_OP_ENCRYPT && r->op <= SERVICE_OP_STATS) {
+        hist_record(&svc->latency[r->op], elapsed_ns(&r->arrived, &now));
+    }
+    __atomic_fetch_add(&svc->requests, 1, __ATOMIC_RELAXED);
+    conn_release(r->c);
+    free(r);
+}
+
+static void reply_stats(struct service *svc, request *r) {
+    char *text = NULL;
+    size_t len = 0;
+    FILE *fp = open_memstream(&text, &len);
+
+    if (fp) {
+        service_print_stats(svc, fp);
+        fclose(fp);
+    }
+    struct iovec part = {text, len};
+    conn_reply(svc, r->c, text ? SERVICE_OK : SERVICE_BAD_REQUEST, r->op, r->id, &part, text ? 1 : 0);
+    free(text);
+}
+
+// One request through the worker's kernel, or the registry's one-shot
+// functions for XChaCha20-Poly1305 (no kernel: its key schedule follows the nonce)
+static void process_single(worker *w, request *r) {
+    struct service *svc = w->svc;
+    int algo_type = r->algo_type;
+    int iv_len, tag_len;
+    unsigned char iv[MAX_IV_SIZE], tag[HMAC_TAG_SIZE];
+    unsigned char *out;
+    kernel *k;
+
+    if (!valid_request(r)) {
+        conn_reply(svc, r->c, SERVICE_BAD_REQUEST, r->op, r->id, NULL, 0);
+        return;
+    }
+    if (r->op == SERVICE_OP_STATS) {
+        reply_stats(svc, r);
+        return;
+    }
+    iv_len = algo_iv_len(algo_type);
+    tag_len = tag_len_of(algo_type);
+    if (!w->kernels[algo_type] && algo_has(algo_type, ALGO_CAP_POOLABLE)) {
+        w->kernels[algo_type] = kernel_new(algo_type, svc->enc_keys[algo_type], svc->mac_keys[algo_type]);
+    }
+    k = w->kernels[algo_type];
+    if (!(out = worker_scratch(w, r->len + EVP_MAX_BLOCK_LENGTH))) {
+        perror("Memory allocation failed");
+        conn_reply(svc, r->c, SERVICE_BAD_REQUEST, r->op, r->id, NULL, 0);
+        return;
+    }
+
+    if (r->op == SERVICE_OP_ENCRYPT) {
+        rand_pool_bytes(iv, iv_len);
+        if (k) {
+            kernel_encrypt(k, r->body, (int)r->len, iv, out, tag);
+        } else {
+            algo_encrypt(algo_type, r->body, (int)r->len, svc->enc_keys[algo_type],
+                         svc->mac_keys[algo_type], iv, out, tag);
+        }
+        struct iovec parts[3] = {{iv, iv_len}, {tag, tag_len}, {out, r->len}};
+        conn_reply(svc, r->c, SERVICE_OK, r->op, r->id, parts, 3);
+    } else {
+        const unsigned char *msg_iv = r->body, *msg_tag = r->body + iv_len;
+        unsigned char *ct = r->body + iv_len + tag_len;
+        int ct_len = (int)r->len - iv_len - tag_len, len;
+
+        memcpy(iv, msg_iv, iv_len);
+        memcpy(tag, msg_tag, tag_len);
+        if (k) {
+            len = kernel_decrypt(k, ct, ct_len, iv, tag, out);
+        } else {
+            len = algo_decrypt(algo_type, ct, ct_len, svc->enc_keys[algo_type],
+                               svc->mac_keys[algo_type], iv, tag, out);
+        }
+        if (len < 0) {
+            conn_reply(svc, r->c, SERVICE_AUTH_FAILED, r->op, r->id, NULL, 0);
+        } else {
+            struct iovec part = {out, (size_t)len};
+            conn_reply(svc, r->c, SERVICE_OK, r->op, r->id, &part, 1);
+        }
+    }
+}
+
+// Same op and AEAD algorithm for all: one multi-buffer call
+static void process_batch(worker *w, request **batch, int n) {
+    struct service *svc = w->svc;
+    int algo_type = batch[0]->algo_type;
+    int iv_len = algo_iv_len(algo_type);
+    int decrypt = batch[0]->op == SERVICE_OP_DECRYPT;
+    aead_msg msgs[SERVICE_BATCH_MAX];
+    unsigned char nonces[SERVICE_BATCH_MAX * MAX_IV_SIZE];
+    unsigned char tags[SERVICE_BATCH_MAX * AEAD_TAG_SIZE];
+    unsigned char ok[SERVICE_BATCH_MAX];
+    size_t total = 0, off = 0;
+    unsigned char *out;
+
+    for (int i = 0; i < n; i++) total += batch[i]->len;
+    if (!(out = worker_scratch(w, total + EVP_MAX_BLOCK_LENGTH))) {
+        perror("Memory allocation failed");
+        for (int i = 0; i < n; i++) conn_reply(svc, batch[i]->c, SERVICE_BAD_REQUEST, batch[i]->op, batch[i]->id, NULL, 0);
+        return;
+    }
+
+    if (!decrypt) {
+        rand_pool_bytes(nonces, (size_t)n * iv_len);
+        for (int i = 0; i < n; i++) {
+            msgs[i] = (aead_msg){.data = batch[i]->body, .len = (int)batch[i]->len,
+                                 .nonce = nonces + (size_t)i * iv_len};
+        }
+        algo_encrypt_batch(algo_type, msgs, n, svc->enc_keys[algo_type], out, tags);
+        for (int i = 0; i < n; i++) {
+            struct iovec parts[3] = {{nonces + (size_t)i * iv_len, iv_len},
+                                     {tags + (size_t)i * AEAD_TAG_SIZE, AEAD_TAG_SIZE},
+                                     {out + off, batch[i]->len}};
+            conn_reply(svc, batch[i]->c, SERVICE_OK, batch[i]->op, batch[i]->id, parts, 3);
+            off += batch[i]->len;
+        }
+        return;
+    }
+
+    for (int i = 0; i < n; i++) {
+        request *r = batch[i];
+        memcpy(tags + (size_t)i * AEAD_TAG_SIZE, r->body + iv_len, AEAD_TAG_SIZE);
+        msgs[i] = (aead_msg){.data = r->body + iv_len + AEAD_TAG_SIZE,
+                             .len = (int)(r->len - iv_len - AEAD_TAG_SIZE), .nonce = r->body};
+    }
+    algo_decrypt_batch(algo_type, msgs, n, svc->enc_keys[algo_type], tags, out, ok);
+    for (int i = 0; i < n; i++) {
+        struct iovec part = {out + off, (size_t)msgs[i].len};
+        conn_reply(svc, batch[i]->c, ok[i] ? SERVICE_OK : SERVICE_AUTH_FAILED, batch[i]->op, batch[i]->id,
+                   &part, ok[i] ? 1 : 0);
+        off += msgs[i].len;
+    }
+}
+
+static void *worker_main(void *arg) {
+    worker *w = arg;
+    struct service *svc = w->svc;
+    request *batch[SERVICE_BATCH_MAX];
+
+    for (;;) {
+        int n;
+
+        pthread_mutex_lock(&svc->lock);
+        while (!svc->head && !svc->stopping) pthread_cond_wait(&svc->ready, &svc->lock);
+        if (!svc->head) {
+            pthread_mutex_unlock(&svc->lock);
+            break;
+        }
+        n = take_batch(svc, batch);
+        pthread_mutex_unlock(&svc->lock);
+
+        if (n > 1) {
+            process_batch(w, batch, n);
+            __atomic_fetch_add(&svc->batches, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&svc->batched_requests, n, __ATOMIC_RELAXED);
+        } else {
+            process_single(w, batch[0]);
+        }
+        for (int i = 0; i < n; i++) finish_request(svc, batch[i]);
+    }
+
+    for (int a = 1; a <= NUM_ALGOS; a++) kernel_free(w->kernels[a]);
+    if (w->scratch) OPENSSL_cleanse(w->scratch, w->scratch_len);
+    free(w->scratch);
+    return NULL;
+}
+
+// --- Lifecycle ---
+
+service *service_start(const char *socket_path, unsigned char *master_key,
+                       int num_workers, int batch_max) {
+    struct service *svc;
+    struct sockaddr_un addr;
+    struct epoll_event ev;
+
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", socket_path);
+        return NULL;
+    }
+    if (!(svc = calloc(1, sizeof(*svc)))) {
+        perror("Memory allocation failed");
+        return NULL;
+    }
+    strcpy(svc->path, socket_path);
+    svc->batch_max = batch_max < 1 ? 1 : batch_max > SERVICE_BATCH_MAX ? SERVICE_BATCH_MAX : batch_max;
+    svc->listen_fd = svc->epoll_fd = svc->wake_fd = -1;
+    pthread_mutex_init(&svc->lock, NULL);
+    pthread_cond_init(&svc->ready, NULL);
+
+    // Every key derived once, up front
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        if (!algo_available(algo_type)) continue;
+        derive_algo_keys(master_key, algo_name(algo_type), algo_type,
+                         svc->enc_keys[algo_type], svc->mac_keys[algo_type]);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    unlink(socket_path);
+    svc->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (svc->listen_fd < 0 || bind(svc->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(svc->listen_fd, SOMAXCONN) != 0) {
+        perror("Cannot listen on the service socket");
+        goto fail;
+    }
+    svc->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    svc->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (svc->epoll_fd < 0 || svc->wake_fd < 0) {
+        perror("epoll/eventfd");
+        goto fail;
+    }
+    ev.events = EPOLLIN;
+    ev.data.ptr = &listen_tag;
+    epoll_ctl(svc->epoll_fd, EPOLL_CTL_ADD, svc->listen_fd, &ev);
+    ev.data.ptr = &wake_tag;
+    epoll_ctl(svc->epoll_fd, EPOLL_CTL_ADD, svc->wake_fd, &ev);
+
+    if (num_workers > SERVICE_MAX_WORKERS) num_workers = SERVICE_MAX_WORKERS;
+    for (int i = 0; i < num_workers; i++) {
+        svc->workers[i].svc = svc;
+        if (pthread_create(&svc->workers[i].thread, NULL, worker_main, &svc->workers[i]) != 0) {
+            perror("pthread_create");
+            break;
+        }
+        svc->num_workers++;
+    }
+    if (svc->num_workers == 0) goto fail;
+    if (pthread_create(&svc->loop_thread, NULL, loop_main, svc) != 0) {
+        perror("pthread_create");
+        goto fail;
+    }
+    svc->loop_started = 1;
+    return svc;
+
+fail:
+    service_stop(svc);
+    return NULL;
+}
+
+void service_stop(service *svc) {
+    uint64_t one = 1;
+
+    if (!svc) return;
+    if (svc->loop_started) {
+        if (write(svc->wake_fd, &one, sizeof(one)) != sizeof(one)) perror("eventfd");
+        pthread_join(svc->loop_thread, NULL);
+    }
+    pthread_mutex_lock(&svc->lock);
+    svc->stopping = 1;
+    pthread_cond_broadcast(&svc->ready);
+    pthread_mutex_unlock(&svc->lock);
+    for (int i = 0; i < svc->num_workers; i++) pthread_join(svc->workers[i].thread, NULL);
+
+    if (svc->listen_fd >= 0) {
+        close(svc->listen_fd);
+        unlink(svc->path);
+    }
+    if (svc->epoll_fd >= 0) close(svc->epoll_fd);
+    if (svc->wake_fd >= 0) close(svc->wake_fd);
+    pthread_mutex_destroy(&svc->lock);
+    pthread_cond_destroy(&svc->ready);
+    OPENSSL_cleanse(svc->enc_keys, sizeof(svc->enc_keys));
+    OPENSSL_cleanse(svc->mac_keys, sizeof(svc->mac_keys));
+    free(svc);
+}
+
+int service_run(const char *socket_path, unsigned char *master_key, int num_workers) {
+    sigset_t signals;
+    service *svc;
+    int sig;
+
+    // Blocked before the threads start, so only sigwait sees them
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    if (!(svc = service_start(socket_path, master_key, num_workers, SERVICE_BATCH_MAX))) return 1;
+    printf("Listening on %s with %d worker(s), batches of up to %d requests (Ctrl-C to stop)\n",
+           socket_path, svc->num_workers, svc->batch_max);
+    fflush(stdout);
+    sigwait(&signals, &sig);
+
+    printf("\n%s, shutting down\n", sig == SIGINT ? "SIGINT" : "SIGTERM");
+    service_print_stats(svc, stdout);
+    service_stop(svc);
+    return 0;
+}
+
+void service_batch_stats(service *svc, unsigned long *batches, unsigned long *batched_requests,
+                         unsigned long *requests) {
+    *batches = __atomic_load_n(&svc->batches, __ATOMIC_RELAXED);
+    *batched_requests = __atomic_load_n(&svc->batched_requests, __ATOMIC_RELAXED);
+    *requests = __atomic_load_n(&svc->requests, __ATOMIC_RELAXED);
+}
+
+void service_print_stats(service *svc, FILE *fp) {
+    static const char *op_names[SERVICE_OP_STATS + 1] = {NULL, "encrypt", "decrypt", "stats"};
+    unsigned long batches, batched, requests;
+
+    service_batch_stats(svc, &batches, &batched, &requests);
+    fprintf(fp, "Requests: %lu, %lu in %lu batches (%.1f per batch)\n", requests, batched, batches,
+            batches ? (double)batched / batches : 0.0);
+    for (int op = SERVICE_OP_ENCRYPT; op <= SERVICE_OP_STATS; op++) {
+        histogram h;
+        unsigned long peak = 0;
+
+        memcpy(&h, &svc->latency[op], sizeof(h));
+        if (h.total == 0) continue;
+        for (int b = 0; b < HIST_BUCKETS; b++) if (h.counts[b] > peak) peak = h.counts[b];
+        fprintf(fp, "%s latency: %lu requests, p50 < %.1f us, p99 < %.1f us\n", op_names[op], h.total,
+                hist_percentile(&h, 50) / 1000.0, hist_percentile(&h, 99) / 1000.0);
+        for (int b = 0; b < HIST_BUCKETS; b++) {
+            if (h.counts[b] == 0) continue;
+            fprintf(fp, "  %9.1f - %9.1f us %10lu ", (1LL << b) / 1000.0, (2LL << b) / 1000.0, h.counts[b]);
+            for (unsigned long i = 0; i < (h.counts[b] * 40 + peak - 1) / peak; i++) fputc('#', fp);
+            fputc('\n', fp);
+        }
+    }
+}
+
+// --- Client ---
+
+int service_connect(const char *socket_path) {
+    struct sockaddr_un addr;
+    int fd;
+
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", socket_path);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+        perror("socket");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("Cannot connect to the service");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int service_send(int fd, int op, int algo_type, uint32_t id,
+                 const unsigned char *part1, size_t len1,
+                 const unsigned char *part2, size_t len2) {
+    unsigned char header[SERVICE_HEADER_SIZE];
+    struct iovec iov[3] = {{header, sizeof(header)}, {(void *)part1, len1}, {(void *)part2, len2}};
+    struct iovec *v = iov;
+    int count = part2 ? 3 : 2;
+
+    put_be32(header, (uint32_t)(len1 + (part2 ? len2 : 0)));
+    header[4] = (unsigned char)op;
+    header[5] = (unsigned char)algo_type;
+    header[6] = header[7] = 0;
+    put_be32(header + 8, id);
+
+    while (count > 0) {
+        ssize_t n = writev(fd, v, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        while (count > 0 && (size_t)n >= v->iov_len) {
+            n -= v->iov_len;
+            v++;
+            count--;
+        }
+        if (count > 0) {
+            v->iov_base = (unsigned char *)v->iov_base + n;
+            v->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+static int read_full(int fd, unsigned char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = recv(fd, buf, len, MSG_WAITALL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int service_recv(int fd, service_reply *reply, unsigned char *body, size_t cap) {
+    unsigned char header[SERVICE_HEADER_SIZE];
+    unsigned char discard[4096];
+    size_t keep;
+
+    if (read_full(fd, header, sizeof(header)) != 0) return -1;
+    reply->len = get_be32(header);
+    reply->status = header[4];
+    reply->op = header[5];
+    reply->id = get_be32(header + 8);
+
+    keep = reply->len < cap ? reply->len : cap;
+    if (keep > 0 && read_full(fd, body, keep) != 0) return -1;
+    for (size_t left = reply->len - keep; left > 0;) {
+        size_t n = left < sizeof(discard) ? left : sizeof(discard);
+        if (read_full(fd, discard, n) != 0) return -1;
+        left -= n;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+#ifndef HW03_SERVICE_H
+#define HW03_SERVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define SERVICE_HEADER_SIZE 12                 // Frame header, requests and responses
+#define SERVICE_MAX_PAYLOAD (1024 * 1024)      // Largest frame body accepted
+#define SERVICE_BATCH_BYTES (16 * 1024)        // Requests up to this size are batched
+#define SERVICE_BATCH_MAX 64                   // Requests per multi-buffer call
+#define SERVICE_MAX_WORKERS 64
+
+// Operations (header op byte)
+#define SERVICE_OP_ENCRYPT 1
+#define SERVICE_OP_DECRYPT 2
+#define SERVICE_OP_STATS   3
+
+// Response status (header status byte)
+#define SERVICE_OK           0
+#define SERVICE_AUTH_FAILED  1  // Decrypt: tag mismatch, empty body
+#define SERVICE_BAD_REQUEST  2  // Unknown op or algorithm, body too short
+#define SERVICE_TOO_LARGE    3  // Body over SERVICE_MAX_PAYLOAD; the server closes the connection
+
+// Encryption service on a Unix stream socket: keys are derived once from
+// the master key at startup and every request reuses them.
+//
+// Binary length-prefixed frames (big-endian), the framing of the HW06/HW07
+// send_message/receive_message without the JSON:
+//
+//   request   be32 body_len || op || algo_type || be16 0 || be32 id || body
+//   response  be32 body_len || status || op || be16 0 || be32 id || body
+//
+//   ENCRYPT   body = plaintext; response = IV || tag || ciphertext, with a
+//             fresh random IV of algo_iv_len bytes and the tag of the algorithm
+//   DECRYPT   body = IV || tag || ciphertext; response = plaintext
+//   STATS     response = the latency histograms as text
+//
+// A client may pipeline requests on one connection; responses carry the
+// request id and can arrive out of order.
+//
+// One thread runs an epoll loop: it accepts, reads and parses frames on
+// non-blocking sockets and queues complete requests. A pool of workers
+// takes them from the queue. A worker that finds several queued requests
+// for the same operation and AEAD algorithm, each up to
+// SERVICE_BATCH_BYTES, takes up to batch_max of them and runs one
+// algo_encrypt_batch/algo_decrypt_batch call. Other requests go through
+// the worker's specialized kernels (kernels.h). Responses are written by
+// the worker, or by the loop once the socket is writable again.
+//
+// Per-request latency (frame parsed to response queued) is recorded in
+// log2 histograms per operation.
+typedef struct service service;
+
+// Listen on socket_path (an existing socket file is replaced) and start the
+// loop and num_workers workers; NULL on error
+service *service_start(const char *socket_path, unsigned char *master_key,
+                       int num_workers, int batch_max);
+
+// Stop accepting, finish the queued requests, join the threads and remove
+// the socket file
+void service_stop(service *svc);
+
+// Foreground daemon: service_start, then wait for SIGINT/SIGTERM and print
+// the histograms on the way out. Returns 0 on a clean shutdown.
+int service_run(const char *socket_path, unsigned char *master_key, int num_workers);
+
+// Latency histograms and batch counts so far
+void service_print_stats(service *svc, FILE *fp);
+void service_batch_stats(service *svc, unsigned long *batches, unsigned long *batched_requests,
+                         unsigned long *requests);
+
+// Client side
+
+typedef struct {
+    int status;
+    int op;
+    uint32_t id;
+    size_t len;  // Body length
+} service_reply;
+
+// Connected socket, -1 on error
+int service_connect(const char *socket_path);
+
+// One request frame, the header and the body in a single writev. body may
+// be split in two parts (e.g. IV || tag and ciphertext); part2 may be NULL.
+// 0 on success, -1 on error.
+int service_send(int fd, int op, int algo_type, uint32_t id,
+                 const unsigned char *part1, size_t len1,
+                 const unsigned char *part2, size_t len2);
+
+// Next response frame. Its body is read into body (up to cap bytes, the
+// rest discarded). 0 on success, -1 on error or closed connection.
+int service_recv(int fd, service_reply *reply, unsigned char *body, size_t cap);
+
+#endif
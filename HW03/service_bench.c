@@ -0,0 +1,222 @@
+#include "service_bench.h"
+#include "bench.h"
+#include "ciphers.h"
+#include "service.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Holds the clients back until all of them are connected
+struct start_gate {
+    pthread_mutex_t lock;
+    pthread_cond_t open;
+    int waiting, is_open;
+};
+
+typedef struct {
+    const char *path;
+    int algo_type;
+    const unsigned char *plaintext;
+    int plaintext_len;
+    size_t msg_size;
+    int requests;
+    struct start_gate *start;
+    long long *latency_ns;  // Indexed by request id
+    int ok;
+} client_arg;
+
+static void gate_wait(struct start_gate *g) {
+    pthread_mutex_lock(&g->lock);
+    g->waiting++;
+    pthread_cond_broadcast(&g->open);
+    while (!g->is_open) pthread_cond_wait(&g->open, &g->lock);
+    pthread_mutex_unlock(&g->lock);
+}
+
+static const unsigned char *client_message(const client_arg *a, uint32_t id) {
+    return a->plaintext + ((size_t)id * a->msg_size) % (a->plaintext_len - a->msg_size + 1);
+}
+
+// One connection, SERVICE_BENCH_DEPTH encrypt requests in flight; the last
+// response is decrypted through the service and compared with its message
+static void *client_main(void *arg) {
+    client_arg *a = arg;
+    size_t cap = a->msg_size + MAX_IV_SIZE + HMAC_TAG_SIZE;
+    struct timespec *sent = malloc(a->requests * sizeof(struct timespec));
+    unsigned char *body = malloc(cap), *decrypted = malloc(cap);
+    service_reply reply = {0};
+    int fd = service_connect(a->path);
+    int next = 0, done = 0;
+
+    a->ok = 0;
+    gate_wait(a->start);
+    if (fd < 0 || !sent || !body || !decrypted) goto cleanup;
+
+    a->ok = 1;
+    while (done < a->requests && a->ok) {
+        struct timespec now;
+
+        while (next < a->requests && next - done < SERVICE_BENCH_DEPTH) {
+            clock_gettime(CLOCK_MONOTONIC, &sent[next]);
+            if (service_send(fd, SERVICE_OP_ENCRYPT, a->algo_type, next, client_message(a, next),
+                             a->msg_size, NULL, 0) != 0) {
+                a->ok = 0;
+                break;
+            }
+            next++;
+        }
+        if (!a->ok || service_recv(fd, &reply, body, cap) != 0 || reply.status != SERVICE_OK ||
+            reply.id >= (uint32_t)next) {
+            a->ok = 0;
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        a->latency_ns[reply.id] = elapsed_ns(&sent[reply.id], &now);
+        done++;
+    }
+
+    if (a->ok && done > 0) {
+        uint32_t id = reply.id;
+        service_reply check;
+        a->ok = service_send(fd, SERVICE_OP_DECRYPT, a->algo_type, id, body, reply.len, NULL, 0) == 0 &&
+                service_recv(fd, &check, decrypted, cap) == 0 && check.status == SERVICE_OK &&
+                check.id == id && check.len == a->msg_size &&
+                memcmp(decrypted, client_message(a, id), a->msg_size) == 0;
+    }
+
+cleanup:
+    if (fd >= 0) close(fd);
+    free(sent);
+    free(body);
+    free(decrypted);
+    return NULL;
+}
+
+// One (algorithm, size, clients, batch_max) point; returns 1 if every client
+// verified, -1 (outputs zeroed) if the service or the clients' buffers could
+// not be set up
+static int run_point(const char *path, int algo_type, unsigned char *plaintext, int plaintext_len,
+                     size_t msg_size, int clients, int requests, int batch_max, int num_workers,
+                     unsigned char *master_key, double *req_per_sec, bench_latency *latency,
+                     double *avg_batch) {
+    service *svc = service_start(path, master_key, num_workers, batch_max);
+    client_arg *args = calloc(clients, sizeof(client_arg));
+    pthread_t *threads = calloc(clients, sizeof(pthread_t));
+    long long *latency_ns = malloc((size_t)clients * requests * sizeof(long long));
+    struct start_gate start = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0};
+    struct timespec begin, end;
+    unsigned long batches, batched, total;
+    int started = 0, ok = 1;
+
+    *req_per_sec = *avg_batch = 0;
+    memset(latency, 0, sizeof(*latency));
+    if (!svc || !args || !threads || !latency_ns) {
+        if (svc) service_stop(svc);
+        else fprintf(stderr, "Cannot start the service on %s\n", path);
+        free(args);
+        free(threads);
+        free(latency_ns);
+        return -1;
+    }
+
+    for (int i = 0; i < clients; i++) {
+        args[i] = (client_arg){path, algo_type, plaintext, plaintext_len, msg_size, requests, &start,
+                               latency_ns + (size_t)i * requests, 0};
+        if (pthread_create(&threads[i], NULL, client_main, &args[i]) != 0) {
+            perror("pthread_create");
+            break;
+        }
+        started++;
+    }
+    pthread_mutex_lock(&start.lock);
+    while (start.waiting < started) pthread_cond_wait(&start.open, &start.lock);
+    start.is_open = 1;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    pthread_cond_broadcast(&start.open);
+    pthread_mutex_unlock(&start.lock);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for (int i = 0; i < clients; i++) ok &= i < started && args[i].ok;
+    service_batch_stats(svc, &batches, &batched, &total);
+    service_stop(svc);
+
+    *req_per_sec = (double)clients * requests / (elapsed_ns(&begin, &end) / 1e9);
+    // Requests per worker call: a single request counts as a batch of one
+    *avg_batch = total > 0 ? (double)total / (batches + (total - batched)) : 0.0;
+    if (ok) bench_latency_summary(latency_ns, clients * requests, latency);
+
+    free(args);
+    free(threads);
+    free(latency_ns);
+    return ok;
+}
+
+int run_service_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                      int *client_counts, int num_client_counts, size_t *msg_sizes, int num_msg_sizes,
+                      int num_messages, int num_workers, unsigned char *master_key) {
+    static const int batch_modes[2] = {1, SERVICE_BATCH_MAX};
+    char results_filename[256];
+    char path[64];
+    FILE *results_file;
+
+    snprintf(path, sizeof(path), "/tmp/hw03_service_%d.sock", (int)getpid());
+    results_file = open_results_file("service_", test_file,
+                                     "Algorithm,Msg_Bytes,Clients,Batch_Max,Requests,Req_per_sec,"
+                                     "Mean_us,P50_us,P99_us,Max_us,Avg_Batch",
+                                     results_filename, sizeof(results_filename));
+    if (!results_file) return 1;
+
+    printf("\n=================================================================\n");
+    printf("  Encryption service: %d worker(s), %d requests in flight per client\n",
+           num_workers, SERVICE_BENCH_DEPTH);
+    printf("  one request per call vs batches of up to %d (client-side latency)\n", SERVICE_BATCH_MAX);
+    printf("=================================================================\n");
+
+    for (int algo_type = 1; algo_type <= NUM_ALGOS; algo_type++) {
+        if (!algo_has(algo_type, ALGO_CAP_AEAD | ALGO_CAP_POOLABLE)) continue;
+        printf("\n%s:\n", algo_name(algo_type));
+        printf("    %-10s %7s %6s %9s %12s %10s %10s %10s %10s %6s\n", "Msg size", "Clients", "Batch",
+               "Requests", "Req/s", "Mean us", "p50 us", "p99 us", "Max us", "Avg b");
+
+        for (int m = 0; m < num_msg_sizes; m++) {
+            size_t msg_size = msg_sizes[m];
+
+            if (msg_size > (size_t)plaintext_len || msg_size > SERVICE_MAX_PAYLOAD) {
+                printf("    %-10zu skipped (larger than %s or the service frame limit)\n", msg_size, test_file);
+                continue;
+            }
+            for (int c = 0; c < num_client_counts; c++) {
+                int clients = client_counts[c];
+                size_t cap = SERVICE_BENCH_BYTES / (msg_size ? msg_size : 1) / clients;
+                int requests = (size_t)num_messages / clients < cap ? num_messages / clients : (int)cap;
+
+                if (requests < 1) requests = 1;
+                for (int b = 0; b < 2; b++) {
+                    double req_per_sec, avg_batch;
+                    bench_latency lat;
+                    int ok = run_point(path, algo_type, plaintext, plaintext_len, msg_size, clients, requests,
+                                       batch_modes[b], num_workers, master_key, &req_per_sec, &lat, &avg_batch);
+
+                    if (ok < 0) continue;  // Nothing was measured
+                    printf("    %-10zu %7d %6d %9d %12.0f %10.1f %10.1f %10.1f %10.1f %6.1f %s\n", msg_size,
+                           clients, batch_modes[b], clients * requests, req_per_sec, lat.mean_ns / 1000.0,
+                           lat.p50_ns / 1000.0, lat.p99_ns / 1000.0, lat.max_ns / 1000.0, avg_batch,
+                           ok ? "[OK]" : "Verification FAILED!");
+                    fprintf(results_file, "%s,%zu,%d,%d,%d,%.0f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+                            algo_name(algo_type), msg_size, clients, batch_modes[b], clients * requests,
+                            req_per_sec, lat.mean_ns / 1000.0, lat.p50_ns / 1000.0, lat.p99_ns / 1000.0,
+                            lat.max_ns / 1000.0, avg_batch);
+                }
+            }
+        }
+    }
+
+    printf("\n✓ Results saved to %s\n\n", results_filename);
+    fclose(results_file);
+    return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef HW03_SERVICE_BENCH_H
+#define HW03_SERVICE_BENCH_H
+
+#include <stddef.h>
+
+#define SERVICE_BENCH_DEPTH 16                    // Requests in flight per client
+#define SERVICE_BENCH_BYTES (64 * 1024 * 1024)    // Plaintext per (size, clients, batch) point
+
+// Encryption service benchmark: starts the service (service.h) in-process
+// on a temporary socket and drives it with each of the given client counts,
+// every client a thread with SERVICE_BENCH_DEPTH pipelined encrypt requests
+// on its own connection. Each point runs twice, one request per call
+// (batch_max 1) and with connection-level batching (batch_max
+// SERVICE_BATCH_MAX), for every AEAD | POOLABLE algorithm and message size;
+// each client checks one decrypt round trip at the end. Client-side
+// latency (send to response) and throughput are written to
+// results_service_<file>.csv.
+int run_service_tests(const char *test_file, unsigned char *plaintext, int plaintext_len,
+                      int *client_counts, int num_client_counts, size_t *msg_sizes, int num_msg_sizes,
+                      int num_messages, int num_workers, unsigned char *master_key);
+
+#endif
@@ -0,0 +1,115 @@
+#include "sha256x8.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+
+#define AVX2 __attribute__((target("avx2")))
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint32_t H0[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+#define ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+#define XOR3(a, b, c) _mm256_xor_si256(_mm256_xor_si256(a, b), c)
+#define ADD(a, b) _mm256_add_epi32(a, b)
+
+int sha256x8_available(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+// One 64-byte block of every lane: blocks holds the padded messages back to
+// back, stride bytes apart, and block is the offset of this block in each
+AVX2 static void compress(__m256i state[8], const unsigned char *blocks, size_t stride, size_t block) {
+    const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                           3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    const __m256i lanes = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                             _mm256_set1_epi32((int)(stride / 4)));
+    __m256i w[16], a = state[0], b = state[1], c = state[2], d = state[3];
+    __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int t = 0; t < 64; t++) {
+        __m256i wt, t1, t2;
+
+        if (t < 16) {
+            // Word t of every lane's block, big-endian
+            wt = _mm256_i32gather_epi32((const int *)(blocks + block + 4 * t), lanes, 4);
+            wt = _mm256_shuffle_epi8(wt, bswap);
+        } else {
+            __m256i w15 = w[(t - 15) & 15], w2 = w[(t - 2) & 15];
+            __m256i s0 = XOR3(ROTR(w15, 7), ROTR(w15, 18), _mm256_srli_epi32(w15, 3));
+            __m256i s1 = XOR3(ROTR(w2, 17), ROTR(w2, 19), _mm256_srli_epi32(w2, 10));
+            wt = ADD(ADD(w[t & 15], s0), ADD(w[(t - 7) & 15], s1));
+        }
+        w[t & 15] = wt;
+
+        __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+        t1 = ADD(ADD(h, XOR3(ROTR(e, 6), ROTR(e, 11), ROTR(e, 25))),
+                 ADD(ch, ADD(_mm256_set1_epi32((int)K[t]), wt)));
+        t2 = ADD(XOR3(ROTR(a, 2), ROTR(a, 13), ROTR(a, 22)), maj);
+        h = g; g = f; f = e; e = ADD(d, t1);
+        d = c; c = b; b = a; a = ADD(t1, t2);
+    }
+    state[0] = ADD(state[0], a); state[1] = ADD(state[1], b);
+    state[2] = ADD(state[2], c); state[3] = ADD(state[3], d);
+    state[4] = ADD(state[4], e); state[5] = ADD(state[5], f);
+    state[6] = ADD(state[6], g); state[7] = ADD(state[7], h);
+}
+
+AVX2 void sha256x8(const unsigned char *const msgs[SHA256X8_LANES], const size_t lens[SHA256X8_LANES],
+                   int nblocks, unsigned char digests[SHA256X8_LANES][32]) {
+    unsigned char padded[SHA256X8_LANES][SHA256X8_MAX_BLOCKS * 64] __attribute__((aligned(32)));
+    size_t stride = sizeof(padded[0]), total = (size_t)nblocks * 64;
+    uint32_t out[8][SHA256X8_LANES] __attribute__((aligned(32)));
+    __m256i state[8];
+
+    // Message, 0x80, zeros, be64 bit length: the standard padding per lane
+    for (int l = 0; l < SHA256X8_LANES; l++) {
+        uint64_t bits = (uint64_t)lens[l] * 8;
+        memcpy(padded[l], msgs[l], lens[l]);
+        padded[l][lens[l]] = 0x80;
+        memset(padded[l] + lens[l] + 1, 0, total - lens[l] - 1 - 8);
+        for (int i = 0; i < 8; i++) padded[l][total - 1 - i] = (unsigned char)(bits >> (8 * i));
+    }
+
+    for (int i = 0; i < 8; i++) state[i] = _mm256_set1_epi32((int)H0[i]);
+    for (int blk = 0; blk < nblocks; blk++) compress(state, padded[0], stride, (size_t)blk * 64);
+
+    for (int i = 0; i < 8; i++) _mm256_store_si256((__m256i *)out[i], state[i]);
+    for (int l = 0; l < SHA256X8_LANES; l++) {
+        for (int i = 0; i < 8; i++) {
+            uint32_t v = out[i][l];
+            digests[l][4 * i] = v >> 24;
+            digests[l][4 * i + 1] = v >> 16;
+            digests[l][4 * i + 2] = v >> 8;
+            digests[l][4 * i + 3] = v;
+        }
+    }
+}
+
+#else
+
+int sha256x8_available(void) {
+    return 0;
+}
+
+void sha256x8(const unsigned char *const msgs[SHA256X8_LANES], const size_t lens[SHA256X8_LANES],
+              int nblocks, unsigned char digests[SHA256X8_LANES][32]) {
+    (void)msgs; (void)lens; (void)nblocks; (void)digests;
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef HW03_SHA256X8_H
+#define HW03_SHA256X8_H
+
+#include <stddef.h>
+
+#define SHA256X8_LANES 8
+#define SHA256X8_MAX_BLOCKS 4  // Padded length per lane, in 64-byte blocks
+
+// Blocks of a message of len bytes once padded
+#define SHA256X8_BLOCKS(len) (((len) + 9 + 63) / 64)
+
+// 1 if this build has the AVX2 lanes and the CPU/OS support them
+int sha256x8_available(void);
+
+// SHA-256 of eight messages at once, one per 32-bit lane of AVX2 registers.
+// Every message has to pad to nblocks blocks (SHA256X8_BLOCKS(lens[l]) ==
+// nblocks <= SHA256X8_MAX_BLOCKS), so the lanes run the same rounds.
+void sha256x8(const unsigned char *const msgs[SHA256X8_LANES], const size_t lens[SHA256X8_LANES],
+              int nblocks, unsigned char digests[SHA256X8_LANES][32]);
+
+#endif
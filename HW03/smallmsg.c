@@ -0,0 +1,99 @@
+// The SHA256_* low-level functions are deprecated in OpenSSL 3 but are the
+// only SHA-256 state that can be copied without an allocation
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include "smallmsg.h"
+#include "tagcmp.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <string.h>
+
+void small_ctx_init(small_ctx *sc, ctx_pool *pool, int algo_type,
+                    unsigned char *enc_key, unsigned char *mac_key) {
+    memset(sc, 0, sizeof(*sc));
+    keyed_ctx_setup(pool, &sc->kc, algo_type, enc_key, mac_key);
+    sc->etm = (algo_get(algo_type)->caps & ALGO_CAP_ETM) != 0;
+
+    if (sc->etm) {
+        unsigned char pad[SHA256_CBLOCK];
+
+        memset(pad, 0x36, sizeof(pad));
+        for (int i = 0; i < HMAC_KEY_SIZE; i++) pad[i] ^= mac_key[i];
+        SHA256_Init(&sc->inner);
+        SHA256_Update(&sc->inner, pad, sizeof(pad));
+
+        memset(pad, 0x5c, sizeof(pad));
+        for (int i = 0; i < HMAC_KEY_SIZE; i++) pad[i] ^= mac_key[i];
+        SHA256_Init(&sc->outer);
+        SHA256_Update(&sc->outer, pad, sizeof(pad));
+        OPENSSL_cleanse(pad, sizeof(pad));
+    }
+}
+
+void small_ctx_release(small_ctx *sc) {
+    keyed_ctx_release(&sc->kc);
+    OPENSSL_cleanse(sc, sizeof(*sc));
+}
+
+// HMAC-SHA256(K, data) from the precomputed pads
+static void small_hmac(const small_ctx *sc, const unsigned char *data, size_t len,
+                       unsigned char *tag) {
+    SHA256_CTX sha = sc->inner;
+    unsigned char inner_digest[SHA256_DIGEST_LENGTH];
+
+    SHA256_Update(&sha, data, len);
+    SHA256_Final(inner_digest, &sha);
+    sha = sc->outer;
+    SHA256_Update(&sha, inner_digest, sizeof(inner_digest));
+    SHA256_Final(tag, &sha);
+    OPENSSL_cleanse(&sha, sizeof(sha));
+}
+
+int small_encrypt(small_ctx *sc, const unsigned char *in, size_t len,
+                  const unsigned char *iv, unsigned char *out, unsigned char *tag) {
+    EVP_CIPHER_CTX *ctx = sc->kc.enc_ctx;
+    int out_len, final_len;
+
+    if (len > SMALL_MSG_MAX) return -1;
+    if (1 != EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, iv)) handle_crypto_error();
+    if (1 != EVP_EncryptUpdate(ctx, out, &out_len, in, (int)len)) handle_crypto_error();
+    if (1 != EVP_EncryptFinal_ex(ctx, out + out_len, &final_len)) handle_crypto_error();
+
+    if (sc->etm) {
+        small_hmac(sc, out, len, tag);
+    } else {
+        if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
+    }
+    return (int)len;
+}
+
+int small_decrypt(small_ctx *sc, const unsigned char *in, size_t len,
+                  const unsigned char *iv, const unsigned char *tag, unsigned char *out) {
+    EVP_CIPHER_CTX *ctx = sc->kc.dec_ctx;
+    unsigned char plain[SMALL_MSG_MAX + EVP_MAX_BLOCK_LENGTH];
+    int out_len, final_len;
+
+    if (len > SMALL_MSG_MAX) return -1;
+    if (sc->etm) {
+        unsigned char computed_tag[HMAC_TAG_SIZE];
+        small_hmac(sc, in, len, computed_tag);
+        if (!tag_equal(tag, computed_tag, HMAC_TAG_SIZE)) return -1;
+
+        if (1 != EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, iv)) handle_crypto_error();
+        if (1 != EVP_DecryptUpdate(ctx, out, &out_len, in, (int)len)) handle_crypto_error();
+        if (1 != EVP_DecryptFinal_ex(ctx, out + out_len, &final_len)) handle_crypto_error();
+        return (int)len;
+    }
+
+    // AEAD: decrypt on the stack and copy out only once the tag has verified
+    if (1 != EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, iv)) handle_crypto_error();
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, AEAD_TAG_SIZE, (void *)tag)) handle_crypto_error();
+    if (1 != EVP_DecryptUpdate(ctx, plain, &out_len, in, (int)len)) handle_crypto_error();
+    if (EVP_DecryptFinal_ex(ctx, plain + out_len, &final_len) <= 0) {
+        OPENSSL_cleanse(plain, len);
+        return -1;
+    }
+    memcpy(out, plain, len);  // Released anyway, so only the failure path wipes
+    return (int)len;
+}
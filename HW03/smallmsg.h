@@ -0,0 +1,38 @@
+#ifndef HW03_SMALLMSG_H
+#define HW03_SMALLMSG_H
+
+#include <stddef.h>
+#include <openssl/sha.h>
+
+#include "ctx_pool.h"
+
+#define SMALL_MSG_MAX 4096  // Largest message the small-message API takes
+
+// Small-message fast path: no heap allocation per message, by this code or
+// inside OpenSSL. The cipher contexts are keyed once (keyed_ctx) and only
+// get a new IV per message. The HMAC-SHA256 inner and outer pads of the
+// Encrypt-then-MAC modes are absorbed once into plain SHA256_CTX structs
+// and copied on the stack per message: re-initializing an EVP_MAC_CTX
+// duplicates its digest context, which costs two allocations per message.
+// All buffers belong to the caller (out needs len bytes, tag HMAC_TAG_SIZE
+// or AEAD_TAG_SIZE).
+typedef struct {
+    keyed_ctx kc;
+    int etm;
+    SHA256_CTX inner;  // SHA-256 state after (K ^ ipad)
+    SHA256_CTX outer;  // SHA-256 state after (K ^ opad)
+} small_ctx;
+
+// For the poolable algorithms (algo_has(algo_type, ALGO_CAP_POOLABLE))
+void small_ctx_init(small_ctx *sc, ctx_pool *pool, int algo_type,
+                    unsigned char *enc_key, unsigned char *mac_key);
+void small_ctx_release(small_ctx *sc);
+
+// Return len, or -1 if len > SMALL_MSG_MAX. small_decrypt also returns -1,
+// without writing out and without printing, when the tag does not verify.
+int small_encrypt(small_ctx *sc, const unsigned char *in, size_t len,
+                  const unsigned char *iv, unsigned char *out, unsigned char *tag);
+int small_decrypt(small_ctx *sc, const unsigned char *in, size_t len,
+                  const unsigned char *iv, const unsigned char *tag, unsigned char *out);
+
+#endif
@@ -0,0 +1,182 @@
+#include "stream.h"
+#include "ciphers.h"
+#include "tagcmp.h"
+
+#include <openssl/evp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+// Optional SHA-256 over the plaintext flowing through the stream
+static EVP_MD_CTX *digest_ctx_new(unsigned char *plain_digest) {
+    EVP_MD_CTX *md;
+
+    if (!plain_digest) return NULL;
+    if (!(md = EVP_MD_CTX_new())) handle_crypto_error();
+    if (1 != EVP_DigestInit_ex(md, EVP_sha256(), NULL)) handle_crypto_error();
+    return md;
+}
+
+static void digest_ctx_final(EVP_MD_CTX *md, unsigned char *plain_digest) {
+    if (!md) return;
+    if (1 != EVP_DigestFinal_ex(md, plain_digest, NULL)) handle_crypto_error();
+    EVP_MD_CTX_free(md);
+}
+
+long long stream_encrypt_file(int algo_type, FILE *in, FILE *out, size_t chunk_size,
+                              unsigned char *enc_key, unsigned char *mac_key,
+                              unsigned char *iv, unsigned char *tag,
+                              unsigned char *plain_digest) {
+    EVP_CIPHER_CTX *ctx;
+    EVP_MAC_CTX *mac = NULL;
+    EVP_MD_CTX *md;
+    unsigned char *inbuf, *outbuf;
+    long long total = 0;
+    size_t nread, mac_len;
+    int len;
+
+    inbuf = (unsigned char *)malloc(chunk_size);
+    outbuf = (unsigned char *)malloc(chunk_size + EVP_MAX_BLOCK_LENGTH);
+    if (!inbuf || !outbuf) {
+        perror("Memory allocation failed");
+        free(inbuf);
+        free(outbuf);
+        return -1;
+    }
+
+    ctx = algo_cipher_ctx_new(algo_type, 1, enc_key, iv);
+    if (algo_get(algo_type)->caps & ALGO_CAP_ETM) mac = hmac_sha256_ctx_new(mac_key);
+    md = digest_ctx_new(plain_digest);
+
+    while ((nread = fread(inbuf, 1, chunk_size, in)) > 0) {
+        if (md && 1 != EVP_DigestUpdate(md, inbuf, nread)) handle_crypto_error();
+        if (1 != EVP_EncryptUpdate(ctx, outbuf, &len, inbuf, (int)nread)) handle_crypto_error();
+        if (mac && 1 != EVP_MAC_update(mac, outbuf, len)) handle_crypto_error();
+        if (out && fwrite(outbuf, 1, len, out) != (size_t)len) {
+            perror("Error writing ciphertext");
+            total = -1;
+            break;
+        }
+        total += nread;
+    }
+    if (total >= 0 && ferror(in)) {
+        perror("Error reading input");
+        total = -1;
+    }
+
+    if (total >= 0) {
+        // Stream ciphers and CTR/GCM emit nothing here, but keep the EVP contract
+        if (1 != EVP_EncryptFinal_ex(ctx, outbuf, &len)) handle_crypto_error();
+        if (mac && 1 != EVP_MAC_update(mac, outbuf, len)) handle_crypto_error();
+        if (out && len > 0 && fwrite(outbuf, 1, len, out) != (size_t)len) {
+            perror("Error writing ciphertext");
+            total = -1;
+        }
+    }
+
+    if (total >= 0) {
+        if (mac) {
+            if (1 != EVP_MAC_final(mac, tag, &mac_len, HMAC_TAG_SIZE)) handle_crypto_error();
+        } else {
+            if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
+        }
+    }
+
+    digest_ctx_final(md, plain_digest);
+    EVP_MAC_CTX_free(mac);
+    EVP_CIPHER_CTX_free(ctx);
+    free(inbuf);
+    free(outbuf);
+    return total;
+}
+
+// First pass of the Encrypt-then-MAC decryption: HMAC the whole input
+static int stream_verify_hmac(FILE *in, size_t chunk_size, unsigned char *mac_key,
+                              unsigned char *tag, unsigned char *buf) {
+    unsigned char computed_tag[EVP_MAX_MD_SIZE];
+    EVP_MAC_CTX *mac = hmac_sha256_ctx_new(mac_key);
+    size_t nread, mac_len;
+
+    while ((nread = fread(buf, 1, chunk_size, in)) > 0) {
+        if (1 != EVP_MAC_update(mac, buf, nread)) handle_crypto_error();
+    }
+    if (1 != EVP_MAC_final(mac, computed_tag, &mac_len, sizeof(computed_tag))) handle_crypto_error();
+    EVP_MAC_CTX_free(mac);
+
+    if (ferror(in)) {
+        perror("Error reading input");
+        return -1;
+    }
+    if (!tag_equal(tag, computed_tag, HMAC_TAG_SIZE)) {
+        if (report_tag_failures) fprintf(stderr, "HMAC verification failed!\n");
+        return -1;
+    }
+    return 0;
+}
+
+long long stream_decrypt_file(int algo_type, FILE *in, FILE *out, size_t chunk_size,
+                              unsigned char *enc_key, unsigned char *mac_key,
+                              unsigned char *iv, unsigned char *tag,
+                              unsigned char *plain_digest) {
+    EVP_CIPHER_CTX *ctx;
+    EVP_MD_CTX *md;
+    unsigned char *inbuf, *outbuf;
+    long long total = 0;
+    size_t nread;
+    int len;
+
+    inbuf = (unsigned char *)malloc(chunk_size);
+    outbuf = (unsigned char *)malloc(chunk_size + EVP_MAX_BLOCK_LENGTH);
+    if (!inbuf || !outbuf) {
+        perror("Memory allocation failed");
+        free(inbuf);
+        free(outbuf);
+        return -1;
+    }
+
+    // Encrypt-then-MAC: authenticate everything before releasing any plaintext
+    if (algo_get(algo_type)->caps & ALGO_CAP_ETM) {
+        off_t start = ftello(in);
+        if (stream_verify_hmac(in, chunk_size, mac_key, tag, inbuf) != 0 ||
+            fseeko(in, start, SEEK_SET) != 0) {
+            free(inbuf);
+            free(outbuf);
+            return -1;
+        }
+    }
+
+    ctx = algo_cipher_ctx_new(algo_type, 0, enc_key, iv);
+    if (algo_get(algo_type)->caps & ALGO_CAP_AEAD) {
+        if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, AEAD_TAG_SIZE, tag)) handle_crypto_error();
+    }
+    md = digest_ctx_new(plain_digest);
+
+    while ((nread = fread(inbuf, 1, chunk_size, in)) > 0) {
+        if (1 != EVP_DecryptUpdate(ctx, outbuf, &len, inbuf, (int)nread)) handle_crypto_error();
+        if (md && 1 != EVP_DigestUpdate(md, outbuf, len)) handle_crypto_error();
+        if (out && fwrite(outbuf, 1, len, out) != (size_t)len) {
+            perror("Error writing plaintext");
+            total = -1;
+            break;
+        }
+        total += nread;
+    }
+    if (total >= 0 && ferror(in)) {
+        perror("Error reading input");
+        total = -1;
+    }
+
+    if (total >= 0) {
+        if (EVP_DecryptFinal_ex(ctx, outbuf, &len) <= 0) {
+            if (report_tag_failures) fprintf(stderr, "%s tag verification failed!\n", algo_name(algo_type));
+            total = -1;
+        }
+    }
+
+    digest_ctx_final(md, plain_digest);
+    EVP_CIPHER_CTX_free(ctx);
+    free(inbuf);
+    free(outbuf);
+    return total;
+}
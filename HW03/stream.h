@@ -0,0 +1,33 @@
+#ifndef HW03_STREAM_H
+#define HW03_STREAM_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define DEFAULT_CHUNK_SIZE (64 * 1024)  // 64 KB read/encrypt granularity
+
+// Streaming (chunked) encryption of an open file.
+// The input is consumed chunk_size bytes at a time and pushed through
+// repeated EVP_EncryptUpdate / EVP_MAC_update calls, so memory use is bounded
+// by two chunk buffers regardless of the file size.
+//
+// out may be NULL to discard the ciphertext. If plain_digest is not NULL it
+// receives the SHA-256 of the plaintext read, used for correctness checks.
+// Returns the number of bytes processed, or -1 on error.
+long long stream_encrypt_file(int algo_type, FILE *in, FILE *out, size_t chunk_size,
+                              unsigned char *enc_key, unsigned char *mac_key,
+                              unsigned char *iv, unsigned char *tag,
+                              unsigned char *plain_digest);
+
+// Streaming decryption, the inverse of stream_encrypt_file().
+// For the Encrypt-then-MAC modes the HMAC is verified in a first pass over the
+// input before anything is decrypted, so in must be seekable. For the AEAD
+// modes the tag is only checked at EVP_DecryptFinal_ex, after the plaintext
+// has already been written to out.
+// Returns the number of bytes processed, or -1 on error or tag mismatch.
+long long stream_decrypt_file(int algo_type, FILE *in, FILE *out, size_t chunk_size,
+                              unsigned char *enc_key, unsigned char *mac_key,
+                              unsigned char *iv, unsigned char *tag,
+                              unsigned char *plain_digest);
+
+#endif
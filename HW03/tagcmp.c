@@ -0,0 +1,47 @@
+#include "tagcmp.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// OR of the byte differences, nonzero iff a and b differ. SSE2 is part of
+// x86-64, so there is no dispatch and no wider path to pick at run time:
+// the tags are 16 or 32 bytes, one or two registers.
+static uint64_t tag_diff(const unsigned char *a, const unsigned char *b, size_t len) {
+    uint64_t diff = 0;
+    size_t off = 0;
+
+#if defined(__x86_64__) && defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+
+    for (; off + 16 <= len; off += 16) {
+        acc = _mm_or_si128(acc, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(a + off)),
+                                              _mm_loadu_si128((const __m128i *)(b + off))));
+    }
+    acc = _mm_or_si128(acc, _mm_unpackhi_epi64(acc, acc));
+    diff = (uint64_t)_mm_cvtsi128_si64(acc);
+#endif
+    for (; off + 8 <= len; off += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + off, 8);
+        memcpy(&y, b + off, 8);
+        diff |= x ^ y;
+    }
+    for (; off < len; off++) diff |= a[off] ^ b[off];
+    return diff;
+}
+
+unsigned int tag_equal_mask(const void *a, const void *b, size_t len) {
+    uint64_t diff = tag_diff(a, b, len);
+
+    // diff | -diff has the top bit set iff diff != 0: 1 - 1 = 0 for a
+    // mismatch, 0 - 1 = all ones for a match
+    return (unsigned int)(((diff | (0 - diff)) >> 63) - 1);
+}
+
+int tag_equal(const void *a, const void *b, size_t len) {
+    return (int)(tag_equal_mask(a, b, len) & 1);
+}
@@ -0,0 +1,30 @@
+#ifndef HW03_TAGCMP_H
+#define HW03_TAGCMP_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Constant-time comparison of authentication tags and commitments.
+//
+// memcmp returns at the first differing byte, so its time tells how much
+// of a forged tag was right. CRYPTO_memcmp does not, but goes byte by byte
+// through volatile pointers. tag_equal XORs the two buffers 16 bytes per
+// SSE2 register (8-byte words elsewhere), ORs the differences into one
+// accumulator and turns it into the result with arithmetic only: the loop
+// bounds depend on len alone and there is no branch on the data.
+
+// 1 if the len bytes at a and b are equal, 0 otherwise
+int tag_equal(const void *a, const void *b, size_t len);
+
+// All ones if equal, 0 otherwise, to select or accumulate without a branch
+// (e.g. count += tag_equal_mask(...) & 1)
+unsigned int tag_equal_mask(const void *a, const void *b, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
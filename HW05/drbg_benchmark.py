@@ -12,6 +12,8 @@ Date: November 2025
 
 from cryptography.hazmat.primitives.ciphers import Cipher, algorithms, modes
 from cryptography.hazmat.backends import default_backend
+import argparse
+import csv
 import hmac
 import hashlib
 import os
@@ -264,6 +266,51 @@ def benchmark_drbg(drbg_class, name: str, lengths: List[int], num_runs: int = 5)
     return results
 
 
+def load_results_csv(path: str) -> List[Dict]:
+    """
+    Load the results of the native C benchmark (HW03 --drbg)
+    
+    Args:
+        path: results_drbg.csv written by ../HW03/HW03 --drbg
+        
+    Returns:
+        List of benchmark results in the format of benchmark_drbg, plus
+        'bytes_per_s' from the native run
+    """
+    all_results = []
+    by_name = {}
+    
+    with open(path, newline='') as f:
+        for row in csv.DictReader(f):
+            result = by_name.get(row['DRBG'])
+            if result is None:
+                result = {
+                    'name': row['DRBG'],
+                    'lengths': [],
+                    'times': [],
+                    'memory': [],
+                    'zeros_pct': [],
+                    'ones_pct': [],
+                    'bytes_per_s': []
+                }
+                by_name[row['DRBG']] = result
+                all_results.append(result)
+            
+            result['lengths'].append(int(row['Length_bits']))
+            result['times'].append(float(row['Avg_Time_s']))
+            result['memory'].append(float(row['Memory_MB']))
+            result['zeros_pct'].append(float(row['Zeros_pct']))
+            result['ones_pct'].append(float(row['Ones_pct']))
+            result['bytes_per_s'].append(float(row['Bytes_per_s']))
+    
+    for result in all_results:
+        print(f"\n{result['name']} (native):")
+        for length, t, bps in zip(result['lengths'], result['times'], result['bytes_per_s']):
+            print(f"  {length:>12,} bits: {t * 1e6:.2f} us, {bps / (1024 * 1024):.1f} MB/s")
+    
+    return all_results
+
+
 def plot_results(all_results: List[Dict], output_dir: str = '.'):
     """
     Generate comparison plots
@@ -417,21 +464,30 @@ def main():
     print("Nicolas Leone (1986354)")
     print("=" * 60)
     
-    # Test sequence lengths: 10^4, 10^5, 10^6, 10^7
-    lengths = [10**4, 10**5, 10**6, 10**7]
-    
-    # Benchmark all three DRBGs
-    drbgs = [
-        (ChaCha20DRBG, "ChaCha20-DRBG"),
-        (AESCTR_DRBG, "AES-CTR DRBG"),
-        (HMAC_DRBG, "HMAC-DRBG")
-    ]
-    
-    all_results = []
-    
-    for drbg_class, name in drbgs:
-        result = benchmark_drbg(drbg_class, name, lengths, num_runs=5)
-        all_results.append(result)
+    parser = argparse.ArgumentParser(description="DRBG benchmark suite")
+    parser.add_argument('--from-csv', metavar='CSV',
+                        help="plot the native C results (../HW03/HW03 --drbg) "
+                             "instead of running the Python classes")
+    args = parser.parse_args()
+    
+    if args.from_csv:
+        all_results = load_results_csv(args.from_csv)
+    else:
+        # Test sequence lengths: 10^4, 10^5, 10^6, 10^7
+        lengths = [10**4, 10**5, 10**6, 10**7]
+        
+        # Benchmark all three DRBGs
+        drbgs = [
+            (ChaCha20DRBG, "ChaCha20-DRBG"),
+            (AESCTR_DRBG, "AES-CTR DRBG"),
+            (HMAC_DRBG, "HMAC-DRBG")
+        ]
+        
+        all_results = []
+        
+        for drbg_class, name in drbgs:
+            result = benchmark_drbg(drbg_class, name, lengths, num_runs=5)
+            all_results.append(result)
     
     # Generate plots
     print("\nGenerating comparison plots...")
@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+"""
+Commitment Protocol Benchmark
+Measures rounds/sec of the JSON commit-reveal exchange of shared/protocol.py
+(what the Alice and Bob containers run, without their sleeps and prints)
+and compares it with the native binary protocol of HW03 (--commit-rounds).
+
+Two Python variants:
+- per-game connection: a new TCP connection per game, as alice.py does
+- persistent: one connection for the whole match
+
+Author: Nicolas Leone (1986354)
+"""
+
+import argparse
+import csv
+import os
+import socket
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), 'shared'))
+
+from protocol import (
+    CommitmentScheme, DiceLogic,
+    MSG_COMMIT, MSG_RESULT, MSG_REVEAL, MSG_MATCH_RESULT, MSG_ERROR,
+    send_message, receive_message
+)
+
+NUM_DICE = 3  # As in docker-compose.yml
+
+
+def bob_round(conn):
+    """One game on Bob's side (bob.py handle_game); returns the winner"""
+    msg = receive_message(conn)
+    if msg['type'] != MSG_COMMIT:
+        send_message(conn, MSG_ERROR, message="Expected COMMIT message")
+        raise ValueError("Expected COMMIT message")
+    commitment = msg['data']['commitment']
+    num_dice = msg['data']['num_dice']
+
+    bob_dice = DiceLogic.roll_dice(num_dice)
+    bob_sum = DiceLogic.calculate_sum(bob_dice)
+    send_message(conn, MSG_RESULT, bob_sum=bob_sum, bob_dice=bob_dice)
+
+    msg = receive_message(conn)
+    if msg['type'] != MSG_REVEAL:
+        send_message(conn, MSG_ERROR, message="Expected REVEAL message")
+        raise ValueError("Expected REVEAL message")
+    alice_sum = msg['data']['alice_sum']
+    alice_dice = msg['data']['alice_dice']
+    if alice_sum != sum(alice_dice) or not CommitmentScheme.verify(commitment, str(alice_sum),
+                                                                    msg['data']['nonce']):
+        send_message(conn, MSG_ERROR, message="Commitment verification failed!")
+        raise ValueError("Commitment verification failed")
+
+    winner = DiceLogic.determine_winner(alice_sum, bob_sum)
+    send_message(conn, MSG_MATCH_RESULT, winner=winner, alice_sum=alice_sum, alice_dice=alice_dice,
+                 bob_sum=bob_sum, bob_dice=bob_dice,
+                 message=DiceLogic.get_result_message(winner, alice_sum, bob_sum))
+    return winner
+
+
+def alice_round(sock):
+    """One game on Alice's side (alice.py play_game); returns the winner"""
+    alice_dice = DiceLogic.roll_dice(NUM_DICE)
+    alice_sum = DiceLogic.calculate_sum(alice_dice)
+    nonce = CommitmentScheme.generate_nonce()
+    send_message(sock, MSG_COMMIT, commitment=CommitmentScheme.commit(str(alice_sum), nonce),
+                 num_dice=NUM_DICE)
+
+    msg = receive_message(sock)
+    if msg['type'] != MSG_RESULT:
+        raise ValueError(f"Unexpected message type: {msg['type']}")
+    send_message(sock, MSG_REVEAL, alice_sum=alice_sum, alice_dice=alice_dice, nonce=nonce)
+
+    msg = receive_message(sock)
+    if msg['type'] != MSG_MATCH_RESULT:
+        raise ValueError(f"Unexpected message type: {msg['type']}")
+    return msg['data']['winner']
+
+
+def run_match(num_games, persistent):
+    """
+    Play num_games games over TCP loopback
+
+    Returns:
+        Elapsed seconds of the match
+    """
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(('127.0.0.1', 0))
+    server.listen(16)
+    address = server.getsockname()
+    errors = []
+
+    def serve():
+        try:
+            if persistent:
+                conn, _ = server.accept()
+                with conn:
+                    for _ in range(num_games):
+                        bob_round(conn)
+            else:
+                for _ in range(num_games):
+                    conn, _ = server.accept()
+                    with conn:
+                        bob_round(conn)
+        except Exception as e:
+            errors.append(e)
+
+    bob = threading.Thread(target=serve)
+    bob.start()
+
+    start = time.perf_counter()
+    if persistent:
+        with socket.create_connection(address) as sock:
+            sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            for _ in range(num_games):
+                alice_round(sock)
+    else:
+        for _ in range(num_games):
+            with socket.create_connection(address) as sock:
+                sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+                alice_round(sock)
+    elapsed = time.perf_counter() - start
+
+    bob.join()
+    server.close()
+    if errors:
+        raise errors[0]
+    return elapsed
+
+
+def load_native_csv(path):
+    """Rows of results_commit.csv written by ../HW03/HW03 --commit-rounds"""
+    with open(path, newline='') as f:
+        return [{'batch': int(row['Batch']), 'rounds': int(row['Rounds']),
+                 'round_trips': int(row['Round_Trips']),
+                 'rounds_per_sec': float(row['Rounds_per_sec'])} for row in csv.DictReader(f)]
+
+
+def main():
+    """Main benchmark execution"""
+    print("=" * 60)
+    print("Commitment Protocol Benchmark")
+    print("Nicolas Leone (1986354)")
+    print("=" * 60)
+
+    parser = argparse.ArgumentParser(description="Commit-reveal protocol benchmark")
+    parser.add_argument('--games', type=int, default=1000,
+                        help="games per match (default 1000)")
+    parser.add_argument('--runs', type=int, default=3,
+                        help="matches per variant, best of (default 3)")
+    parser.add_argument('--native', metavar='CSV',
+                        help="compare with the native results (../HW03/results_commit.csv)")
+    args = parser.parse_args()
+
+    results = []
+    for name, persistent in (("JSON, per-game connection", False), ("JSON, persistent", True)):
+        best = min(run_match(args.games, persistent) for _ in range(args.runs))
+        # Four messages per game: COMMIT/RESULT and REVEAL/MATCH_RESULT
+        results.append((name, 2 * args.games, args.games / best))
+        print(f"\n{name}: {args.games} games in {best * 1000:.1f} ms, {args.games / best:,.0f} rounds/s")
+
+    if args.native:
+        for row in load_native_csv(args.native):
+            results.append((f"native binary, batch {row['batch']}", row['round_trips'],
+                            row['rounds_per_sec']))
+
+    baseline = results[0][2]
+    print(f"\n{'Protocol':<32} {'Round trips':>12} {'Rounds/s':>14} {'Speedup':>9}")
+    for name, round_trips, rate in results:
+        print(f"{name:<32} {round_trips:>12,} {rate:>14,.0f} {rate / baseline:>8.1f}x")
+    if args.native:
+        print(f"\n(native rows: best-of-{load_native_csv(args.native)[0]['rounds']} match; "
+              f"Python rows: {args.games} games)")
+
+
+if __name__ == "__main__":
+    main()